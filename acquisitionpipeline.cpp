@@ -0,0 +1,111 @@
+// Include necessary headers
+#include "acquisitionpipeline.h"
+#include <algorithm>                    // For std::copy_n
+
+// AcquisitionPipeline constructor
+AcquisitionPipeline::AcquisitionPipeline()
+    : nextSequence(0)
+{
+    reset();
+}
+
+// Number, zero-adjust, filter, derive and check one frame
+void AcquisitionPipeline::process(SensorFrame &frame)
+{
+    frame.sequence = nextSequence++;
+
+    // Apply zero offsets
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        frame.zeroed[channel] = frame.raw[channel] - zero[channel];
+    }
+
+    // Follow baseline drift while the channels are unloaded
+    baseline.update(frame, zero);
+
+    // Smoothed force, rate of change and uncertainty
+    estimator.update(frame);
+
+    // User-defined channels see all of the above
+    derived.evaluate(frame);
+
+    // Alarm rules run on every frame so no excursion is missed
+    alarms.evaluate(frame);
+
+    latest = frame;
+}
+
+// Process a block on its columns; drift tracking and the alarm rules go frame by frame
+void AcquisitionPipeline::processBlock(const FrameBlock &input, FrameBlock &output)
+{
+    const int count = input.size();
+    output.resize(count);               // Results are written straight into the reused columns
+    if (count == 0) return;
+
+    std::copy_n(input.timestamps(), count, output.timestamps());
+    quint64 *sequence = output.sequences();
+    for (int index = 0; index < count; ++index) sequence[index] = nextSequence++;
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        std::copy_n(input.raw(channel), count, output.raw(channel));
+    }
+
+    // Without drift tracking the offsets hold for the whole block: one tight loop per channel
+    if (!baseline.settings().enabled) {
+        for (int channel = 0; channel < ChannelCount; ++channel) {
+            const int *raw = output.raw(channel);
+            int *zeroed = output.zeroed(channel);
+            const int offset = zero[channel];
+            for (int index = 0; index < count; ++index) zeroed[index] = raw[index] - offset;
+        }
+    } else {
+        // Drift tracking may move the offsets from one frame to the next
+        const qint64 *timestamps = output.timestamps();
+        const int *raw[ChannelCount];
+        int *zeroed[ChannelCount];
+        for (int channel = 0; channel < ChannelCount; ++channel) {
+            raw[channel] = output.raw(channel);
+            zeroed[channel] = output.zeroed(channel);
+        }
+        for (int index = 0; index < count; ++index) {
+            int values[ChannelCount];
+            for (int channel = 0; channel < ChannelCount; ++channel) {
+                values[channel] = raw[channel][index] - zero[channel];
+                zeroed[channel][index] = values[channel];
+            }
+            baseline.update(timestamps[index], values, zero);
+        }
+    }
+
+    // The filters run down each channel, the expressions over whole columns
+    estimator.update(output);
+    derived.evaluate(output);
+
+    // Alarm rules keep state from frame to frame and see whole frames
+    const FrameBlock &frames = output;
+    for (int index = 0; index < count; ++index) {
+        frames.readFrame(index, latest);
+        alarms.evaluate(latest);
+    }
+}
+
+// Zero all channels at the current reading
+void AcquisitionPipeline::zeroToLatest()
+{
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        zero[channel] = latest.raw[channel];
+        latest.zeroed[channel] = 0;
+    }
+    baseline.reset();                   // Windows so far were measured against the old zero
+}
+
+// Clear zero offsets, filter and alarm state
+void AcquisitionPipeline::reset()
+{
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        zero[channel] = 0;
+    }
+    estimator.reset();
+    alarms.reset();
+    baseline.reset();
+    latest = SensorFrame();
+    nextSequence = 0;
+}
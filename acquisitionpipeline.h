@@ -0,0 +1,50 @@
+#ifndef ACQUISITIONPIPELINE_H
+#define ACQUISITIONPIPELINE_H
+
+#include <QVector>
+#include "sensorframe.h"
+#include "frameblock.h"
+#include "forceestimator.h"
+#include "derivedchannels.h"
+#include "alarmengine.h"
+#include "baselinetracker.h"
+
+// Per-frame processing between the parser and the display/recording:
+// numbering, zeroing (with optional drift tracking), force estimation, derived
+// channels and alarm rules
+class AcquisitionPipeline
+{
+public:
+    AcquisitionPipeline();
+
+    // Process a freshly parsed frame in place
+    void process(SensorFrame &frame);
+
+    // Process a block of freshly parsed frames into output (which is reused
+    // from block to block); gives the same frames as process() one by one
+    void processBlock(const FrameBlock &input, FrameBlock &output);
+
+    // Use the latest raw values as the new zero point
+    void zeroToLatest();
+
+    // Clear zero offsets and all per-stream state (e.g. after reopening the port)
+    void reset();
+
+    const SensorFrame &latestFrame() const { return latest; }
+    const int *zeroOffsets() const { return zero; }
+    ForceEstimator &forceEstimator() { return estimator; }
+    DerivedChannels &derivedChannels() { return derived; }
+    AlarmEngine &alarmEngine() { return alarms; }
+    BaselineTracker &baselineTracker() { return baseline; }
+
+private:
+    int zero[ChannelCount];
+    ForceEstimator estimator;
+    DerivedChannels derived;
+    AlarmEngine alarms;
+    BaselineTracker baseline;
+    SensorFrame latest;
+    quint64 nextSequence;
+};
+
+#endif // ACQUISITIONPIPELINE_H
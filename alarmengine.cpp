@@ -0,0 +1,170 @@
+// Include necessary headers
+#include "alarmengine.h"
+#include "derivedchannels.h"            // For the variable layout shared with derived channels
+
+// AlarmEngine constructor
+AlarmEngine::AlarmEngine()
+{
+    reset();
+}
+
+// Parse rule lines: "name = condition" followed by optional "; option" parts
+bool AlarmEngine::parseRules(const QString &text, QVector<Rule> &rules, QString *errorString)
+{
+    rules.clear();
+    QStringList lines = text.split("\n");
+
+    for (int i = 0; i < lines.size(); ++i) {
+        QString line = lines[i];
+        int comment = line.indexOf('#');
+        if (comment >= 0) line = line.left(comment);
+        line = line.trimmed();
+        if (line.isEmpty()) continue;
+
+        // The first '=' (not part of "==") separates the name from the condition
+        int separator = line.indexOf('=');
+        if (separator <= 0 || (separator + 1 < line.size() && line.at(separator + 1) == '=')) {
+            if (errorString) *errorString = QString("Line %1: expected 'name = condition'").arg(i + 1);
+            return false;
+        }
+
+        QStringList parts = line.mid(separator + 1).split(";");
+        Rule rule;
+        rule.name = line.left(separator).trimmed();
+        rule.condition = parts[0].trimmed();
+
+        // Options after the condition
+        for (int part = 1; part < parts.size(); ++part) {
+            QString option = parts[part].trimmed();
+            bool ok = true;
+            if (option.isEmpty()) {
+                continue;
+            } else if (option == "critical") {
+                rule.severity = SeverityCritical;
+            } else if (option == "warning") {
+                rule.severity = SeverityWarning;
+            } else if (option.startsWith("hold=")) {
+                rule.holdMs = option.mid(5).toInt(&ok);
+                ok = ok && rule.holdMs >= 0;
+            } else if (option.startsWith("pico=")) {
+                rule.picoCommand = option.mid(5).toUtf8();
+            } else {
+                ok = false;
+            }
+
+            if (!ok) {
+                if (errorString) *errorString = QString("Line %1: invalid option '%2'").arg(i + 1).arg(option);
+                return false;
+            }
+        }
+        rules.append(rule);
+    }
+    return true;
+}
+
+// Format rules so that parseRules() reads them back unchanged
+QString AlarmEngine::formatRules(const QVector<Rule> &rules)
+{
+    QStringList lines;
+    for (const Rule &rule : rules) {
+        QString line = rule.name + " = " + rule.condition;
+        if (rule.holdMs > 0) line += QString("; hold=%1").arg(rule.holdMs);
+        if (rule.severity == SeverityCritical) line += "; critical";
+        if (!rule.picoCommand.isEmpty()) line += "; pico=" + QString::fromUtf8(rule.picoCommand);
+        lines << line;
+    }
+    return lines.join("\n");
+}
+
+// Compile a new set of rules
+bool AlarmEngine::setRules(const QVector<Rule> &rules, const QStringList &derivedNames, QString *errorString)
+{
+    if (rules.size() > MaxRules) {
+        if (errorString) *errorString = QString("At most %1 alarm rules are supported").arg(MaxRules);
+        return false;
+    }
+
+    // Same variable layout as DerivedChannels::loadVariables()
+    QStringList variables = DerivedChannels::variableNames() + derivedNames;
+    QVector<ChannelExpression> compiled;
+
+    for (const Rule &rule : rules) {
+        ChannelExpression condition;
+        QString error;
+        if (rule.name.isEmpty() || !condition.compile(rule.condition, variables, &error)) {
+            if (errorString) *errorString = QString("%1: %2").arg(rule.name, error);
+            return false;
+        }
+        compiled.append(condition);
+    }
+
+    defined = rules;
+    conditions = compiled;
+    reset();
+    return true;
+}
+
+// Evaluate every rule against one frame
+void AlarmEngine::evaluate(const SensorFrame &frame)
+{
+    if (conditions.isEmpty()) return;
+
+    double variables[DerivedChannels::MaxVariables];
+    DerivedChannels::loadVariables(frame, variables);
+
+    for (int index = 0; index < conditions.size(); ++index) {
+        const quint32 bit = 1u << index;
+        const bool holds = conditions[index].evaluate(variables) != 0;
+
+        bool changed = false;
+        if (holds) {
+            // Raise once the condition has held for the rule's hold time
+            if (trueSinceNs[index] < 0) trueSinceNs[index] = frame.timestampNs;
+            if (!(active & bit) &&
+                frame.timestampNs - trueSinceNs[index] >= qint64(defined[index].holdMs) * 1000000) {
+                active |= bit;
+                changed = true;
+            }
+        } else {
+            trueSinceNs[index] = -1;
+            if (active & bit) {
+                active &= ~bit;
+                changed = true;
+            }
+        }
+
+        // Queue the transition, dropping the oldest one if nobody collected them
+        if (changed) {
+            if (eventCount == EventCapacity) {
+                eventHead = (eventHead + 1) % EventCapacity;
+                --eventCount;
+            }
+            Event &event = events[(eventHead + eventCount) % EventCapacity];
+            event.rule = index;
+            event.raised = (active & bit) != 0;
+            event.timestampNs = frame.timestampNs;
+            ++eventCount;
+        }
+    }
+}
+
+// Pop the oldest pending transition
+bool AlarmEngine::takeEvent(Event &event)
+{
+    if (eventCount == 0) return false;
+    event = events[eventHead];
+    eventHead = (eventHead + 1) % EventCapacity;
+    --eventCount;
+    return true;
+}
+
+// Clear all alarm state
+void AlarmEngine::reset()
+{
+    for (int index = 0; index < MaxRules; ++index) {
+        trueSinceNs[index] = -1;
+    }
+    active = 0;
+    eventHead = 0;
+    eventCount = 0;
+}
@@ -0,0 +1,78 @@
+#ifndef ALARMENGINE_H
+#define ALARMENGINE_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QVector>
+#include "sensorframe.h"
+#include "channelexpression.h"
+
+// Evaluates operator-defined alarm rules on every frame.
+// A rule is a condition over the same values derived channels can use (plus the
+// derived channels themselves), e.g. "topLeft > 800" or "abs(rateTopLeft) > 2000",
+// that must hold for a minimum time before the alarm is raised. Raise and clear
+// transitions are queued without allocating and collected with takeEvent().
+class AlarmEngine
+{
+public:
+    static const int MaxRules = 32;
+
+    enum Severity {
+        SeverityWarning,                // Shown on screen
+        SeverityCritical                // Shown on screen and sounded
+    };
+
+    struct Rule {
+        QString name;
+        QString condition;
+        int holdMs = 0;                 // Condition must hold this long before raising
+        Severity severity = SeverityWarning;
+        QByteArray picoCommand;         // Sent to the Pico when raised (empty = none)
+    };
+
+    // One raise or clear transition
+    struct Event {
+        int rule = 0;
+        bool raised = false;
+        qint64 timestampNs = 0;         // Timestamp of the frame that caused it
+    };
+
+    AlarmEngine();
+
+    // Convert between Rules and "name = condition; hold=200; critical; pico=0" lines
+    static bool parseRules(const QString &text, QVector<Rule> &rules, QString *errorString = nullptr);
+    static QString formatRules(const QVector<Rule> &rules);
+
+    // Compile rules against the built-ins and the given derived channel names;
+    // on error the current rules are kept
+    bool setRules(const QVector<Rule> &rules, const QStringList &derivedNames, QString *errorString = nullptr);
+    const QVector<Rule> &rules() const { return defined; }
+
+    // Evaluate all rules for one frame
+    void evaluate(const SensorFrame &frame);
+
+    // Bit i is set while rule i is raised
+    quint32 activeMask() const { return active; }
+
+    // Pop the oldest pending transition; returns false if there is none
+    bool takeEvent(Event &event);
+
+    // Clear all alarm state (e.g. after reopening the port)
+    void reset();
+
+private:
+    static const int EventCapacity = 64;
+
+    QVector<Rule> defined;
+    QVector<ChannelExpression> conditions;
+    qint64 trueSinceNs[MaxRules];       // When the condition became true, -1 if false
+    quint32 active;
+
+    // Fixed ring of pending transitions
+    Event events[EventCapacity];
+    int eventHead;
+    int eventCount;
+};
+
+#endif // ALARMENGINE_H
@@ -0,0 +1,224 @@
+// Include necessary headers
+#include "allocationstats.h"
+#include <QStringList>
+
+#ifdef ALLOCATION_STATS
+#include <atomic>                       // For lock-free counters
+#include <cerrno>                       // For posix_memalign's error codes
+#include <cstdlib>                      // For malloc/free
+#include <new>                          // For std::bad_alloc
+
+namespace {
+
+// Each thread gets its own slot so counting never contends with other threads
+const int MaxThreadSlots = 64;
+
+struct ThreadSlot {
+    std::atomic<quint64> allocations[AllocationStats::StageCount];
+    std::atomic<quint64> bytes[AllocationStats::StageCount];
+};
+
+// Static storage is zero-initialized before any allocation can happen
+ThreadSlot threadSlots[MaxThreadSlots];
+std::atomic<int> nextThreadSlot;
+std::atomic<quint64> stageFrames[AllocationStats::StageCount];
+
+// Plain thread-locals so that reading them never allocates
+thread_local int currentSlot = -1;
+thread_local int currentStage = AllocationStats::StageOther;
+
+// Count one allocation against the calling thread's current stage
+inline void countAllocation(size_t size)
+{
+    int slot = currentSlot;
+    if (slot < 0) {
+        // First allocation on this thread; threads past the limit share the last slot
+        slot = qMin(nextThreadSlot.fetch_add(1, std::memory_order_relaxed), MaxThreadSlots - 1);
+        currentSlot = slot;
+    }
+
+    ThreadSlot &counters = threadSlots[slot];
+    counters.allocations[currentStage].fetch_add(1, std::memory_order_relaxed);
+    counters.bytes[currentStage].fetch_add(size, std::memory_order_relaxed);
+}
+
+} // namespace
+
+#if defined(__GLIBC__)
+// On glibc we interpose the C allocator itself, which also catches QString and
+// QByteArray storage (Qt allocates those with malloc, not operator new). The
+// aligned entry points are included because operator new for over-aligned
+// types allocates through them.
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void *__libc_valloc(size_t size);
+void *__libc_pvalloc(size_t size);
+
+void *malloc(size_t size) __THROW
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) __THROW
+{
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) __THROW
+{
+    countAllocation(size);
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) __THROW
+{
+    countAllocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) __THROW
+{
+    countAllocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) __THROW
+{
+    // Same checks as glibc: a power of two and a multiple of the pointer size
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0 || alignment == 0) return EINVAL;
+    countAllocation(size);
+    void *memory = __libc_memalign(alignment, size);
+    if (!memory) return ENOMEM;
+    *ptr = memory;
+    return 0;
+}
+
+void *valloc(size_t size) __THROW
+{
+    countAllocation(size);
+    return __libc_valloc(size);
+}
+
+void *pvalloc(size_t size) __THROW
+{
+    countAllocation(size);
+    return __libc_pvalloc(size);
+}
+}
+#else
+// Elsewhere only C++ allocations can be counted portably, and not those of
+// over-aligned types (operator new with std::align_val_t is left alone)
+void *operator new(size_t size)
+{
+    countAllocation(size);
+    if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    countAllocation(size);
+    if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+#endif
+
+// Mark one frame as handled by a stage
+void AllocationStats::recordFrame(Stage stage)
+{
+    stageFrames[stage].fetch_add(1, std::memory_order_relaxed);
+}
+
+// Switch the calling thread to a new stage and return the previous one
+AllocationStats::Stage AllocationStats::setStage(Stage stage)
+{
+    Stage previous = static_cast<Stage>(currentStage);
+    currentStage = stage;
+    return previous;
+}
+
+bool AllocationStats::enabled()
+{
+    return true;
+}
+
+// Sum the counters of every thread that has allocated so far
+AllocationStats::Snapshot AllocationStats::snapshot()
+{
+    Snapshot result;
+    int usedSlots = qMin(nextThreadSlot.load(std::memory_order_relaxed), MaxThreadSlots);
+
+    for (int slot = 0; slot < usedSlots; ++slot) {
+        for (int stage = 0; stage < StageCount; ++stage) {
+            result.allocations[stage] += threadSlots[slot].allocations[stage].load(std::memory_order_relaxed);
+            result.bytes[stage] += threadSlots[slot].bytes[stage].load(std::memory_order_relaxed);
+        }
+    }
+
+    for (int stage = 0; stage < StageCount; ++stage) {
+        result.frames[stage] = stageFrames[stage].load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+#else
+
+bool AllocationStats::enabled()
+{
+    return false;
+}
+
+AllocationStats::Snapshot AllocationStats::snapshot()
+{
+    return Snapshot();
+}
+
+#endif // ALLOCATION_STATS
+
+// Human readable name of a stage
+const char *AllocationStats::stageName(Stage stage)
+{
+    switch (stage) {
+    case StageParse:   return "parse";
+    case StageDisplay: return "display";
+    case StageRecord:  return "record";
+    default:           return "other";
+    }
+}
+
+// Format allocations and bytes per frame for each tagged stage
+QString AllocationStats::formatReport(const Snapshot &before, const Snapshot &after)
+{
+    if (!enabled()) {
+        return "Allocation counting disabled (configure with -DALLOCATION_STATS=ON)";
+    }
+
+    QStringList lines;
+    for (int stage = StageParse; stage < StageCount; ++stage) {
+        quint64 allocations = after.allocations[stage] - before.allocations[stage];
+        quint64 bytes = after.bytes[stage] - before.bytes[stage];
+        quint64 frames = after.frames[stage] - before.frames[stage];
+
+        // Avoid dividing by zero when the stage was idle
+        if (frames == 0) {
+            lines << QString("%1: idle").arg(stageName(static_cast<Stage>(stage)));
+            continue;
+        }
+
+        lines << QString("%1: %2 allocs/frame, %3 bytes/frame")
+                     .arg(stageName(static_cast<Stage>(stage)))
+                     .arg(double(allocations) / frames, 0, 'f', 2)
+                     .arg(double(bytes) / frames, 0, 'f', 1);
+    }
+    return lines.join("\n");
+}
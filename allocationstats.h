@@ -0,0 +1,60 @@
+#ifndef ALLOCATIONSTATS_H
+#define ALLOCATIONSTATS_H
+
+#include <QtGlobal>
+#include <QString>
+
+// Heap allocation counters for the acquisition hot path.
+// Counting is compiled in only when the project is configured with
+// -DALLOCATION_STATS=ON; otherwise recordFrame() and setStage(), the calls on
+// the hot path, are empty inlines, enabled() is false and snapshots are empty.
+class AllocationStats
+{
+public:
+    // Pipeline stages that allocations are attributed to
+    enum Stage {
+        StageOther = 0,     // Anything outside a tagged scope
+        StageParse,         // Splitting serial data into sensor frames
+        StageDisplay,       // Updating the LCD displays
+        StageRecord,        // Formatting and writing CSV rows
+        StageCount
+    };
+
+    // Totals summed over all threads at one point in time
+    struct Snapshot {
+        quint64 allocations[StageCount] = {};   // Number of allocations
+        quint64 bytes[StageCount] = {};         // Bytes requested
+        quint64 frames[StageCount] = {};        // Frames handled by the stage
+    };
+
+    static bool enabled();
+    static const char *stageName(Stage stage);
+    static Snapshot snapshot();
+
+    // Format per-frame allocation figures for the interval between two snapshots
+    static QString formatReport(const Snapshot &before, const Snapshot &after);
+
+#ifdef ALLOCATION_STATS
+    static void recordFrame(Stage stage);
+    static Stage setStage(Stage stage);
+#else
+    static void recordFrame(Stage) {}
+    static Stage setStage(Stage) { return StageOther; }
+#endif
+};
+
+// Attributes allocations made on this thread to a stage until it goes out of scope
+class AllocationScope
+{
+public:
+    explicit AllocationScope(AllocationStats::Stage stage)
+        : previousStage(AllocationStats::setStage(stage)) {}
+    ~AllocationScope() { AllocationStats::setStage(previousStage); }
+
+private:
+    AllocationStats::Stage previousStage;
+
+    Q_DISABLE_COPY(AllocationScope)
+};
+
+#endif // ALLOCATIONSTATS_H
@@ -0,0 +1,118 @@
+// Include necessary headers
+#include "baselinetracker.h"
+#include <QStringList>
+#include <cmath>                        // For sqrt
+
+// Fewer frames than this in a window say nothing about the noise
+static const int MinWindowFrames = 10;
+
+// Channel names in SensorChannel order, as used by derived channels
+static const char *const ChannelNames[ChannelCount] = { "topLeft", "topRight", "botLeft" };
+
+// BaselineTracker constructor
+BaselineTracker::BaselineTracker()
+    : windowStartNs(0)
+    , windowStarted(false)
+    , hasPending(false)
+{
+}
+
+void BaselineTracker::setSettings(const Settings &settings)
+{
+    current = settings;
+    reset();
+}
+
+// Start over with an empty window
+void BaselineTracker::reset()
+{
+    for (Window &window : windows) window = Window();
+    windowStarted = false;
+    hasPending = false;
+}
+
+// Add one frame to the current window
+void BaselineTracker::update(const SensorFrame &frame, int offsets[ChannelCount])
+{
+    update(frame.timestampNs, frame.zeroed, offsets);
+}
+
+void BaselineTracker::update(qint64 timestampNs, const int zeroed[ChannelCount], int offsets[ChannelCount])
+{
+    if (!current.enabled) return;
+
+    if (!windowStarted) {
+        windowStarted = true;
+        windowStartNs = timestampNs;
+    }
+
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        Window &window = windows[channel];
+        double value = zeroed[channel];
+        if (std::fabs(value) > current.threshold) window.loaded = true;
+        window.count++;
+        window.sum += value;
+        window.sumSquares += value * value;
+    }
+
+    if (timestampNs - windowStartNs >= qint64(current.windowMs * 1e6)) {
+        finishWindow(timestampNs, offsets);
+    }
+}
+
+// Move the offsets of the channels that were quiet for the whole window
+void BaselineTracker::finishWindow(qint64 timestampNs, int offsets[ChannelCount])
+{
+    int previous[ChannelCount];
+    bool changed = false;
+
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        previous[channel] = offsets[channel];
+        const Window &window = windows[channel];
+        if (window.loaded || window.count < MinWindowFrames) continue;
+
+        double mean = window.sum / window.count;
+        double variance = window.sumSquares / window.count - mean * mean;
+        if (std::sqrt(qMax(0.0, variance)) > current.noise) continue;
+
+        // A fraction of the drift per window, but at least one count while it is a count or more
+        int step = qRound(current.gain * mean);
+        if (step == 0 && std::fabs(mean) >= 1) step = mean > 0 ? 1 : -1;
+        if (step == 0) continue;
+
+        offsets[channel] += step;
+        changed = true;
+    }
+
+    if (changed) {
+        // Keep the offsets from before the first change that was not taken yet
+        if (!hasPending) {
+            for (int channel = 0; channel < ChannelCount; ++channel) pending.previous[channel] = previous[channel];
+        }
+        for (int channel = 0; channel < ChannelCount; ++channel) pending.offsets[channel] = offsets[channel];
+        pending.timestampNs = timestampNs;
+        hasPending = true;
+    }
+
+    for (Window &window : windows) window = Window();
+    windowStartNs = timestampNs;
+}
+
+bool BaselineTracker::takeAdjustment(Adjustment &adjustment)
+{
+    if (!hasPending) return false;
+    adjustment = pending;
+    hasPending = false;
+    return true;
+}
+
+// Text logged with every change of the zero offsets
+QString BaselineTracker::describe(const char *reason, const int offsets[ChannelCount])
+{
+    QStringList parts;
+    parts << reason;
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        parts << QString("%1=%2").arg(ChannelNames[channel]).arg(offsets[channel]);
+    }
+    return parts.join(" ");
+}
@@ -0,0 +1,70 @@
+#ifndef BASELINETRACKER_H
+#define BASELINETRACKER_H
+
+#include <QString>
+#include "sensorframe.h"
+
+// Follows slow drift of the load cell baselines (mostly temperature) during
+// long captures. Frames are collected in windows of settings().windowMs; a
+// channel whose zero-adjusted readings stayed within the threshold with little
+// noise for a whole window is taken to be unloaded, and its zero offset is moved
+// a fraction of the way towards the mean of the window. Offsets change in small
+// steps at window boundaries only, never in the middle of a press.
+class BaselineTracker
+{
+public:
+    struct Settings {
+        bool enabled = false;
+        double windowMs = 2000;         // Length of a quiet period before the baseline is trusted
+        double threshold = 20;          // Largest zero-adjusted reading of an unloaded channel (counts)
+        double noise = 3;               // Largest standard deviation of an unloaded channel (counts)
+        double gain = 0.25;             // Fraction of the remaining drift removed per quiet period
+    };
+
+    // Zero offsets before and after one adjustment
+    struct Adjustment {
+        qint64 timestampNs = 0;         // Timestamp of the frame that ended the quiet period
+        int previous[ChannelCount] = {0, 0, 0};
+        int offsets[ChannelCount] = {0, 0, 0};
+    };
+
+    BaselineTracker();
+
+    void setSettings(const Settings &settings);
+    const Settings &settings() const { return current; }
+
+    // Forget the current window and any untaken adjustment (after zeroing, reopening the port, ...)
+    void reset();
+
+    // Watch one zero-adjusted frame; may move the offsets, which then apply from the next frame
+    void update(const SensorFrame &frame, int offsets[ChannelCount]);
+
+    // The same from a frame's timestamp and zero-adjusted values alone
+    void update(qint64 timestampNs, const int zeroed[ChannelCount], int offsets[ChannelCount]);
+
+    // Adjustments not yet logged (the latest one holds all changes since the last call)
+    bool takeAdjustment(Adjustment &adjustment);
+
+    // "reason topLeft=.. topRight=.. botLeft=..", as logged in recordings
+    static QString describe(const char *reason, const int offsets[ChannelCount]);
+
+private:
+    // Statistics of one channel over the current window
+    struct Window {
+        int count = 0;
+        double sum = 0;
+        double sumSquares = 0;
+        bool loaded = false;            // A reading beyond the threshold was seen
+    };
+
+    void finishWindow(qint64 timestampNs, int offsets[ChannelCount]);
+
+    Settings current;
+    Window windows[ChannelCount];
+    qint64 windowStartNs;
+    bool windowStarted;
+    Adjustment pending;
+    bool hasPending;
+};
+
+#endif // BASELINETRACKER_H
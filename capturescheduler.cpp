@@ -0,0 +1,165 @@
+// Include necessary headers
+#include "capturescheduler.h"
+#include <cmath>                        // For ceil
+
+// CaptureScheduler constructor
+CaptureScheduler::CaptureScheduler()
+    : mode(TerminateTicks)
+    , running(false)
+    , paused(false)
+    , expired(false)
+    , durationNs(0)
+    , elapsedNs(0)
+    , pauseStartNs(0)
+    , totalPausedNs(0)
+    , startNs(0)
+    , intervalNs(0)
+    , totalFrames(0)
+    , issuedFrames(0)
+    , lateness(0)
+    , backlog(0)
+{
+}
+
+// Begin a capture of totalFrames ticks, the first one due immediately
+void CaptureScheduler::start(qint64 startNs, double framesPerSecond, qint64 totalFrames)
+{
+    this->startNs = startNs;
+    this->intervalNs = 1e9 / framesPerSecond;
+    this->totalFrames = totalFrames;
+    mode = TerminateTicks;
+    issuedFrames = 0;
+    lateness = 0;
+    backlog = 0;
+    paused = false;
+    expired = false;
+    totalPausedNs = 0;
+    running = totalFrames > 0;
+}
+
+// Begin a capture of exactly totalFrames sensor frames
+void CaptureScheduler::startFrames(qint64 startNs, qint64 totalFrames)
+{
+    start(startNs, 1, totalFrames);
+    mode = TerminateFrames;
+}
+
+// Begin a capture of the sensor frames of the next durationNs
+void CaptureScheduler::startTimed(qint64 startNs, qint64 durationNs)
+{
+    start(startNs, 1, 0);
+    mode = TerminateTime;
+    this->durationNs = durationNs;
+    elapsedNs = 0;
+    running = durationNs > 0;
+}
+
+// Change the tick rate, keeping the end of the capture
+void CaptureScheduler::setRate(qint64 nowNs, double framesPerSecond)
+{
+    if (mode != TerminateTicks || !running || framesPerSecond <= 0) return;
+
+    // The next tick is one new interval from now; the ticks left are the ones
+    // due before the old end (the end itself is not a tick, as at the old rate)
+    qint64 endNs = dueNs(totalFrames);
+    intervalNs = 1e9 / framesPerSecond;
+    startNs = nowNs + qint64(intervalNs) - qint64(issuedFrames * intervalNs);
+    qint64 intervalsLeft = qint64(std::ceil((endNs - nowNs) / intervalNs - 1e-6));
+    totalFrames = issuedFrames + qMax<qint64>(0, intervalsLeft - 1);
+    if (finished()) running = false;
+}
+
+const char *CaptureScheduler::terminationName(Termination termination)
+{
+    switch (termination) {
+    case TerminateFrames: return "frames";
+    case TerminateTime:   return "time";
+    default:              return "ticks";
+    }
+}
+
+void CaptureScheduler::pause(qint64 nowNs)
+{
+    if (!running || paused) return;
+    paused = true;
+    pauseStartNs = nowNs;
+}
+
+// Continue with the next tick, as far from now as it was from the pause
+void CaptureScheduler::resume(qint64 nowNs)
+{
+    if (!paused) return;
+    paused = false;
+    qint64 length = qMax<qint64>(0, nowNs - pauseStartNs);
+    startNs += length;
+    totalPausedNs += length;
+}
+
+qint64 CaptureScheduler::progress() const
+{
+    return mode == TerminateTime ? elapsedNs / 1000000 : issuedFrames;
+}
+
+qint64 CaptureScheduler::progressTotal() const
+{
+    return mode == TerminateTime ? durationNs / 1000000 : totalFrames;
+}
+
+qint64 CaptureScheduler::nextDueNs() const
+{
+    switch (mode) {
+    case TerminateFrames: return -1;
+    case TerminateTime:   return startNs + durationNs;
+    default:              return dueNs(issuedFrames);
+    }
+}
+
+// Count the ticks that are due
+int CaptureScheduler::takeDue(qint64 nowNs)
+{
+    if (!running || paused) return 0;
+
+    // A timed capture ends on the clock even if the frames stop coming
+    if (mode == TerminateTime) {
+        elapsedNs = qBound<qint64>(0, nowNs - startNs, durationNs);
+        if (nowNs >= startNs + durationNs) {
+            lateness = nowNs - (startNs + durationNs);
+            expired = true;
+            running = false;
+        }
+        return 0;
+    }
+    if (mode != TerminateTicks) return 0;
+
+    int due = 0;
+    while (issuedFrames < totalFrames && dueNs(issuedFrames) <= nowNs) {
+        lateness = nowNs - dueNs(issuedFrames);
+        if (due == 0) backlog = lateness;
+        issuedFrames++;
+        due++;
+    }
+    if (finished()) running = false;
+    return due;
+}
+
+// Count a sensor frame if it belongs to the capture
+bool CaptureScheduler::takeFrame(qint64 timestampNs)
+{
+    if (!running || paused || mode == TerminateTicks) return false;
+    if (timestampNs < startNs) return false;    // Arrived before the capture started
+
+    if (mode == TerminateTime) {
+        // The first frame at or after the end is not part of the capture
+        if (timestampNs >= startNs + durationNs) {
+            elapsedNs = durationNs;
+            expired = true;
+            running = false;
+            return false;
+        }
+        elapsedNs = timestampNs - startNs;
+    }
+
+    issuedFrames++;
+    if (mode == TerminateFrames && issuedFrames >= totalFrames) running = false;
+    return true;
+}
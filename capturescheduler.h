@@ -0,0 +1,95 @@
+#ifndef CAPTURESCHEDULER_H
+#define CAPTURESCHEDULER_H
+
+#include <QtGlobal>
+
+// Decides when capture ticks are due. Ticks fall on exact multiples of the
+// frame interval from the start, so rounding the timer to whole milliseconds
+// never changes the capture rate, and a late tick is caught up rather than lost.
+// Time comes from the caller, so the same schedule runs on real or virtual time.
+// A pause shifts the rest of the schedule by its length, so tick numbering and
+// spacing carry on as if the pause had not happened.
+//
+// Instead of ticks, a capture may also be driven by the sensor frames: every
+// frame is recorded until an exact number of frames was taken, or until an
+// exact time on the frame clock has passed.
+class CaptureScheduler
+{
+public:
+    // What ends the capture (and what the progress counts)
+    enum Termination {
+        TerminateTicks = 0,             // totalFrames ticks at framesPerSecond
+        TerminateFrames,                // totalFrames sensor frames
+        TerminateTime                   // durationNs of sensor frames
+    };
+
+    CaptureScheduler();
+
+    void start(qint64 startNs, double framesPerSecond, qint64 totalFrames);
+    void startFrames(qint64 startNs, qint64 totalFrames);
+    void startTimed(qint64 startNs, qint64 durationNs);
+    void stop() { running = false; paused = false; }
+
+    Termination termination() const { return mode; }
+    static const char *terminationName(Termination termination);
+
+    // Tick at a new rate from now on; the capture still ends when it would have
+    void setRate(qint64 nowNs, double framesPerSecond);
+
+    // Hold the schedule; no ticks are due until resume()
+    void pause(qint64 nowNs);
+    void resume(qint64 nowNs);
+
+    bool isRunning() const { return running; }
+    bool isPaused() const { return paused; }
+    qint64 pausedNs() const { return totalPausedNs; }   // Total length of all pauses so far
+    bool finished() const { return mode == TerminateTime ? expired : issuedFrames >= totalFrames; }
+    qint64 issued() const { return issuedFrames; }
+    qint64 total() const { return totalFrames; }
+
+    // Progress in ticks, frames or elapsed milliseconds, and where it ends
+    qint64 progress() const;
+    qint64 progressTotal() const;
+
+    // When the timer should look again: the next tick, or the end of a timed
+    // capture (-1 when only frames can end the capture)
+    qint64 nextDueNs() const;
+
+    // When tick number tick (counting from 0) was due; caught-up ticks are
+    // recorded at these times rather than at the time they were taken
+    qint64 tickDueNs(qint64 tick) const { return dueNs(tick); }
+
+    // Ticks due by nowNs, which are counted as issued (0 if not running or
+    // paused); ends a timed capture whose time is up
+    int takeDue(qint64 nowNs);
+
+    // Whether a sensor frame stamped timestampNs is part of a frame-driven
+    // capture; it is counted if so, and may end the capture
+    bool takeFrame(qint64 timestampNs);
+
+    // How late the most recent tick was taken
+    qint64 lastLatenessNs() const { return lateness; }
+
+    // How late the oldest tick of the last takeDue() was (the backlog it caught up)
+    qint64 backlogNs() const { return backlog; }
+
+private:
+    qint64 dueNs(qint64 frame) const { return startNs + qint64(frame * intervalNs); }
+
+    Termination mode;
+    bool running;
+    bool paused;
+    bool expired;                       // A timed capture reached its end
+    qint64 durationNs;
+    qint64 elapsedNs;                   // Of a timed capture, as far as seen
+    qint64 pauseStartNs;
+    qint64 totalPausedNs;
+    qint64 startNs;
+    double intervalNs;
+    qint64 totalFrames;
+    qint64 issuedFrames;
+    qint64 lateness;
+    qint64 backlog;
+};
+
+#endif // CAPTURESCHEDULER_H
@@ -0,0 +1,336 @@
+// Include necessary headers
+#include "capturesession.h"
+#include "derivedchannels.h"            // For the variable layout shared with alarm rules
+#include "triggersequence.h"            // For the escapes of Pico commands
+#include <QHash>                        // For resolving labels
+
+// CaptureSession constructor
+CaptureSession::CaptureSession()
+    : running(false)
+    , current(0)
+    , waiting(WaitNone)
+    , satisfied(false)
+    , deadline(-1)
+    , stepStartNs(0)
+    , startNs(0)
+    , replyId(-1)
+    , captures(0)
+{
+}
+
+// Parse and compile a session
+bool CaptureSession::compile(const QString &source, const QStringList &derivedNames, QString *errorString)
+{
+    QVector<Step> compiled;
+    QVector<ChannelExpression> compiledConditions;
+    QHash<QString, int> labels;         // Label -> index of the step after it
+    QVector<QString> targets;           // Label each jumping step refers to
+    QStringList variables = DerivedChannels::variableNames() + derivedNames;
+
+    const QStringList lines = source.split("\n");
+    for (int i = 0; i < lines.size(); ++i) {
+        QString line = lines[i];
+        int comment = line.indexOf('#');
+        if (comment >= 0) line = line.left(comment);
+        line = line.trimmed();
+        if (line.isEmpty()) continue;
+
+        auto fail = [&](const QString &message) {
+            if (errorString) *errorString = QString("Line %1: %2").arg(i + 1).arg(message);
+            return false;
+        };
+
+        // A label names the next step
+        if (line.endsWith(':')) {
+            QString label = line.left(line.size() - 1).trimmed();
+            if (label.isEmpty() || label.contains(' ')) return fail("invalid label");
+            if (labels.contains(label)) return fail("label '" + label + "' is defined twice");
+            labels.insert(label, compiled.size());
+            continue;
+        }
+
+        int space = line.indexOf(' ');
+        QString keyword = space < 0 ? line : line.left(space);
+        QString argument = space < 0 ? QString() : line.mid(space + 1).trimmed();
+        QStringList words = argument.simplified().split(" ");
+
+        Step step;
+        step.line = i + 1;
+        step.source = line.simplified();
+        QString target;
+        bool ok = true;
+
+        if (keyword == "wait") {
+            step.op = OpWait;
+            double ms = argument.toDouble(&ok);
+            if (!ok || ms < 0) return fail("invalid wait '" + argument + "'");
+            step.waitNs = qint64(ms * 1e6);
+        } else if (keyword == "until") {
+            step.op = OpUntil;
+            QString condition = argument;
+            int within = argument.lastIndexOf(" within ");
+            if (within >= 0) {
+                double ms = argument.mid(within + 8).trimmed().toDouble(&ok);
+                if (!ok || ms <= 0) return fail("invalid timeout in '" + argument + "'");
+                step.waitNs = qint64(ms * 1e6);
+                condition = argument.left(within).trimmed();
+            }
+            if (condition.isEmpty()) return fail("expected 'until <condition> [within <ms>]'");
+            ChannelExpression expression;
+            QString error;
+            if (!expression.compile(condition, variables, &error)) return fail(error);
+            step.condition = compiledConditions.size();
+            compiledConditions.append(expression);
+        } else if (keyword == "zero" && argument.isEmpty()) {
+            step.op = OpZero;
+        } else if (keyword == "capture") {
+            step.op = OpCapture;
+            if (!argument.isEmpty()) {
+                if (words.size() == 2 && words[1] == "s") {
+                    step.seconds = words[0].toDouble(&ok);
+                    if (!ok || step.seconds <= 0) return fail("invalid capture length '" + words[0] + "'");
+                } else if (words.size() == 2 && words[1] == "frames") {
+                    step.frames = words[0].toLongLong(&ok);
+                    if (!ok || step.frames <= 0) return fail("invalid frame count '" + words[0] + "'");
+                } else {
+                    return fail("expected 'capture', 'capture <seconds> s' or 'capture <n> frames'");
+                }
+            }
+        } else if (keyword == "sensor") {
+            step.op = OpSensor;
+            if (argument.isEmpty()) return fail("expected 'sensor <command>'");
+            step.command = argument.toUtf8();
+        } else if (keyword == "send") {
+            step.op = OpSend;
+            if (!TriggerSequence::unescape(argument, step.command)) return fail("invalid command '" + argument + "'");
+        } else if (keyword == "marker") {
+            step.op = OpMarker;
+            step.text = argument;
+        } else if (keyword == "log") {
+            step.op = OpLog;
+            if (argument.isEmpty()) return fail("expected 'log <text>'");
+            step.text = argument;
+        } else if (keyword == "repeat") {
+            step.op = OpRepeat;
+            if (words.size() == 2) step.times = words[1].toInt(&ok);
+            if (words.size() != 2 || !ok || step.times < 0) return fail("expected 'repeat <label> <times>'");
+            target = words[0];
+        } else if (keyword == "goto") {
+            step.op = OpJump;
+            if (words.size() != 1 || words[0].isEmpty()) return fail("expected 'goto <label>'");
+            target = words[0];
+        } else if (keyword == "stop" && argument.isEmpty()) {
+            step.op = OpStop;
+        } else {
+            return fail("unknown step '" + keyword + "'");
+        }
+
+        compiled.append(step);
+        targets.append(target);
+    }
+
+    // Resolve the labels now that all of them are known
+    for (int index = 0; index < compiled.size(); ++index) {
+        if (targets[index].isEmpty()) continue;
+        if (!labels.contains(targets[index])) {
+            if (errorString) *errorString = QString("Line %1: unknown label '%2'")
+                                                .arg(compiled[index].line).arg(targets[index]);
+            return false;
+        }
+        compiled[index].target = labels.value(targets[index]);
+    }
+
+    // Falling off the end stops the session
+    Step end;
+    end.op = OpStop;
+    end.line = lines.size();
+    end.source = "end";
+    compiled.append(end);
+
+    text = source;
+    steps = compiled;
+    conditions = compiledConditions;
+    running = false;
+    waiting = WaitNone;
+    return true;
+}
+
+// Start from the first step
+void CaptureSession::start(qint64 nowNs)
+{
+    running = isValid();
+    current = 0;
+    waiting = WaitNone;
+    satisfied = false;
+    deadline = -1;
+    stepStartNs = nowNs;
+    startNs = nowNs;
+    replyId = -1;
+    remaining.fill(-1, steps.size());
+    captures = 0;
+    error.clear();
+}
+
+// End the session with an error
+bool CaptureSession::fail(const QString &message)
+{
+    error = QString("Line %1: %2").arg(steps[current].line).arg(message);
+    running = false;
+    waiting = WaitNone;
+    return false;
+}
+
+// Resume after the step waited on, then run steps until one has to wait
+bool CaptureSession::advance(qint64 nowNs, QVector<Action> &actions)
+{
+    actions.clear();
+    if (!running) return false;
+
+    if (waiting != WaitNone) {
+        if (!satisfied && deadline >= 0 && nowNs >= deadline) {
+            if (waiting != WaitTime) return fail("'" + steps[current].source + "' timed out");
+            satisfied = true;
+        }
+        if (!satisfied) return true;
+        waiting = WaitNone;
+        deadline = -1;
+        current++;
+    }
+
+    // Start waiting for an event, at most until the deadline (-1 for none)
+    auto waitFor = [&](Wait wait, qint64 until) {
+        waiting = wait;
+        satisfied = false;
+        deadline = until;
+        stepStartNs = nowNs;
+        return true;
+    };
+
+    int stepsRun = 0;
+    while (true) {
+        if (++stepsRun > MaxStepsWithoutWait) return fail("the session loops without waiting");
+
+        const Step &step = steps[current];
+        Action action;
+        switch (step.op) {
+        case OpWait:
+            if (step.waitNs > 0) return waitFor(WaitTime, nowNs + step.waitNs);
+            current++;
+            break;
+
+        case OpUntil:
+            return waitFor(WaitCondition, step.waitNs > 0 ? nowNs + step.waitNs : -1);
+
+        case OpZero:
+            action.type = Action::Zero;
+            actions.append(action);
+            current++;
+            break;
+
+        case OpCapture:
+            action.type = Action::Capture;
+            action.seconds = step.seconds;
+            action.frames = step.frames;
+            actions.append(action);
+            captures++;
+            return waitFor(WaitCapture, -1);
+
+        case OpSensor:
+            // The board's answer or the command's own timeout ends the wait
+            action.type = Action::SensorCommand;
+            action.command = step.command;
+            actions.append(action);
+            replyId = -1;
+            return waitFor(WaitReply, -1);
+
+        case OpSend:
+            action.type = Action::Pico;
+            action.command = step.command;
+            actions.append(action);
+            current++;
+            break;
+
+        case OpMarker:
+            return waitFor(WaitMarker, -1);
+
+        case OpLog:
+            action.type = Action::Log;
+            action.text = step.text;
+            actions.append(action);
+            current++;
+            break;
+
+        case OpRepeat: {
+            // The counter starts when the repeat is first reached and is rearmed once it runs out
+            int &left = remaining[current];
+            if (left < 0) left = step.times;
+            if (left > 0) {
+                left--;
+                current = step.target;
+            } else {
+                left = -1;
+                current++;
+            }
+            break;
+        }
+
+        case OpJump:
+            current = step.target;
+            break;
+
+        case OpStop:
+            running = false;
+            return false;
+        }
+    }
+}
+
+// Check a processed frame against the condition waited for
+bool CaptureSession::frameArrived(const SensorFrame &frame)
+{
+    if (!waitsForFrames() || satisfied) return false;
+
+    double variables[DerivedChannels::MaxVariables];
+    DerivedChannels::loadVariables(frame, variables);
+    satisfied = conditions[steps[current].condition].evaluate(variables) != 0;
+    return satisfied;
+}
+
+bool CaptureSession::captureFinished()
+{
+    if (!running || waiting != WaitCapture || satisfied) return false;
+    satisfied = true;
+    return true;
+}
+
+// A sensor command finished; only the answer to the session's own command counts
+bool CaptureSession::replyReceived(int id, bool ok, const QString &text)
+{
+    if (!running || waiting != WaitReply || satisfied || id != replyId) return false;
+    if (!ok) {
+        fail(QString("'%1' failed: %2").arg(steps[current].source, text));
+        return true;
+    }
+    satisfied = true;
+    return true;
+}
+
+bool CaptureSession::markerPlaced(const QString &label)
+{
+    if (!running || waiting != WaitMarker || satisfied) return false;
+    const QString &wanted = steps[current].text;
+    if (!wanted.isEmpty() && label != wanted) return false;
+    satisfied = true;
+    return true;
+}
+
+// Progress line for the status bar and the statistics panel
+QString CaptureSession::status(qint64 nowNs) const
+{
+    if (!running) return error.isEmpty() ? QString("Session: stopped") : "Session failed: " + error;
+
+    const Step &step = steps[current];
+    QString text = QString("Session: line %1 '%2'").arg(step.line).arg(step.source);
+    if (waiting != WaitNone) text += QString(" for %1 s").arg((nowNs - stepStartNs) / 1e9, 0, 'f', 1);
+    return text + QString(", %1 captures in %2 s").arg(captures).arg((nowNs - startNs) / 1e9, 0, 'f', 1);
+}
@@ -0,0 +1,126 @@
+#ifndef CAPTURESESSION_H
+#define CAPTURESESSION_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "sensorframe.h"
+#include "channelexpression.h"
+
+// A capture session protocol, written one step per line like a trigger
+// sequence ('#' starts a comment). Unlike a trigger sequence, steps can wait
+// for things other than time:
+//
+//   name:                         label that steps can jump to
+//   wait <ms>                     dwell before the next step
+//   until <condition> [within <ms>]  wait for a frame meeting the condition (same
+//                                 values as alarm rules); fails if it takes longer
+//   zero                          zero the load cells at the latest frame
+//   capture                       record a capture with the main window's settings
+//   capture <seconds> s           record every frame for the given time
+//   capture <n> frames            record the next n frames
+//   sensor <command>              send a command to the sensor board and wait for its answer
+//   send <command>                send a command to the Pico (escapes as in trigger sequences)
+//   marker [label]                wait for the operator to place a marker (with that label)
+//   log <text>                    write an event into the running capture
+//   repeat <label> <times>        jump back to the label, <times> more times
+//   goto <label>
+//   stop                          end the session (also at the end of the text)
+//
+// A session is a resumable procedure: advance() runs the steps until one has
+// to wait, hands out what the main window should do, and returns. The main
+// window reports the events (frames, the end of a capture, sensor answers,
+// markers) and advances the session again once the step it waits for is
+// satisfied, so a session needs no thread and no timer per step. A capture
+// step waits for the capture to end, whether by itself or by the Stop button.
+class CaptureSession
+{
+public:
+    // Steps run in a row without waiting before a loop is taken to be missing a wait
+    static const int MaxStepsWithoutWait = 10000;
+
+    // What a step asks the main window to do
+    struct Action {
+        enum Type { Zero, Capture, SensorCommand, Pico, Log };
+
+        Type type = Log;
+        double seconds = 0;             // Capture: timed capture of this length, or
+        qint64 frames = 0;              // frame-driven capture of this many frames (both 0: the main window's settings)
+        QByteArray command;             // SensorCommand and Pico
+        QString text;                   // Log
+    };
+
+    // What the session is waiting for
+    enum Wait { WaitNone, WaitTime, WaitCondition, WaitCapture, WaitReply, WaitMarker };
+
+    CaptureSession();
+
+    // Parse and compile; conditions may use the built-ins and the given derived channels
+    bool compile(const QString &text, const QStringList &derivedNames, QString *errorString = nullptr);
+    bool isValid() const { return !steps.isEmpty(); }
+    QString source() const { return text; }
+
+    void start(qint64 nowNs);
+    void cancel() { running = false; waiting = WaitNone; }
+    bool isRunning() const { return running; }
+
+    // Run the steps until one has to wait; what to do is put in actions.
+    // Returns false if the session ended (normally or with an error).
+    bool advance(qint64 nowNs, QVector<Action> &actions);
+
+    // When the wait or timeout of the current step runs out, -1 if it has none
+    qint64 deadlineNs() const { return running ? deadline : -1; }
+
+    // Events; each returns true when it satisfied the step waiting for it,
+    // i.e. when the session should be advanced
+    bool waitsForFrames() const { return running && waiting == WaitCondition; }
+    bool frameArrived(const SensorFrame &frame);
+    bool captureFinished();
+    void expectReply(int id) { replyId = id; }
+    bool replyReceived(int id, bool ok, const QString &text);
+    bool markerPlaced(const QString &label);
+
+    // Progress: the step being waited on, how long it has waited and the captures so far
+    QString status(qint64 nowNs) const;
+    int capturesStarted() const { return captures; }
+
+    QString errorString() const { return error; }
+
+private:
+    enum Op { OpWait, OpUntil, OpZero, OpCapture, OpSensor, OpSend, OpMarker, OpLog, OpRepeat, OpJump, OpStop };
+
+    struct Step {
+        Op op = OpStop;
+        qint64 waitNs = 0;              // OpWait, and OpUntil's timeout (0 for none)
+        int condition = -1;             // OpUntil: index into conditions
+        double seconds = 0;             // OpCapture
+        qint64 frames = 0;              // OpCapture
+        QByteArray command;             // OpSensor and OpSend
+        QString text;                   // OpMarker label, OpLog text
+        int target = 0;                 // OpRepeat and OpJump
+        int times = 0;                  // OpRepeat
+        int line = 0;                   // Source line, for errors and progress
+        QString source;                 // The step as written, for progress
+    };
+
+    bool fail(const QString &message);
+
+    QString text;
+    QVector<Step> steps;
+    QVector<ChannelExpression> conditions;
+
+    bool running;
+    int current;                        // Step being run or waited on
+    Wait waiting;
+    bool satisfied;                     // The awaited event has happened
+    qint64 deadline;
+    qint64 stepStartNs;
+    qint64 startNs;
+    int replyId;
+    QVector<int> remaining;             // Repeats left per step, -1 when not counting
+    int captures;
+    QString error;
+};
+
+#endif // CAPTURESESSION_H
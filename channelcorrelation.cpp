@@ -0,0 +1,549 @@
+// Include necessary headers
+#include "channelcorrelation.h"
+#include "taskexecutor.h"               // For analyzing live windows off the GUI thread
+#include <QElapsedTimer>                // For timing the offline analysis
+#include <QFile>                        // For mapping the recording
+#include <QSaveFile>                    // For atomic output writes
+#include <algorithm>                    // For std::nth_element
+#include <cmath>                        // For cos, floor, sqrt
+#include <complex>
+#include <cstring>                      // For memchr
+#include <vector>
+
+namespace {
+
+typedef std::complex<double> Complex;
+
+const double Pi = 3.14159265358979323846;
+
+// Half the length of the fractional-delay filter
+const int DelayHalfTaps = 8;
+
+// Output is written in pieces of about this size
+const int FlushBytes = 1024 * 1024;
+
+// Columns every recording starts with: zero-adjusted, then raw values
+const int ChannelColumns = 2 * ChannelCount;
+
+// Smallest power of two not below n
+int powerOfTwo(int n)
+{
+    int size = 1;
+    while (size < n) size <<= 1;
+    return size;
+}
+
+// In-place radix-2 FFT; the size must be a power of two
+void fft(std::vector<Complex> &data, bool inverse)
+{
+    const size_t n = data.size();
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(data[i], data[j]);
+    }
+
+    for (size_t length = 2; length <= n; length <<= 1) {
+        double angle = (inverse ? 2 : -2) * Pi / double(length);
+        Complex step(std::cos(angle), std::sin(angle));
+        for (size_t start = 0; start < n; start += length) {
+            Complex twiddle(1);
+            for (size_t k = 0; k < length / 2; ++k) {
+                Complex even = data[start + k];
+                Complex odd = data[start + k + length / 2] * twiddle;
+                data[start + k] = even + odd;
+                data[start + k + length / 2] = even - odd;
+                twiddle *= step;
+            }
+        }
+    }
+
+    if (inverse) {
+        for (Complex &value : data) value /= double(n);
+    }
+}
+
+// Cross-correlation sum(a[i] * b[i + lag]) for lags -maxLag..maxLag, at correlation[maxLag + lag];
+// each sum is scaled up for the samples it misses, or longer lags would look weaker and pull the peak towards zero
+void crossCorrelate(const std::vector<double> &a, const std::vector<double> &b, int maxLag,
+                    std::vector<double> &correlation)
+{
+    const int length = int(a.size());
+    const int padded = powerOfTwo(2 * length);
+    correlation.assign(size_t(2 * maxLag + 1), 0.0);
+
+    // Direct sums cost a multiply per sample and lag, the FFTs about 3 N log2 N each way
+    int log2Padded = 0;
+    while ((1 << log2Padded) < padded) ++log2Padded;
+    if (qint64(2 * maxLag + 1) * length <= qint64(6) * padded * log2Padded) {
+        for (int lag = -maxLag; lag <= maxLag; ++lag) {
+            double sum = 0;
+            for (int i = qMax(0, -lag); i < qMin(length, length - lag); ++i) sum += a[size_t(i)] * b[size_t(i + lag)];
+            correlation[size_t(maxLag + lag)] = sum * length / (length - qAbs(lag));
+        }
+        return;
+    }
+
+    // Long windows: conj(A) * B transformed back; negative lags wrap to the end
+    std::vector<Complex> spectrumA(padded), spectrumB(padded);
+    for (int i = 0; i < length; ++i) {
+        spectrumA[size_t(i)] = a[size_t(i)];
+        spectrumB[size_t(i)] = b[size_t(i)];
+    }
+    fft(spectrumA, false);
+    fft(spectrumB, false);
+    for (int i = 0; i < padded; ++i) spectrumA[size_t(i)] = std::conj(spectrumA[size_t(i)]) * spectrumB[size_t(i)];
+    fft(spectrumA, true);
+    for (int lag = -maxLag; lag <= maxLag; ++lag) {
+        correlation[size_t(maxLag + lag)] = spectrumA[size_t(lag >= 0 ? lag : padded + lag)].real()
+                                            * length / (length - qAbs(lag));
+    }
+}
+
+// Welch estimate (Hann segments overlapping by half) of the cross spectrum from bin 1 up to bandHz.
+// Gives the magnitude-squared coherence, averaged with the cross power as weight so that bins
+// without movement do not dilute it, and the lag left over after wholeLag samples: a lag of
+// tau samples turns the phase of bin f (in cycles per sample) by -2 pi f tau, fitted by weighted least squares.
+void crossSpectrum(const std::vector<double> &a, const std::vector<double> &b, double sampleRateHz, double bandHz,
+                   int wholeLag, double &coherence, double &residualLag)
+{
+    coherence = 0;
+    residualLag = 0;
+    const int length = int(a.size());
+    int segment = 16;
+    while (segment * 8 <= length) segment <<= 1;     // At least 7 segments once the window allows
+    if (segment > length) return;
+
+    std::vector<double> window(segment);
+    for (int i = 0; i < segment; ++i) window[size_t(i)] = 0.5 - 0.5 * std::cos(2 * Pi * i / segment);
+
+    const int bins = qBound(1, int(bandHz * segment / sampleRateHz), segment / 2);
+    std::vector<double> powerA(bins + 1, 0.0), powerB(bins + 1, 0.0);
+    std::vector<Complex> cross(bins + 1);
+    std::vector<Complex> spectrumA(segment), spectrumB(segment);
+
+    for (int start = 0; start + segment <= length; start += segment / 2) {
+        for (int i = 0; i < segment; ++i) {
+            spectrumA[size_t(i)] = a[size_t(start + i)] * window[size_t(i)];
+            spectrumB[size_t(i)] = b[size_t(start + i)] * window[size_t(i)];
+        }
+        fft(spectrumA, false);
+        fft(spectrumB, false);
+        for (int bin = 1; bin <= bins; ++bin) {
+            powerA[size_t(bin)] += std::norm(spectrumA[size_t(bin)]);
+            powerB[size_t(bin)] += std::norm(spectrumB[size_t(bin)]);
+            cross[size_t(bin)] += std::conj(spectrumA[size_t(bin)]) * spectrumB[size_t(bin)];
+        }
+    }
+
+    double sum = 0, weights = 0, phaseSum = 0, frequencySum = 0;
+    for (int bin = 1; bin <= bins; ++bin) {
+        double power = powerA[size_t(bin)] * powerB[size_t(bin)];
+        if (power <= 0) continue;
+        double weight = std::abs(cross[size_t(bin)]);
+        double binCoherence = std::norm(cross[size_t(bin)]) / power;
+        sum += weight * binCoherence;
+        weights += weight;
+
+        // Undo the whole samples first so that the phase stays within half a turn
+        double frequency = double(bin) / segment;
+        double phase = std::arg(cross[size_t(bin)] * std::polar(1.0, 2 * Pi * frequency * wholeLag));
+        phaseSum += weight * binCoherence * frequency * phase;
+        frequencySum += weight * binCoherence * frequency * frequency;
+    }
+    if (weights > 0) coherence = sum / weights;
+    if (frequencySum > 0) residualLag = -phaseSum / (2 * Pi * frequencySum);
+}
+
+// Median of a list (reordered)
+double median(std::vector<double> &values)
+{
+    size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + long(middle), values.end());
+    double value = values[middle];
+    if (values.size() % 2 == 0) value = (value + *std::max_element(values.begin(), values.begin() + long(middle))) / 2;
+    return value;
+}
+
+} // namespace
+
+// ChannelCorrelation constructor
+ChannelCorrelation::ChannelCorrelation()
+    : analysis(std::make_shared<Analysis>())
+{
+    reset();
+}
+
+void ChannelCorrelation::setSettings(const Settings &settings)
+{
+    bool resize = settings.windowSamples != current.windowSamples;
+    current = settings;
+    if (resize) reset();
+}
+
+const char *ChannelCorrelation::pairName(Pair pair)
+{
+    switch (pair) {
+    case PairTopLeftTopRight: return "Top Left/Top Right";
+    case PairTopLeftBotLeft:  return "Top Left/Bottom Left";
+    default:                  return "Top Right/Bottom Left";
+    }
+}
+
+void ChannelCorrelation::pairChannels(Pair pair, int &first, int &second)
+{
+    switch (pair) {
+    case PairTopLeftTopRight: first = ChannelTopLeft; second = ChannelTopRight; break;
+    case PairTopLeftBotLeft:  first = ChannelTopLeft; second = ChannelBotLeft; break;
+    default:                  first = ChannelTopRight; second = ChannelBotLeft; break;
+    }
+}
+
+// Add one frame to the window; every half window, queue it for analysis
+bool ChannelCorrelation::addFrame(const SensorFrame &frame)
+{
+    const int window = current.windowSamples;
+    for (int channel = 0; channel < ChannelCount; ++channel) history[channel][next] = frame.zeroed[channel];
+    timestamps[next] = frame.timestampNs;
+    next = (next + 1) % window;
+    if (filled < window) filled++;
+    if (filled < window || ++sinceAnalysis < window / 2) return false;
+    sinceAnalysis = 0;
+
+    // The oldest frame is at next; the rate comes from the window's own timestamps
+    qint64 spanNs = timestamps[(next + window - 1) % window] - timestamps[next];
+    if (spanNs <= 0) return false;
+    double sampleRateHz = (window - 1) * 1e9 / spanNs;
+
+    int generation;
+    {
+        QMutexLocker locker(&analysis->mutex);
+        if (analysis->busy) {
+            analysis->skipped++;
+            return false;
+        }
+        analysis->busy = true;
+        generation = analysis->generation;
+    }
+
+    // Copy the window out of the rings so the frames can go on arriving
+    auto series = std::make_shared<std::vector<double>>(size_t(ChannelCount) * size_t(window));
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        double *column = series->data() + size_t(channel) * size_t(window);
+        for (int i = 0; i < window; ++i) column[i] = history[channel][(next + i) % window];
+    }
+
+    std::shared_ptr<Analysis> shared = analysis;
+    Settings settings = current;
+    TaskExecutor::shared().submit("channel lag", TaskExecutor::PriorityCritical,
+                                  [shared, series, settings, window, sampleRateHz, generation]() {
+        Result results[PairCount];
+        for (int pair = 0; pair < PairCount; ++pair) {
+            int first, second;
+            pairChannels(Pair(pair), first, second);
+            results[pair] = analyze(series->data() + size_t(first) * size_t(window),
+                                    series->data() + size_t(second) * size_t(window),
+                                    window, sampleRateHz, settings);
+        }
+
+        QMutexLocker locker(&shared->mutex);
+        shared->busy = false;
+        if (shared->generation != generation) return;
+        for (int pair = 0; pair < PairCount; ++pair) shared->results[pair] = results[pair];
+    });
+    return true;
+}
+
+ChannelCorrelation::Result ChannelCorrelation::result(Pair pair) const
+{
+    QMutexLocker locker(&analysis->mutex);
+    return analysis->results[pair];
+}
+
+// Lags for the statistics panel
+QString ChannelCorrelation::statistics() const
+{
+    Result results[PairCount];
+    int skipped;
+    {
+        QMutexLocker locker(&analysis->mutex);
+        for (int pair = 0; pair < PairCount; ++pair) results[pair] = analysis->results[pair];
+        skipped = analysis->skipped;
+    }
+    if (!results[0].valid) return QString("Channel lag: collecting %1 samples").arg(current.windowSamples);
+
+    QString text = QString("Channel lag (%1 samples):").arg(current.windowSamples);
+    for (int pair = 0; pair < PairCount; ++pair) {
+        const Result &result = results[pair];
+        text += QString("\n  %1 %2 samples (%3 ms), r %4, coherence %5")
+                    .arg(pairName(Pair(pair)))
+                    .arg(result.lagSamples, 0, 'f', 3)
+                    .arg(result.lagMs, 0, 'f', 3)
+                    .arg(result.peak, 0, 'f', 3)
+                    .arg(result.coherence, 0, 'f', 2);
+    }
+    if (skipped > 0) text += QString("\n  %1 windows skipped while the previous one was analyzed").arg(skipped);
+    return text;
+}
+
+void ChannelCorrelation::reset()
+{
+    const int window = qMax(16, current.windowSamples);
+    current.windowSamples = window;
+    for (int channel = 0; channel < ChannelCount; ++channel) history[channel].fill(0, window);
+    timestamps.fill(0, window);
+    next = 0;
+    filled = 0;
+    sinceAnalysis = 0;
+
+    QMutexLocker locker(&analysis->mutex);
+    analysis->generation++;
+    analysis->skipped = 0;
+    for (Result &result : analysis->results) result = Result();
+}
+
+// Lag, correlation and coherence of one pair
+ChannelCorrelation::Result ChannelCorrelation::analyze(const double *first, const double *second, int length,
+                                                       double sampleRateHz, const Settings &settings)
+{
+    Result result;
+    if (length < 16 || sampleRateHz <= 0) return result;
+    const int maxLag = qBound(1, settings.maxLagSamples, length / 4);
+
+    // Remove the means so the load on the cells, not their offsets, is compared
+    std::vector<double> a(first, first + length), b(second, second + length);
+    double meanA = 0, meanB = 0;
+    for (int i = 0; i < length; ++i) {
+        meanA += a[size_t(i)];
+        meanB += b[size_t(i)];
+    }
+    meanA /= length;
+    meanB /= length;
+    double energyA = 0, energyB = 0;
+    for (int i = 0; i < length; ++i) {
+        a[size_t(i)] -= meanA;
+        b[size_t(i)] -= meanB;
+        energyA += a[size_t(i)] * a[size_t(i)];
+        energyB += b[size_t(i)] * b[size_t(i)];
+    }
+    if (energyA <= 0 || energyB <= 0) return result;
+
+    std::vector<double> correlation;
+    crossCorrelate(a, b, maxLag, correlation);
+    int best = 0;
+    for (int index = 1; index < int(correlation.size()); ++index) {
+        if (correlation[size_t(index)] > correlation[size_t(best)]) best = index;
+    }
+
+    // The peak gives whole samples, the phase of the cross spectrum the fraction
+    double residual;
+    crossSpectrum(a, b, sampleRateHz, settings.bandHz, best - maxLag, result.coherence, residual);
+
+    result.valid = true;
+    result.lagSamples = best - maxLag + qBound(-1.0, residual, 1.0);
+    result.lagMs = result.lagSamples * 1000 / sampleRateHz;
+    result.peak = correlation[size_t(best)] / std::sqrt(energyA * energyB);
+    return result;
+}
+
+// Windowed-sinc fractional delay
+void ChannelCorrelation::delay(const double *input, double *output, int length, double delaySamples)
+{
+    // y[i] = x[i - delay]: whole samples by indexing, the fraction by interpolation
+    const int whole = int(std::floor(delaySamples));
+    const double fraction = delaySamples - whole;
+    double weights[2 * DelayHalfTaps];
+    double total = 0;
+    for (int tap = 0; tap < 2 * DelayHalfTaps; ++tap) {
+        double x = tap - DelayHalfTaps + 1 - fraction;
+        double sinc = x == 0 ? 1 : std::sin(Pi * x) / (Pi * x);
+        weights[tap] = sinc * (0.5 + 0.5 * std::cos(Pi * x / DelayHalfTaps));
+        total += weights[tap];
+    }
+    for (double &weight : weights) weight /= total;    // Unit gain for steady loads
+
+    for (int i = 0; i < length; ++i) {
+        double sum = 0;
+        for (int tap = 0; tap < 2 * DelayHalfTaps; ++tap) {
+            int index = qBound(0, i - whole - (tap - DelayHalfTaps + 1), length - 1);
+            sum += input[index] * weights[tap];
+        }
+        output[i] = sum;
+    }
+}
+
+// Analyze a recording window by window and optionally write it compensated
+bool ChannelCorrelation::analyzeRecording(const QString &recordingName, const QString &outputName,
+                                          const Settings &settings, Report *report, QString *errorString)
+{
+    QElapsedTimer timer;
+    timer.start();
+    Report result;
+
+    QFile recording(recordingName);
+    if (!recording.open(QIODevice::ReadOnly)) {
+        if (errorString) *errorString = "Cannot open recording: " + recording.errorString();
+        return false;
+    }
+    const qint64 size = recording.size();
+    const uchar *mapped = size > 0 ? recording.map(0, size) : nullptr;
+    if (!mapped) {
+        if (errorString) *errorString = "Cannot map recording: " + recording.errorString();
+        return false;
+    }
+    const char *data = reinterpret_cast<const char *>(mapped);
+
+    const char *headerEnd = static_cast<const char *>(std::memchr(data, '\n', size_t(size)));
+    QByteArray header = headerEnd ? QByteArray(data, int(headerEnd - data)).trimmed() : QByteArray();
+    if (!header.startsWith("Timestamp,") || header.count(',') < ChannelColumns) {
+        if (errorString) *errorString = "Unsupported recording format (no CSV header)";
+        return false;
+    }
+
+    // Rows are kept as text positions plus the channel values, which are all that change
+    std::vector<double> times;
+    std::vector<double> columns[ChannelColumns];
+    std::vector<qint64> lineStarts, restStarts, lineEnds;
+    qint64 position = (headerEnd - data) + 1;
+    while (position < size) {
+        const char *line = data + position;
+        const char *newline = static_cast<const char *>(std::memchr(line, '\n', size_t(size - position)));
+        qint64 length = newline ? newline - line : size - position;
+        qint64 lineStart = position;
+        position += length + 1;
+        if (length > 0 && line[length - 1] == '\r') --length;
+        if (length == 0) continue;
+
+        const char *end = line + length;
+        const char *field = static_cast<const char *>(std::memchr(line, ',', size_t(length)));
+        double ms;
+        bool ok = field && parseRecordingTimestamp(line, field - line, ms) && (times.empty() || ms >= times.back());
+        double values[ChannelColumns];
+        for (int column = 0; ok && column < ChannelColumns; ++column) {
+            const char *start = field + 1;
+            field = static_cast<const char *>(std::memchr(start, ',', size_t(end - start)));
+            const char *fieldEnd = field ? field : end;
+            ok = parseRecordingNumber(start, fieldEnd - start, values[column]) && (field || column == ChannelColumns - 1);
+            if (!field) field = end;
+        }
+        if (!ok) {
+            result.skippedRows++;
+            continue;
+        }
+
+        times.push_back(ms);
+        for (int column = 0; column < ChannelColumns; ++column) columns[column].push_back(values[column]);
+        lineStarts.push_back(lineStart);
+        restStarts.push_back(field - data);            // Derived columns, from their leading comma
+        lineEnds.push_back(end - data);
+    }
+
+    const int window = qMax(16, settings.windowSamples);
+    result.rows = qint64(times.size());
+    if (result.rows < window || times.back() <= times.front()) {
+        if (errorString) *errorString = QString("Recording has fewer than %1 usable rows").arg(window);
+        return false;
+    }
+    result.sampleRateHz = (result.rows - 1) * 1000.0 / (times.back() - times.front());
+
+    // Half-overlapping windows; only coherent ones vote on the lag
+    std::vector<double> lags[PairCount];
+    for (qint64 start = 0; start + window <= result.rows; start += window / 2) {
+        result.windows++;
+        for (int pair = 0; pair < PairCount; ++pair) {
+            int first, second;
+            pairChannels(Pair(pair), first, second);
+            Result analysis = analyze(columns[first].data() + start, columns[second].data() + start, window,
+                                      result.sampleRateHz, settings);
+            result.meanCoherence[pair] += analysis.coherence;
+            if (!analysis.valid || analysis.coherence < settings.minCoherence) continue;
+            lags[pair].push_back(analysis.lagSamples);
+        }
+    }
+    for (int pair = 0; pair < PairCount; ++pair) {
+        result.meanCoherence[pair] /= result.windows;
+        result.coherentWindows[pair] = int(lags[pair].size());
+        if (lags[pair].empty()) continue;
+        result.minLagSamples[pair] = *std::min_element(lags[pair].begin(), lags[pair].end());
+        result.maxLagSamples[pair] = *std::max_element(lags[pair].begin(), lags[pair].end());
+        result.medianLagSamples[pair] = median(lags[pair]);
+    }
+
+    if (!outputName.isEmpty()) {
+        // Align every channel to Top Left: a channel that lags is moved earlier by its lag
+        result.channelDelaySamples[ChannelTopRight] = -result.medianLagSamples[PairTopLeftTopRight];
+        result.channelDelaySamples[ChannelBotLeft] = -result.medianLagSamples[PairTopLeftBotLeft];
+        std::vector<double> shifted(times.size());
+        for (int column = 0; column < ChannelColumns; ++column) {
+            double delaySamples = result.channelDelaySamples[column % ChannelCount];
+            if (delaySamples == 0) continue;
+            delay(columns[column].data(), shifted.data(), int(shifted.size()), delaySamples);
+            columns[column].swap(shifted);
+        }
+
+        QSaveFile output(outputName);
+        if (!output.open(QIODevice::WriteOnly)) {
+            if (errorString) *errorString = "Cannot create output: " + output.errorString();
+            return false;
+        }
+        QByteArray buffer;
+        buffer.reserve(FlushBytes + 4096);
+        buffer.append(header);
+        buffer.append('\n');
+        for (size_t row = 0; row < times.size(); ++row) {
+            // Timestamp as recorded, compensated values, derived columns as recorded
+            const char *line = data + lineStarts[row];
+            const char *comma = static_cast<const char *>(std::memchr(line, ',', size_t(lineEnds[row] - lineStarts[row])));
+            buffer.append(line, int(comma - line));
+            for (int column = 0; column < ChannelColumns; ++column) {
+                buffer.append(',');
+                buffer.append(QByteArray::number(columns[column][row], 'f', 2));
+            }
+            buffer.append(data + restStarts[row], int(lineEnds[row] - restStarts[row]));
+            buffer.append('\n');
+            if (buffer.size() >= FlushBytes) {
+                output.write(buffer);
+                buffer.clear();
+            }
+        }
+        output.write(buffer);
+        if (!output.commit()) {
+            if (errorString) *errorString = "Cannot write output: " + output.errorString();
+            return false;
+        }
+        result.compensated = true;
+    }
+
+    result.elapsedMs = timer.elapsed();
+    if (report) *report = result;
+    return true;
+}
+
+// Human-readable analysis
+QString ChannelCorrelation::Report::text() const
+{
+    QString text = QString("%1 rows (%2 skipped) at %3 Hz, %4 windows")
+                       .arg(rows).arg(skippedRows).arg(sampleRateHz, 0, 'f', 2).arg(windows);
+    for (int pair = 0; pair < PairCount; ++pair) {
+        text += QString("\n%1: ").arg(pairName(Pair(pair)));
+        if (coherentWindows[pair] == 0) {
+            text += QString("no coherent windows (mean coherence %1)").arg(meanCoherence[pair], 0, 'f', 2);
+            continue;
+        }
+        text += QString("lag %1 samples (%2 ms), range %3 to %4, mean coherence %5, %6 coherent windows")
+                    .arg(medianLagSamples[pair], 0, 'f', 3)
+                    .arg(medianLagSamples[pair] * 1000 / sampleRateHz, 0, 'f', 3)
+                    .arg(minLagSamples[pair], 0, 'f', 3)
+                    .arg(maxLagSamples[pair], 0, 'f', 3)
+                    .arg(meanCoherence[pair], 0, 'f', 2)
+                    .arg(coherentWindows[pair]);
+    }
+    if (compensated) {
+        text += QString("\nWritten with Top Right shifted by %1 and Bottom Left by %2 samples")
+                    .arg(channelDelaySamples[ChannelTopRight], 0, 'f', 3)
+                    .arg(channelDelaySamples[ChannelBotLeft], 0, 'f', 3);
+    }
+    text += QString("\nElapsed: %1 ms").arg(elapsedMs);
+    return text;
+}
@@ -0,0 +1,117 @@
+#ifndef CHANNELCORRELATION_H
+#define CHANNELCORRELATION_H
+
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include "sensorframe.h"
+
+// Measures how far apart in time the load cells are sampled, from the
+// cross-correlation of each pair of channels over a sliding window. A
+// movement loads all cells at once, so a channel that is sampled later shows
+// the same shape shifted by its lag. The peak of the cross-correlation gives
+// the lag, refined to a fraction of a sample by fitting a parabola through the
+// peak; the mean magnitude-squared coherence over the movement band (Welch
+// estimate from overlapping Hann segments) tells how much the pair has in
+// common, and thereby how far the lag can be trusted. At rest the channels
+// share only noise, so windows with low coherence say nothing about the lag.
+//
+// Live, frames are added as they arrive and every half window is analyzed as
+// a critical task of the shared executor; a window that comes due while the
+// previous one is still being analyzed is skipped.
+// Offline, a recording is analyzed window by window and, if asked for, written
+// again with each channel's median lag relative to Top Left taken out by a
+// fractional-delay filter.
+class ChannelCorrelation
+{
+public:
+    enum Pair {
+        PairTopLeftTopRight = 0,
+        PairTopLeftBotLeft,
+        PairTopRightBotLeft,
+        PairCount
+    };
+
+    struct Settings {
+        bool enabled = false;           // Live analysis
+        int windowSamples = 512;
+        int maxLagSamples = 8;          // Largest lag searched either way
+        double bandHz = 10;             // Coherence is averaged from the lowest bin up to here
+        double minCoherence = 0.5;      // Offline, windows below this do not count towards the lag
+    };
+
+    // Analysis of one pair over one window
+    struct Result {
+        bool valid = false;
+        double lagSamples = 0;          // Positive when the second channel lags the first
+        double lagMs = 0;
+        double peak = 0;                // Normalized correlation at the lag (-1 to 1)
+        double coherence = 0;           // 0 to 1
+    };
+
+    // Outcome of analyzing (and compensating) a recording
+    struct Report {
+        qint64 rows = 0;
+        qint64 skippedRows = 0;
+        double sampleRateHz = 0;
+        int windows = 0;
+        int coherentWindows[PairCount] = {};
+        double medianLagSamples[PairCount] = {};
+        double minLagSamples[PairCount] = {};
+        double maxLagSamples[PairCount] = {};
+        double meanCoherence[PairCount] = {};
+        bool compensated = false;
+        double channelDelaySamples[ChannelCount] = {};  // Removed from each channel
+        qint64 elapsedMs = 0;
+
+        QString text() const;
+    };
+
+    ChannelCorrelation();
+
+    void setSettings(const Settings &settings);
+    const Settings &settings() const { return current; }
+
+    static const char *pairName(Pair pair);
+    static void pairChannels(Pair pair, int &first, int &second);
+
+    // Add a frame's zero-adjusted values; returns true when a new window was queued for analysis
+    bool addFrame(const SensorFrame &frame);
+    Result result(Pair pair) const;
+    QString statistics() const;
+    void reset();
+
+    // Analyze one pair of equally spaced series
+    static Result analyze(const double *first, const double *second, int length, double sampleRateHz,
+                          const Settings &settings);
+
+    // Shift a series by a (fractional) number of samples, later for positive delays,
+    // with a windowed-sinc filter; the ends are extended with the edge values
+    static void delay(const double *input, double *output, int length, double delaySamples);
+
+    // Analyze a recording; with an output name, also write it with the lags removed
+    static bool analyzeRecording(const QString &recordingName, const QString &outputName, const Settings &settings,
+                                 Report *report = nullptr, QString *errorString = nullptr);
+
+private:
+    Settings current;
+    QVector<double> history[ChannelCount];  // Rings of windowSamples values
+    QVector<qint64> timestamps;
+    int next;                           // Ring position of the next frame
+    int filled;
+    int sinceAnalysis;
+
+    // Latest results, shared with the analysis in flight; a reset starts a
+    // new generation so that results of the old window are dropped
+    struct Analysis {
+        QMutex mutex;
+        Result results[PairCount];
+        bool busy = false;
+        int generation = 0;
+        int skipped = 0;                // Windows not analyzed because the previous one still was
+    };
+    std::shared_ptr<Analysis> analysis;
+};
+
+#endif // CHANNELCORRELATION_H
@@ -0,0 +1,593 @@
+// Include necessary headers
+#include "channelexpression.h"
+#include <cmath>                        // For sqrt and fabs
+#include <cstring>                      // For strlen
+
+// Levels the parser may recurse into (a parenthesis takes two, a unary operator
+// or conditional one); deeper input, from a corrupted setting say, fails
+// instead of overflowing the stack
+static const int MaxNesting = 256;
+
+// Recursive descent parser that emits bytecode directly into a ChannelExpression
+class ExpressionParser
+{
+public:
+    ExpressionParser(const QString &source, const QStringList &variables, ChannelExpression &target)
+        : source(source), variables(variables), target(target), position(0), depth(0), nesting(0) {}
+
+    bool parse(QString *errorString);
+
+private:
+    typedef ChannelExpression::OpCode OpCode;
+
+    void parseTernary();
+    void parseOr();
+    void parseAnd();
+    void parseComparison();
+    void parseAdditive();
+    void parseMultiplicative();
+    void parseUnary();
+    void parsePrimary();
+    void parseCall(const QString &name);
+
+    void emitOp(OpCode op, quint16 operand = 0);
+    void emitConstant(double value);
+    bool foldConstants(OpCode op, int arity);
+
+    bool enter();
+    void leave() { --nesting; }
+
+    void skipSpaces();
+    bool accept(const char *token);
+    void expect(const char *token);
+    void fail(const QString &message);
+
+    const QString &source;
+    const QStringList &variables;
+    ChannelExpression &target;
+    int position;
+    int depth;                          // Current stack depth of the emitted code
+    int nesting;                        // Current recursion depth of the parser
+    QString error;
+};
+
+// Parse the whole source; returns false and sets errorString on failure
+bool ExpressionParser::parse(QString *errorString)
+{
+    target.code.clear();
+    target.constants.clear();
+    target.stackDepth = 0;
+
+    skipSpaces();
+    if (position >= source.size()) fail("Expression is empty");
+    if (error.isEmpty()) parseTernary();
+    skipSpaces();
+    if (error.isEmpty() && position < source.size()) fail("Unexpected character");
+
+    if (!error.isEmpty()) {
+        target.code.clear();
+        if (errorString) *errorString = error;
+        return false;
+    }
+    return true;
+}
+
+// cond ? a : b
+void ExpressionParser::parseTernary()
+{
+    if (!enter()) {
+        leave();
+        return;
+    }
+
+    parseOr();
+    if (error.isEmpty() && accept("?")) {
+        parseTernary();
+        expect(":");
+        parseTernary();
+        emitOp(ChannelExpression::OpSelect);
+    }
+    leave();
+}
+
+// a || b
+void ExpressionParser::parseOr()
+{
+    parseAnd();
+    while (error.isEmpty() && accept("||")) {
+        parseAnd();
+        emitOp(ChannelExpression::OpOr);
+    }
+}
+
+// a && b
+void ExpressionParser::parseAnd()
+{
+    parseComparison();
+    while (error.isEmpty() && accept("&&")) {
+        parseComparison();
+        emitOp(ChannelExpression::OpAnd);
+    }
+}
+
+// a < b, a == b, ... (not chained)
+void ExpressionParser::parseComparison()
+{
+    parseAdditive();
+    if (!error.isEmpty()) return;
+
+    // Two character operators first so "<=" is not read as "<"
+    static const struct { const char *token; OpCode op; } operators[] = {
+        { "<=", ChannelExpression::OpLessEqual }, { ">=", ChannelExpression::OpGreaterEqual },
+        { "==", ChannelExpression::OpEqual },     { "!=", ChannelExpression::OpNotEqual },
+        { "<", ChannelExpression::OpLess },       { ">", ChannelExpression::OpGreater },
+    };
+    for (const auto &entry : operators) {
+        if (accept(entry.token)) {
+            parseAdditive();
+            emitOp(entry.op);
+            return;
+        }
+    }
+}
+
+// a + b, a - b
+void ExpressionParser::parseAdditive()
+{
+    parseMultiplicative();
+    while (error.isEmpty()) {
+        if (accept("+")) {
+            parseMultiplicative();
+            emitOp(ChannelExpression::OpAdd);
+        } else if (accept("-")) {
+            parseMultiplicative();
+            emitOp(ChannelExpression::OpSub);
+        } else {
+            break;
+        }
+    }
+}
+
+// a * b, a / b
+void ExpressionParser::parseMultiplicative()
+{
+    parseUnary();
+    while (error.isEmpty()) {
+        if (accept("*")) {
+            parseUnary();
+            emitOp(ChannelExpression::OpMul);
+        } else if (accept("/")) {
+            parseUnary();
+            emitOp(ChannelExpression::OpDiv);
+        } else {
+            break;
+        }
+    }
+}
+
+// -a, !a, +a
+void ExpressionParser::parseUnary()
+{
+    if (!enter()) {
+        leave();
+        return;
+    }
+
+    skipSpaces();
+    // "!=" never starts an operand, so a lone "!" is always negation
+    if (accept("-")) {
+        parseUnary();
+        emitOp(ChannelExpression::OpNeg);
+    } else if (accept("!")) {
+        parseUnary();
+        emitOp(ChannelExpression::OpNot);
+    } else if (accept("+")) {
+        parseUnary();
+    } else {
+        parsePrimary();
+    }
+    leave();
+}
+
+// Numbers, variables, function calls and parentheses
+void ExpressionParser::parsePrimary()
+{
+    skipSpaces();
+    if (position >= source.size()) {
+        fail("Unexpected end of expression");
+        return;
+    }
+
+    QChar c = source.at(position);
+
+    // Parenthesized subexpression
+    if (c == '(') {
+        ++position;
+        parseTernary();
+        expect(")");
+        return;
+    }
+
+    // Number literal, including an optional exponent
+    if (c.isDigit() || c == '.') {
+        int start = position;
+        while (position < source.size() && (source.at(position).isDigit() || source.at(position) == '.')) ++position;
+        if (position < source.size() && (source.at(position) == 'e' || source.at(position) == 'E')) {
+            int exponent = position + 1;
+            if (exponent < source.size() && (source.at(exponent) == '+' || source.at(exponent) == '-')) ++exponent;
+            if (exponent < source.size() && source.at(exponent).isDigit()) {
+                position = exponent;
+                while (position < source.size() && source.at(position).isDigit()) ++position;
+            }
+        }
+
+        bool ok;
+        double value = source.mid(start, position - start).toDouble(&ok);
+        if (!ok) {
+            position = start;
+            fail("Invalid number");
+            return;
+        }
+        emitConstant(value);
+        return;
+    }
+
+    // Identifier: variable or function name
+    if (c.isLetter() || c == '_') {
+        int start = position;
+        while (position < source.size() && (source.at(position).isLetterOrNumber() || source.at(position) == '_')) ++position;
+        QString name = source.mid(start, position - start);
+
+        if (accept("(")) {
+            parseCall(name);
+            return;
+        }
+
+        int index = variables.indexOf(name);
+        if (index < 0) {
+            position = start;
+            fail(QString("Unknown channel '%1'").arg(name));
+            return;
+        }
+        emitOp(ChannelExpression::OpLoad, quint16(index));
+        return;
+    }
+
+    fail("Expected a number, channel or '('");
+}
+
+// Function call; the opening parenthesis has been consumed
+void ExpressionParser::parseCall(const QString &name)
+{
+    static const struct { const char *name; int arity; OpCode op; } functions[] = {
+        { "abs", 1, ChannelExpression::OpAbs },
+        { "sqrt", 1, ChannelExpression::OpSqrt },
+        { "min", 2, ChannelExpression::OpMin },
+        { "max", 2, ChannelExpression::OpMax },
+        { "clamp", 3, ChannelExpression::OpClamp },
+    };
+
+    for (const auto &function : functions) {
+        if (name != function.name) continue;
+
+        for (int argument = 0; argument < function.arity && error.isEmpty(); ++argument) {
+            if (argument > 0) expect(",");
+            parseTernary();
+        }
+        expect(")");
+        emitOp(function.op);
+        return;
+    }
+
+    fail(QString("Unknown function '%1'").arg(name));
+}
+
+// Append an instruction, folding it if all its operands are constants
+void ExpressionParser::emitOp(OpCode op, quint16 operand)
+{
+    if (!error.isEmpty()) return;
+
+    // Stack effect of each instruction
+    int arity = 0;
+    switch (op) {
+    case ChannelExpression::OpConst:
+    case ChannelExpression::OpLoad:
+        depth++;
+        break;
+    case ChannelExpression::OpNeg:
+    case ChannelExpression::OpNot:
+    case ChannelExpression::OpAbs:
+    case ChannelExpression::OpSqrt:
+        arity = 1;
+        break;
+    case ChannelExpression::OpClamp:
+    case ChannelExpression::OpSelect:
+        arity = 3;
+        depth -= 2;
+        break;
+    default:
+        arity = 2;
+        depth -= 1;
+        break;
+    }
+
+    if (depth > ChannelExpression::MaxStackDepth) {
+        fail("Expression is nested too deeply");
+        return;
+    }
+    target.stackDepth = qMax(target.stackDepth, depth);
+
+    if (arity > 0 && foldConstants(op, arity)) return;
+
+    ChannelExpression::Instruction instruction;
+    instruction.op = op;
+    instruction.operand = operand;
+    target.code.append(instruction);
+}
+
+// Replace constant operands and their operation by a single constant
+bool ExpressionParser::foldConstants(OpCode op, int arity)
+{
+    int count = target.code.size();
+    if (count < arity) return false;
+
+    double operands[3];
+    for (int i = 0; i < arity; ++i) {
+        const ChannelExpression::Instruction &instruction = target.code[count - arity + i];
+        if (instruction.op != ChannelExpression::OpConst) return false;
+        operands[i] = target.constants[instruction.operand];
+    }
+
+    double value;
+    if (arity == 1) {
+        value = ChannelExpression::applyUnary(op, operands[0]);
+    } else if (op == ChannelExpression::OpClamp) {
+        value = qBound(operands[1], operands[0], operands[2]);
+    } else if (op == ChannelExpression::OpSelect) {
+        value = operands[0] != 0 ? operands[1] : operands[2];
+    } else {
+        value = ChannelExpression::applyBinary(op, operands[0], operands[1]);
+    }
+
+    target.code.resize(count - arity);
+    // The folded constants stay in the pool; only the code shrinks
+    ChannelExpression::Instruction instruction;
+    instruction.op = ChannelExpression::OpConst;
+    instruction.operand = quint16(target.constants.size());
+    target.constants.append(value);
+    target.code.append(instruction);
+    return true;
+}
+
+// Push a numeric constant
+void ExpressionParser::emitConstant(double value)
+{
+    emitOp(ChannelExpression::OpConst, quint16(target.constants.size()));
+    if (error.isEmpty()) target.constants.append(value);
+}
+
+// Skip whitespace
+void ExpressionParser::skipSpaces()
+{
+    while (position < source.size() && source.at(position).isSpace()) ++position;
+}
+
+// Consume a token if it comes next
+bool ExpressionParser::accept(const char *token)
+{
+    skipSpaces();
+    int length = int(std::strlen(token));
+    if (source.mid(position, length) != QLatin1String(token)) return false;
+
+    // Keep "<", ">" and "!" from swallowing the start of "<=", ">=" and "!="
+    if (length == 1 && position + 1 < source.size()) {
+        QChar next = source.at(position + 1);
+        if ((token[0] == '<' || token[0] == '>' || token[0] == '!') && next == '=') return false;
+    }
+
+    position += length;
+    return true;
+}
+
+// Consume a required token
+void ExpressionParser::expect(const char *token)
+{
+    if (!error.isEmpty()) return;
+    if (!accept(token)) fail(QString("Expected '%1'").arg(token));
+}
+
+// Go one level deeper; false (with the error set) past MaxNesting. Every
+// enter() is matched by a leave(), whether it succeeded or not.
+bool ExpressionParser::enter()
+{
+    if (++nesting > MaxNesting) fail("Expression is nested too deeply");
+    return error.isEmpty();
+}
+
+// Record the first error together with its position
+void ExpressionParser::fail(const QString &message)
+{
+    if (error.isEmpty()) {
+        error = QString("%1 at position %2").arg(message).arg(position + 1);
+    }
+}
+
+// Apply a unary operation (shared by evaluation and constant folding)
+double ChannelExpression::applyUnary(int op, double a)
+{
+    switch (op) {
+    case ChannelExpression::OpNeg:  return -a;
+    case ChannelExpression::OpNot:  return a == 0 ? 1 : 0;
+    case ChannelExpression::OpAbs:  return std::fabs(a);
+    case ChannelExpression::OpSqrt: return std::sqrt(a);
+    default:                        return 0;
+    }
+}
+
+// Apply a binary operation (shared by evaluation and constant folding)
+double ChannelExpression::applyBinary(int op, double a, double b)
+{
+    switch (op) {
+    case ChannelExpression::OpAdd:          return a + b;
+    case ChannelExpression::OpSub:          return a - b;
+    case ChannelExpression::OpMul:          return a * b;
+    case ChannelExpression::OpDiv:          return a / b;
+    case ChannelExpression::OpLess:         return a < b ? 1 : 0;
+    case ChannelExpression::OpLessEqual:    return a <= b ? 1 : 0;
+    case ChannelExpression::OpGreater:      return a > b ? 1 : 0;
+    case ChannelExpression::OpGreaterEqual: return a >= b ? 1 : 0;
+    case ChannelExpression::OpEqual:        return a == b ? 1 : 0;
+    case ChannelExpression::OpNotEqual:     return a != b ? 1 : 0;
+    case ChannelExpression::OpAnd:          return (a != 0 && b != 0) ? 1 : 0;
+    case ChannelExpression::OpOr:           return (a != 0 || b != 0) ? 1 : 0;
+    case ChannelExpression::OpMin:          return qMin(a, b);
+    case ChannelExpression::OpMax:          return qMax(a, b);
+    default:                                return 0;
+    }
+}
+
+// ChannelExpression constructor
+ChannelExpression::ChannelExpression()
+    : stackDepth(0)
+{
+}
+
+// Parse and compile an expression
+bool ChannelExpression::compile(const QString &source, const QStringList &variables, QString *errorString)
+{
+    text = source;
+    ExpressionParser parser(text, variables, *this);
+    return parser.parse(errorString);
+}
+
+// Evaluate for a single frame
+double ChannelExpression::evaluate(const double *variables) const
+{
+    if (code.isEmpty()) return 0;
+
+    double stack[MaxStackDepth];
+    int top = -1;
+
+    for (const Instruction &instruction : code) {
+        switch (instruction.op) {
+        case OpConst:
+            stack[++top] = constants[instruction.operand];
+            break;
+        case OpLoad:
+            stack[++top] = variables[instruction.operand];
+            break;
+        case OpNeg:
+        case OpNot:
+        case OpAbs:
+        case OpSqrt:
+            stack[top] = applyUnary(instruction.op, stack[top]);
+            break;
+        case OpClamp:
+            top -= 2;
+            stack[top] = qBound(stack[top + 1], stack[top], stack[top + 2]);
+            break;
+        case OpSelect:
+            top -= 2;
+            stack[top] = stack[top] != 0 ? stack[top + 1] : stack[top + 2];
+            break;
+        default:
+            --top;
+            stack[top] = applyBinary(instruction.op, stack[top], stack[top + 1]);
+            break;
+        }
+    }
+    return stack[0];
+}
+
+// Evaluate for a batch of frames; each instruction runs over the whole batch
+void ChannelExpression::evaluateBatch(const double *const *variables, int count, double *result,
+                                      double *scratch) const
+{
+    if (code.isEmpty()) {
+        for (int i = 0; i < count; ++i) result[i] = 0;
+        return;
+    }
+
+    // Loads reference the input columns directly; computed values live in scratch
+    const double *operands[MaxStackDepth];
+    int top = -1;
+
+    for (const Instruction &instruction : code) {
+        switch (instruction.op) {
+        case OpConst: {
+            double *out = scratch + (++top) * count;
+            const double value = constants[instruction.operand];
+            for (int i = 0; i < count; ++i) out[i] = value;
+            operands[top] = out;
+            break;
+        }
+        case OpLoad:
+            operands[++top] = variables[instruction.operand];
+            break;
+        case OpNeg:
+        case OpNot:
+        case OpAbs:
+        case OpSqrt: {
+            const double *a = operands[top];
+            double *out = scratch + top * count;
+            for (int i = 0; i < count; ++i) out[i] = applyUnary(instruction.op, a[i]);
+            operands[top] = out;
+            break;
+        }
+        case OpClamp:
+        case OpSelect: {
+            top -= 2;
+            const double *a = operands[top];
+            const double *b = operands[top + 1];
+            const double *c = operands[top + 2];
+            double *out = scratch + top * count;
+            if (instruction.op == OpClamp) {
+                for (int i = 0; i < count; ++i) out[i] = qBound(b[i], a[i], c[i]);
+            } else {
+                for (int i = 0; i < count; ++i) out[i] = a[i] != 0 ? b[i] : c[i];
+            }
+            operands[top] = out;
+            break;
+        }
+        case OpAdd: {
+            // The most common operations get dedicated loops the compiler can vectorize
+            --top;
+            const double *a = operands[top];
+            const double *b = operands[top + 1];
+            double *out = scratch + top * count;
+            for (int i = 0; i < count; ++i) out[i] = a[i] + b[i];
+            operands[top] = out;
+            break;
+        }
+        case OpSub: {
+            --top;
+            const double *a = operands[top];
+            const double *b = operands[top + 1];
+            double *out = scratch + top * count;
+            for (int i = 0; i < count; ++i) out[i] = a[i] - b[i];
+            operands[top] = out;
+            break;
+        }
+        case OpMul: {
+            --top;
+            const double *a = operands[top];
+            const double *b = operands[top + 1];
+            double *out = scratch + top * count;
+            for (int i = 0; i < count; ++i) out[i] = a[i] * b[i];
+            operands[top] = out;
+            break;
+        }
+        default: {
+            --top;
+            const double *a = operands[top];
+            const double *b = operands[top + 1];
+            double *out = scratch + top * count;
+            for (int i = 0; i < count; ++i) out[i] = applyBinary(instruction.op, a[i], b[i]);
+            operands[top] = out;
+            break;
+        }
+        }
+    }
+
+    for (int i = 0; i < count; ++i) result[i] = operands[0][i];
+}
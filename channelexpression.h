@@ -0,0 +1,61 @@
+#ifndef CHANNELEXPRESSION_H
+#define CHANNELEXPRESSION_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// An arithmetic expression over channel variables, compiled once to a compact
+// stack bytecode. Supports numbers, variables, + - * /, comparisons
+// (< <= > >= == !=, yielding 1 or 0), && || !, cond ? a : b and the functions
+// abs, sqrt, min, max and clamp(x, lo, hi). Constant subexpressions are folded
+// at compile time.
+class ChannelExpression
+{
+public:
+    static const int MaxStackDepth = 32;
+
+    ChannelExpression();
+
+    // Parse and compile; variables are referenced by their index in the list
+    bool compile(const QString &source, const QStringList &variables, QString *errorString = nullptr);
+
+    bool isValid() const { return !code.isEmpty(); }
+    QString source() const { return text; }
+
+    // Evaluate for one frame; variables[i] is the value of variable i
+    double evaluate(const double *variables) const;
+
+    // Evaluate for a batch of frames, one instruction at a time over the whole batch.
+    // variables[i] points to count values of variable i; scratch must hold scratchSize(count) doubles.
+    void evaluateBatch(const double *const *variables, int count, double *result, double *scratch) const;
+    int scratchSize(int count) const { return stackDepth * count; }
+
+private:
+    enum OpCode : quint8 {
+        OpConst, OpLoad,
+        OpAdd, OpSub, OpMul, OpDiv,
+        OpLess, OpLessEqual, OpGreater, OpGreaterEqual, OpEqual, OpNotEqual,
+        OpAnd, OpOr,
+        OpNeg, OpNot, OpAbs, OpSqrt,
+        OpMin, OpMax,
+        OpClamp, OpSelect
+    };
+
+    struct Instruction {
+        OpCode op;
+        quint16 operand;                // Constant or variable index
+    };
+
+    static double applyUnary(int op, double a);
+    static double applyBinary(int op, double a, double b);
+
+    friend class ExpressionParser;
+
+    QString text;
+    QVector<Instruction> code;
+    QVector<double> constants;
+    int stackDepth;
+};
+
+#endif // CHANNELEXPRESSION_H
@@ -0,0 +1,9 @@
+// Include necessary headers
+#include "clock.h"
+
+// The one real clock; started on first use
+const Clock *Clock::system()
+{
+    static const SystemClock clock;
+    return &clock;
+}
@@ -0,0 +1,56 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <QDateTime>
+#include <QElapsedTimer>
+
+// Source of time for scheduling, frame timestamps and statistics. Code that
+// needs the time takes a Clock so that it can run on simulated time.
+class Clock
+{
+public:
+    virtual ~Clock() {}
+
+    // Monotonic time in nanoseconds since the clock started
+    virtual qint64 nowNs() const = 0;
+
+    // Wall-clock time matching nowNs(), as written into recordings
+    virtual QDateTime wallTime() const = 0;
+
+    // The real clock, shared by everything that is not given another one
+    static const Clock *system();
+};
+
+// Real time: a monotonic timer plus the system's wall clock
+class SystemClock : public Clock
+{
+public:
+    SystemClock() { timer.start(); }
+
+    qint64 nowNs() const override { return timer.nsecsElapsed(); }
+    QDateTime wallTime() const override { return QDateTime::currentDateTime(); }
+
+private:
+    QElapsedTimer timer;
+};
+
+// Simulated time that only moves when told to, so that an hour of acquisition
+// can be run in moments with exactly reproducible timing
+class VirtualClock : public Clock
+{
+public:
+    explicit VirtualClock(const QDateTime &startWallTime = QDateTime(QDate(2000, 1, 1), QTime(0, 0)))
+        : currentNs(0), startWall(startWallTime) {}
+
+    qint64 nowNs() const override { return currentNs; }
+    QDateTime wallTime() const override { return startWall.addMSecs(currentNs / 1000000); }
+
+    void advanceTo(qint64 ns) { if (ns > currentNs) currentNs = ns; }
+    void advanceBy(qint64 ns) { advanceTo(currentNs + ns); }
+
+private:
+    qint64 currentNs;
+    QDateTime startWall;
+};
+
+#endif // CLOCK_H
@@ -0,0 +1,647 @@
+// Include necessary headers
+#include "commandline.h"
+#include "sensorframe.h"                // For the parse and CSV row stages
+#include "acquisitionpipeline.h"        // For zeroing and force estimation
+#include "frameblock.h"                 // For --benchmark --block
+#include "allocationstats.h"            // For allocation counters
+#include "recordingverifier.h"          // For --verify
+#include "timestampjoin.h"              // For --join
+#include "channelcorrelation.h"         // For --correlate
+#include "eventmarkers.h"               // For --events
+#include "networkframesource.h"         // For the --bridge frame format
+#include "simulatorframesource.h"       // For --bridge and --simulate-capture readings
+#include "capturescheduler.h"           // For --simulate-capture
+#include "dashboardserver.h"            // For --dashboard
+#include "recordingwriter.h"
+#include "crc32.h"                      // For the --simulate-capture fingerprint
+#include "clock.h"
+#include <QCommandLineParser>          // For argument parsing
+#include <QCoreApplication>            // For the --dashboard event loop
+#include <QElapsedTimer>               // For benchmark timing
+#include <QTemporaryFile>              // For the benchmark CSV sink
+#include <QTextStream>                 // For console output
+#include <QTcpServer>                  // For the --bridge TCP server
+#include <QTcpSocket>
+#include <QTimer>                      // For the --dashboard status and duration
+#include <QUdpSocket>                  // For --bridge datagrams
+#include <chrono>                      // For pacing --bridge
+#include <cstring>                     // For strcmp
+#include <random>                      // For --bridge drops and reordering
+#include <thread>                      // For sleep_until
+
+// Switches that select a headless tool
+static const char *const toolSwitches[] = { "--benchmark", "--verify", "--join", "--events", "--bridge",
+                                            "--simulate-capture", "--correlate", "--dashboard" };
+
+// Check the raw arguments before any QApplication exists
+bool isCommandLineMode(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        for (const char *toolSwitch : toolSwitches) {
+            if (std::strcmp(argv[i], toolSwitch) == 0) return true;
+        }
+    }
+    return false;
+}
+
+// Push synthetic sensor readings through the parse, processing and record stages,
+// one frame at a time or in blocks of blockFrames
+static int runBenchmark(int frames, int blockFrames)
+{
+    QTextStream out(stdout);
+
+    // Record into a temporary file exactly like a capture does
+    QTemporaryFile file;
+    if (!file.open()) {
+        out << "Failed to create benchmark file: " << file.errorString() << "\n";
+        return 1;
+    }
+    QByteArray row;
+
+    // Typical reading as sent by the sensor board
+    const QByteArray reading("512,498,505\r\n");
+    AcquisitionPipeline pipeline;
+    const qint64 frameIntervalNs = 12500000;   // 80 Hz, the sensor's usual rate
+
+    // A typical derived channel so expression evaluation is part of the measurement
+    QVector<DerivedChannels::Definition> definitions(1);
+    definitions[0].name = "shear";
+    definitions[0].expression = "topLeft + topRight - 2 * botLeft";
+    pipeline.derivedChannels().setDefinitions(definitions);
+
+    AllocationStats::Snapshot before = AllocationStats::snapshot();
+    QElapsedTimer timer;
+    timer.start();
+
+    FrameBlock parsed, processed;
+    for (int i = 0; i < frames; ++i) {
+        SensorFrame frame;
+        {
+            AllocationScope scope(AllocationStats::StageParse);
+            if (!parseSensorLine(reading, frame)) {
+                out << "Benchmark reading failed to parse\n";
+                return 1;
+            }
+        }
+        AllocationStats::recordFrame(AllocationStats::StageParse);
+        frame.timestampNs = i * frameIntervalNs;
+
+        if (blockFrames <= 1) {
+            pipeline.process(frame);
+            {
+                AllocationScope scope(AllocationStats::StageRecord);
+                row.resize(0);
+                appendCsvRow(row, QDateTime::currentDateTime(), frame, pipeline.derivedChannels().count());
+                file.write(row);
+                file.flush();
+            }
+            AllocationStats::recordFrame(AllocationStats::StageRecord);
+            continue;
+        }
+
+        // Blocks are processed when full (or at the end) and written with one flush
+        parsed.append(frame);
+        if (parsed.size() < blockFrames && i + 1 < frames) continue;
+        pipeline.processBlock(parsed, processed);
+        parsed.clear();
+
+        {
+            AllocationScope scope(AllocationStats::StageRecord);
+            QDateTime now = QDateTime::currentDateTime();
+            row.resize(0);
+            for (int index = 0; index < processed.size(); ++index) {
+                processed.readFrame(index, frame);
+                appendCsvRow(row, now, frame, pipeline.derivedChannels().count());
+            }
+            file.write(row);
+            file.flush();
+        }
+        for (int index = 0; index < processed.size(); ++index) AllocationStats::recordFrame(AllocationStats::StageRecord);
+    }
+
+    qint64 elapsedNs = timer.nsecsElapsed();
+    AllocationStats::Snapshot after = AllocationStats::snapshot();
+
+    // Report throughput followed by the per-stage allocation figures
+    out << "Frames: " << frames << "\n"
+        << "Elapsed: " << QString::number(elapsedNs / 1e6, 'f', 1) << " ms\n"
+        << "Throughput: " << QString::number(frames / (elapsedNs / 1e9), 'f', 0) << " frames/s\n"
+        << AllocationStats::formatReport(before, after) << "\n";
+    return 0;
+}
+
+// Verify recordings and print one report per file
+static int runVerify(const QStringList &fileNames, const RecordingVerifier::Options &options)
+{
+    QTextStream out(stdout);
+    int failures = 0;
+
+    for (const QString &fileName : fileNames) {
+        RecordingReport report = RecordingVerifier::verify(fileName, options);
+        out << report.summary() << "\n";
+        if (!report.ok()) failures++;
+    }
+
+    out << fileNames.size() - failures << " of " << fileNames.size() << " recordings OK\n";
+    return failures == 0 ? 0 : 2;
+}
+
+// Join an ultrasound timestamp log against a recording
+static int runJoin(const QStringList &fileNames, const TimestampJoin::Options &options)
+{
+    QTextStream out(stdout);
+    TimestampJoin::Summary summary;
+    QString error;
+
+    if (!TimestampJoin::run(fileNames[0], fileNames[1], fileNames[2], options, &summary, &error)) {
+        QTextStream(stderr) << "Join failed: " << error << "\n";
+        return 2;
+    }
+    out << summary.text() << "\n";
+    return 0;
+}
+
+// Measure the lag between the channels of a recording, optionally writing it compensated
+static int runCorrelate(const QStringList &fileNames, const ChannelCorrelation::Settings &settings)
+{
+    ChannelCorrelation::Report report;
+    QString error;
+
+    if (!ChannelCorrelation::analyzeRecording(fileNames[0], fileNames.value(1), settings, &report, &error)) {
+        QTextStream(stderr) << "Analysis failed: " << error << "\n";
+        return 2;
+    }
+    QTextStream(stdout) << report.text() << "\n";
+    return 0;
+}
+
+// List the event markers of recordings
+static int runEvents(const QStringList &fileNames)
+{
+    QTextStream out(stdout);
+    int failures = 0;
+
+    for (const QString &fileName : fileNames) {
+        QVector<EventMarker> markers;
+        QString error;
+        if (!EventMarkers::load(EventMarkers::fileNameFor(fileName), markers, &error)) {
+            QTextStream(stderr) << fileName << ": no event markers (" << error << ")\n";
+            failures++;
+            continue;
+        }
+
+        // Seconds since the first marker come from the monotonic stamps, not the wall clock
+        out << fileName << ": " << markers.size() << " event markers\n";
+        for (const EventMarker &marker : markers) {
+            double seconds = (marker.timestampNs - markers[0].timestampNs) / 1e9;
+            out << QString("  row %1  %2  +%3 s  %4\n")
+                       .arg(marker.row + 1, 8)
+                       .arg(marker.wallTime.toString("yyyy-MM-dd HH:mm:ss.zzz"))
+                       .arg(seconds, 0, 'f', 3)
+                       .arg(marker.label);
+        }
+    }
+    return failures == 0 ? 0 : 2;
+}
+
+// Settings of the loopback bridge stand-in
+struct BridgeOptions {
+    bool udp = false;
+    QString host;                       // UDP destination
+    quint16 port = 5000;
+    double framesPerSecond = 80;
+    double durationSeconds = 0;         // 0 = until interrupted
+    bool binary = false;
+    double dropRate = 0;                // Fraction of frames never sent
+    double reorderRate = 0;             // Fraction of frames sent after their successor
+};
+
+// Stand in for a network bridge: send simulated readings like a sensor bridge would
+static int runBridge(const BridgeOptions &options)
+{
+    QTextStream out(stdout);
+    QTcpServer server;
+    QTcpSocket *tcpSocket = nullptr;
+    QUdpSocket udpSocket;
+    QHostAddress destination(options.host);
+
+    if (options.udp) {
+        if (destination.isNull()) {
+            QTextStream(stderr) << "Invalid destination address: " << options.host << "\n";
+            return 1;
+        }
+        out << "Sending to UDP " << options.host << ":" << options.port << "\n";
+    } else {
+        // Like the real bridge, wait for the GUI to connect
+        if (!server.listen(QHostAddress::Any, options.port)) {
+            QTextStream(stderr) << "Cannot listen on TCP port " << options.port << ": " << server.errorString() << "\n";
+            return 1;
+        }
+        out << "Waiting for a connection on TCP port " << options.port << "\n";
+        out.flush();
+        if (!server.waitForNewConnection(-1)) return 1;
+        tcpSocket = server.nextPendingConnection();
+        tcpSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    }
+    out.flush();
+
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    const qint64 totalFrames = options.durationSeconds > 0
+                             ? qRound64(options.framesPerSecond * options.durationSeconds) : -1;
+    const auto interval = std::chrono::duration<double>(1.0 / options.framesPerSecond);
+    const auto start = std::chrono::steady_clock::now();
+
+    QByteArray held;                    // Frame waiting to be sent after its successor
+    QByteArray message;
+    qint64 sent = 0, dropped = 0, reordered = 0;
+
+    // Send one message; false once the GUI has disconnected
+    auto send = [&](const QByteArray &data) {
+        if (options.udp) {
+            udpSocket.writeDatagram(data, destination, options.port);
+        } else {
+            tcpSocket->write(data);
+            tcpSocket->waitForBytesWritten(1000);
+            if (tcpSocket->state() != QAbstractSocket::ConnectedState) return false;
+        }
+        sent++;
+        return true;
+    };
+
+    for (qint64 sequence = 0; totalFrames < 0 || sequence < totalFrames; ++sequence) {
+        std::this_thread::sleep_until(start + sequence * interval);
+
+        // Encode the reading in the requested format
+        int values[ChannelCount];
+        SimulatorFrameSource::syntheticReading(sequence / options.framesPerSecond, random, values);
+        if (options.binary) {
+            message.resize(NetworkFrameSource::BinaryFrameSize);
+            NetworkFrameSource::encodeBinaryFrame(quint32(sequence), values, message.data());
+        } else {
+            message = QByteArray::number(sequence) + ',' + QByteArray::number(values[ChannelBotLeft]) + ',' +
+                      QByteArray::number(values[ChannelTopLeft]) + ',' +
+                      QByteArray::number(values[ChannelTopRight]) + "\r\n";
+        }
+
+        // Misbehave on request so that loss and reorder accounting can be checked
+        if (chance(random) < options.dropRate) {
+            dropped++;
+            continue;
+        }
+        if (held.isEmpty() && chance(random) < options.reorderRate) {
+            held = message;
+            reordered++;
+            continue;
+        }
+
+        bool connected = send(message) && (held.isEmpty() || send(held));
+        held.clear();
+        if (!connected) {
+            out << "Connection closed after " << sent << " frames\n";
+            return 0;
+        }
+    }
+    if (!held.isEmpty()) send(held);
+
+    out << "Sent " << sent << " frames (" << dropped << " dropped, " << reordered << " reordered)\n";
+    return 0;
+}
+
+// Run a whole capture from the simulator on a virtual clock: an hour of
+// acquisition takes moments and the recording is identical on every run
+static int runSimulatedCapture(double framesPerSecond, double durationSeconds, double sensorRate,
+                               qint64 samples, const QString &outputName)
+{
+    QTextStream out(stdout);
+    QElapsedTimer timer;
+    timer.start();
+
+    VirtualClock clock(QDateTime(QDate(2024, 1, 1), QTime(12, 0)));
+    AcquisitionPipeline pipeline;
+    SimulatorFrameSource source(sensorRate);
+    RecordingWriter writer;
+    CaptureScheduler scheduler;
+    source.setClock(&clock);
+    QObject::connect(&source, &FrameSource::frameReceived, [&](const SensorFrame &received) {
+        SensorFrame frame = received;
+        pipeline.process(frame);
+
+        // With --samples every frame is a row, stamped with its own time
+        if (scheduler.takeFrame(frame.timestampNs)) {
+            writer.writeFrame(clock.wallTime().addMSecs(-(clock.nowNs() - frame.timestampNs) / 1000000), frame);
+        }
+    });
+
+    // Record into the given file or a temporary one
+    QTemporaryFile temporary;
+    QString fileName = outputName;
+    if (fileName.isEmpty()) {
+        if (!temporary.open()) {
+            out << "Failed to create recording: " << temporary.errorString() << "\n";
+            return 1;
+        }
+        fileName = temporary.fileName();
+        temporary.close();
+    }
+
+    QString error;
+    if (!source.open(&error) ||
+        !writer.open(fileName, samples > 0 ? 0 : framesPerSecond, samples > 0 ? 0 : durationSeconds,
+                     QStringList(), &error)) {
+        out << "Failed to start: " << error << "\n";
+        return 1;
+    }
+
+    // An exact number of sensor frames: step the clock until the simulator delivered them
+    qint64 maxLatenessNs = 0;
+    if (samples > 0) {
+        writer.setTermination("frames", samples);
+        scheduler.startFrames(clock.nowNs(), samples);
+        while (!scheduler.finished()) {
+            clock.advanceBy(10000000);
+            source.poll();
+        }
+    } else {
+        scheduler.start(clock.nowNs(), framesPerSecond, qRound64(framesPerSecond * durationSeconds));
+    }
+
+    // Jump from one capture tick to the next; the simulator catches up at each
+    while (!scheduler.finished()) {
+        clock.advanceTo(scheduler.nextDueNs());
+        source.poll();
+        int due = scheduler.takeDue(clock.nowNs());
+        maxLatenessNs = qMax(maxLatenessNs, scheduler.lastLatenessNs());
+        for (int i = 0; i < due; ++i) writer.writeFrame(clock.wallTime(), pipeline.latestFrame());
+    }
+    writer.close();
+    source.close();
+
+    // Fingerprint of the recording, to compare runs
+    QFile file(fileName);
+    quint32 crc = 0;
+    if (file.open(QIODevice::ReadOnly)) {
+        QByteArray contents = file.readAll();
+        crc = crc32Update(0, contents.constData(), contents.size());
+    }
+
+    out << "Simulated: " << QString::number(clock.nowNs() / 1e9, 'f', 3) << " s\n"
+        << "Rows: " << scheduler.issued() << " of " << scheduler.total() << "\n"
+        << "Sensor frames: " << source.framesReceived() << "\n"
+        << "Max tick lateness: " << QString::number(maxLatenessNs / 1e6, 'f', 3) << " ms\n"
+        << "Recording CRC-32: " << QString::number(crc, 16) << "\n"
+        << "Elapsed: " << timer.elapsed() << " ms\n";
+    return 0;
+}
+
+// Dispatch to the requested tool
+// Serve the web dashboard for simulated readings, so it can be tried and load tested on this computer
+static int runDashboard(const DashboardServer::Settings &settings, double sensorRate, double durationSeconds)
+{
+    QTextStream out(stdout);
+    AcquisitionPipeline pipeline;
+    SimulatorFrameSource source(sensorRate);
+    DashboardServer dashboard;
+    dashboard.setSettings(settings);
+    QObject::connect(&source, &FrameSource::frameReceived, [&](const SensorFrame &received) {
+        SensorFrame frame = received;
+        pipeline.process(frame);
+        dashboard.addFrame(frame);
+    });
+
+    QString error;
+    if (!source.open(&error) || !dashboard.start(&error)) {
+        QTextStream(stderr) << "Failed to start: " << error << "\n";
+        return 1;
+    }
+    out << "Dashboard at " << dashboard.url() << " with " << sensorRate << " simulated frames per second\n";
+    out.flush();
+
+    // Status once a second, like the statistics panel
+    QTimer statusTimer;
+    QObject::connect(&statusTimer, &QTimer::timeout, [&]() {
+        DashboardServer::Status status;
+        status.append(qMakePair(QString("Source"), source.description()));
+        status.append(qMakePair(QString("Frames"), QString::number(source.framesReceived())));
+        status.append(qMakePair(QString("Dashboard"), dashboard.statistics()));
+        dashboard.setStatus(status);
+    });
+    statusTimer.start(1000);
+
+    if (durationSeconds > 0) {
+        QTimer::singleShot(qRound(durationSeconds * 1000), QCoreApplication::instance(), &QCoreApplication::quit);
+    }
+    int result = QCoreApplication::exec();
+    out << dashboard.statistics() << "\n";
+    return result;
+}
+
+int runCommandLine(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Ultrasound GUI command-line tools");
+    parser.addHelpOption();
+
+    QCommandLineOption benchmarkOption("benchmark", "Benchmark the parse, processing and record stages.");
+    QCommandLineOption framesOption("frames", "Number of frames for --benchmark.", "count", "100000");
+    QCommandLineOption blockOption("block", "Frames processed together by --benchmark (1 = one at a time).",
+                                   "count", "1");
+    QCommandLineOption verifyOption("verify", "Verify the recordings given as arguments.");
+    QCommandLineOption threadsOption("threads", "Threads used by --verify (0 = one per core).", "count", "0");
+    QCommandLineOption fpsOption("fps", "Expected frames per second for --verify (overrides the manifest), "
+                                        "or the send rate for --bridge.", "fps");
+    QCommandLineOption durationOption("duration", "Expected capture length in seconds for --verify, "
+                                                  "or how long --bridge sends.", "seconds");
+    parser.addOption(benchmarkOption);
+    parser.addOption(framesOption);
+    parser.addOption(blockOption);
+    parser.addOption(verifyOption);
+    parser.addOption(threadsOption);
+    parser.addOption(fpsOption);
+    QCommandLineOption joinOption("join", "Match the frames of a timestamp log to sensor rows "
+                                          "(arguments: recording, timestamp log, output).");
+    QCommandLineOption modeOption("mode", "Join mode for --join: asof, nearest or interpolate.", "mode", "asof");
+    QCommandLineOption offsetOption("offset", "Milliseconds added to the log timestamps for --join.", "ms", "0");
+    QCommandLineOption toleranceOption("tolerance", "Farthest sensor row in milliseconds for --join.", "ms");
+    QCommandLineOption columnOption("ts-column", "Column of the log holding the timestamp for --join.", "index", "0");
+    QCommandLineOption baseOption("ts-base", "What plain-number log timestamps count for --join: unix, or s, ms or us "
+                                             "since the recording start.", "base", "unix");
+    parser.addOption(durationOption);
+    parser.addOption(joinOption);
+    parser.addOption(modeOption);
+    parser.addOption(offsetOption);
+    parser.addOption(toleranceOption);
+    parser.addOption(columnOption);
+    parser.addOption(baseOption);
+    QCommandLineOption eventsOption("events", "List the event markers of the recordings given as arguments.");
+    parser.addOption(eventsOption);
+    QCommandLineOption correlateOption("correlate", "Measure the sampling lag between the channels of a recording "
+                                                    "(arguments: recording, optional compensated output).");
+    QCommandLineOption windowOption("window", "Samples per analysis window for --correlate.", "samples", "512");
+    QCommandLineOption maxLagOption("max-lag", "Largest lag searched by --correlate, in samples.", "samples", "8");
+    parser.addOption(correlateOption);
+    parser.addOption(windowOption);
+    parser.addOption(maxLagOption);
+
+    QCommandLineOption bridgeOption("bridge", "Stand in for a network bridge, sending simulated readings.");
+    QCommandLineOption transportOption("transport", "Transport for --bridge: tcp (listen) or udp (send).",
+                                       "transport", "tcp");
+    QCommandLineOption hostOption("host", "Destination of --bridge datagrams.", "address", "127.0.0.1");
+    QCommandLineOption portOption("port", "Port for --bridge (default 5000) or --dashboard (default 8080).",
+                                  "port", "5000");
+    QCommandLineOption binaryOption("binary", "Send binary frames instead of text lines from --bridge.");
+    QCommandLineOption dropOption("drop", "Fraction of frames --bridge leaves out.", "fraction", "0");
+    QCommandLineOption reorderOption("reorder", "Fraction of frames --bridge sends after their successor.",
+                                     "fraction", "0");
+    parser.addOption(bridgeOption);
+    parser.addOption(transportOption);
+    parser.addOption(hostOption);
+    parser.addOption(portOption);
+    parser.addOption(binaryOption);
+    parser.addOption(dropOption);
+    parser.addOption(reorderOption);
+
+    QCommandLineOption simulateOption("simulate-capture",
+                                      "Run a capture from the simulator on a virtual clock (uses --fps and --duration).");
+    QCommandLineOption sensorRateOption("sensor-rate", "Simulated sensor frames per second for --simulate-capture.",
+                                        "fps", "80");
+    QCommandLineOption outputOption("output", "Recording written by --simulate-capture.", "file");
+    QCommandLineOption samplesOption("samples", "Record exactly this many sensor frames in --simulate-capture "
+                                                "instead of ticks.", "count");
+    parser.addOption(simulateOption);
+    parser.addOption(sensorRateOption);
+    parser.addOption(outputOption);
+    parser.addOption(samplesOption);
+    QCommandLineOption dashboardOption("dashboard", "Serve the web dashboard on this computer for simulated "
+                                                    "readings (uses --port, --sensor-rate and --duration).");
+    parser.addOption(dashboardOption);
+    parser.addPositionalArgument("files", "Recordings to verify or list markers of, or the files for --join.",
+                                 "[files...]");
+    parser.process(arguments);
+
+    if (parser.isSet(benchmarkOption)) {
+        bool ok;
+        int frames = parser.value(framesOption).toInt(&ok);
+        if (!ok || frames <= 0) {
+            QTextStream(stderr) << "Invalid frame count: " << parser.value(framesOption) << "\n";
+            return 1;
+        }
+        int blockFrames = parser.value(blockOption).toInt(&ok);
+        if (!ok || blockFrames < 1 || blockFrames > FrameBlock::Capacity) {
+            QTextStream(stderr) << "Invalid block size: " << parser.value(blockOption) << "\n";
+            return 1;
+        }
+        return runBenchmark(frames, blockFrames);
+    }
+
+    if (parser.isSet(verifyOption)) {
+        if (parser.positionalArguments().isEmpty()) {
+            QTextStream(stderr) << "No recordings given to --verify\n";
+            return 1;
+        }
+        RecordingVerifier::Options options;
+        options.threads = parser.value(threadsOption).toInt();
+        options.framesPerSecond = parser.value(fpsOption).toDouble();
+        options.durationSeconds = parser.value(durationOption).toDouble();
+        return runVerify(parser.positionalArguments(), options);
+    }
+
+    if (parser.isSet(joinOption)) {
+        if (parser.positionalArguments().size() != 3) {
+            QTextStream(stderr) << "--join needs a recording, a timestamp log and an output file\n";
+            return 1;
+        }
+        TimestampJoin::Options options;
+        bool ok;
+        options.mode = TimestampJoin::modeFromName(parser.value(modeOption), &ok);
+        if (!ok) {
+            QTextStream(stderr) << "Unknown join mode: " << parser.value(modeOption) << "\n";
+            return 1;
+        }
+        options.offsetMs = parser.value(offsetOption).toDouble();
+        if (parser.isSet(toleranceOption)) options.toleranceMs = parser.value(toleranceOption).toDouble();
+        options.timestampColumn = parser.value(columnOption).toInt();
+        options.timeBase = TimestampJoin::timeBaseFromName(parser.value(baseOption), &ok);
+        if (!ok) {
+            QTextStream(stderr) << "Unknown timestamp base: " << parser.value(baseOption) << "\n";
+            return 1;
+        }
+        return runJoin(parser.positionalArguments(), options);
+    }
+
+    if (parser.isSet(correlateOption)) {
+        if (parser.positionalArguments().isEmpty() || parser.positionalArguments().size() > 2) {
+            QTextStream(stderr) << "--correlate needs a recording and optionally an output file\n";
+            return 1;
+        }
+        ChannelCorrelation::Settings settings;
+        settings.windowSamples = parser.value(windowOption).toInt();
+        settings.maxLagSamples = parser.value(maxLagOption).toInt();
+        if (settings.windowSamples < 16 || settings.maxLagSamples < 1) {
+            QTextStream(stderr) << "--window must be at least 16 and --max-lag at least 1\n";
+            return 1;
+        }
+        return runCorrelate(parser.positionalArguments(), settings);
+    }
+
+    if (parser.isSet(eventsOption)) {
+        if (parser.positionalArguments().isEmpty()) {
+            QTextStream(stderr) << "No recordings given to --events\n";
+            return 1;
+        }
+        return runEvents(parser.positionalArguments());
+    }
+
+    if (parser.isSet(bridgeOption)) {
+        BridgeOptions options;
+        bool ok;
+        options.udp = parser.value(transportOption) == "udp";
+        options.host = parser.value(hostOption);
+        options.port = parser.value(portOption).toUShort(&ok);
+        if (!ok || options.port == 0 || (!options.udp && parser.value(transportOption) != "tcp")) {
+            QTextStream(stderr) << "Invalid --transport or --port\n";
+            return 1;
+        }
+        if (parser.isSet(fpsOption)) options.framesPerSecond = parser.value(fpsOption).toDouble();
+        if (options.framesPerSecond <= 0) {
+            QTextStream(stderr) << "Invalid frame rate: " << parser.value(fpsOption) << "\n";
+            return 1;
+        }
+        options.durationSeconds = parser.value(durationOption).toDouble();
+        options.binary = parser.isSet(binaryOption);
+        options.dropRate = parser.value(dropOption).toDouble();
+        options.reorderRate = parser.value(reorderOption).toDouble();
+        return runBridge(options);
+    }
+
+    if (parser.isSet(simulateOption)) {
+        double fps = parser.isSet(fpsOption) ? parser.value(fpsOption).toDouble() : 80;
+        double duration = parser.isSet(durationOption) ? parser.value(durationOption).toDouble() : 3600;
+        double sensorRate = parser.value(sensorRateOption).toDouble();
+        if (fps <= 0 || duration <= 0 || sensorRate <= 0) {
+            QTextStream(stderr) << "--fps, --duration and --sensor-rate must be greater than zero\n";
+            return 1;
+        }
+        qint64 samples = parser.value(samplesOption).toLongLong();
+        if (parser.isSet(samplesOption) && samples <= 0) {
+            QTextStream(stderr) << "--samples must be greater than zero\n";
+            return 1;
+        }
+        return runSimulatedCapture(fps, duration, sensorRate, samples, parser.value(outputOption));
+    }
+
+    if (parser.isSet(dashboardOption)) {
+        DashboardServer::Settings settings;
+        bool ok = true;
+        if (parser.isSet(portOption)) settings.port = parser.value(portOption).toUShort(&ok);
+        double sensorRate = parser.value(sensorRateOption).toDouble();
+        if (!ok || settings.port == 0 || sensorRate <= 0) {
+            QTextStream(stderr) << "Invalid --port or --sensor-rate\n";
+            return 1;
+        }
+        return runDashboard(settings, sensorRate, parser.value(durationOption).toDouble());
+    }
+
+    parser.showHelp(1);
+    return 1;
+}
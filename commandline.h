@@ -0,0 +1,12 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#include <QStringList>
+
+// Returns true when the arguments ask for a headless tool instead of the GUI
+bool isCommandLineMode(int argc, char *argv[]);
+
+// Run the requested headless tool and return the process exit code
+int runCommandLine(const QStringList &arguments);
+
+#endif // COMMANDLINE_H
@@ -0,0 +1,34 @@
+// Include necessary headers
+#include "crc32.h"
+
+namespace {
+
+// Byte lookup table for the reflected polynomial
+struct Crc32Table {
+    quint32 values[256];
+
+    Crc32Table()
+    {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : (value >> 1);
+            }
+            values[i] = value;
+        }
+    }
+};
+
+} // namespace
+
+// Extend a CRC-32 with more data
+quint32 crc32Update(quint32 crc, const char *data, qint64 length)
+{
+    static const Crc32Table table;  // Built once, thread-safe since C++11
+
+    crc = ~crc;
+    for (qint64 i = 0; i < length; ++i) {
+        crc = table.values[(crc ^ quint8(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
@@ -0,0 +1,10 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <QtGlobal>
+
+// Standard CRC-32 (IEEE 802.3, as used by zip and PNG).
+// Start with crc = 0 and feed consecutive pieces of data to extend it.
+quint32 crc32Update(quint32 crc, const char *data, qint64 length);
+
+#endif // CRC32_H
@@ -0,0 +1,534 @@
+// Include necessary headers
+#include "dashboardserver.h"
+#include "frameblock.h"                 // For feeding whole blocks
+#include <QCryptographicHash>           // For the WebSocket handshake
+#include <QHostInfo>                    // For the address of a remote dashboard
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+namespace {
+
+// Limits that keep a misbehaving client from holding memory
+const int MaxClients = 16;
+const int MaxHeaderBytes = 8192;
+const int MaxClientMessageBytes = 4096;
+const int MaxBacklogColumns = 2000;
+const int RequestTimeoutMs = 5000;      // To send a whole HTTP request after connecting
+
+// WebSocket opcodes (RFC 6455)
+const int OpText = 0x1;
+const int OpClose = 0x8;
+const int OpPing = 0x9;
+const int OpPong = 0xA;
+
+const char WebSocketGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// The dashboard page: one plot per channel over the last ten seconds and the status table
+const char Page[] = R"(<!DOCTYPE html>
+<html><head><meta charset="utf-8"><title>Sensor Dashboard</title>
+<style>
+body { font-family: sans-serif; margin: 1em; background: #fafafa; }
+canvas { width: 100%; height: 140px; background: #fff; border: 1px solid #ccc; display: block; margin-bottom: 0.5em; }
+td { padding: 0.1em 0.8em 0.1em 0; vertical-align: top; }
+pre { margin: 0; }
+#link { color: #888; }
+</style></head>
+<body>
+<h2>Sensor Dashboard <span id="link">connecting</span></h2>
+<div id="plots"></div>
+<table id="status"></table>
+<script>
+const names = ['Top Left', 'Top Right', 'Bottom Left'];
+const colors = ['#c33', '#36c', '#393'];
+const windowMs = 10000;
+let columns = [];
+
+const plots = names.map((name) => {
+  const canvas = document.createElement('canvas');
+  document.getElementById('plots').appendChild(canvas);
+  return canvas;
+});
+
+function showStatus(status) {
+  const table = document.getElementById('status');
+  table.innerHTML = '';
+  for (const [name, value] of status) {
+    const row = table.insertRow();
+    row.insertCell().textContent = name;
+    const pre = document.createElement('pre');
+    pre.textContent = value;
+    row.insertCell().appendChild(pre);
+  }
+}
+
+function connect() {
+  const socket = new WebSocket((location.protocol === 'https:' ? 'wss://' : 'ws://') + location.host + '/ws');
+  socket.onmessage = (event) => {
+    const update = JSON.parse(event.data);
+    columns = columns.concat(update.columns);
+    if (columns.length) {
+      const newest = columns[columns.length - 1][0];
+      const first = columns.findIndex((column) => column[0] >= newest - windowMs);
+      if (first > 0) columns = columns.slice(first);
+    }
+    if (update.status) showStatus(update.status);
+    document.getElementById('link').textContent = 'live';
+  };
+  socket.onclose = () => {
+    document.getElementById('link').textContent = 'disconnected, retrying';
+    setTimeout(connect, 2000);
+  };
+}
+
+function draw() {
+  const newest = columns.length ? columns[columns.length - 1][0] : 0;
+  plots.forEach((canvas, channel) => {
+    canvas.width = canvas.clientWidth;
+    canvas.height = canvas.clientHeight;
+    const context = canvas.getContext('2d');
+    let low = Infinity, high = -Infinity;
+    for (const column of columns) {
+      low = Math.min(low, column[1 + 2 * channel]);
+      high = Math.max(high, column[2 + 2 * channel]);
+    }
+    if (high - low < 10) { low -= 5; high += 5; }
+    const y = (value) => canvas.height - 4 - (value - low) / (high - low) * (canvas.height - 8);
+    context.fillStyle = colors[channel];
+    for (const column of columns) {
+      const x = canvas.width - (newest - column[0]) / windowMs * canvas.width;
+      const top = y(column[2 + 2 * channel]);
+      context.fillRect(x, top, 2, Math.max(1, y(column[1 + 2 * channel]) - top));
+    }
+    context.fillStyle = '#000';
+    const latest = columns.length ? columns[columns.length - 1][2 + 2 * channel] : 0;
+    context.fillText(names[channel] + ': ' + latest + '  (' + low + ' .. ' + high + ')', 6, 14);
+  });
+  requestAnimationFrame(draw);
+}
+
+connect();
+requestAnimationFrame(draw);
+</script>
+</body></html>
+)";
+
+// Quote a string for JSON
+QByteArray jsonString(const QString &text)
+{
+    QByteArray quoted = "\"";
+    for (char c : text.toUtf8()) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (c == '\n') {
+            quoted += "\\n";
+        } else if (uchar(c) < 0x20) {
+            quoted += "\\u00" + QByteArray::number(uchar(c), 16).rightJustified(2, '0');
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + '"';
+}
+
+}
+
+// DashboardServer constructor
+DashboardServer::DashboardServer(QObject *parent)
+    : QObject(parent)
+    , server(new QTcpServer(this))
+    , updateTimer(new QTimer(this))
+    , watchers(0)
+    , columnOpen(false)
+    , columnEndNs(0)
+    , statusVersion(0)
+    , bytesSent(0)
+    , updatesSent(0)
+    , updatesHeldBack(0)
+{
+    connect(server, &QTcpServer::newConnection, this, &DashboardServer::acceptConnections);
+    connect(updateTimer, &QTimer::timeout, this, &DashboardServer::sendUpdates);
+}
+
+// DashboardServer destructor
+DashboardServer::~DashboardServer()
+{
+    stop();
+}
+
+void DashboardServer::setSettings(const Settings &settings)
+{
+    current = settings;
+    current.updateHz = qBound(1, current.updateHz, 50);
+    current.pointsPerSecond = qBound(1, current.pointsPerSecond, 1000);
+    current.maxBytesPerSecond = qMax(1024, current.maxBytesPerSecond);
+}
+
+bool DashboardServer::start(QString *errorString)
+{
+    stop();
+    if (!server->listen(current.remote ? QHostAddress::Any : QHostAddress::LocalHost, current.port)) {
+        if (errorString) *errorString = server->errorString();
+        return false;
+    }
+    bytesSent = 0;
+    updatesSent = 0;
+    updatesHeldBack = 0;
+    sinceUpdate.start();
+    updateTimer->start(1000 / current.updateHz);
+    return true;
+}
+
+void DashboardServer::stop()
+{
+    updateTimer->stop();
+    server->close();
+    for (Client *client : clients) {
+        client->socket->disconnect(this);
+        client->socket->abort();
+        client->socket->deleteLater();
+        delete client;
+    }
+    clients.clear();
+    watchers = 0;
+    columnOpen = false;
+    fresh.clear();
+}
+
+bool DashboardServer::isRunning() const
+{
+    return server->isListening();
+}
+
+QString DashboardServer::url() const
+{
+    return QString("http://%1:%2/").arg(current.remote ? QHostInfo::localHostName() : QString("localhost"))
+                                   .arg(server->serverPort());
+}
+
+// Feed a block's zero-adjusted columns
+void DashboardServer::addBlock(const FrameBlock &block)
+{
+    if (watchers == 0) return;
+
+    const int *zeroed[ChannelCount];
+    for (int channel = 0; channel < ChannelCount; ++channel) zeroed[channel] = block.zeroed(channel);
+    const qint64 *timestamps = block.timestamps();
+
+    int values[ChannelCount];
+    for (int index = 0; index < block.size(); ++index) {
+        for (int channel = 0; channel < ChannelCount; ++channel) values[channel] = zeroed[channel][index];
+        collect(timestamps[index], values);
+    }
+}
+
+// Widen the current column by a frame, or start the next one
+void DashboardServer::collect(qint64 timestampNs, const int *values)
+{
+    if (columnOpen && timestampNs < columnEndNs) {
+        for (int channel = 0; channel < ChannelCount; ++channel) {
+            column.min[channel] = qMin(column.min[channel], values[channel]);
+            column.max[channel] = qMax(column.max[channel], values[channel]);
+        }
+        return;
+    }
+
+    if (columnOpen && fresh.size() < MaxBacklogColumns) fresh.append(column);
+    column.timeNs = timestampNs;
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        column.min[channel] = values[channel];
+        column.max[channel] = values[channel];
+    }
+    columnEndNs = timestampNs + 1000000000 / current.pointsPerSecond;
+    columnOpen = true;
+}
+
+void DashboardServer::setStatus(const Status &status)
+{
+    if (status == this->status) return;
+    this->status = status;
+    statusVersion++;
+}
+
+// New connection handler
+void DashboardServer::acceptConnections()
+{
+    while (server->hasPendingConnections()) {
+        QTcpSocket *socket = server->nextPendingConnection();
+        if (clients.size() >= MaxClients) {
+            socket->abort();
+            socket->deleteLater();
+            continue;
+        }
+
+        Client *client = new Client;
+        client->socket = socket;
+        client->connected.start();
+        clients.append(client);
+        connect(socket, &QTcpSocket::readyRead, this, [this, client]() { readClient(client); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, client]() { removeClient(client); });
+    }
+}
+
+// Client data handler: an HTTP request, then WebSocket frames if it upgraded
+void DashboardServer::readClient(Client *client)
+{
+    client->received += client->socket->readAll();
+    if (client->webSocket) {
+        readWebSocket(client);
+        return;
+    }
+
+    int end = client->received.indexOf("\r\n\r\n");
+    if (end < 0) {
+        if (client->received.size() > MaxHeaderBytes) client->socket->abort();
+        return;
+    }
+    QByteArray head = client->received.left(end);
+    client->received.remove(0, end + 4);
+    handleRequest(client, head);
+}
+
+void DashboardServer::handleRequest(Client *client, const QByteArray &head)
+{
+    QTcpSocket *socket = client->socket;
+    QList<QByteArray> lines = head.split('\n');
+    QList<QByteArray> request = lines[0].trimmed().split(' ');
+    if (request.size() != 3) {
+        respond(socket, "400 Bad Request", "text/plain", "Bad request\n");
+        return;
+    }
+    if (request[0] != "GET") {
+        respond(socket, "405 Method Not Allowed", "text/plain", "Only GET is supported\n");
+        return;
+    }
+    QByteArray path = request[1];
+    int query = path.indexOf('?');
+    if (query >= 0) path.truncate(query);
+
+    QByteArray upgrade, key;
+    for (int i = 1; i < lines.size(); ++i) {
+        int colon = lines[i].indexOf(':');
+        if (colon < 0) continue;
+        QByteArray name = lines[i].left(colon).trimmed().toLower();
+        if (name == "upgrade") upgrade = lines[i].mid(colon + 1).trimmed().toLower();
+        else if (name == "sec-websocket-key") key = lines[i].mid(colon + 1).trimmed();
+    }
+
+    if (path == "/" || path == "/index.html") {
+        respond(socket, "200 OK", "text/html; charset=utf-8", QByteArray(Page));
+    } else if (path == "/status") {
+        respond(socket, "200 OK", "application/json", statusJson() + "\n");
+    } else if (path == "/ws" && upgrade == "websocket" && !key.isEmpty()) {
+        QByteArray accept = QCryptographicHash::hash(key + WebSocketGuid, QCryptographicHash::Sha1).toBase64();
+        socket->write("HTTP/1.1 101 Switching Protocols\r\n"
+                      "Upgrade: websocket\r\n"
+                      "Connection: Upgrade\r\n"
+                      "Sec-WebSocket-Accept: " + accept + "\r\n\r\n");
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        client->webSocket = true;
+        client->tokens = current.maxBytesPerSecond;
+        client->statusVersion = -1;
+        watchers++;
+        if (!client->received.isEmpty()) readWebSocket(client);
+    } else if (path == "/ws") {
+        respond(socket, "400 Bad Request", "text/plain", "Expected a WebSocket upgrade\n");
+    } else {
+        respond(socket, "404 Not Found", "text/plain", "Not found\n");
+    }
+}
+
+// Write a whole response and close once it is sent
+void DashboardServer::respond(QTcpSocket *socket, const char *code, const char *type, const QByteArray &body)
+{
+    socket->write(QByteArray("HTTP/1.1 ") + code + "\r\n"
+                  "Content-Type: " + type + "\r\n"
+                  "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                  "Cache-Control: no-store\r\n"
+                  "Connection: close\r\n\r\n" + body);
+    socket->disconnectFromHost();
+}
+
+// Frames from the page: only close and ping need an answer
+void DashboardServer::readWebSocket(Client *client)
+{
+    QByteArray &data = client->received;
+    while (data.size() >= 2) {
+        const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+        int opcode = bytes[0] & 0x0f;
+        bool masked = bytes[1] & 0x80;
+        qint64 length = bytes[1] & 0x7f;
+        int header = 2;
+        if (length == 126) {
+            if (data.size() < 4) return;
+            length = (qint64(bytes[2]) << 8) | bytes[3];
+            header = 4;
+        } else if (length == 127) {
+            length = MaxClientMessageBytes + 1;     // Nothing the page sends is this long
+        }
+
+        // Clients must mask their frames (RFC 6455 5.1)
+        if (!masked || length > MaxClientMessageBytes) {
+            client->socket->abort();
+            return;
+        }
+        if (data.size() < header + 4 + length) return;
+
+        QByteArray payload = data.mid(header + 4, int(length));
+        for (int i = 0; i < payload.size(); ++i) payload[i] = char(payload[i] ^ bytes[header + i % 4]);
+        data.remove(0, header + 4 + int(length));
+
+        if (opcode == OpClose) {
+            client->socket->write(webSocketFrame(OpClose, QByteArray()));
+            client->socket->disconnectFromHost();
+            return;
+        }
+        if (opcode == OpPing) client->socket->write(webSocketFrame(OpPong, payload));
+    }
+}
+
+void DashboardServer::removeClient(Client *client)
+{
+    if (!clients.removeOne(client)) return;
+    if (client->webSocket && --watchers == 0) {
+        columnOpen = false;
+        fresh.clear();
+    }
+    client->socket->deleteLater();
+    delete client;
+}
+
+// Unmasked frame from the server, in one piece
+QByteArray DashboardServer::webSocketFrame(int opcode, const QByteArray &payload)
+{
+    QByteArray frame;
+    frame += char(0x80 | opcode);
+    qint64 length = payload.size();
+    if (length < 126) {
+        frame += char(length);
+    } else if (length < 65536) {
+        frame += char(126);
+        frame += char(length >> 8);
+        frame += char(length & 0xff);
+    } else {
+        frame += char(127);
+        for (int shift = 56; shift >= 0; shift -= 8) frame += char((length >> shift) & 0xff);
+    }
+    return frame + payload;
+}
+
+// Halve the resolution of a backlog: each pair of columns becomes one
+void DashboardServer::mergePairs(QVector<Column> &columns)
+{
+    int merged = 0;
+    for (int index = 0; index < columns.size(); index += 2, ++merged) {
+        Column column = columns[index];
+        if (index + 1 < columns.size()) {
+            const Column &next = columns[index + 1];
+            for (int channel = 0; channel < ChannelCount; ++channel) {
+                column.min[channel] = qMin(column.min[channel], next.min[channel]);
+                column.max[channel] = qMax(column.max[channel], next.max[channel]);
+            }
+        }
+        columns[merged] = column;
+    }
+    columns.resize(merged);
+}
+
+// Close connections that still have not sent a whole request
+void DashboardServer::closeStalledRequests()
+{
+    QVector<QTcpSocket *> stalled;
+    for (Client *client : clients) {
+        if (!client->webSocket && client->connected.elapsed() > RequestTimeoutMs) stalled.append(client->socket);
+    }
+    for (QTcpSocket *socket : stalled) socket->abort();     // Removes the client
+}
+
+// Update timer handler: send each client what is new, within its byte budget
+void DashboardServer::sendUpdates()
+{
+    closeStalledRequests();
+
+    double seconds = sinceUpdate.restart() / 1000.0;
+    const double budget = current.maxBytesPerSecond;
+
+    for (Client *client : clients) {
+        if (!client->webSocket) continue;
+
+        client->backlog += fresh;
+        while (client->backlog.size() > MaxBacklogColumns) mergePairs(client->backlog);
+        client->tokens = qMin(budget, client->tokens + budget * seconds);
+
+        StatusDetail detail = client->statusVersion != statusVersion ? StatusFull : StatusNone;
+        if (client->backlog.isEmpty() && detail == StatusNone) continue;
+
+        // No update may exceed a second's budget: coarser columns first, then
+        // a shortened status, and only then is the status left for a later update
+        QByteArray message = webSocketFrame(OpText, encodeUpdate(client->backlog, detail));
+        while (message.size() > budget && (client->backlog.size() > 1 || detail != StatusNone)) {
+            if (client->backlog.size() > 1) mergePairs(client->backlog);
+            else detail = StatusDetail(detail - 1);
+            message = webSocketFrame(OpText, encodeUpdate(client->backlog, detail));
+        }
+
+        bool fits = message.size() <= client->tokens && message.size() <= budget;
+        if (!fits || client->socket->bytesToWrite() > budget) {
+            updatesHeldBack++;
+            if (client->backlog.size() > 1) mergePairs(client->backlog);
+            continue;
+        }
+
+        client->socket->write(message);
+        client->tokens -= message.size();
+        client->backlog.clear();
+        if (detail != StatusNone) client->statusVersion = statusVersion;  // Shortened or not
+        bytesSent += quint64(message.size());
+        updatesSent++;
+    }
+    fresh.clear();
+}
+
+// {"columns":[[ms, min, max per channel], ...], "status":[[name, value], ...]}
+QByteArray DashboardServer::encodeUpdate(const QVector<Column> &columns, StatusDetail detail) const
+{
+    QByteArray json = "{\"columns\":[";
+    for (int index = 0; index < columns.size(); ++index) {
+        const Column &column = columns[index];
+        if (index > 0) json += ',';
+        json += '[' + QByteArray::number(column.timeNs / 1000000);
+        for (int channel = 0; channel < ChannelCount; ++channel) {
+            json += ',' + QByteArray::number(column.min[channel]) + ',' + QByteArray::number(column.max[channel]);
+        }
+        json += ']';
+    }
+    json += ']';
+    if (detail != StatusNone) json += ",\"status\":" + statusJson(detail);
+    return json + '}';
+}
+
+// The status rows; shortened to the first line of each value for a tight budget
+QByteArray DashboardServer::statusJson(StatusDetail detail) const
+{
+    QByteArray json = "[";
+    for (int index = 0; index < status.size(); ++index) {
+        const QString &value = status[index].second;
+        if (index > 0) json += ',';
+        json += '[' + jsonString(status[index].first) + ','
+              + jsonString(detail == StatusShort ? value.section('\n', 0, 0) : value) + ']';
+    }
+    return json + ']';
+}
+
+// Statistics handler
+QString DashboardServer::statistics() const
+{
+    return QString("Dashboard %1: %2 clients (%3 live), %4 updates, %5 KiB sent, %6 held back for bandwidth")
+        .arg(url())
+        .arg(clients.size())
+        .arg(watchers)
+        .arg(updatesSent)
+        .arg(bytesSent / 1024)
+        .arg(updatesHeldBack);
+}
@@ -0,0 +1,134 @@
+#ifndef DASHBOARDSERVER_H
+#define DASHBOARDSERVER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include "sensorframe.h"
+
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+class FrameBlock;
+
+// A small web server for watching the rig from another computer. GET / serves
+// a dashboard page, GET /status the status as JSON, and GET /ws upgrades to a
+// WebSocket over which the page receives the live channels and the status.
+//
+// The channels are decimated as they arrive: each plot column keeps only the
+// minimum and maximum of every channel over 1/pointsPerSecond of signal, a few
+// comparisons per frame and nothing at all while no page is connected.
+// Columns are sent at a fixed update rate whatever the sensor rate. Every
+// client has a byte budget per second, and no update is larger than that: its
+// columns are merged in pairs, then the status is cut to the first line of each
+// row, and only if that is still too large left for a later update. When an update does not fit in what is left of the
+// budget (or the socket has not drained the last ones), its columns wait for
+// the next update and are merged, so a slow client gets a coarser plot rather
+// than a growing backlog. A connection that has not sent a whole request within
+// a few seconds is closed, so idle connections cannot hold every client slot.
+// All work happens on the thread that feeds the frames, without blocking:
+// sockets are written, never waited for.
+class DashboardServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Settings {
+        quint16 port = 8080;
+        bool remote = false;            // Listen on all interfaces rather than only this computer
+        int updateHz = 10;              // Updates sent to each client per second
+        int pointsPerSecond = 100;      // Plot columns per second of signal
+        int maxBytesPerSecond = 65536;  // Per client
+    };
+
+    // Name and value pairs shown on the page in order
+    typedef QVector<QPair<QString, QString>> Status;
+
+    explicit DashboardServer(QObject *parent = nullptr);
+    ~DashboardServer();
+
+    // Settings take effect when the server is next started
+    void setSettings(const Settings &settings);
+    const Settings &settings() const { return current; }
+
+    // Listen (again) with the current settings
+    bool start(QString *errorString = nullptr);
+    void stop();
+    bool isRunning() const;
+
+    // Address to open in a browser
+    QString url() const;
+
+    // Feed processed frames (zero-adjusted values are plotted)
+    void addFrame(const SensorFrame &frame) { if (watchers > 0) collect(frame.timestampNs, frame.zeroed); }
+    void addBlock(const FrameBlock &block);
+
+    void setStatus(const Status &status);
+
+    // Clients, data sent and updates held back for the statistics panel
+    QString statistics() const;
+
+private:
+    // One plot column: the range of each channel over a stretch of signal
+    struct Column {
+        qint64 timeNs = 0;
+        int min[ChannelCount];
+        int max[ChannelCount];
+    };
+
+    // How much of the status an update carries
+    enum StatusDetail {
+        StatusNone,
+        StatusShort,                    // First line of each row
+        StatusFull
+    };
+
+    struct Client {
+        QTcpSocket *socket = nullptr;
+        QElapsedTimer connected;        // For closing requests that never finish
+        QByteArray received;
+        bool webSocket = false;
+        QVector<Column> backlog;        // Columns not sent yet
+        double tokens = 0;              // Bytes the client may still be sent
+        int statusVersion = -1;         // Status it has seen
+    };
+
+    void collect(qint64 timestampNs, const int *values);
+    void acceptConnections();
+    void readClient(Client *client);
+    void handleRequest(Client *client, const QByteArray &head);
+    void readWebSocket(Client *client);
+    void removeClient(Client *client);
+    void sendUpdates();
+    void closeStalledRequests();
+    QByteArray encodeUpdate(const QVector<Column> &columns, StatusDetail detail) const;
+    QByteArray statusJson(StatusDetail detail = StatusFull) const;
+
+    static void respond(QTcpSocket *socket, const char *code, const char *type, const QByteArray &body);
+    static QByteArray webSocketFrame(int opcode, const QByteArray &payload);
+    static void mergePairs(QVector<Column> &columns);
+
+    Settings current;
+    QTcpServer *server;
+    QTimer *updateTimer;
+    QElapsedTimer sinceUpdate;
+    QVector<Client *> clients;
+    int watchers;                       // Clients with a WebSocket open
+
+    Column column;                      // Column being filled
+    bool columnOpen;
+    qint64 columnEndNs;
+    QVector<Column> fresh;              // Columns completed since the last update
+
+    Status status;
+    int statusVersion;
+
+    quint64 bytesSent;
+    quint64 updatesSent;
+    quint64 updatesHeldBack;
+};
+
+#endif // DASHBOARDSERVER_H
@@ -0,0 +1,204 @@
+// Include necessary headers
+#include "derivedchannels.h"
+#include "frameblock.h"                 // For evaluating whole blocks
+
+namespace {
+
+// Built-in values, in the order loadVariables() writes them
+const char *const BuiltInVariables[] = {
+    "topLeft", "topRight", "botLeft",                           // Zero-adjusted counts
+    "rawTopLeft", "rawTopRight", "rawBotLeft",                  // Raw counts
+    "filteredTopLeft", "filteredTopRight", "filteredBotLeft",   // Kalman filtered force
+    "rateTopLeft", "rateTopRight", "rateBotLeft",               // Rate of change per second
+    "t"                                                         // Frame time in seconds
+};
+const int BuiltInCount = DerivedChannels::BuiltInVariableCount;
+const int VariableCount = DerivedChannels::MaxVariables;
+static_assert(sizeof(BuiltInVariables) / sizeof(BuiltInVariables[0]) == BuiltInCount,
+              "BuiltInVariableCount must match the built-in variable names");
+
+// Names that would shadow a function
+const char *const ReservedNames[] = { "abs", "sqrt", "min", "max", "clamp" };
+
+// Check that a name is a plain identifier
+bool isIdentifier(const QString &name)
+{
+    if (name.isEmpty() || !(name.at(0).isLetter() || name.at(0) == '_')) return false;
+    for (int i = 1; i < name.size(); ++i) {
+        if (!(name.at(i).isLetterOrNumber() || name.at(i) == '_')) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// DerivedChannels constructor
+DerivedChannels::DerivedChannels()
+{
+}
+
+// Names usable in expressions before any derived channel
+QStringList DerivedChannels::variableNames()
+{
+    QStringList names;
+    for (const char *name : BuiltInVariables) names << name;
+    return names;
+}
+
+// Parse "name = expression" lines
+bool DerivedChannels::parseDefinitions(const QString &text, QVector<Definition> &definitions,
+                                       QString *errorString)
+{
+    definitions.clear();
+    QStringList lines = text.split("\n");
+
+    for (int i = 0; i < lines.size(); ++i) {
+        QString line = lines[i];
+        int comment = line.indexOf('#');
+        if (comment >= 0) line = line.left(comment);
+        line = line.trimmed();
+        if (line.isEmpty()) continue;
+
+        int separator = line.indexOf('=');
+        // "==" inside the expression is fine, but the first '=' must be the assignment
+        if (separator <= 0 || (separator + 1 < line.size() && line.at(separator + 1) == '=')) {
+            if (errorString) *errorString = QString("Line %1: expected 'name = expression'").arg(i + 1);
+            return false;
+        }
+
+        Definition definition;
+        definition.name = line.left(separator).trimmed();
+        definition.expression = line.mid(separator + 1).trimmed();
+        definitions.append(definition);
+    }
+    return true;
+}
+
+// Format definitions as one "name = expression" line each
+QString DerivedChannels::formatDefinitions(const QVector<Definition> &definitions)
+{
+    QStringList lines;
+    for (const Definition &definition : definitions) {
+        lines << definition.name + " = " + definition.expression;
+    }
+    return lines.join("\n");
+}
+
+// Validate and compile a full set of definitions
+bool DerivedChannels::setDefinitions(const QVector<Definition> &definitions, QString *errorString)
+{
+    if (definitions.size() > MaxDerivedChannels) {
+        if (errorString) *errorString = QString("At most %1 derived channels are supported").arg(MaxDerivedChannels);
+        return false;
+    }
+
+    QStringList variables = variableNames();
+    QVector<ChannelExpression> compiled;
+
+    for (const Definition &definition : definitions) {
+        // Names must be unique identifiers that do not shadow anything
+        bool reserved = false;
+        for (const char *name : ReservedNames) reserved = reserved || definition.name == name;
+        if (!isIdentifier(definition.name) || reserved || variables.contains(definition.name)) {
+            if (errorString) *errorString = QString("'%1' is not a valid new channel name").arg(definition.name);
+            return false;
+        }
+
+        // Each expression sees the built-ins and the channels defined above it
+        ChannelExpression expression;
+        QString error;
+        if (!expression.compile(definition.expression, variables, &error)) {
+            if (errorString) *errorString = QString("%1: %2").arg(definition.name, error);
+            return false;
+        }
+        compiled.append(expression);
+        variables << definition.name;
+    }
+
+    defined = definitions;
+    programs = compiled;
+    return true;
+}
+
+// Names of the derived channels in definition order
+QStringList DerivedChannels::names() const
+{
+    QStringList result;
+    for (const Definition &definition : defined) result << definition.name;
+    return result;
+}
+
+// Write the values of a frame into a variable array
+void DerivedChannels::loadVariables(const SensorFrame &frame, double *variables)
+{
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        variables[channel] = frame.zeroed[channel];
+        variables[ChannelCount + channel] = frame.raw[channel];
+        variables[2 * ChannelCount + channel] = frame.filtered[channel];
+        variables[3 * ChannelCount + channel] = frame.rate[channel];
+    }
+    variables[4 * ChannelCount] = frame.timestampNs / 1e9;
+
+    for (int index = 0; index < MaxDerivedChannels; ++index) {
+        variables[BuiltInCount + index] = frame.derived[index];
+    }
+}
+
+// Evaluate every channel for one frame
+void DerivedChannels::evaluate(SensorFrame &frame) const
+{
+    if (programs.isEmpty()) return;
+
+    double variables[VariableCount];
+    loadVariables(frame, variables);
+
+    for (int index = 0; index < programs.size(); ++index) {
+        double value = programs[index].evaluate(variables);
+        frame.derived[index] = value;
+        variables[BuiltInCount + index] = value;   // Visible to later channels
+    }
+}
+
+// Evaluate every channel for a block, column by column
+void DerivedChannels::evaluate(FrameBlock &block)
+{
+    const int count = block.size();
+    if (programs.isEmpty() || count == 0) return;
+
+    // The integer columns and the time are converted to doubles, followed by the expression stack
+    const int converted = 2 * ChannelCount + 1;
+    int stackSize = 0;
+    for (const ChannelExpression &program : programs) {
+        stackSize = qMax(stackSize, program.scratchSize(count));
+    }
+    int needed = converted * count + stackSize;
+    if (scratch.size() < needed) scratch.resize(needed);    // Grows only for larger blocks
+    double *stack = scratch.data() + converted * count;
+
+    // Variables in the order loadVariables() writes them
+    const double *variables[VariableCount];
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        double *zeroed = scratch.data() + channel * count;
+        double *raw = scratch.data() + (ChannelCount + channel) * count;
+        const int *zeroedCounts = block.zeroed(channel);
+        const int *rawCounts = block.raw(channel);
+        for (int i = 0; i < count; ++i) zeroed[i] = zeroedCounts[i];
+        for (int i = 0; i < count; ++i) raw[i] = rawCounts[i];
+        variables[channel] = zeroed;
+        variables[ChannelCount + channel] = raw;
+        variables[2 * ChannelCount + channel] = block.filtered(channel);
+        variables[3 * ChannelCount + channel] = block.rate(channel);
+    }
+    double *seconds = scratch.data() + 2 * ChannelCount * count;
+    const qint64 *timestamps = block.timestamps();
+    for (int i = 0; i < count; ++i) seconds[i] = timestamps[i] / 1e9;
+    variables[4 * ChannelCount] = seconds;
+
+    // Results go straight into the block; each becomes an input for the channels after it
+    for (int index = 0; index < MaxDerivedChannels; ++index) {
+        variables[BuiltInCount + index] = block.derived(index);
+    }
+    for (int index = 0; index < programs.size(); ++index) {
+        programs[index].evaluateBatch(variables, count, block.derived(index), stack);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef DERIVEDCHANNELS_H
+#define DERIVEDCHANNELS_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "sensorframe.h"
+#include "channelexpression.h"
+
+class FrameBlock;
+
+// User-defined channels computed from each frame, e.g. "shear = topLeft - topRight".
+// Expressions may use the built-in frame values (see variableNames()) and any
+// derived channel defined before them.
+class DerivedChannels
+{
+public:
+    struct Definition {
+        QString name;
+        QString expression;
+    };
+
+    // Size of the variable array expressions are evaluated against
+    static const int BuiltInVariableCount = 13;
+    static const int MaxVariables = BuiltInVariableCount + MaxDerivedChannels;
+
+    DerivedChannels();
+
+    // Names of the built-in values available to every expression
+    static QStringList variableNames();
+
+    // Convert between Definitions and "name = expression" lines ('#' starts a comment)
+    static bool parseDefinitions(const QString &text, QVector<Definition> &definitions,
+                                 QString *errorString = nullptr);
+    static QString formatDefinitions(const QVector<Definition> &definitions);
+
+    // Compile a new set of definitions; on error the current set is kept
+    bool setDefinitions(const QVector<Definition> &definitions, QString *errorString = nullptr);
+    const QVector<Definition> &definitions() const { return defined; }
+    int count() const { return defined.size(); }
+    QStringList names() const;
+
+    // Evaluate all channels for one frame, or for the frames of a block at once
+    // (into its derived columns)
+    void evaluate(SensorFrame &frame) const;
+    void evaluate(FrameBlock &block);
+
+    // Fill a MaxVariables array with the built-in values and the derived channels of a frame
+    static void loadVariables(const SensorFrame &frame, double *variables);
+
+private:
+    QVector<Definition> defined;
+    QVector<ChannelExpression> programs;
+    QVector<double> scratch;            // Reused converted columns and stack for block evaluation
+};
+
+#endif // DERIVEDCHANNELS_H
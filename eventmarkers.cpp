@@ -0,0 +1,185 @@
+// Include necessary headers
+#include "eventmarkers.h"
+#include "recordingmanifest.h"          // For seeking to a row through the block offsets
+#include <QFile>                        // For reading markers and recordings
+#include <QKeySequence>                 // For hotkey names
+
+// Column names of the marker file
+const char EventMarkers::Header[] = "Row,Timestamp,Monotonic ns,Label\n";
+
+// Capture pauses; the resume label is followed by the length of the pause
+const char EventMarkers::PauseLabel[] = "pause";
+const char EventMarkers::ResumeLabel[] = "resume";
+
+// Format of the wall time, the same as the recording rows
+static const char TimestampFormat[] = "yyyy-MM-dd HH:mm:ss.zzz";
+
+// Name of the marker file that belongs to a recording
+QString EventMarkers::fileNameFor(const QString &recordingFileName)
+{
+    return recordingFileName + ".events";
+}
+
+// Append one marker line
+void EventMarkers::appendLine(QByteArray &out, const EventMarker &marker)
+{
+    QString label = marker.label;
+    label.replace('\n', ' ').replace('\r', ' ');
+
+    out += QByteArray::number(marker.row);
+    out += ',';
+    out += marker.wallTime.toString(TimestampFormat).toLatin1();
+    out += ',';
+    out += QByteArray::number(marker.timestampNs);
+    out += ',';
+    out += label.toUtf8();
+    out += '\n';
+}
+
+// Read a marker file written by RecordingWriter
+bool EventMarkers::load(const QString &fileName, QVector<EventMarker> &markers, QString *errorString)
+{
+    markers.clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+
+    int lineNumber = 0;
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        ++lineNumber;
+        if (line.endsWith('\n')) line.chop(1);
+        if (line.endsWith('\r')) line.chop(1);
+        if (line.isEmpty() || (lineNumber == 1 && line.startsWith("Row,"))) continue;
+
+        // The label is everything after the third comma
+        int first = line.indexOf(',');
+        int second = first < 0 ? -1 : line.indexOf(',', first + 1);
+        int third = second < 0 ? -1 : line.indexOf(',', second + 1);
+        if (third < 0) {
+            if (errorString) *errorString = QString("Malformed marker line %1").arg(lineNumber);
+            return false;
+        }
+
+        bool rowOk, timeOk;
+        EventMarker marker;
+        marker.row = line.left(first).toLongLong(&rowOk);
+        marker.wallTime = QDateTime::fromString(QString::fromLatin1(line.mid(first + 1, second - first - 1)),
+                                                TimestampFormat);
+        marker.timestampNs = line.mid(second + 1, third - second - 1).toLongLong(&timeOk);
+        marker.label = QString::fromUtf8(line.mid(third + 1));
+        if (!rowOk || !timeOk || marker.row < 0 || !marker.wallTime.isValid()) {
+            if (errorString) *errorString = QString("Invalid value on marker line %1").arg(lineNumber);
+            return false;
+        }
+        markers.append(marker);
+    }
+    return true;
+}
+
+// Read a few data rows from the middle of a recording
+bool EventMarkers::readRows(const QString &recordingFileName, qint64 firstRow, int count,
+                            QStringList &rows, QString *errorString)
+{
+    rows.clear();
+
+    QFile file(recordingFileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    file.readLine();                    // Skip the header
+    if (firstRow < 0) {
+        count += int(firstRow);
+        firstRow = 0;
+    }
+
+    // Jump to the block holding the first row if the manifest lists the blocks
+    qint64 skip = firstRow;
+    RecordingManifest manifest;
+    if (manifest.load(RecordingManifest::fileNameFor(recordingFileName))) {
+        qint64 blockStart = 0;
+        for (const RecordingManifest::Block &block : manifest.blocks) {
+            if (firstRow < blockStart + block.rows) {
+                if (file.seek(block.offset)) skip = firstRow - blockStart;
+                break;
+            }
+            blockStart += block.rows;
+        }
+    }
+
+    while (skip > 0 && !file.atEnd()) {
+        file.readLine();
+        skip--;
+    }
+    while (rows.size() < count && !file.atEnd()) {
+        QByteArray line = file.readLine();
+        if (!line.endsWith('\n')) break;    // A truncated last row is not shown
+        line.chop(1);
+        if (line.endsWith('\r')) line.chop(1);
+        rows << QString::fromUtf8(line);
+    }
+    return true;
+}
+
+// Parse "key = label" lines
+bool EventMarkers::parseHotkeys(const QString &text, QMap<int, QString> &labels, QString *errorString)
+{
+    labels.clear();
+    const QStringList lines = text.split('\n');
+
+    for (int lineNumber = 0; lineNumber < lines.size(); ++lineNumber) {
+        QString line = lines[lineNumber].trimmed();
+        if (line.isEmpty()) continue;
+
+        int separator = line.indexOf('=');
+        QString keyName = separator < 0 ? QString() : line.left(separator).trimmed();
+        QString label = separator < 0 ? QString() : line.mid(separator + 1).trimmed();
+        if (keyName.isEmpty() || label.isEmpty()) {
+            if (errorString) *errorString = QString("Line %1: expected 'key = label'").arg(lineNumber + 1);
+            return false;
+        }
+
+        // One key without modifiers, so that a marker is a single key press
+        QKeySequence sequence = QKeySequence::fromString(keyName, QKeySequence::PortableText);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        int key = sequence.count() == 1 ? sequence[0].toCombined() : 0;
+#else
+        int key = sequence.count() == 1 ? sequence[0] : 0;
+#endif
+        if (key == 0 || (key & Qt::KeyboardModifierMask)) {
+            if (errorString) *errorString = QString("Line %1: '%2' is not a single key").arg(lineNumber + 1).arg(keyName);
+            return false;
+        }
+        if (labels.contains(key)) {
+            if (errorString) *errorString = QString("Line %1: %2 is used twice").arg(lineNumber + 1).arg(keyName);
+            return false;
+        }
+        labels.insert(key, label);
+    }
+    return true;
+}
+
+// Format hotkeys the way parseHotkeys reads them
+QString EventMarkers::formatHotkeys(const QMap<int, QString> &labels)
+{
+    QStringList lines;
+    for (auto it = labels.constBegin(); it != labels.constEnd(); ++it) {
+        lines << QKeySequence(it.key()).toString(QKeySequence::PortableText) + " = " + it.value();
+    }
+    return lines.join("\n");
+}
+
+// Markers the operators asked for most
+QMap<int, QString> EventMarkers::defaultHotkeys()
+{
+    QMap<int, QString> labels;
+    labels.insert(Qt::Key_F1, "probe placed");
+    labels.insert(Qt::Key_F2, "probe removed");
+    labels.insert(Qt::Key_F3, "patient moved");
+    labels.insert(Qt::Key_F4, "marker");
+    return labels;
+}
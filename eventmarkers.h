@@ -0,0 +1,51 @@
+#ifndef EVENTMARKERS_H
+#define EVENTMARKERS_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// An operator note such as "probe placed", stamped when the key was pressed
+struct EventMarker
+{
+    qint64 row = 0;                     // Data rows recorded before the marker (index of the next row)
+    qint64 timestampNs = 0;             // Monotonic time on the same clock as the frame timestamps
+    QDateTime wallTime;                 // Wall time in the format of the recording timestamps
+    QString label;
+};
+
+// Event markers are kept next to the recording ("<recording>.events") as CSV
+// lines "row,timestamp,monotonic ns,label", in the order they were made. The
+// row indexes the recording, so a marker can be found without searching the
+// timestamps; the manifest records how many markers there should be.
+class EventMarkers
+{
+public:
+    static const char Header[];
+
+    // Labels the capture writes itself when it is paused and resumed
+    static const char PauseLabel[];
+    static const char ResumeLabel[];
+
+    static QString fileNameFor(const QString &recordingFileName);
+
+    // Append one marker line (the label may contain commas but no line breaks)
+    static void appendLine(QByteArray &out, const EventMarker &marker);
+
+    static bool load(const QString &fileName, QVector<EventMarker> &markers, QString *errorString = nullptr);
+
+    // Data rows [firstRow, firstRow + count) of a recording as text, seeking
+    // through the manifest blocks instead of reading from the start
+    static bool readRows(const QString &recordingFileName, qint64 firstRow, int count,
+                         QStringList &rows, QString *errorString = nullptr);
+
+    // Hotkeys as "F1 = probe placed", one per line (keys are Qt::Key values)
+    static bool parseHotkeys(const QString &text, QMap<int, QString> &labels, QString *errorString = nullptr);
+    static QString formatHotkeys(const QMap<int, QString> &labels);
+    static QMap<int, QString> defaultHotkeys();
+};
+
+#endif // EVENTMARKERS_H
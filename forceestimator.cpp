@@ -0,0 +1,130 @@
+// Include necessary headers
+#include "forceestimator.h"
+#include "frameblock.h"                 // For filtering whole blocks
+#include <cmath>                        // For sqrt
+
+// Gaps longer than this restart the filter instead of extrapolating across them
+static const qint64 MaxGapNs = 1000000000;
+
+// Initial rate uncertainty (counts/s) when the filter starts
+static const double InitialRateStdDev = 1000.0;
+
+// ForceEstimator constructor
+ForceEstimator::ForceEstimator()
+    : initialized(false)
+    , lastTimestampNs(0)
+    , measurementStdDev(2.0)            // Typical ADC noise of the load cells
+    , processNoiseDensity(2000.0)       // Follows a press or release within a fraction of a second
+{
+}
+
+// Set how noisy a single reading is
+void ForceEstimator::setMeasurementNoise(double countsStdDev)
+{
+    measurementStdDev = qMax(1e-3, countsStdDev);
+}
+
+// Set how quickly the rate of change may vary
+void ForceEstimator::setProcessNoise(double countsPerSecondSquared)
+{
+    processNoiseDensity = qMax(1e-6, countsPerSecondSquared);
+}
+
+// Restart the filter on the next frame
+void ForceEstimator::reset()
+{
+    initialized = false;
+}
+
+// Run one predict/update step for every channel
+void ForceEstimator::update(SensorFrame &frame)
+{
+    const qint64 elapsedNs = frame.timestampNs - lastTimestampNs;
+    const bool restart = restarts(initialized, elapsedNs);
+    const double dt = elapsedNs / 1e9;
+    for (int channel = 0; channel < ChannelCount; ++channel) step(channels[channel], frame.raw[channel], restart, dt);
+    initialized = true;
+    lastTimestampNs = frame.timestampNs;
+
+    // Publish the estimates in the same zero-adjusted units as the display
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        const ChannelState &state = channels[channel];
+        frame.filtered[channel] = state.force - (frame.raw[channel] - frame.zeroed[channel]);
+        frame.rate[channel] = state.rate;
+        frame.forceStdDev[channel] = std::sqrt(qMax(0.0, state.p00));
+        frame.rateStdDev[channel] = std::sqrt(qMax(0.0, state.p11));
+    }
+}
+
+// Run the filter down each channel column of a block
+void ForceEstimator::update(FrameBlock &block)
+{
+    const int count = block.size();
+    if (count == 0) return;
+    const qint64 *timestamps = block.timestamps();
+
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        const int *raw = block.raw(channel);
+        const int *zeroed = block.zeroed(channel);
+        double *filtered = block.filtered(channel);
+        double *rate = block.rate(channel);
+        double *forceStdDev = block.forceStdDev(channel);
+        double *rateStdDev = block.rateStdDev(channel);
+
+        // Every channel starts from the timing the block started with
+        ChannelState state = channels[channel];
+        bool wasInitialized = initialized;
+        qint64 previousNs = lastTimestampNs;
+        for (int index = 0; index < count; ++index) {
+            const qint64 elapsedNs = timestamps[index] - previousNs;
+            step(state, raw[index], restarts(wasInitialized, elapsedNs), elapsedNs / 1e9);
+            wasInitialized = true;
+            previousNs = timestamps[index];
+
+            filtered[index] = state.force - (raw[index] - zeroed[index]);
+            rate[index] = state.rate;
+            forceStdDev[index] = std::sqrt(qMax(0.0, state.p00));
+            rateStdDev[index] = std::sqrt(qMax(0.0, state.p11));
+        }
+        channels[channel] = state;
+    }
+    initialized = true;
+    lastTimestampNs = timestamps[count - 1];
+}
+
+// (Re)start from the first reading after a reset or a long gap
+bool ForceEstimator::restarts(bool initialized, qint64 elapsedNs)
+{
+    return !initialized || elapsedNs > MaxGapNs || elapsedNs < 0;
+}
+
+void ForceEstimator::step(ChannelState &state, int raw, bool restart, double dt) const
+{
+    const double r = measurementStdDev * measurementStdDev;
+    if (restart) {
+        state.force = raw;
+        state.rate = 0;
+        state.p00 = r;
+        state.p01 = 0;
+        state.p11 = InitialRateStdDev * InitialRateStdDev;
+        return;
+    }
+
+    // Predict: force moves along the current rate, uncertainty grows
+    const double q = processNoiseDensity;
+    state.force += state.rate * dt;
+    state.p00 += dt * (2 * state.p01 + dt * state.p11) + q * dt * dt * dt / 3;
+    state.p01 += dt * state.p11 + q * dt * dt / 2;
+    state.p11 += q * dt;
+
+    // Update: blend in the new reading according to the Kalman gain
+    const double innovation = raw - state.force;
+    const double s = state.p00 + r;
+    const double k0 = state.p00 / s;
+    const double k1 = state.p01 / s;
+    state.force += k0 * innovation;
+    state.rate += k1 * innovation;
+    state.p11 -= k1 * state.p01;
+    state.p00 -= k0 * state.p00;
+    state.p01 -= k0 * state.p01;
+}
@@ -0,0 +1,57 @@
+#ifndef FORCEESTIMATOR_H
+#define FORCEESTIMATOR_H
+
+#include <QtGlobal>
+#include "sensorframe.h"
+
+class FrameBlock;
+
+// Per-channel Kalman filter with a constant-rate model.
+// Each channel tracks force and its rate of change; the process noise sets how
+// quickly the rate may change, the measurement noise how much a single reading
+// is trusted. Cheap enough to run on every frame (a few dozen flops per channel).
+class ForceEstimator
+{
+public:
+    ForceEstimator();
+
+    // Tuning, in sensor counts
+    void setMeasurementNoise(double countsStdDev);
+    void setProcessNoise(double countsPerSecondSquared);
+    double measurementNoise() const { return measurementStdDev; }
+    double processNoise() const { return processNoiseDensity; }
+
+    // Forget all state; the next frame re-initializes the filter
+    void reset();
+
+    // Filter the raw values of a frame and store force, rate and uncertainty in it
+    void update(SensorFrame &frame);
+
+    // The same for every frame of a block, one channel column at a time (the
+    // channels are independent); gives the same values as update() frame by frame
+    void update(FrameBlock &block);
+
+private:
+    // Filter state of one channel
+    struct ChannelState {
+        double force = 0;               // Estimated raw force (counts)
+        double rate = 0;                // Estimated rate of change (counts/s)
+        double p00 = 0;                 // Covariance of force
+        double p01 = 0;                 // Covariance of force and rate
+        double p11 = 0;                 // Covariance of rate
+    };
+
+    // Whether a frame elapsedNs after the one before restarts the filter
+    static bool restarts(bool initialized, qint64 elapsedNs);
+
+    // One predict/update step of a channel, or a restart at the reading
+    void step(ChannelState &state, int raw, bool restart, double dt) const;
+
+    ChannelState channels[ChannelCount];
+    bool initialized;
+    qint64 lastTimestampNs;
+    double measurementStdDev;
+    double processNoiseDensity;
+};
+
+#endif // FORCEESTIMATOR_H
@@ -0,0 +1,72 @@
+// Include necessary headers
+#include "frameblock.h"
+
+// FrameBlock constructor
+FrameBlock::FrameBlock()
+    : d(new Data)
+{
+}
+
+// Empty the block; a block still held elsewhere is left to its holders
+void FrameBlock::clear()
+{
+    if (d.constData()->ref.loadRelaxed() == 1) d->size = 0;
+    else d = QSharedDataPointer<Data>(new Data);
+}
+
+void FrameBlock::resize(int size)
+{
+    Q_ASSERT(size >= 0 && size <= Capacity);
+    d->size = size;
+}
+
+void FrameBlock::append(const SensorFrame &frame)
+{
+    Q_ASSERT(!isFull());
+    int index = d->size++;
+    writeFrame(index, frame);
+}
+
+// Gather one frame from the columns
+void FrameBlock::readFrame(int index, SensorFrame &frame) const
+{
+    frame.sequence = d->sequence[index];
+    frame.timestampNs = d->timestampNs[index];
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        frame.raw[channel] = d->raw[channel][index];
+        frame.zeroed[channel] = d->zeroed[channel][index];
+        frame.filtered[channel] = d->filtered[channel][index];
+        frame.rate[channel] = d->rate[channel][index];
+        frame.forceStdDev[channel] = d->forceStdDev[channel][index];
+        frame.rateStdDev[channel] = d->rateStdDev[channel][index];
+    }
+    for (int derived = 0; derived < MaxDerivedChannels; ++derived) {
+        frame.derived[derived] = d->derived[derived][index];
+    }
+}
+
+// Scatter one frame into the columns
+void FrameBlock::writeFrame(int index, const SensorFrame &frame)
+{
+    Data *data = d.data();              // Detaches once, not per field
+    data->sequence[index] = frame.sequence;
+    data->timestampNs[index] = frame.timestampNs;
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        data->raw[channel][index] = frame.raw[channel];
+        data->zeroed[channel][index] = frame.zeroed[channel];
+        data->filtered[channel][index] = frame.filtered[channel];
+        data->rate[channel][index] = frame.rate[channel];
+        data->forceStdDev[channel][index] = frame.forceStdDev[channel];
+        data->rateStdDev[channel][index] = frame.rateStdDev[channel];
+    }
+    for (int derived = 0; derived < MaxDerivedChannels; ++derived) {
+        data->derived[derived][index] = frame.derived[derived];
+    }
+}
+
+SensorFrame FrameBlock::frame(int index) const
+{
+    SensorFrame frame;
+    readFrame(index, frame);
+    return frame;
+}
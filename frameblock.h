@@ -0,0 +1,73 @@
+#ifndef FRAMEBLOCK_H
+#define FRAMEBLOCK_H
+
+#include <QSharedDataPointer>
+#include "sensorframe.h"
+
+// Up to Capacity consecutive frames in structure-of-arrays layout: one array
+// per field and channel, so a stage can run a tight loop over one channel of
+// the whole block. Blocks are implicitly shared: passing one on only counts a
+// reference, and the frames are copied the first time a holder writes to a
+// block someone else still holds.
+class FrameBlock
+{
+public:
+    static const int Capacity = 256;
+
+    FrameBlock();
+
+    int size() const { return d->size; }
+    bool isEmpty() const { return d->size == 0; }
+    bool isFull() const { return d->size == Capacity; }
+    void clear();
+
+    // Set the number of frames; new frames are left for the caller to fill column by column
+    void resize(int size);
+
+    // Add a frame at the end (the block must not be full)
+    void append(const SensorFrame &frame);
+
+    // Copy one frame out of the columns, or back into them
+    void readFrame(int index, SensorFrame &frame) const;
+    void writeFrame(int index, const SensorFrame &frame);
+    SensorFrame frame(int index) const;
+
+    // Columns, one array of size() values each; the non-const ones detach a shared block
+    const qint64 *timestamps() const { return d->timestampNs; }
+    qint64 *timestamps() { return d->timestampNs; }
+    const quint64 *sequences() const { return d->sequence; }
+    quint64 *sequences() { return d->sequence; }
+    const int *raw(int channel) const { return d->raw[channel]; }
+    int *raw(int channel) { return d->raw[channel]; }
+    const int *zeroed(int channel) const { return d->zeroed[channel]; }
+    int *zeroed(int channel) { return d->zeroed[channel]; }
+    const double *filtered(int channel) const { return d->filtered[channel]; }
+    double *filtered(int channel) { return d->filtered[channel]; }
+    const double *rate(int channel) const { return d->rate[channel]; }
+    double *rate(int channel) { return d->rate[channel]; }
+    const double *forceStdDev(int channel) const { return d->forceStdDev[channel]; }
+    double *forceStdDev(int channel) { return d->forceStdDev[channel]; }
+    const double *rateStdDev(int channel) const { return d->rateStdDev[channel]; }
+    double *rateStdDev(int channel) { return d->rateStdDev[channel]; }
+    const double *derived(int index) const { return d->derived[index]; }
+    double *derived(int index) { return d->derived[index]; }
+    qint64 lastTimestampNs() const { return d->size > 0 ? d->timestampNs[d->size - 1] : 0; }
+
+private:
+    struct Data : QSharedData {
+        int size = 0;
+        quint64 sequence[Capacity];
+        qint64 timestampNs[Capacity];
+        int raw[ChannelCount][Capacity];
+        int zeroed[ChannelCount][Capacity];
+        double filtered[ChannelCount][Capacity];
+        double rate[ChannelCount][Capacity];
+        double forceStdDev[ChannelCount][Capacity];
+        double rateStdDev[ChannelCount][Capacity];
+        double derived[MaxDerivedChannels][Capacity];
+    };
+
+    QSharedDataPointer<Data> d;
+};
+
+#endif // FRAMEBLOCK_H
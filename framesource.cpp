@@ -0,0 +1,243 @@
+// Include necessary headers
+#include "framesource.h"
+#include "allocationstats.h"            // For tagging the parse stage
+#include <QTimer>                       // For command timeouts, link retries and block deadlines
+#include <cstring>                      // For memchr
+
+// Lines longer than this cannot be sensor readings; drop them instead of buffering forever
+static const int MaxLineLength = 1024;
+
+// FrameSource constructor
+FrameSource::FrameSource(QObject *parent)
+    : QObject(parent)
+    , clock(Clock::system())
+    , commandTimer(nullptr)
+    , linkTimer(nullptr)
+    , blockSize(1)
+    , blockDelayMs(0)
+    , blockTimer(nullptr)
+    , frames(0)
+    , malformed(0)
+{
+}
+
+// Split a chunk of received bytes into lines
+void FrameSource::receiveData(const char *data, qint64 length, qint64 timestampNs)
+{
+    const char *end = data + length;
+
+    // Complete the line left over from the previous chunk first
+    if (!pending.isEmpty()) {
+        const char *newline = static_cast<const char *>(std::memchr(data, '\n', size_t(length)));
+        if (!newline) {
+            pending.append(data, int(length));
+            if (pending.size() > MaxLineLength) {
+                pending.clear();
+                malformed++;
+            }
+            return;
+        }
+        pending.append(data, int(newline - data));
+        if (SensorCommands::isResponse(pending.constData(), pending.size())) {
+            receiveResponse(pending.constData(), pending.size());
+        } else {
+            receiveLine(pending.constData(), pending.size(), timestampNs);
+        }
+        pending.clear();
+        data = newline + 1;
+    }
+
+    // Lines wholly inside this chunk are parsed straight from it
+    while (data < end) {
+        const char *newline = static_cast<const char *>(std::memchr(data, '\n', size_t(end - data)));
+        if (!newline) break;
+        if (SensorCommands::isResponse(data, newline - data)) receiveResponse(data, newline - data);
+        else receiveLine(data, newline - data, timestampNs);
+        data = newline + 1;
+    }
+
+    // Keep the incomplete tail for the next chunk
+    if (data < end) {
+        if (end - data > MaxLineLength) malformed++;
+        else pending.append(data, int(end - data));
+    }
+}
+
+// Parse one line and hand the frame to whoever is listening
+void FrameSource::receiveLine(const char *line, qint64 length, qint64 timestampNs)
+{
+    if (length > 0 && line[length - 1] == '\r') --length;
+
+    SensorFrame frame;
+    if (!ReliableLink::isReliableLine(line, length)) {
+        if (link.isActive()) {
+            // The board left reliable mode; what the link holds comes first
+            link.restart();
+            serviceLink();
+        }
+        if (parseLine(line, length, frame)) deliverFrame(frame, timestampNs);
+        return;
+    }
+
+    quint32 sequence;
+    const char *reading;
+    qint64 readingLength;
+    if (!ReliableLink::checkLine(line, length, sequence, reading, readingLength)) {
+        malformed++;
+        link.countCorrupt();
+        return;                         // The gap it leaves is asked for again
+    }
+    if (parseLine(reading, readingLength, frame)) {
+        link.accept(sequence, frame, timestampNs, now());
+        serviceLink();
+    }
+}
+
+// Parse one line into a frame, counting lines that are not readings
+bool FrameSource::parseLine(const char *line, qint64 length, SensorFrame &frame)
+{
+    if (length > 0 && line[length - 1] == '\r') --length;   // The sensor ends lines with CRLF
+    if (length == 0) return false;
+
+    bool parsed;
+    {
+        AllocationScope scope(AllocationStats::StageParse);
+        parsed = parseSensorLine(QByteArray::fromRawData(line, int(length)), frame);
+    }
+    if (!parsed) {
+        malformed++;
+        return false;
+    }
+    AllocationStats::recordFrame(AllocationStats::StageParse);
+    return true;
+}
+
+// Stamp a parsed frame and emit it, or add it to the block
+void FrameSource::deliverFrame(SensorFrame &frame, qint64 timestampNs)
+{
+    frame.timestampNs = timestampNs;
+    frames++;
+    if (blockSize <= 1) {
+        emit frameReceived(frame);
+        return;
+    }
+
+    block.append(frame);
+    if (block.size() >= blockSize) flushBlock();
+    else if (block.size() == 1) blockTimer->start(blockDelayMs);
+}
+
+void FrameSource::setBlockDelivery(int maxFrames, int maxDelayMs)
+{
+    flushBlock();
+    blockSize = qBound(1, maxFrames, int(FrameBlock::Capacity));
+    blockDelayMs = qMax(0, maxDelayMs);
+    if (blockSize > 1 && !blockTimer) {
+        blockTimer = new QTimer(this);
+        blockTimer->setSingleShot(true);
+        blockTimer->setTimerType(Qt::PreciseTimer);
+        connect(blockTimer, &QTimer::timeout, this, &FrameSource::flushBlock);
+    }
+}
+
+// Hand the collected frames on and collect into the other of two blocks, so
+// neither frames nor blocks are copied or allocated once both exist
+void FrameSource::flushBlock()
+{
+    if (blockTimer) blockTimer->stop();
+    if (block.isEmpty()) return;
+
+    FrameBlock full = block;            // Another reference, so a receiver may flush again
+    qSwap(block, spare);
+    block.clear();                      // Reuses the storage unless a receiver kept the block
+    emit blockReceived(full);
+}
+
+// Send a command and watch for its answer
+int FrameSource::sendCommand(const QByteArray &command, int timeoutMs)
+{
+    if (!supportsCommands() || !isOpen()) return -1;
+
+    QByteArray line;
+    int id = commands.request(command, now(), timeoutMs, line);
+    if (id < 0) return -1;
+    if (!writeCommand(line)) {
+        commands.cancel(id);            // The other requests are still waited for
+        return -1;
+    }
+
+    if (!commandTimer) {
+        commandTimer = new QTimer(this);
+        commandTimer->setSingleShot(true);
+        connect(commandTimer, &QTimer::timeout, this, &FrameSource::reportCommands);
+    }
+    reportCommands();                   // Rearms the timer for the earliest deadline
+    return id;
+}
+
+// Match a response line
+void FrameSource::receiveResponse(const char *line, qint64 length)
+{
+    if (length > 0 && line[length - 1] == '\r') --length;
+    if (commands.handleResponse(line, length, now())) reportCommands();
+}
+
+// Forget outstanding commands and the link's state
+void FrameSource::resetCommands()
+{
+    commands.reset();
+    if (commandTimer) commandTimer->stop();
+    link.reset();
+    if (linkTimer) linkTimer->stop();
+}
+
+QString FrameSource::statistics() const
+{
+    return link.isActive() ? link.statistics() : QString();
+}
+
+// Report finished commands and wait for the next deadline
+void FrameSource::reportCommands()
+{
+    qint64 nowNs = now();
+    commands.expire(nowNs);
+
+    SensorCommands::Reply reply;
+    while (commands.takeReply(reply)) {
+        emit commandFinished(reply.id, reply.command, reply.ok, reply.text, reply.latencyNs);
+    }
+
+    qint64 deadline = commands.nextDeadlineNs();
+    if (deadline < 0) {
+        if (commandTimer) commandTimer->stop();
+    } else {
+        commandTimer->start(int(qMax<qint64>(0, (deadline - nowNs + 999999) / 1000000)));
+    }
+}
+
+// Send the link's resend requests, deliver its frames and wait for the next retry
+void FrameSource::serviceLink()
+{
+    qint64 nowNs = now();
+    link.service(nowNs);
+
+    quint32 first, count;
+    while (link.takeResendRequest(first, count)) {
+        writeCommand("!RESEND " + QByteArray::number(first) + " " + QByteArray::number(count) + "\n");
+    }
+
+    ReliableLink::Delivery delivery;
+    while (link.takeDelivery(delivery)) deliverFrame(delivery.frame, delivery.timestampNs);
+
+    qint64 deadline = link.nextDeadlineNs();
+    if (deadline < 0) {
+        if (linkTimer) linkTimer->stop();
+        return;
+    }
+    if (!linkTimer) {
+        linkTimer = new QTimer(this);
+        linkTimer->setSingleShot(true);
+        connect(linkTimer, &QTimer::timeout, this, &FrameSource::serviceLink);
+    }
+    linkTimer->start(int(qMax<qint64>(0, (deadline - nowNs + 999999) / 1000000)));
+}
@@ -0,0 +1,119 @@
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <QObject>
+#include <QByteArray>
+#include "sensorframe.h"
+#include "frameblock.h"
+#include "clock.h"
+#include "sensorcommands.h"
+#include "reliablelink.h"
+
+class QTimer;
+
+// Where sensor readings come from. Every source delivers the sensor's ASCII
+// lines to the same parser, so everything downstream of parsing (zeroing,
+// estimation, recording) is identical whatever the input is.
+class FrameSource : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FrameSource(QObject *parent = nullptr);
+
+    virtual bool open(QString *errorString = nullptr) = 0;
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0;
+
+    // Short description for the status bar, e.g. "COM3" or "Simulator 1000 Hz"
+    virtual QString description() const = 0;
+
+    // Time base for frame timestamps and pacing (the system clock unless set); must outlive the source
+    void setClock(const Clock *clock) { this->clock = clock; }
+
+    // Deliver everything due at the clock's current time. Sources that pace
+    // themselves (simulator, replay) call this from their timers; on a virtual
+    // clock the caller drives it after advancing the time.
+    virtual void poll() {}
+
+    // Deliver frames in blocks of up to maxFrames through blockReceived(), a
+    // partial block at most maxDelayMs after its first frame arrived. One frame
+    // per block (the default) delivers each frame by itself through frameReceived().
+    void setBlockDelivery(int maxFrames, int maxDelayMs);
+    int blockFrames() const { return blockSize; }
+
+    // Deliver the frames collected so far (e.g. before reading the latest frame)
+    void flushBlock();
+
+    quint64 framesReceived() const { return frames; }
+    quint64 malformedLines() const { return malformed; }
+
+    // Source specific counters for the statistics panel (the reliable link's, if in use)
+    virtual QString statistics() const;
+
+    // Send a command to the sensor board (see SensorCommands); returns the
+    // request id, or -1 if the source cannot send commands or too many are outstanding.
+    // The outcome is reported by commandFinished().
+    int sendCommand(const QByteArray &command, int timeoutMs = SensorCommands::DefaultTimeoutMs);
+    virtual bool supportsCommands() const { return false; }
+
+signals:
+    void frameReceived(const SensorFrame &frame);
+    void blockReceived(const FrameBlock &block);
+
+    // The source ended or failed by itself (end of replay, lost connection)
+    void stopped(const QString &reason);
+
+    // A command was answered or timed out
+    void commandFinished(int id, const QByteArray &command, bool ok, const QString &text, qint64 latencyNs);
+
+protected:
+    // Current time on the shared time base in nanoseconds
+    qint64 now() const { return clock->nowNs(); }
+
+    // Split received bytes into lines; an incomplete last line is kept for the next call
+    void receiveData(const char *data, qint64 length, qint64 timestampNs);
+
+    // Parse one complete line (without its line ending) and deliver the frame;
+    // reliable lines (see ReliableLink) go through the link first
+    virtual void receiveLine(const char *line, qint64 length, qint64 timestampNs);
+
+    // Write a command line to the board; sources that support commands override this
+    virtual bool writeCommand(const QByteArray &line) { Q_UNUSED(line); return false; }
+
+    // Match a command response line (one starting with '$') to its request
+    void receiveResponse(const char *line, qint64 length);
+
+    // Drop outstanding commands and the reliable link's state (call when opening and closing)
+    void resetCommands();
+
+    // Building blocks of receiveLine for sources that hold frames back (e.g. to reorder them)
+    bool parseLine(const char *line, qint64 length, SensorFrame &frame);
+    void deliverFrame(SensorFrame &frame, qint64 timestampNs);
+
+    // Count a reading that could not be decoded
+    void countMalformed() { malformed++; }
+
+    // Forget any partial line (call when reopening)
+    void resetLineBuffer() { pending.clear(); }
+
+private:
+    void reportCommands();
+    void serviceLink();
+
+    const Clock *clock;
+    QByteArray pending;
+    SensorCommands commands;
+    QTimer *commandTimer;               // Times out unanswered commands
+    ReliableLink link;
+    QTimer *linkTimer;                  // Retries and gives up on gaps
+    FrameBlock block;                   // Frames not yet delivered
+    FrameBlock spare;                   // The block delivered last, reused for the next one
+    int blockSize;
+    int blockDelayMs;
+    QTimer *blockTimer;                 // Flushes a partial block at its deadline
+    quint64 frames;
+    quint64 malformed;
+};
+
+#endif // FRAMESOURCE_H
@@ -0,0 +1,127 @@
+// Include necessary headers
+#include "latencymonitor.h"
+#include <QTimer>                       // For the heartbeat
+#include <QStringList>
+
+// The heartbeat fires this often; its lateness is the dispatch latency
+static const int HeartbeatIntervalMs = 5;
+
+// Add one duration
+void LatencyHistogram::add(qint64 nanoseconds)
+{
+    if (nanoseconds < 0) nanoseconds = 0;
+
+    // Bucket 0 is below 1 us, bucket b covers [2^(b-1), 2^b) us, the last one everything above
+    qint64 microseconds = nanoseconds / 1000;
+    int bucket = 0;
+    while (microseconds > 0 && bucket < BucketCount - 1) {
+        microseconds >>= 1;
+        bucket++;
+    }
+
+    buckets[bucket]++;
+    samples++;
+    total += nanoseconds;
+    maximum = qMax(maximum, nanoseconds);
+}
+
+// Percentiles are only as fine as the buckets, so report the bucket's upper edge
+qint64 LatencyHistogram::percentileNs(double fraction) const
+{
+    if (samples == 0) return 0;
+
+    quint64 wanted = quint64(fraction * samples);
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < BucketCount; ++bucket) {
+        seen += buckets[bucket];
+        if (seen > wanted) {
+            if (bucket == BucketCount - 1) return maximum;
+            return qMin((qint64(1) << bucket) * 1000, maximum);
+        }
+    }
+    return maximum;
+}
+
+// Summary line with a character per bucket: ' ' empty, then . : - = + * # for growing shares
+QString LatencyHistogram::format(const char *name) const
+{
+    if (samples == 0) return QString("%1: idle").arg(name);
+
+    static const char levels[] = " .:-=+*#";
+    QString bars;
+    for (int bucket = 0; bucket < BucketCount; ++bucket) {
+        int level = 0;
+        if (buckets[bucket] > 0) {
+            // Share of samples on a rough log scale so rare slow events stay visible
+            double share = double(buckets[bucket]) / samples;
+            level = 1;
+            while (level < 7 && share > 1.0 / (qint64(1) << (2 * (7 - level)))) level++;
+        }
+        bars += QChar(levels[level]);
+    }
+
+    return QString("%1: n=%2 p50<%3 p99<%4 max %5 ms |%6|")
+        .arg(name, -9)
+        .arg(samples)
+        .arg(percentileNs(0.5) / 1e6, 0, 'f', 2)
+        .arg(percentileNs(0.99) / 1e6, 0, 'f', 2)
+        .arg(maximum / 1e6, 0, 'f', 2)
+        .arg(bars);
+}
+
+// LatencyMonitor constructor
+LatencyMonitor::LatencyMonitor(QObject *parent)
+    : QObject(parent)
+    , timer(new QTimer(this))
+    , clock(Clock::system())
+    , expectedNs(0)
+{
+    timer->setTimerType(Qt::PreciseTimer);
+    timer->setSingleShot(true);         // Rearmed by every beat, see heartbeat()
+    connect(timer, &QTimer::timeout, this, &LatencyMonitor::heartbeat);
+}
+
+void LatencyMonitor::start()
+{
+    expectedNs = now() + HeartbeatIntervalMs * 1000000LL;
+    timer->start(HeartbeatIntervalMs);
+}
+
+void LatencyMonitor::stop()
+{
+    timer->stop();
+}
+
+// Heartbeat timer handler
+void LatencyMonitor::heartbeat()
+{
+    // How much later than scheduled the event loop got round to us
+    qint64 current = now();
+    record(ProbeHeartbeat, current - expectedNs);
+
+    // Rearm from now so one long stall is counted once, not for every missed beat
+    expectedNs = current + HeartbeatIntervalMs * 1000000LL;
+    timer->start(HeartbeatIntervalMs);
+}
+
+const char *LatencyMonitor::probeName(Probe probe)
+{
+    switch (probe) {
+    case ProbeHeartbeat: return "dispatch";
+    case ProbeFrame:     return "frame";
+    case ProbeCapture:   return "capture";
+    case ProbeRepaint:   return "repaint";
+    default:             return "other";
+    }
+}
+
+// Format every histogram
+QString LatencyMonitor::report(bool reset)
+{
+    QStringList lines;
+    for (int probe = 0; probe < ProbeCount; ++probe) {
+        lines << histograms[probe].format(probeName(static_cast<Probe>(probe)));
+        if (reset) histograms[probe].clear();
+    }
+    return lines.join("\n");
+}
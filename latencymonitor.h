@@ -0,0 +1,94 @@
+#ifndef LATENCYMONITOR_H
+#define LATENCYMONITOR_H
+
+#include <QObject>
+#include <QString>
+#include "clock.h"
+
+class QTimer;
+
+// Durations in power-of-two microsecond buckets, from below 1 us to over 1 s
+class LatencyHistogram
+{
+public:
+    static const int BucketCount = 22;
+
+    void add(qint64 nanoseconds);
+    void clear() { *this = LatencyHistogram(); }
+
+    quint64 count() const { return samples; }
+    qint64 maximumNs() const { return maximum; }
+
+    // Upper bound of the bucket holding the given fraction of samples, in nanoseconds
+    qint64 percentileNs(double fraction) const;
+
+    // One line: count, p50, p99, max and a character per bucket
+    QString format(const char *name) const;
+
+private:
+    quint64 buckets[BucketCount] = {};
+    quint64 samples = 0;
+    qint64 total = 0;
+    qint64 maximum = 0;
+};
+
+// Watches the GUI event loop: how late a fast heartbeat timer fires (dispatch
+// latency) and how long the work sharing the loop takes (frame handling, the
+// capture tick and repaints), so that UI work that starves acquisition shows up.
+class LatencyMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Probe {
+        ProbeHeartbeat = 0,             // Lateness of the heartbeat timer
+        ProbeFrame,                     // Handling one frame from the data source
+        ProbeCapture,                   // One tick of the capture timer
+        ProbeRepaint,                   // Painting the main window
+        ProbeCount
+    };
+
+    explicit LatencyMonitor(QObject *parent = nullptr);
+
+    void start();
+    void stop();
+
+    // Time base for all measurements (the system clock unless set)
+    void setClock(const Clock *clock) { this->clock = clock; }
+
+    qint64 now() const { return clock->nowNs(); }
+    void record(Probe probe, qint64 nanoseconds) { histograms[probe].add(nanoseconds); }
+
+    const LatencyHistogram &histogram(Probe probe) const { return histograms[probe]; }
+
+    // All histograms, one per line; clears them when reset is true
+    QString report(bool reset);
+
+    static const char *probeName(Probe probe);
+
+private:
+    void heartbeat();
+
+    QTimer *timer;
+    const Clock *clock;
+    qint64 expectedNs;
+    LatencyHistogram histograms[ProbeCount];
+};
+
+// Records the time until it goes out of scope against a probe
+class LatencyScope
+{
+public:
+    LatencyScope(LatencyMonitor &monitor, LatencyMonitor::Probe probe)
+        : monitor(monitor), probe(probe), startNs(monitor.now()) {}
+    ~LatencyScope() { monitor.record(probe, monitor.now() - startNs); }
+
+private:
+    LatencyMonitor &monitor;
+    LatencyMonitor::Probe probe;
+    qint64 startNs;
+
+    Q_DISABLE_COPY(LatencyScope)
+};
+
+#endif // LATENCYMONITOR_H
@@ -1,9 +1,21 @@
 #include "mainwindow.h"
+#include "commandline.h"
 
 #include <QApplication>
+#include <QCoreApplication>
 
 int main(int argc, char *argv[])
 {
+    // Identifies where QSettings stores the user's configuration
+    QCoreApplication::setOrganizationName("Ultrasound-GUI");
+    QCoreApplication::setApplicationName("Reformatted_GUI");
+
+    // Headless tools run without creating any windows
+    if (isCommandLineMode(argc, argv)) {
+        QCoreApplication a(argc, argv);
+        return runCommandLine(a.arguments());
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
@@ -6,29 +6,193 @@
 #include <QDateTime>                   // For date/time handling
 #include <QDebug>                      // For debug output
 #include <QStandardPaths>              // For accessing standard system paths
+#include "sensorframe.h"                // For sensor frame parsing and CSV rows
+#include "recordingverifier.h"          // For checking finished recordings
+#include "timestampjoin.h"              // For matching ultrasound frames to recordings
+#include "eventmarkers.h"               // For operator markers in recordings
+#include "triggersequence.h"            // For Pico trigger protocols
+#include "triggergroup.h"               // For triggers on several devices
+#include "phaselock.h"                  // For triggers locked to the sensor samples
+#include "ratecontroller.h"             // For degrading orderly under overload
+#include "channelcorrelation.h"         // For the sampling lag between load cells
+#include "taskexecutor.h"               // For offline jobs on the shared workers
+#include "dashboardserver.h"            // For watching the rig from a browser
+#include "serialframesource.h"          // Data sources selectable in the UI
+#include "replayframesource.h"
+#include "simulatorframesource.h"
+#include "networkframesource.h"
+#include <QFileDialog>                 // For choosing recordings to verify
+#include <QFileInfo>                   // For default output names
+#include <QPointer>                    // For finishing offline jobs only while the window exists
+#include <QInputDialog>                // For editing derived channels
+#include <QLineEdit>                   // For the network address prompt
+#include <QSettings>                   // For persisting derived channels and alarm rules
+#include <QApplication>                // For the alarm beep
+#include <memory>                      // For sharing results with the worker
+
+// Entries of the data source combo box
+enum SourceType {
+    SourceSerial = 0,
+    SourceReplay,
+    SourceSimulator,
+    SourceNetwork,
+    SourceUdp
+};
 
 // MainWindow constructor
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)               // Initialize QMainWindow parent
     , ui(new Ui::MainWindow)            // Initialize UI
-    , _serialPort(nullptr)              // Initialize serial port pointer to null
+    , frameSource(nullptr)              // Initialize data source pointer to null
     , Pico_Port(nullptr)                 // Initialize Pico port pointer to null
     , csvRunning(false)                 // Initialize CSV recording flag to false
+    , csvFramesPerSecond(0)             // Initialize capture rate
+    , csvCaptureDuration(0)             // Initialize capture length
     , csvTimer(nullptr)                // Initialize CSV timer pointer to null
-    , zeroTopLeft(0)                    // Initialize top left zero offset
-    , zeroTopRight(0)                   // Initialize top right zero offset
-    , zeroBotLeft(0)                    // Initialize bottom left zero offset
+    , statsTimer(nullptr)              // Initialize statistics timer pointer to null
+    , clock(Clock::system())           // Real time unless a test supplies another clock
+    , sequenceTimer(nullptr)           // Initialize trigger sequence timer pointer to null
+    , sessionTimer(nullptr)
+    , sessionCapture(false)
+    , triggerGroup(nullptr)            // Initialize trigger group pointer to null
+    , keptTicks(0)
+    , dashboard(nullptr)
+    , blockFrames(1)
+    , blockDelayMs(0)
 {
     ui->setupUi(this);                  // Set up the UI
 
     // Setup UI ranges for controls
     ui->framesPerSecond->setRange(0.00000001, 1000);        // Set FPS range (very small to 1000)
     ui->captureLengthSeconds->setRange(1, 3600);            // Set capture length range (1-3600 seconds)
+    ui->sampleCount->setRange(1, 1000000000);               // Set sensor frame count range
+    ui->sampleCount->setValue(1000);
+    on_captureMode_currentIndexChanged(ui->captureMode->currentIndex());
 
     // Install event filters for numeric input controls
     ui->framesPerSecond->installEventFilter(this);          // Filter events for FPS control
     ui->captureLengthSeconds->installEventFilter(this);     // Filter events for capture length control
 
+    // Restore the derived channels from the last session
+    QSettings settings;
+    QVector<DerivedChannels::Definition> definitions;
+    QString error;
+    if (!DerivedChannels::parseDefinitions(settings.value("derivedChannels").toString(), definitions, &error) ||
+        !pipeline.derivedChannels().setDefinitions(definitions, &error)) {
+        qWarning() << "Ignoring saved derived channels:" << error;
+    }
+
+    // Restore the alarm rules (they may refer to the derived channels above)
+    QVector<AlarmEngine::Rule> rules;
+    if (!AlarmEngine::parseRules(settings.value("alarmRules").toString(), rules, &error) ||
+        !pipeline.alarmEngine().setRules(rules, pipeline.derivedChannels().names(), &error)) {
+        qWarning() << "Ignoring saved alarm rules:" << error;
+    }
+    updateAlarmDisplay();
+
+    // Restore the trigger sequence (it may refer to the derived channels too)
+    QString sequence = settings.value("triggerSequence").toString();
+    if (!sequence.isEmpty() &&
+        !triggerSequence.compile(sequence, pipeline.derivedChannels().names(), &error)) {
+        qWarning() << "Ignoring saved trigger sequence:" << error;
+    }
+
+    // Sequence steps are timed like capture ticks
+    sequenceTimer = new QTimer(this);
+    sequenceTimer->setSingleShot(true);
+    sequenceTimer->setTimerType(Qt::PreciseTimer);
+    connect(sequenceTimer, &QTimer::timeout, this, &MainWindow::sequenceTick);
+
+    // Restore the capture session protocol (conditions may use derived channels as well)
+    QString session = settings.value("captureSession").toString();
+    if (!session.isEmpty() &&
+        !captureSession.compile(session, pipeline.derivedChannels().names(), &error)) {
+        qWarning() << "Ignoring saved capture session:" << error;
+    }
+
+    // The session is advanced by its events; the timer covers waits and timeouts
+    sessionTimer = new QTimer(this);
+    sessionTimer->setSingleShot(true);
+    sessionTimer->setTimerType(Qt::PreciseTimer);
+    connect(sessionTimer, &QTimer::timeout, this, &MainWindow::sessionTick);
+
+    // The trigger group runs its ports on a thread of its own
+    triggerGroup = new TriggerGroup(this);
+    connect(triggerGroup, &TriggerGroup::failed, this, &MainWindow::triggerGroupFailed);
+
+    // Restore the web dashboard; it only listens on this computer unless allowed otherwise
+    dashboard = new DashboardServer(this);
+    DashboardServer::Settings web;
+    web.port = quint16(settings.value("dashboardPort", web.port).toUInt());
+    web.remote = settings.value("dashboardRemote", web.remote).toBool();
+    web.updateHz = settings.value("dashboardUpdateHz", web.updateHz).toInt();
+    web.pointsPerSecond = settings.value("dashboardPointsPerSecond", web.pointsPerSecond).toInt();
+    web.maxBytesPerSecond = settings.value("dashboardBytesPerSecond", web.maxBytesPerSecond).toInt();
+    dashboard->setSettings(web);
+    if (settings.value("webDashboard", false).toBool() && !dashboard->start(&error)) {
+        qWarning() << "Web dashboard not started:" << error;
+    }
+    ui->actionWebDashboard->setChecked(dashboard->isRunning());
+
+    // Restore baseline drift tracking
+    BaselineTracker::Settings baseline;
+    baseline.enabled = settings.value("baselineTracking", false).toBool();
+    baseline.threshold = settings.value("baselineThreshold", baseline.threshold).toDouble();
+    baseline.noise = settings.value("baselineNoise", baseline.noise).toDouble();
+    baseline.windowMs = settings.value("baselineWindowMs", baseline.windowMs).toDouble();
+    pipeline.baselineTracker().setSettings(baseline);
+    ui->actionTrackBaseline->setChecked(baseline.enabled);
+
+    // Restore the phase-locked trigger
+    PhaseLock::Settings lock;
+    lock.enabled = settings.value("phaseLock", false).toBool();
+    lock.every = settings.value("phaseLockEvery", lock.every).toInt();
+    lock.phase = settings.value("phaseLockPhase", lock.phase).toInt();
+    phaseLock.setSettings(lock);
+    ui->actionPhaseLock->setChecked(lock.enabled);
+
+    // Restore the overload policy
+    RateController::Settings overload;
+    overload.policy = static_cast<RateController::Policy>(
+        qBound<int>(RateController::PolicyOff, settings.value("overloadPolicy", RateController::PolicyOff).toInt(),
+                    RateController::PolicyAbort));
+    overload.maxLatenessMs = settings.value("overloadLatenessMs", overload.maxLatenessMs).toDouble();
+    overload.maxQueueBytes = settings.value("overloadQueueBytes", overload.maxQueueBytes).toInt();
+    rateController.setSettings(overload);
+
+    ui->actionMatchSensorRate->setChecked(settings.value("matchSensorRate", false).toBool());
+
+    blockFrames = qBound(1, settings.value("frameBlockFrames", 256).toInt(), int(FrameBlock::Capacity));
+    blockDelayMs = settings.value("frameBlockDelayMs", 10).toInt();
+
+    ChannelCorrelation::Settings lag;
+    lag.enabled = settings.value("channelLag", false).toBool();
+    lag.windowSamples = settings.value("channelLagWindow", lag.windowSamples).toInt();
+    lag.maxLagSamples = settings.value("channelLagMax", lag.maxLagSamples).toInt();
+    lag.bandHz = settings.value("channelLagBandHz", lag.bandHz).toDouble();
+    channelCorrelation.setSettings(lag);
+    ui->actionChannelLag->setChecked(lag.enabled);
+    ui->actionReliableLink->setChecked(settings.value("reliableLink", false).toBool());
+
+    // Restore the marker hotkeys
+    if (!EventMarkers::parseHotkeys(settings.value("markerHotkeys").toString(), markerHotkeys, &error)) {
+        qWarning() << "Ignoring saved marker hotkeys:" << error;
+        markerHotkeys.clear();
+    }
+    if (markerHotkeys.isEmpty()) markerHotkeys = EventMarkers::defaultHotkeys();
+
+    // Refresh the statistics panel once per second
+    lastAllocationSnapshot = AllocationStats::snapshot();
+    statsTimer = new QTimer(this);
+    connect(statsTimer, &QTimer::timeout, this, &MainWindow::updateStatistics);
+    statsTimer->start(1000);
+    latencyMonitor.start();            // Watch event loop latency from now on
+    updateStatistics();
+
+    // Restore the data source used last time
+    ui->sourceType->setCurrentIndex(settings.value("sourceType", SourceSerial).toInt());
+    on_sourceType_currentIndexChanged(ui->sourceType->currentIndex());
+
     // Refresh the list of available serial ports
     on_btnRefreshPorts_clicked();
 }
@@ -36,13 +200,10 @@ MainWindow::MainWindow(QWidget *parent)
 // MainWindow destructor
 MainWindow::~MainWindow()
 {
+    captureSession.cancel();            // A capture ending now does not resume the session
     stopCsvRecording();                 // Ensure CSV recording is stopped
 
-    // Clean up serial port resources
-    if (_serialPort) {
-        _serialPort->close();           // Close the serial port if open
-        delete _serialPort;             // Delete the serial port object
-    }
+    closeFrameSource();                 // Close the data source if open
 
     // Clean up Pico port resources
     if (Pico_Port) {
@@ -53,6 +214,16 @@ MainWindow::~MainWindow()
     delete ui;                         // Delete the UI object
 }
 
+// Time repaints of the main window, which run on the same event loop as acquisition
+bool MainWindow::event(QEvent *event)
+{
+    if (event->type() == QEvent::UpdateRequest) {
+        LatencyScope latency(latencyMonitor, LatencyMonitor::ProbeRepaint);
+        return QMainWindow::event(event);
+    }
+    return QMainWindow::event(event);
+}
+
 // Event filter for handling specific key events
 bool MainWindow::eventFilter(QObject *watched, QEvent *event)
 {
@@ -76,7 +247,15 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
 {
     if (event->isAutoRepeat()) return;  // Ignore auto-repeated key events
 
-    // Handle your key press events here
+    // Marker hotkeys are stamped on receipt, before anything else happens
+    auto hotkey = markerHotkeys.constFind(event->key());
+    if (hotkey != markerHotkeys.constEnd() && event->modifiers() == Qt::NoModifier) {
+        EventMarker marker = stampMarker();
+        marker.label = hotkey.value();
+        addMarker(marker);
+        return;
+    }
+
     QMainWindow::keyPressEvent(event);  // Pass to parent class
 }
 
@@ -93,24 +272,42 @@ void MainWindow::keyReleaseEvent(QKeyEvent *event)
 void MainWindow::on_btnStart_clicked()
 {
     // Get current values from UI
+    int mode = ui->captureMode->currentIndex();
     double fps = ui->framesPerSecond->value();      // Frames per second
     double duration = ui->captureLengthSeconds->value();  // Capture duration in seconds
+    qint64 sampleCount = ui->sampleCount->value();  // Sensor frames to record
 
     // Validate input values
-    if (fps <= 0 || duration <= 0) {
+    if (mode == CaptureScheduler::TerminateTicks && (fps <= 0 || duration <= 0)) {
         QMessageBox::warning(this, "Invalid Input",
                              "Frames per second and capture length must be greater than zero.");
         return;
     }
+    if (mode != CaptureScheduler::TerminateTicks && !frameSource) {
+        QMessageBox::warning(this, "No Data Source",
+                             "Open a data source first; this capture records its frames.");
+        return;
+    }
+
+    startCapture(mode, fps, duration, sampleCount);
+}
 
+// Start a capture that stops by itself as the mode says (see CaptureScheduler)
+void MainWindow::startCapture(int mode, double fps, double duration, qint64 sampleCount)
+{
     // Calculate total frames needed (rounded to nearest integer)
     int totalFrames = qRound(fps * duration);
 
+    // Frame-driven captures record every sensor frame, so there is no tick rate
+    csvFramesPerSecond = mode == CaptureScheduler::TerminateTicks ? fps : 0;   // Remember the settings for the manifest
+    csvCaptureDuration = mode == CaptureScheduler::TerminateFrames ? 0 : int(duration);
     startCsvRecording();  // Start CSV recording
-
-    // Setup progress bar range and initial value
-    ui->progressBar->setRange(0, totalFrames);  // Set range from 0 to total frames
-    ui->progressBar->setValue(0);               // Start at 0
+    phaseLock.restart();  // Phase-locked triggers count the samples of this capture
+    if (phaseLock.settings().enabled) {
+        logEvent(QString("phase lock every=%1 phase=%2").arg(phaseLock.settings().every)
+                     .arg(phaseLock.settings().phase), clock->nowNs());
+    }
+    ui->btnPause->setEnabled(csvRunning);
 
     // Clean up any existing timer
     if (csvTimer) {
@@ -118,41 +315,158 @@ void MainWindow::on_btnStart_clicked()
         csvTimer->deleteLater();     // Schedule for deletion
     }
 
-    // Create new timer for frame capture
+    // Create new timer for frame capture; it is rearmed for each tick the scheduler plans
     csvTimer = new QTimer(this);
-    int framesCaptured = 0;          // Counter for captured frames
-
-    // Connect timer timeout signal to capture lambda function
-    connect(csvTimer, &QTimer::timeout, this, [=]() mutable {
-        // Check if we've captured all needed frames
-        if (framesCaptured >= totalFrames) {
-            csvTimer->stop();        // Stop the timer
-            stopCsvRecording();      // Stop recording
-            return;
-        }
+    csvTimer->setSingleShot(true);
+    csvTimer->setTimerType(Qt::PreciseTimer);
+    connect(csvTimer, &QTimer::timeout, this, &MainWindow::captureTick);
+
+    // Ticks fall on exact multiples of the frame interval from now; frame-driven
+    // captures start with the first frame stamped from now on
+    switch (mode) {
+    case CaptureScheduler::TerminateFrames:
+        captureScheduler.startFrames(clock->nowNs(), sampleCount);
+        csvWriter.setTermination("frames", sampleCount);
+        break;
+    case CaptureScheduler::TerminateTime:
+        captureScheduler.startTimed(clock->nowNs(), qint64(duration * 1e9));
+        csvWriter.setTermination("time", 0);
+        break;
+    default:
+        captureScheduler.start(clock->nowNs(), fps, totalFrames);
+        break;
+    }
+
+    // Sample at the capture rate rather than decimating a faster stream
+    if (mode == CaptureScheduler::TerminateTicks && ui->actionMatchSensorRate->isChecked() &&
+        frameSource && frameSource->supportsCommands()) {
+        frameSource->sendCommand("RATE " + QByteArray::number(fps));
+    }
+
+    // Only tick-driven captures are rate controlled; note the policy in the recording
+    rateController.start(clock->nowNs(), fps);
+    keptTicks = 0;
+    if (triggerGroup->isOpen()) triggerGroup->takeWorstLatenessNs();
+    if (mode == CaptureScheduler::TerminateTicks && rateController.settings().policy != RateController::PolicyOff) {
+        logEvent(QString("overload policy %1")
+                     .arg(RateController::policyName(rateController.settings().policy)), clock->nowNs());
+    }
+
+    // Setup progress bar range and initial value (ticks, frames or milliseconds)
+    ui->progressBar->setRange(0, int(captureScheduler.progressTotal()));
+    ui->progressBar->setValue(0);
+    captureTick();
+
+    // Debug output of capture parameters
+    qDebug() << "Starting capture with:"
+             << "\nStop after:" << CaptureScheduler::terminationName(captureScheduler.termination())
+             << "\nFPS:" << fps
+             << "\nDuration:" << duration
+             << "\nTotal frames:" << (mode == CaptureScheduler::TerminateFrames ? sampleCount : totalFrames)
+             << "\nInterval:" << 1000.0 / fps << "ms";
+}
+
+// Capture mode selection handler
+void MainWindow::on_captureMode_currentIndexChanged(int index)
+{
+    // Only the settings the selected mode uses can be edited
+    ui->framesPerSecond->setEnabled(index == CaptureScheduler::TerminateTicks);
+    ui->captureLengthSeconds->setEnabled(index != CaptureScheduler::TerminateFrames);
+    ui->sampleCount->setEnabled(index == CaptureScheduler::TerminateFrames);
+}
+
+// Capture timer handler: write every row that is due, then wait for the next one
+void MainWindow::captureTick()
+{
+    LatencyScope latency(latencyMonitor, LatencyMonitor::ProbeCapture);
+
+    // Ticks record the latest frame, so frames waiting for their block deadline come first
+    if (frameSource) frameSource->flushBlock();
+
+    qint64 now = clock->nowNs();
+    int due = captureScheduler.takeDue(now);
+    qint64 firstTick = captureScheduler.issued() - due;
+    for (int i = 0; i < due; ++i) {
+        // Under the skip policy only every Nth tick is recorded and triggered
+        if (!rateController.keepTick(firstTick + i)) continue;
+        keptTicks++;
 
-        // Capture data to CSV
-        writeCsvData();
+        // Capture data to CSV, stamped with the time the tick was due so that
+        // caught-up rows keep the capture interval between them
+        writeCsvData(pipeline.latestFrame(), captureScheduler.tickDueNs(firstTick + i));
+
+        // Phase-locked triggers come from the sensor frames instead
+        if (phaseLock.settings().enabled) continue;
 
         // Send trigger to Pico if connected
         if (Pico_Port && Pico_Port->isOpen()) {
             Pico_Port->write("1");    // Send "1" as trigger
         }
 
-        framesCaptured++;            // Increment frame counter
-        ui->progressBar->setValue(framesCaptured);  // Update progress bar
-    });
+        // The group fires its outputs together, as soon as they can all be aligned
+        if (triggerGroup->isOpen()) {
+            triggerGroup->fire(triggerGroup->earliestTriggerNs());
+        }
+    }
+    if (due > 0 && handleOverload(now)) return;
+    if (updateCaptureProgress()) return;
+    if (!captureScheduler.isRunning()) return;
+
+    // Sleep until the next tick (or the end of a timed capture), rounding up so
+    // that it is due when the timer fires; frame counts need no timer
+    qint64 nextNs = captureScheduler.nextDueNs();
+    if (nextNs < 0) return;
+    qint64 waitNs = nextNs - clock->nowNs();
+    csvTimer->start(int(qMax<qint64>(0, (waitNs + 999999) / 1000000)));
+}
 
-    // Calculate timer interval in milliseconds (minimum 1ms)
-    int intervalMs = qMax(1, qRound(1000.0 / fps));
-    csvTimer->start(intervalMs);     // Start the timer
+// Feed the tick's load to the rate controller and apply its decision; true if the capture was aborted
+bool MainWindow::handleOverload(qint64 nowNs)
+{
+    RateController::Load load;
+    load.latenessNs = captureScheduler.backlogNs();
+    load.queueBytes = Pico_Port && Pico_Port->isOpen() ? Pico_Port->bytesToWrite() : 0;
+    load.deviceLatenessNs = triggerGroup->isOpen() ? triggerGroup->takeWorstLatenessNs() : 0;
+
+    switch (rateController.update(nowNs, load)) {
+    case RateController::ActionChange: {
+        if (rateController.settings().policy == RateController::PolicyReduce) {
+            captureScheduler.setRate(nowNs, rateController.rate());
+            ui->progressBar->setRange(0, int(captureScheduler.progressTotal()));
+        }
+        QString change = QString("rate %1 fps, keeping 1 in %2 ticks (%3)")
+                             .arg(rateController.rate(), 0, 'f', 2)
+                             .arg(rateController.skipFactor())
+                             .arg(rateController.reason());
+        logEvent(change, nowNs);
+        ui->statusbar->showMessage("Overload: " + change, 5000);
+        return false;
+    }
+    case RateController::ActionAbort: {
+        QString reason = "Capture aborted on overload: " + rateController.reason();
+        logEvent("overload abort (" + rateController.reason() + ")", nowNs);
+        csvWriter.setTermination("overload", csvWriter.rowsWritten());
+        if (csvTimer) csvTimer->stop();
+        stopCsvRecording();
+        captureScheduler.stop();
+        ui->statusbar->showMessage(reason, 10000);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
 
-    // Debug output of capture parameters
-    qDebug() << "Starting capture with:"
-             << "\nFPS:" << fps
-             << "\nDuration:" << duration
-             << "\nTotal frames:" << totalFrames
-             << "\nInterval:" << intervalMs << "ms";
+// Show how far the capture is and end it when it is complete; true if it ended
+bool MainWindow::updateCaptureProgress()
+{
+    ui->progressBar->setValue(int(captureScheduler.progress()));  // Update progress bar
+
+    // Check if we've captured all needed frames (or time)
+    if (!captureScheduler.finished()) return false;
+    if (csvTimer) csvTimer->stop();
+    stopCsvRecording();              // Stop recording
+    return true;
 }
 
 // Stop button click handler
@@ -161,46 +475,176 @@ void MainWindow::on_btnStop_clicked()
     if (csvTimer) {
         csvTimer->stop();            // Stop the capture timer if running
     }
-    stopCsvRecording();              // Stop CSV recording
+    stopCsvRecording();              // Stop CSV recording (and end a pause)
+    captureScheduler.stop();
 }
 
-// Open port button click handler
-void MainWindow::on_btnOpenPort_clicked()
+// Pause button click handler: hold the capture without closing the recording
+void MainWindow::on_btnPause_clicked()
 {
-    resetValues();  // Reset sensor values
-
-    // Clean up existing serial port if any
-    if (_serialPort) {
-        _serialPort->close();        // Close the port if open
-        delete _serialPort;          // Delete the port object
+    if (!csvRunning || !captureScheduler.isRunning()) return;
+
+    // The pause and resume are events in the recording, like the operator's markers
+    EventMarker marker = stampMarker();
+    if (!captureScheduler.isPaused()) {
+        captureScheduler.pause(marker.timestampNs);
+        csvTimer->stop();
+        marker.label = EventMarkers::PauseLabel;
+        csvWriter.writeEvent(marker);
+        ui->btnPause->setText("Resume Capture");
+        ui->statusbar->showMessage(QString("Capture paused after row %1").arg(marker.row));
+        return;
     }
 
-    // Create and configure new serial port
-    _serialPort = new QSerialPort(this);
-    _serialPort->setPortName(ui->HC06Ports->currentText());  // Set port name from UI
-    _serialPort->setBaudRate(QSerialPort::Baud9600);          // Set baud rate
-    _serialPort->setDataBits(QSerialPort::Data8);              // 8 data bits
-    _serialPort->setParity(QSerialPort::NoParity);             // No parity
-    _serialPort->setStopBits(QSerialPort::OneStop);            // 1 stop bit
-    _serialPort->setFlowControl(QSerialPort::NoFlowControl);   // No flow control
+    qint64 pausedBefore = captureScheduler.pausedNs();
+    captureScheduler.resume(marker.timestampNs);
+    marker.label = QString("%1 %2 s").arg(EventMarkers::ResumeLabel)
+                       .arg((captureScheduler.pausedNs() - pausedBefore) / 1e9, 0, 'f', 3);
+    csvWriter.writeEvent(marker);
+    ui->btnPause->setText("Pause Capture");
+    ui->statusbar->clearMessage();
+    captureTick();                      // Rows and frame numbering carry on from before the pause
+}
+
+// Data source selection handler
+void MainWindow::on_sourceType_currentIndexChanged(int index)
+{
+    // Only the serial source uses the port list
+    ui->HC06Ports->setEnabled(index == SourceSerial);
+
+    switch (index) {
+    case SourceReplay:    ui->HC06Button->setText("Open Replay"); break;
+    case SourceSimulator: ui->HC06Button->setText("Start Simulator"); break;
+    case SourceNetwork:   ui->HC06Button->setText("Connect to Network"); break;
+    case SourceUdp:       ui->HC06Button->setText("Listen for Bridge"); break;
+    default:              ui->HC06Button->setText("Connect to Bluetooth"); break;
+    }
+}
 
-    // Try to open the port in read-only mode
-    if (_serialPort->open(QIODevice::ReadOnly)) {
-        // Connect readyRead signal to our readData slot
-        connect(_serialPort, &QSerialPort::readyRead, this, &MainWindow::readData);
-        QMessageBox::information(this, "Success", "Port opened successfully");
+// Open data source button click handler
+void MainWindow::on_HC06Button_clicked()
+{
+    resetValues();      // Reset sensor values
+    closeFrameSource(); // Clean up the existing source if any
+
+    FrameSource *source = createFrameSource();
+    if (!source) return;                // Cancelled by the operator
+
+    // Try to open the source and feed its frames into the pipeline
+    QString error;
+    source->setClock(clock);
+    if (source->open(&error)) {
+        frameSource = source;
+        connect(source, &FrameSource::frameReceived, this, &MainWindow::handleFrame);
+        connect(source, &FrameSource::blockReceived, this, &MainWindow::handleBlock);
+        connect(source, &FrameSource::stopped, this, &MainWindow::handleSourceStopped);
+        connect(source, &FrameSource::commandFinished, this, &MainWindow::sensorCommandFinished);
+        QSettings().setValue("sourceType", ui->sourceType->currentIndex());
+        if (ui->actionReliableLink->isChecked() && source->supportsCommands()) source->sendCommand("RELIABLE 1");
+        applyFrameBatching();
+        QMessageBox::information(this, "Success", source->description() + " opened successfully");
         ui->HC06Button->setStyleSheet("background-color: green");
     }
 
     else {
-        // Show error if port opening failed
-        QMessageBox::critical(this, "Error", "Failed to open port: " + _serialPort->errorString());
-        delete _serialPort;
-        _serialPort = nullptr;
+        // Show error if opening failed
+        QMessageBox::critical(this, "Error", "Failed to open " + source->description() + ": " + error);
+        delete source;
         ui->HC06Button->setStyleSheet("background-color: red");
     }
 }
 
+// Create the source selected in the UI, asking for its settings (nullptr if cancelled)
+FrameSource *MainWindow::createFrameSource()
+{
+    QSettings settings;
+    bool ok = true;
+
+    switch (ui->sourceType->currentIndex()) {
+    case SourceReplay: {
+        QString fileName = QFileDialog::getOpenFileName(
+            this, "Replay Recording",
+            QStandardPaths::writableLocation(QStandardPaths::DesktopLocation),
+            "Recordings (*.csv);;All files (*)");
+        if (fileName.isEmpty()) return nullptr;
+        double speed = QInputDialog::getDouble(this, "Replay Recording",
+                                               "Replay speed (1 = real time, 0 = as fast as possible):",
+                                               1, 0, 1000, 2, &ok);
+        return ok ? new ReplayFrameSource(fileName, speed, this) : nullptr;
+    }
+
+    case SourceSimulator: {
+        double rate = QInputDialog::getDouble(this, "Simulator", "Frames per second:",
+                                              settings.value("simulatorRate", 80).toDouble(),
+                                              0.1, 1000000, 1, &ok);
+        if (!ok) return nullptr;
+        settings.setValue("simulatorRate", rate);
+        return new SimulatorFrameSource(rate, this);
+    }
+
+    case SourceNetwork: {
+        QString address = QInputDialog::getText(this, "Network Source", "Bridge address (host:port):",
+                                                QLineEdit::Normal,
+                                                settings.value("networkSource", "192.168.4.1:5000").toString(),
+                                                &ok).trimmed();
+        if (!ok || address.isEmpty()) return nullptr;
+
+        int colon = address.lastIndexOf(':');
+        quint16 port = colon > 0 ? address.mid(colon + 1).toUShort(&ok) : 0;
+        if (colon <= 0 || !ok || port == 0) {
+            QMessageBox::warning(this, "Invalid Input", "Enter the bridge address as host:port.");
+            return nullptr;
+        }
+        settings.setValue("networkSource", address);
+        return new NetworkFrameSource(NetworkFrameSource::TransportTcp, address.left(colon), port, this);
+    }
+
+    case SourceUdp: {
+        int port = QInputDialog::getInt(this, "Network Source", "Listen for bridge datagrams on UDP port:",
+                                        settings.value("udpSourcePort", 5000).toInt(), 1, 65535, 1, &ok);
+        if (!ok) return nullptr;
+        settings.setValue("udpSourcePort", port);
+        return new NetworkFrameSource(NetworkFrameSource::TransportUdp, QString(), quint16(port), this);
+    }
+
+    default:
+        return new SerialFrameSource(ui->HC06Ports->currentText(), this);
+    }
+}
+
+// Deliver frames in blocks, or one by one while phase-locked triggers or alarm
+// Pico commands must go out the moment their frame is parsed
+void MainWindow::applyFrameBatching()
+{
+    if (!frameSource) return;
+
+    bool immediate = phaseLock.settings().enabled;
+    for (const AlarmEngine::Rule &rule : pipeline.alarmEngine().rules()) {
+        immediate = immediate || !rule.picoCommand.isEmpty();
+    }
+    frameSource->setBlockDelivery(immediate ? 1 : blockFrames, blockDelayMs);
+}
+
+// Close and release the current data source
+void MainWindow::closeFrameSource()
+{
+    if (!frameSource) return;
+    if (captureSession.isRunning()) stopSession("Capture session stopped: data source closed");
+    frameSource->flushBlock();          // Frames still waiting for their block deadline
+    frameSource->disconnect(this);      // No more frames or stop notices from it
+    frameSource->close();
+    frameSource->deleteLater();         // May be inside one of its own signals
+    frameSource = nullptr;
+}
+
+// The source ended by itself (end of replay, lost connection)
+void MainWindow::handleSourceStopped(const QString &reason)
+{
+    closeFrameSource();
+    ui->HC06Button->setStyleSheet("background-color: red");
+    ui->statusbar->showMessage(reason, 5000);
+}
+
 // Pico button click handler
 void MainWindow::on_PicoButton_clicked()
 {
@@ -234,53 +678,105 @@ void MainWindow::on_PicoButton_clicked()
     }
 }
 
-// Serial port data ready read handler
-void MainWindow::readData()
+// Handle a frame delivered by the data source
+void MainWindow::handleFrame(const SensorFrame &received)
 {
-    // Check if port exists and is open
-    if (!_serialPort || !_serialPort->isOpen()) return;
+    LatencyScope latency(latencyMonitor, LatencyMonitor::ProbeFrame);
 
-    static QByteArray buffer;  // Static buffer to accumulate data
-    buffer.append(_serialPort->readAll());  // Append new data to buffer
+    // A phase-locked trigger goes out the moment its sample is parsed, before any other work
+    if (phaseLock.update(received.timestampNs) && csvRunning && !captureScheduler.isPaused()) {
+        sendSampleTrigger(received);
+    }
 
-    // Convert buffer to string and split by commas
-    QString data = QString::fromUtf8(buffer).trimmed();
-    QStringList items = data.split(",");
+    // Process the frame and update the displays
+    SensorFrame frame = received;
+    pipeline.process(frame);   // Zero-adjust, estimate force and rate, check alarms
+    handleAlarmEvents();       // Act on alarms before spending time on the display
+    handleBaselineAdjustments();
+    if (channelCorrelation.settings().enabled) channelCorrelation.addFrame(frame);
+    if (captureSession.waitsForFrames() && captureSession.frameArrived(frame)) sessionTimer->start(0);
+    dashboard->addFrame(frame);
+
+    // Frame-driven captures record this very frame
+    if (csvRunning && captureScheduler.takeFrame(frame.timestampNs)) {
+        writeCsvData(frame, frame.timestampNs);
+    }
+    if (csvRunning && captureScheduler.termination() != CaptureScheduler::TerminateTicks) {
+        updateCaptureProgress();
+    }
+    displayFrame(frame);
+}
 
-    // Check if we have exactly 3 values (expected sensor data)
-    if (items.size() == 3) {
-        bool ok1, ok2, ok3;
-        // Convert strings to integers
-        int botLeft = items[0].toInt(&ok1);
-        int topLeft = items[1].toInt(&ok2);
-        int topRight = items[2].toInt(&ok3);
+// Handle a block of frames: the same steps as handleFrame, with the per-frame
+// overhead (signal, display, progress) paid once per block
+void MainWindow::handleBlock(const FrameBlock &received)
+{
+    LatencyScope latency(latencyMonitor, LatencyMonitor::ProbeFrame);
 
-        // If all conversions succeeded, update displays with zero-adjusted values
-        if (ok1 && ok2 && ok3) {
-            ui->botLeftNum->display(botLeft - zeroBotLeft);
-            ui->topLeftNum->display(topLeft - zeroTopLeft);
-            ui->topRightNum->display(topRight - zeroTopRight);
+    // Batching is off while triggers are phase locked, but blocks already on their way still count
+    const qint64 *timestamps = received.timestamps();
+    for (int index = 0; index < received.size(); ++index) {
+        if (phaseLock.update(timestamps[index]) && csvRunning && !captureScheduler.isPaused()) {
+            sendSampleTrigger(received.frame(index));
         }
     }
 
-    buffer.clear();  // Clear buffer for next read
+    pipeline.processBlock(received, processedBlock);
+    handleAlarmEvents();
+
+    // A baseline adjustment is logged before the row of the frame that made it, as frame by frame
+    BaselineTracker::Adjustment adjustment;
+    bool adjusted = pipeline.baselineTracker().takeAdjustment(adjustment);
+
+    SensorFrame frame;
+    const bool correlate = channelCorrelation.settings().enabled;
+    for (int index = 0; index < processedBlock.size(); ++index) {
+        processedBlock.readFrame(index, frame);
+        if (adjusted && frame.timestampNs >= adjustment.timestampNs) {
+            logZeroOffsets("baseline", adjustment.timestampNs);
+            adjusted = false;
+        }
+        if (correlate) channelCorrelation.addFrame(frame);
+        if (captureSession.waitsForFrames() && captureSession.frameArrived(frame)) sessionTimer->start(0);
+        if (csvRunning && captureScheduler.takeFrame(frame.timestampNs)) {
+            writeCsvData(frame, frame.timestampNs);
+        }
+    }
+    if (adjusted) logZeroOffsets("baseline", adjustment.timestampNs);
+    dashboard->addBlock(processedBlock);
+
+    if (csvRunning && captureScheduler.termination() != CaptureScheduler::TerminateTicks) {
+        updateCaptureProgress();
+    }
+    if (!processedBlock.isEmpty()) displayFrame(frame);
+}
+
+// Show a processed frame
+void MainWindow::displayFrame(const SensorFrame &frame)
+{
+    AllocationScope scope(AllocationStats::StageDisplay);
+    ui->botLeftNum->display(frame.zeroed[ChannelBotLeft]);
+    ui->topLeftNum->display(frame.zeroed[ChannelTopLeft]);
+    ui->topRightNum->display(frame.zeroed[ChannelTopRight]);
+    updateEstimateDisplay(frame);
+    updateDerivedDisplay(frame);
+    AllocationStats::recordFrame(AllocationStats::StageDisplay);
 }
 
 // Zero button click handler
 void MainWindow::on_btnZero_clicked()
 {
-    // Adjust zero offsets based on current displayed values
-    zeroBotLeft += ui->botLeftNum->value();
-    zeroTopLeft += ui->topLeftNum->value();
-    zeroTopRight += ui->topRightNum->value();
+    // Zero all channels at the current reading
+    pipeline.zeroToLatest();
+    logZeroOffsets("zero", clock->nowNs());
 }
 
 // Refresh ports button click handler
 void MainWindow::on_btnRefreshPorts_clicked()
 {
 
-    // If HC06 is not connected refresh the port
-    if (!_serialPort) {
+    // If no data source is open refresh the port
+    if (!frameSource) {
 
         // Clear existing port lists
         ui->HC06Ports->clear();
@@ -308,10 +804,8 @@ void MainWindow::on_btnRefreshPorts_clicked()
 // Close port button click handler
 void MainWindow::on_btnClosPort_clicked()
 {
-    if (_serialPort) {
-        _serialPort->close();        // Close the port if open
-        delete _serialPort;        // Delete the port object
-        _serialPort = nullptr;      // Clear the pointer
+    if (frameSource) {
+        closeFrameSource();         // Close the data source if open
         resetValues();              // Reset sensor values
         ui->HC06Button->setStyleSheet("background-color: red");
     }
@@ -329,14 +823,17 @@ void MainWindow::on_btnClosPort_clicked()
 // Reset sensor values and zero offsets
 void MainWindow::resetValues()
 {
-    zeroTopLeft = 0;                // Reset top left zero offset
-    zeroTopRight = 0;               // Reset top right zero offset
-    zeroBotLeft = 0;                // Reset bottom left zero offset
+    pipeline.reset();               // Reset zero offsets and filter state
+    phaseLock.reset();              // The sample clock is measured again
+    channelCorrelation.reset();
 
     // Reset displayed values to zero
     ui->botLeftNum->display(0);
     ui->topLeftNum->display(0);
     ui->topRightNum->display(0);
+    ui->estimateLabel->clear();
+    ui->derivedLabel->clear();
+    updateAlarmDisplay();
 }
 
 // Start CSV recording function
@@ -346,43 +843,1190 @@ void MainWindow::startCsvRecording()
     QString fileName = QStandardPaths::writableLocation(QStandardPaths::DesktopLocation) +
                        "/sensor_data_" + QDateTime::currentDateTime().toString("yyyy-MM-dd_HH-mm-ss") + ".csv";
 
-    csvFile.setFileName(fileName);
-    // Try to open file for writing
-    if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::critical(this, "Error", "Failed to create CSV file: " + csvFile.errorString());
+    // Try to open file for writing (the writer also writes the CSV header)
+    QString error;
+    if (!csvWriter.open(fileName, csvFramesPerSecond, csvCaptureDuration,
+                        pipeline.derivedChannels().names(), &error)) {
+        QMessageBox::critical(this, "Error", "Failed to create CSV file: " + error);
         return;
     }
-
-    // Set up text stream and write CSV header
-    csvStream.setDevice(&csvFile);
-    csvStream << "Timestamp,Top Left,Top Right,Bottom Left,Top Left w/o Zero,Top Right w/o Zero,Bottom Left w/o Zero\n";
     csvRunning = true;  // Set recording flag
+
+    // With drift tracking the offsets change during the capture; note where they start
+    if (pipeline.baselineTracker().settings().enabled) logZeroOffsets("offsets", clock->nowNs());
 }
 
 // Stop CSV recording function
 void MainWindow::stopCsvRecording()
 {
     csvRunning = false;  // Clear recording flag
-    if (csvFile.isOpen()) {
-        csvFile.close();  // Close the file if open
+
+    // If the rate controller changed the plan, the manifest says what the plan became
+    if (rateController.changes() > 0) {
+        csvWriter.setRateChanges(rateController.changes(), rateController.lowestRate(),
+                                 keptTicks + rateController.keptBetween(captureScheduler.issued(),
+                                                                        captureScheduler.total()));
     }
+    csvWriter.close();   // Close the file and write its manifest
+
+    // A paused capture ends here too
+    ui->btnPause->setEnabled(false);
+    ui->btnPause->setText("Pause Capture");
+    if (captureScheduler.isPaused()) ui->statusbar->clearMessage();
+
+    // A session waiting for its capture goes on from the event loop, not from inside this call
+    sessionCapture = false;
+    if (captureSession.captureFinished()) sessionTimer->start(0);
 }
 
 // Write data to CSV function
-void MainWindow::writeCsvData()
+void MainWindow::writeCsvData(const SensorFrame &frame, qint64 timestampNs)
 {
     // Check if we should record and file is open
-    if (!csvRunning || !csvFile.isOpen()) return;
+    if (!csvRunning || !csvWriter.isOpen()) return;
+
+    AllocationScope scope(AllocationStats::StageRecord);
+
+    // Wall time of the tick or frame (frames are handled a little after they were stamped)
+    QDateTime timestamp = clock->wallTime().addMSecs(-(clock->nowNs() - timestampNs) / 1000000);
+
+    // Write the timestamp and the sensor values (zero-adjusted, raw and derived)
+    csvWriter.writeFrame(timestamp, frame);
+    AllocationStats::recordFrame(AllocationStats::StageRecord);
+}
+
+// Write an event to the running capture's marker file
+void MainWindow::logEvent(const QString &label, qint64 timestampNs)
+{
+    if (!csvRunning || !csvWriter.isOpen()) return;
+
+    EventMarker marker;
+    marker.timestampNs = timestampNs;
+    marker.wallTime = clock->wallTime();
+    marker.row = csvWriter.rowsWritten();
+    marker.label = label;
+    csvWriter.writeEvent(marker);
+}
+
+// Log zero offset changes made by the baseline tracker
+void MainWindow::handleBaselineAdjustments()
+{
+    BaselineTracker::Adjustment adjustment;
+    if (pipeline.baselineTracker().takeAdjustment(adjustment)) {
+        logZeroOffsets("baseline", adjustment.timestampNs);
+    }
+}
+
+// Record the current zero offsets in the running capture, so every row can be traced back to raw counts
+void MainWindow::logZeroOffsets(const char *reason, qint64 timestampNs)
+{
+    if (!csvRunning || !csvWriter.isOpen()) return;
+    logEvent(BaselineTracker::describe(reason, pipeline.zeroOffsets()), timestampNs);
+}
+
+// Take the time and recording position for a marker made now
+EventMarker MainWindow::stampMarker() const
+{
+    // Same clock as the frame timestamps, so markers and frames can be ordered
+    EventMarker marker;
+    marker.timestampNs = clock->nowNs();
+    marker.wallTime = clock->wallTime();
+    marker.row = csvWriter.rowsWritten();
+    return marker;
+}
+
+// Record a marker in the running capture
+void MainWindow::addMarker(const EventMarker &marker)
+{
+    if (captureSession.markerPlaced(marker.label)) sessionTimer->start(0);
+
+    // Only a buffered append: the capture timer and frame handling are never held up
+    if (!csvRunning || !csvWriter.isOpen()) {
+        ui->statusbar->showMessage("Marker not saved (no capture running): " + marker.label, 5000);
+        return;
+    }
+    csvWriter.writeEvent(marker);
+    ui->statusbar->showMessage(QString("Marker at row %1: %2").arg(marker.row + 1).arg(marker.label), 5000);
+}
+
+// Show filtered force, rate of change and uncertainty for each channel
+void MainWindow::updateEstimateDisplay(const SensorFrame &frame)
+{
+    static const char *const names[ChannelCount] = { "Top left", "Top right", "Bottom left" };
+
+    QString text;
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        text += QString("%1: %2 +/- %3, rate %4/s\n")
+                    .arg(names[channel])
+                    .arg(frame.filtered[channel], 0, 'f', 1)
+                    .arg(frame.forceStdDev[channel], 0, 'f', 1)
+                    .arg(frame.rate[channel], 0, 'f', 1);
+    }
+    ui->estimateLabel->setText(text.trimmed());
+}
+
+// Show the current value of every derived channel
+void MainWindow::updateDerivedDisplay(const SensorFrame &frame)
+{
+    const QVector<DerivedChannels::Definition> &definitions = pipeline.derivedChannels().definitions();
+    if (definitions.isEmpty()) return;
+
+    QString text;
+    for (int index = 0; index < definitions.size(); ++index) {
+        text += QString("%1: %2\n").arg(definitions[index].name).arg(frame.derived[index], 0, 'g', 6);
+    }
+    ui->derivedLabel->setText(text.trimmed());
+}
 
-    // Write current timestamp and sensor values (both zero-adjusted and raw)
-    csvStream << QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss.zzz") << ","
-              << ui->topLeftNum->value() << ","
-              << ui->topRightNum->value() << ","
-              << ui->botLeftNum->value() << ","
-              << ui->topLeftNum->value()+zeroTopLeft << ","
-              << ui->topRightNum->value()+zeroTopRight << ","
-              << ui->botLeftNum->value()+zeroBotLeft << "\n";
+// Derived channels menu handler
+void MainWindow::on_actionDerivedChannels_triggered()
+{
+    // Changing columns in the middle of a recording would corrupt the CSV
+    if (csvRunning) {
+        QMessageBox::warning(this, "Capture Running", "Stop the capture before editing derived channels.");
+        return;
+    }
+
+    DerivedChannels &derived = pipeline.derivedChannels();
+    QString text = DerivedChannels::formatDefinitions(derived.definitions());
+    QString help = "One channel per line as 'name = expression'.\nAvailable values: " +
+                   DerivedChannels::variableNames().join(", ") +
+                   "\nOperators: + - * / < <= > >= == != && || ! ?: and abs, sqrt, min, max, clamp";
+
+    // Keep asking until the definitions compile or the operator cancels
+    while (true) {
+        bool ok;
+        text = QInputDialog::getMultiLineText(this, "Derived Channels", help, text, &ok);
+        if (!ok) return;
+
+        QVector<DerivedChannels::Definition> definitions;
+        QString error;
+        if (DerivedChannels::parseDefinitions(text, definitions, &error)) {
+            // The alarm rules must still compile against the new channel names
+            QStringList names;
+            for (const DerivedChannels::Definition &definition : definitions) names << definition.name;
+            AlarmEngine check;
+            TriggerSequence sequenceCheck;
+            CaptureSession sessionCheck;
+            if (!check.setRules(pipeline.alarmEngine().rules(), names, &error)) {
+                error = "An alarm rule uses a removed channel. " + error;
+            } else if (triggerSequence.isValid() &&
+                       !sequenceCheck.compile(triggerSequence.source(), names, &error)) {
+                error = "The trigger sequence uses a removed channel. " + error;
+            } else if (captureSession.isValid() &&
+                       !sessionCheck.compile(captureSession.source(), names, &error)) {
+                error = "The capture session uses a removed channel. " + error;
+            } else if (derived.setDefinitions(definitions, &error)) {
+                pipeline.alarmEngine().setRules(pipeline.alarmEngine().rules(), names);
+                if (triggerSequence.isValid()) {
+                    stopSequence("Trigger sequence stopped: derived channels changed");
+                    triggerSequence.compile(triggerSequence.source(), names);
+                }
+                if (captureSession.isValid()) {
+                    stopSession("Capture session stopped: derived channels changed");
+                    captureSession.compile(captureSession.source(), names);
+                }
+                QSettings settings;
+                settings.setValue("derivedChannels", DerivedChannels::formatDefinitions(definitions));
+                ui->derivedLabel->clear();
+                updateAlarmDisplay();
+                return;
+            }
+        }
+        QMessageBox::warning(this, "Invalid Derived Channel", error);
+    }
+}
+
+// Alarm rules menu handler
+void MainWindow::on_actionAlarmRules_triggered()
+{
+    AlarmEngine &alarms = pipeline.alarmEngine();
+    QString text = AlarmEngine::formatRules(alarms.rules());
+    QString help = "One rule per line as 'name = condition; hold=ms; critical; pico=command'.\n"
+                   "Conditions use the same values as derived channels, plus the derived channels.\n"
+                   "Example: overload = topLeft + topRight > 1500; hold=200; critical";
+
+    // Keep asking until the rules compile or the operator cancels
+    while (true) {
+        bool ok;
+        text = QInputDialog::getMultiLineText(this, "Alarm Rules", help, text, &ok);
+        if (!ok) return;
+
+        QVector<AlarmEngine::Rule> rules;
+        QString error;
+        if (AlarmEngine::parseRules(text, rules, &error) &&
+            alarms.setRules(rules, pipeline.derivedChannels().names(), &error)) {
+            QSettings settings;
+            settings.setValue("alarmRules", AlarmEngine::formatRules(rules));
+            updateAlarmDisplay();
+            applyFrameBatching();
+            return;
+        }
+        QMessageBox::warning(this, "Invalid Alarm Rule", error);
+    }
+}
+
+// React to alarms raised or cleared by the last frame
+void MainWindow::handleAlarmEvents()
+{
+    AlarmEngine &alarms = pipeline.alarmEngine();
+    AlarmEngine::Event event;
+    bool changed = false;
+
+    while (alarms.takeEvent(event)) {
+        changed = true;
+        if (!event.raised) continue;
+
+        const AlarmEngine::Rule &rule = alarms.rules()[event.rule];
+
+        // The Pico command goes out first; it is the latency-critical part
+        if (!rule.picoCommand.isEmpty() && Pico_Port && Pico_Port->isOpen()) {
+            Pico_Port->write(rule.picoCommand);
+        }
+        if (rule.severity == AlarmEngine::SeverityCritical) {
+            QApplication::beep();
+        }
+        ui->statusbar->showMessage("ALARM: " + rule.name, 5000);
+    }
 
-    csvStream.flush();  // Ensure data is written to file
+    if (changed) updateAlarmDisplay();
 }
 
+// Show the names of all raised alarms
+void MainWindow::updateAlarmDisplay()
+{
+    const AlarmEngine &alarms = pipeline.alarmEngine();
+    QStringList names;
+    bool critical = false;
+
+    for (int index = 0; index < alarms.rules().size(); ++index) {
+        if (!(alarms.activeMask() & (1u << index))) continue;
+        names << alarms.rules()[index].name;
+        critical = critical || alarms.rules()[index].severity == AlarmEngine::SeverityCritical;
+    }
+
+    if (names.isEmpty()) {
+        ui->alarmLabel->setText(alarms.rules().isEmpty() ? QString() : "No active alarms");
+        ui->alarmLabel->setStyleSheet("");
+    } else {
+        ui->alarmLabel->setText("ALARM: " + names.join(", "));
+        ui->alarmLabel->setStyleSheet(critical ? "background-color: red; color: white; font-weight: bold"
+                                               : "background-color: orange; font-weight: bold");
+    }
+}
+
+// Refresh the statistics panel
+void MainWindow::updateStatistics()
+{
+    // Report allocations per frame over the last refresh interval
+    AllocationStats::Snapshot current = AllocationStats::snapshot();
+    QString text = AllocationStats::formatReport(lastAllocationSnapshot, current);
+    if (frameSource) {
+        text += QString("\n%1: %2 frames, %3 malformed lines")
+                    .arg(frameSource->description())
+                    .arg(frameSource->framesReceived())
+                    .arg(frameSource->malformedLines());
+        QString sourceStatistics = frameSource->statistics();
+        if (!sourceStatistics.isEmpty()) text += "\n" + sourceStatistics;
+    }
+    if (pipeline.baselineTracker().settings().enabled) {
+        text += "\n" + BaselineTracker::describe("Baseline tracking:", pipeline.zeroOffsets());
+    }
+    if (phaseLock.settings().enabled) {
+        double period = phaseLock.periodNs();
+        text += QString("\nPhase lock: every %1 samples from %2, sensor %3 Hz, %4 triggers, jitter max %5 ms")
+                    .arg(phaseLock.settings().every).arg(phaseLock.settings().phase)
+                    .arg(period > 0 ? 1e9 / period : 0, 0, 'f', 1)
+                    .arg(phaseLock.triggers())
+                    .arg(phaseLock.maxJitterNs() / 1e6, 0, 'f', 2);
+    }
+    if (triggerGroup->isOpen()) {
+        text += "\n" + triggerGroup->report(true);
+    }
+    if (channelCorrelation.settings().enabled) {
+        text += "\n" + channelCorrelation.statistics();
+    }
+    if (captureSession.isRunning()) {
+        text += "\n" + captureSession.status(clock->nowNs());
+    }
+    text += "\n" + TaskExecutor::shared().report(true);
+    if (dashboard->isRunning()) {
+        text += "\n" + dashboard->statistics();
+    }
+    ui->statsLabel->setText(text);
+
+    // Event loop latency and the work competing for it over the same interval
+    QString latency = latencyMonitor.report(true);
+    ui->latencyLabel->setText(latency);
+    lastAllocationSnapshot = current;
+
+    // The dashboard shows the same panel, with the capture status on top
+    if (dashboard->isRunning()) {
+        QString capture = "idle";
+        if (csvRunning) {
+            capture = QString("%1, %2 of %3: %4")
+                          .arg(captureScheduler.isPaused() ? "paused" : "recording")
+                          .arg(ui->progressBar->value()).arg(ui->progressBar->maximum())
+                          .arg(QFileInfo(csvWriter.fileName()).fileName());
+        }
+        DashboardServer::Status status;
+        status.append(qMakePair(QString("Source"), frameSource ? frameSource->description() : QString("closed")));
+        status.append(qMakePair(QString("Capture"), capture));
+        if (captureSession.isRunning()) {
+            status.append(qMakePair(QString("Session"), captureSession.status(clock->nowNs())));
+        }
+        status.append(qMakePair(QString("Statistics"), text));
+        status.append(qMakePair(QString("Event loop"), latency));
+        dashboard->setStatus(status);
+    }
+}
+
+// Verify recording menu handler
+void MainWindow::on_actionVerifyRecording_triggered()
+{
+    // Let the operator pick one or more recordings
+    QStringList fileNames = QFileDialog::getOpenFileNames(
+        this, "Verify Recordings",
+        QStandardPaths::writableLocation(QStandardPaths::DesktopLocation),
+        "Recordings (*.csv);;All files (*)");
+    if (fileNames.isEmpty()) return;
+
+    // Verify on the shared workers so the sensor display keeps updating
+    auto reports = std::make_shared<QVector<RecordingReport>>();
+    ui->actionVerifyRecording->setEnabled(false);
+    runOffline("verify recordings", [fileNames, reports]() {
+        for (const QString &fileName : fileNames) {
+            reports->append(RecordingVerifier::verify(fileName));
+        }
+    }, [this, reports]() {
+        // Summarize all reports in one message box
+        QStringList summaries;
+        bool allOk = true;
+        for (const RecordingReport &report : *reports) {
+            summaries << report.summary();
+            allOk = allOk && report.ok();
+        }
+
+        if (allOk) {
+            QMessageBox::information(this, "Recordings OK", summaries.join("\n\n"));
+        } else {
+            QMessageBox::warning(this, "Recording Problems", summaries.join("\n\n"));
+        }
+        ui->actionVerifyRecording->setEnabled(true);
+    });
+}
+
+// Join ultrasound timestamps menu handler
+void MainWindow::on_actionJoinTimestamps_triggered()
+{
+    QString desktop = QStandardPaths::writableLocation(QStandardPaths::DesktopLocation);
+    QString recordingName = QFileDialog::getOpenFileName(
+        this, "Sensor Recording", desktop, "Recordings (*.csv);;All files (*)");
+    if (recordingName.isEmpty()) return;
+    QString timestampsName = QFileDialog::getOpenFileName(
+        this, "Ultrasound Timestamp Log", QFileInfo(recordingName).path(), "All files (*)");
+    if (timestampsName.isEmpty()) return;
+
+    // Ask how frames are matched and how far the two clocks are apart
+    QStringList modes = {"asof", "nearest", "interpolate"};
+    bool ok;
+    QString mode = QInputDialog::getItem(this, "Join Ultrasound Timestamps", "Match each frame to:", modes, 0, false, &ok);
+    if (!ok) return;
+    TimestampJoin::Options options;
+    options.mode = TimestampJoin::modeFromName(mode);
+
+    // Numbers in the log are either Unix time or count from the start of the recording
+    QStringList bases = {"Unix time (s, ms or us)", "Seconds since the recording start",
+                         "Milliseconds since the recording start", "Microseconds since the recording start"};
+    QString base = QInputDialog::getItem(this, "Join Ultrasound Timestamps", "Numeric log timestamps are:",
+                                         bases, 0, false, &ok);
+    if (!ok) return;
+    options.timeBase = TimestampJoin::TimeBase(bases.indexOf(base));
+    options.offsetMs = QInputDialog::getDouble(this, "Join Ultrasound Timestamps",
+                                               "Milliseconds added to the log timestamps:",
+                                               0, -86400000, 86400000, 3, &ok);
+    if (!ok) return;
+
+    QString outputName = QFileDialog::getSaveFileName(
+        this, "Save Joined Frames",
+        QFileInfo(recordingName).path() + "/ultrasound_" + QFileInfo(recordingName).fileName(),
+        "CSV files (*.csv)");
+    if (outputName.isEmpty()) return;
+
+    // Join on the shared workers like verification
+    auto summary = std::make_shared<TimestampJoin::Summary>();
+    auto error = std::make_shared<QString>();
+    auto success = std::make_shared<bool>(false);
+    ui->actionJoinTimestamps->setEnabled(false);
+    runOffline("join timestamps", [=]() {
+        *success = TimestampJoin::run(recordingName, timestampsName, outputName, options, summary.get(), error.get());
+    }, [this, summary, error, success]() {
+        if (*success) {
+            QMessageBox::information(this, "Join Complete", summary->text());
+        } else {
+            QMessageBox::warning(this, "Join Failed", *error);
+        }
+        ui->actionJoinTimestamps->setEnabled(true);
+    });
+}
+
+// Analyze channel lag menu handler
+void MainWindow::on_actionAnalyzeChannelLag_triggered()
+{
+    QString desktop = QStandardPaths::writableLocation(QStandardPaths::DesktopLocation);
+    QString recordingName = QFileDialog::getOpenFileName(
+        this, "Sensor Recording", desktop, "Recordings (*.csv);;All files (*)");
+    if (recordingName.isEmpty()) return;
+
+    // Compensating is optional; cancelling the save dialog only analyzes
+    QString outputName = QFileDialog::getSaveFileName(
+        this, "Save Compensated Recording (cancel to only analyze)",
+        QFileInfo(recordingName).path() + "/aligned_" + QFileInfo(recordingName).fileName(),
+        "CSV files (*.csv)");
+
+    // Analyze on the shared workers like verification
+    ChannelCorrelation::Settings settings = channelCorrelation.settings();
+    auto report = std::make_shared<ChannelCorrelation::Report>();
+    auto error = std::make_shared<QString>();
+    auto success = std::make_shared<bool>(false);
+    ui->actionAnalyzeChannelLag->setEnabled(false);
+    runOffline("analyze channel lag", [=]() {
+        *success = ChannelCorrelation::analyzeRecording(recordingName, outputName, settings, report.get(), error.get());
+    }, [this, report, error, success]() {
+        if (*success) {
+            QMessageBox::information(this, "Channel Lag", report->text());
+        } else {
+            QMessageBox::warning(this, "Channel Lag Analysis Failed", *error);
+        }
+        ui->actionAnalyzeChannelLag->setEnabled(true);
+    });
+}
+
+// Run an offline job on the shared workers, then finish it on the GUI thread
+void MainWindow::runOffline(const char *name, std::function<void()> work, std::function<void()> done)
+{
+    QPointer<MainWindow> window(this);
+    TaskExecutor::shared().submit(name, TaskExecutor::PriorityBestEffort, [window, work, done]() {
+        work();
+        QCoreApplication *application = QCoreApplication::instance();
+        if (!application) return;
+        QMetaObject::invokeMethod(application, [window, done]() {
+            if (window) done();
+        }, Qt::QueuedConnection);
+    });
+}
+
+// Trigger sequence menu handler
+void MainWindow::on_actionTriggerSequence_triggered()
+{
+    QString text = triggerSequence.source();
+    QString help = "One step per line: 'label:', 'send <command>', 'wait <ms>',\n"
+                   "'repeat <label> <times>', 'if <condition> goto <label>', 'goto <label>', 'stop'.\n"
+                   "Conditions use the same values as alarm rules. Example:\n"
+                   "loop:  send 1 / wait 40 / repeat loop 99 / send 2";
+
+    // Keep asking until the sequence compiles or the operator cancels
+    while (true) {
+        bool ok;
+        text = QInputDialog::getMultiLineText(this, "Trigger Sequence", help, text, &ok);
+        if (!ok) return;
+
+        TriggerSequence sequence;
+        QString error;
+        if (text.trimmed().isEmpty() ||
+            sequence.compile(text, pipeline.derivedChannels().names(), &error)) {
+            stopSequence("Trigger sequence stopped: sequence edited");
+            triggerSequence = sequence;
+            QSettings().setValue("triggerSequence", text);
+            return;
+        }
+        QMessageBox::warning(this, "Invalid Trigger Sequence", error);
+    }
+}
+
+// Run trigger sequence menu handler
+void MainWindow::on_actionRunSequence_triggered(bool checked)
+{
+    if (!checked) {
+        stopSequence("Trigger sequence stopped");
+        return;
+    }
+
+    QString problem;
+    if (!triggerSequence.isValid()) problem = "Define a trigger sequence first (Tools > Trigger Sequence...).";
+    else if (!Pico_Port || !Pico_Port->isOpen()) problem = "Open the Pico port first.";
+    if (!problem.isEmpty()) {
+        ui->actionRunSequence->setChecked(false);
+        QMessageBox::warning(this, "Trigger Sequence", problem);
+        return;
+    }
+
+    qint64 now = clock->nowNs();
+    triggerSequence.start(now);
+    logEvent("sequence start", now);
+    sequenceTick();
+}
+
+// Trigger sequence timer handler: send what is due, then wait for the next step
+void MainWindow::sequenceTick()
+{
+    if (!triggerSequence.isRunning()) return;
+    if (!Pico_Port || !Pico_Port->isOpen()) {
+        stopSequence("Trigger sequence stopped: Pico port closed");
+        return;
+    }
+
+    qint64 now = clock->nowNs();
+    bool running = triggerSequence.advance(now, pipeline.latestFrame(), sequenceCommands);
+    for (const QByteArray &command : sequenceCommands) {
+        Pico_Port->write(command);
+        logEvent("pico " + TriggerSequence::escape(command), now);
+    }
+
+    if (!running) {
+        QString error = triggerSequence.errorString();
+        stopSequence(error.isEmpty() ? "Trigger sequence finished" : "Trigger sequence failed: " + error);
+        return;
+    }
+
+    // Round up so that the step is due when the timer fires
+    qint64 waitNs = triggerSequence.nextDueNs() - clock->nowNs();
+    sequenceTimer->start(int(qMax<qint64>(0, (waitNs + 999999) / 1000000)));
+}
+
+// Stop the trigger sequence if it runs and say why
+void MainWindow::stopSequence(const QString &reason)
+{
+    // The action is still checked when the sequence ended on its own
+    bool wasRunning = triggerSequence.isRunning() || ui->actionRunSequence->isChecked();
+    ui->actionRunSequence->setChecked(false);
+    sequenceTimer->stop();
+    triggerSequence.stop();
+    if (!wasRunning) return;
+
+    logEvent("sequence stop", clock->nowNs());
+    ui->statusbar->showMessage(QString("%1 (%2 commands, max lateness %3 ms)")
+                                   .arg(reason).arg(triggerSequence.commandsSent())
+                                   .arg(triggerSequence.maxLatenessNs() / 1e6, 0, 'f', 2), 5000);
+}
+
+// Capture session menu handler
+void MainWindow::on_actionCaptureSession_triggered()
+{
+    QString text = captureSession.source();
+    QString help = "One step per line: 'label:', 'wait <ms>', 'until <condition> [within <ms>]', 'zero',\n"
+                   "'capture [<seconds> s | <n> frames]', 'sensor <command>', 'send <command>',\n"
+                   "'marker [label]', 'log <text>', 'repeat <label> <times>', 'goto <label>', 'stop'.\n"
+                   "Conditions use the same values as alarm rules. Example:\n"
+                   "trial:  zero / until topLeft > 500 within 60000 / capture 5 s / wait 2000 / repeat trial 9";
+
+    // Keep asking until the session compiles or the operator cancels
+    while (true) {
+        bool ok;
+        text = QInputDialog::getMultiLineText(this, "Capture Session", help, text, &ok);
+        if (!ok) return;
+
+        CaptureSession session;
+        QString error;
+        if (text.trimmed().isEmpty() ||
+            session.compile(text, pipeline.derivedChannels().names(), &error)) {
+            stopSession("Capture session stopped: session edited");
+            captureSession = session;
+            QSettings().setValue("captureSession", text);
+            return;
+        }
+        QMessageBox::warning(this, "Invalid Capture Session", error);
+    }
+}
+
+// Run capture session menu handler
+void MainWindow::on_actionRunSession_triggered(bool checked)
+{
+    if (!checked) {
+        stopSession("Capture session stopped");
+        return;
+    }
+
+    QString problem;
+    if (!captureSession.isValid()) problem = "Define a capture session first (Tools > Capture Session...).";
+    else if (!frameSource) problem = "Open a data source first.";
+    else if (csvRunning) problem = "Stop the running capture first.";
+    if (!problem.isEmpty()) {
+        ui->actionRunSession->setChecked(false);
+        QMessageBox::warning(this, "Capture Session", problem);
+        return;
+    }
+
+    captureSession.start(clock->nowNs());
+    sessionTick();
+}
+
+// Capture session handler: resume the session, carry out what its steps ask for,
+// and arm the timer if the step it now waits on has a deadline
+void MainWindow::sessionTick()
+{
+    if (!captureSession.isRunning()) return;
+
+    // Frames waiting for their block first, so steps see (and zero at) the newest frame
+    if (frameSource) frameSource->flushBlock();
+    if (!captureSession.isRunning()) return;
+
+    qint64 now = clock->nowNs();
+    bool running = captureSession.advance(now, sessionActions);
+    for (const CaptureSession::Action &action : sessionActions) {
+        QString error;
+        if (!runSessionAction(action, &error)) {
+            stopSession("Capture session failed: " + error);
+            return;
+        }
+    }
+
+    if (!running) {
+        QString error = captureSession.errorString();
+        stopSession(error.isEmpty() ? "Capture session finished" : "Capture session failed: " + error);
+        return;
+    }
+    ui->statusbar->showMessage(captureSession.status(now));
+
+    // Other waits end with their events, which restart the timer themselves
+    qint64 deadline = captureSession.deadlineNs();
+    if (deadline >= 0) {
+        sessionTimer->start(int(qMax<qint64>(0, (deadline - clock->nowNs() + 999999) / 1000000)));
+    }
+}
+
+// Carry out one step of the capture session
+bool MainWindow::runSessionAction(const CaptureSession::Action &action, QString *errorString)
+{
+    switch (action.type) {
+    case CaptureSession::Action::Zero:
+        on_btnZero_clicked();
+        return true;
+
+    case CaptureSession::Action::Capture: {
+        if (!frameSource || csvRunning) {
+            *errorString = frameSource ? "a capture is already running" : "the data source was closed";
+            return false;
+        }
+        double fps = ui->framesPerSecond->value();
+        if (action.frames > 0) {
+            startCapture(CaptureScheduler::TerminateFrames, fps, 0, action.frames);
+        } else if (action.seconds > 0) {
+            startCapture(CaptureScheduler::TerminateTime, fps, action.seconds, 0);
+        } else {
+            int mode = ui->captureMode->currentIndex();
+            double duration = ui->captureLengthSeconds->value();
+            if (mode == CaptureScheduler::TerminateTicks && (fps <= 0 || duration <= 0)) {
+                *errorString = "frames per second and capture length must be greater than zero";
+                return false;
+            }
+            startCapture(mode, fps, duration, ui->sampleCount->value());
+        }
+        if (!csvRunning) {
+            *errorString = "the recording could not be created";
+            return false;
+        }
+        sessionCapture = true;
+        logEvent(QString("session capture %1").arg(captureSession.capturesStarted()), clock->nowNs());
+        return true;
+    }
+
+    case CaptureSession::Action::SensorCommand: {
+        int id = frameSource && frameSource->supportsCommands() ? frameSource->sendCommand(action.command) : -1;
+        if (id < 0) {
+            *errorString = "sensor command '" + QString::fromUtf8(action.command) + "' could not be sent";
+            return false;
+        }
+        captureSession.expectReply(id);
+        return true;
+    }
+
+    case CaptureSession::Action::Pico:
+        if (!Pico_Port || !Pico_Port->isOpen()) {
+            *errorString = "the Pico port is not open";
+            return false;
+        }
+        Pico_Port->write(action.command);
+        logEvent("pico " + TriggerSequence::escape(action.command), clock->nowNs());
+        return true;
+
+    case CaptureSession::Action::Log:
+        logEvent("session " + action.text, clock->nowNs());
+        return true;
+    }
+    return true;
+}
+
+// Stop the capture session if it runs and say why; a capture it started ends with it
+void MainWindow::stopSession(const QString &reason)
+{
+    // The action is still checked when the session ended on its own
+    bool wasRunning = captureSession.isRunning() || ui->actionRunSession->isChecked();
+    ui->actionRunSession->setChecked(false);
+    sessionTimer->stop();
+    captureSession.cancel();
+    if (!wasRunning) return;
+
+    if (sessionCapture && csvRunning) {
+        logEvent("session stop", clock->nowNs());
+        on_btnStop_clicked();
+    }
+    sessionCapture = false;
+    ui->statusbar->showMessage(QString("%1 (%2 captures)").arg(reason).arg(captureSession.capturesStarted()), 5000);
+}
+
+// Web dashboard menu handler
+void MainWindow::on_actionWebDashboard_triggered(bool checked)
+{
+    QSettings().setValue("webDashboard", checked);
+    if (!checked) {
+        dashboard->stop();
+        ui->statusbar->showMessage("Web dashboard stopped", 5000);
+        return;
+    }
+
+    QString error;
+    if (!dashboard->start(&error)) {
+        ui->actionWebDashboard->setChecked(false);
+        QMessageBox::warning(this, "Web Dashboard", "The dashboard could not be started: " + error);
+        return;
+    }
+    ui->statusbar->showMessage("Web dashboard at " + dashboard->url(), 10000);
+}
+
+// Web dashboard settings menu handler
+void MainWindow::on_actionDashboardSettings_triggered()
+{
+    DashboardServer::Settings web = dashboard->settings();
+    bool ok;
+    web.port = quint16(QInputDialog::getInt(this, "Web Dashboard", "TCP port:", web.port, 1, 65535, 1, &ok));
+    if (!ok) return;
+    QStringList access = {"This computer only", "All network interfaces"};
+    QString choice = QInputDialog::getItem(this, "Web Dashboard", "Accept connections from:", access,
+                                           web.remote ? 1 : 0, false, &ok);
+    if (!ok) return;
+    web.remote = choice == access[1];
+    web.updateHz = QInputDialog::getInt(this, "Web Dashboard", "Updates per second:", web.updateHz, 1, 50, 1, &ok);
+    if (!ok) return;
+    web.pointsPerSecond = QInputDialog::getInt(this, "Web Dashboard", "Plot points per second of signal:",
+                                               web.pointsPerSecond, 1, 1000, 1, &ok);
+    if (!ok) return;
+    web.maxBytesPerSecond = 1024 * QInputDialog::getInt(this, "Web Dashboard", "Bandwidth per client (KiB/s):",
+                                                        web.maxBytesPerSecond / 1024, 1, 100000, 1, &ok);
+    if (!ok) return;
+
+    QSettings settings;
+    settings.setValue("dashboardPort", web.port);
+    settings.setValue("dashboardRemote", web.remote);
+    settings.setValue("dashboardUpdateHz", web.updateHz);
+    settings.setValue("dashboardPointsPerSecond", web.pointsPerSecond);
+    settings.setValue("dashboardBytesPerSecond", web.maxBytesPerSecond);
+
+    // A running dashboard restarts with the new settings; otherwise they apply when it is started
+    dashboard->setSettings(web);
+    QString error;
+    if (dashboard->isRunning() && !dashboard->start(&error)) {
+        ui->actionWebDashboard->setChecked(false);
+        QSettings().setValue("webDashboard", false);
+        QMessageBox::warning(this, "Web Dashboard", "The dashboard could not be restarted: " + error);
+    }
+}
+
+// Trigger group menu handler
+void MainWindow::on_actionTriggerGroup_triggered()
+{
+    QSettings settings;
+    QString text = settings.value("triggerGroup").toString();
+    QString help = "One device per line as 'name = port; offset=ms; send=command'.\n"
+                   "offset is the device's output latency: its command is written that much earlier.\n"
+                   "Example: camera = COM7; offset=0.4";
+
+    // Keep asking until the devices parse or the operator cancels
+    while (true) {
+        bool ok;
+        text = QInputDialog::getMultiLineText(this, "Trigger Group", help, text, &ok);
+        if (!ok) return;
+
+        QVector<TriggerDevice> devices;
+        QString error;
+        if (TriggerGroup::parseDevices(text, devices, &error)) {
+            settings.setValue("triggerGroup", TriggerGroup::formatDevices(devices));
+
+            // Reopen with the new devices if the group is in use
+            if (triggerGroup->isOpen()) on_actionOpenTriggerGroup_triggered(true);
+            return;
+        }
+        QMessageBox::warning(this, "Invalid Trigger Device", error);
+    }
+}
+
+// Open trigger group menu handler
+void MainWindow::on_actionOpenTriggerGroup_triggered(bool checked)
+{
+    if (!checked) {
+        triggerGroup->close();
+        ui->statusbar->showMessage("Trigger group closed", 5000);
+        return;
+    }
+
+    QVector<TriggerDevice> devices;
+    QString error;
+    if (!TriggerGroup::parseDevices(QSettings().value("triggerGroup").toString(), devices, &error) ||
+        !triggerGroup->open(devices, &error)) {
+        ui->actionOpenTriggerGroup->setChecked(false);
+        QMessageBox::critical(this, "Error", "Failed to open trigger group: " + error);
+        return;
+    }
+    ui->actionOpenTriggerGroup->setChecked(true);
+    ui->statusbar->showMessage(QString("Trigger group open (%1 devices)").arg(triggerGroup->deviceCount()), 5000);
+}
+
+// A device of the trigger group failed
+void MainWindow::triggerGroupFailed(const QString &reason)
+{
+    triggerGroup->close();
+    ui->actionOpenTriggerGroup->setChecked(false);
+    QMessageBox::warning(this, "Trigger Group", "Trigger group closed: " + reason);
+}
+
+// Send the triggers for a phase-locked sample
+void MainWindow::sendSampleTrigger(const SensorFrame &frame)
+{
+    if (Pico_Port && Pico_Port->isOpen()) {
+        Pico_Port->write("1");
+    }
+
+    // Other devices are aligned to the estimated sampling instant, not the jittery arrival
+    if (triggerGroup->isOpen()) {
+        triggerGroup->fire(phaseLock.sampleTimeNs() + triggerGroup->alignmentNs());
+    }
+
+    // The marker's row is the row this frame gets in a frame-driven capture
+    logEvent("trigger", frame.timestampNs);
+}
+
+// Trigger on sensor samples menu handler
+void MainWindow::on_actionPhaseLock_triggered(bool checked)
+{
+    PhaseLock::Settings lock = phaseLock.settings();
+    lock.enabled = checked;
+    phaseLock.setSettings(lock);
+    QSettings().setValue("phaseLock", checked);
+    applyFrameBatching();
+}
+
+// Sample trigger settings menu handler
+void MainWindow::on_actionPhaseLockSettings_triggered()
+{
+    PhaseLock::Settings lock = phaseLock.settings();
+    bool ok;
+    int every = QInputDialog::getInt(this, "Sample Triggers", "Trigger on every Nth sensor sample, N:",
+                                     lock.every, 1, 1000000, 1, &ok);
+    if (!ok) return;
+    int phase = QInputDialog::getInt(this, "Sample Triggers",
+                                     "...starting at this sample of the capture (phase, in samples):",
+                                     qMin(lock.phase, every - 1), 0, every - 1, 1, &ok);
+    if (!ok) return;
+
+    lock.every = every;
+    lock.phase = phase;
+    phaseLock.setSettings(lock);
+
+    QSettings settings;
+    settings.setValue("phaseLockEvery", lock.every);
+    settings.setValue("phaseLockPhase", lock.phase);
+}
+
+// Overload policy menu handler
+void MainWindow::on_actionOverloadPolicy_triggered()
+{
+    RateController::Settings overload = rateController.settings();
+    QStringList policies = {"Off (measure only)", "Reduce the rate", "Skip ticks", "Abort the capture"};
+    bool ok;
+    QString policy = QInputDialog::getItem(this, "Overload Policy",
+                                           "When the capture cannot keep up with its rate:",
+                                           policies, overload.policy, false, &ok);
+    if (!ok) return;
+    double lateness = QInputDialog::getDouble(this, "Overload Policy",
+                                              "A tick or trigger later than this is overload (ms):",
+                                              overload.maxLatenessMs, 0.1, 10000, 1, &ok);
+    if (!ok) return;
+    int queue = QInputDialog::getInt(this, "Overload Policy",
+                                     "...and so are more trigger bytes than this waiting for the Pico:",
+                                     overload.maxQueueBytes, 1, 1000000, 1, &ok);
+    if (!ok) return;
+
+    overload.policy = static_cast<RateController::Policy>(policies.indexOf(policy));
+    overload.maxLatenessMs = lateness;
+    overload.maxQueueBytes = queue;
+    rateController.setSettings(overload);
+
+    QSettings settings;
+    settings.setValue("overloadPolicy", int(overload.policy));
+    settings.setValue("overloadLatenessMs", overload.maxLatenessMs);
+    settings.setValue("overloadQueueBytes", overload.maxQueueBytes);
+}
+
+// Sensor settings menu handler: send one setting to the sensor board
+void MainWindow::on_actionSensorSettings_triggered()
+{
+    if (!frameSource || !frameSource->supportsCommands()) {
+        QMessageBox::warning(this, "Sensor Settings", "Open the sensor (or the simulator) first; "
+                                                      "other sources cannot be configured.");
+        return;
+    }
+
+    QStringList settings = {"Sample rate (Hz)", "ADC gain", "Oversampling", "Board information", "Other command..."};
+    bool ok;
+    QString setting = QInputDialog::getItem(this, "Sensor Settings", "Setting:", settings, 0, false, &ok);
+    if (!ok) return;
+
+    QByteArray command;
+    switch (settings.indexOf(setting)) {
+    case 0: {
+        double rate = QInputDialog::getDouble(this, "Sensor Settings", "Sample rate (Hz):",
+                                              ui->framesPerSecond->value(), 0.1, 100000, 1, &ok);
+        command = "RATE " + QByteArray::number(rate);
+        break;
+    }
+    case 1:
+        command = "GAIN " + QByteArray::number(QInputDialog::getInt(this, "Sensor Settings", "ADC gain:",
+                                                                    1, 1, 128, 1, &ok));
+        break;
+    case 2:
+        command = "OVERSAMPLE " + QByteArray::number(QInputDialog::getInt(this, "Sensor Settings",
+                                                                          "ADC samples per reading:",
+                                                                          1, 1, 1024, 1, &ok));
+        break;
+    case 3:
+        command = "INFO";
+        break;
+    default:
+        command = QInputDialog::getText(this, "Sensor Settings", "Command (without the '$id' prefix):",
+                                        QLineEdit::Normal, QString(), &ok).trimmed().toUtf8();
+        break;
+    }
+    if (!ok || command.isEmpty()) return;
+
+    if (frameSource->sendCommand(command) < 0) {
+        QMessageBox::warning(this, "Sensor Settings", "The command could not be sent.");
+        return;
+    }
+    ui->statusbar->showMessage("Sensor: " + QString::fromUtf8(command) + "...", 5000);
+}
+
+// Match sensor rate menu handler
+void MainWindow::on_actionMatchSensorRate_triggered(bool checked)
+{
+    QSettings().setValue("matchSensorRate", checked);
+}
+
+// Reliable link menu handler: switch the board's format now if it is open
+void MainWindow::on_actionReliableLink_triggered(bool checked)
+{
+    QSettings().setValue("reliableLink", checked);
+    if (frameSource && frameSource->supportsCommands()) {
+        frameSource->sendCommand(checked ? "RELIABLE 1" : "RELIABLE 0");
+    }
+}
+
+// Frame batching menu handler
+void MainWindow::on_actionFrameBatching_triggered()
+{
+    bool ok;
+    int frames = QInputDialog::getInt(this, "Frame Batching",
+                                      "Frames handled together (1 = each frame by itself):",
+                                      blockFrames, 1, FrameBlock::Capacity, 1, &ok);
+    if (!ok) return;
+    int delayMs = QInputDialog::getInt(this, "Frame Batching",
+                                       "...waiting at most (ms) after the first frame of a block:",
+                                       blockDelayMs, 0, 1000, 1, &ok);
+    if (!ok) return;
+
+    blockFrames = frames;
+    blockDelayMs = delayMs;
+    applyFrameBatching();
+
+    QSettings settings;
+    settings.setValue("frameBlockFrames", blockFrames);
+    settings.setValue("frameBlockDelayMs", blockDelayMs);
+}
+
+// Show (and log) the sensor's answer to a command
+void MainWindow::sensorCommandFinished(int id, const QByteArray &command, bool ok,
+                                       const QString &text, qint64 latencyNs)
+{
+    if (captureSession.replyReceived(id, ok, text)) sessionTimer->start(0);
+
+    QString outcome = QString("%1 %2 %3 (%4 ms)").arg(QString::fromUtf8(command), ok ? "OK" : "failed:", text)
+                          .arg(latencyNs / 1e6, 0, 'f', 1);
+    ui->statusbar->showMessage("Sensor: " + outcome, ok ? 5000 : 10000);
+    logEvent("sensor " + outcome, clock->nowNs());
+}
+
+// Track baseline drift menu handler
+void MainWindow::on_actionTrackBaseline_triggered(bool checked)
+{
+    BaselineTracker::Settings baseline = pipeline.baselineTracker().settings();
+    baseline.enabled = checked;
+    pipeline.baselineTracker().setSettings(baseline);
+    QSettings().setValue("baselineTracking", checked);
+
+    // Rows recorded from here on use moving offsets; log the starting point
+    if (checked) logZeroOffsets("offsets", clock->nowNs());
+}
+
+// Baseline tracking settings menu handler
+void MainWindow::on_actionBaselineSettings_triggered()
+{
+    BaselineTracker::Settings baseline = pipeline.baselineTracker().settings();
+    bool ok;
+    double threshold = QInputDialog::getDouble(this, "Baseline Tracking",
+                                               "A channel counts as unloaded while its zeroed reading stays within (counts):",
+                                               baseline.threshold, 0, 1000000, 1, &ok);
+    if (!ok) return;
+    double noise = QInputDialog::getDouble(this, "Baseline Tracking",
+                                           "...and its standard deviation stays below (counts):",
+                                           baseline.noise, 0, 1000000, 2, &ok);
+    if (!ok) return;
+    double windowSeconds = QInputDialog::getDouble(this, "Baseline Tracking",
+                                                   "...for a quiet period of (seconds):",
+                                                   baseline.windowMs / 1000, 0.1, 3600, 1, &ok);
+    if (!ok) return;
+
+    baseline.threshold = threshold;
+    baseline.noise = noise;
+    baseline.windowMs = windowSeconds * 1000;
+    pipeline.baselineTracker().setSettings(baseline);
+
+    QSettings settings;
+    settings.setValue("baselineThreshold", baseline.threshold);
+    settings.setValue("baselineNoise", baseline.noise);
+    settings.setValue("baselineWindowMs", baseline.windowMs);
+}
+
+// Add marker menu handler
+void MainWindow::on_actionAddMarker_triggered()
+{
+    // Stamp before asking, so the marker is where the operator asked for it
+    EventMarker marker = stampMarker();
+
+    bool ok;
+    marker.label = QInputDialog::getItem(this, "Add Marker", "Label:", markerHotkeys.values(), 0, true, &ok).trimmed();
+    if (!ok || marker.label.isEmpty()) return;
+    addMarker(marker);
+}
+
+// Marker hotkeys menu handler
+void MainWindow::on_actionMarkerHotkeys_triggered()
+{
+    QString text = EventMarkers::formatHotkeys(markerHotkeys);
+    QString help = "One hotkey per line as 'key = label', for example 'F5 = cough'.\n"
+                   "Pressing the key during a capture adds the label as an event marker.";
+
+    // Keep asking until the hotkeys parse or the operator cancels
+    while (true) {
+        bool ok;
+        text = QInputDialog::getMultiLineText(this, "Marker Hotkeys", help, text, &ok);
+        if (!ok) return;
+
+        QMap<int, QString> labels;
+        QString error;
+        if (EventMarkers::parseHotkeys(text, labels, &error)) {
+            markerHotkeys = labels.isEmpty() ? EventMarkers::defaultHotkeys() : labels;
+            QSettings settings;
+            settings.setValue("markerHotkeys", EventMarkers::formatHotkeys(markerHotkeys));
+            return;
+        }
+        QMessageBox::warning(this, "Invalid Marker Hotkey", error);
+    }
+}
+
+// Browse event markers menu handler
+void MainWindow::on_actionBrowseMarkers_triggered()
+{
+    QString recordingName = QFileDialog::getOpenFileName(
+        this, "Browse Event Markers",
+        QStandardPaths::writableLocation(QStandardPaths::DesktopLocation),
+        "Recordings (*.csv);;All files (*)");
+    if (recordingName.isEmpty()) return;
+
+    QVector<EventMarker> markers;
+    QString error;
+    if (!EventMarkers::load(EventMarkers::fileNameFor(recordingName), markers, &error)) {
+        QMessageBox::warning(this, "Browse Event Markers", "No event markers for this recording: " + error);
+        return;
+    }
+    if (markers.isEmpty()) {
+        QMessageBox::information(this, "Browse Event Markers", "The recording has no event markers.");
+        return;
+    }
+
+    // Data rows are numbered from 1 like the rows shown around each marker
+    QStringList items;
+    for (const EventMarker &marker : markers) {
+        items << QString("Row %1  %2  %3").arg(marker.row + 1)
+                     .arg(marker.wallTime.toString("HH:mm:ss.zzz"), marker.label);
+    }
+
+    // Jump from marker to marker until the operator closes the list
+    static const int ContextRows = 5;
+    int current = 0;
+    while (true) {
+        bool ok;
+        QString item = QInputDialog::getItem(this, "Browse Event Markers",
+                                             QString("%1 markers in %2").arg(markers.size())
+                                                 .arg(QFileInfo(recordingName).fileName()),
+                                             items, current, false, &ok);
+        if (!ok) return;
+        current = items.indexOf(item);
+        const EventMarker &marker = markers[current];
+
+        QStringList before, after;
+        if (!EventMarkers::readRows(recordingName, marker.row - ContextRows, ContextRows, before, &error) ||
+            !EventMarkers::readRows(recordingName, marker.row, ContextRows, after, &error)) {
+            QMessageBox::warning(this, "Browse Event Markers", error);
+            return;
+        }
+        QStringList lines = before;
+        lines << QString(">>> %1 (%2)").arg(marker.label, marker.wallTime.toString("yyyy-MM-dd HH:mm:ss.zzz"));
+        lines << after;
+        QMessageBox::information(this, item, lines.join("\n"));
+    }
+}
+
+// Measure channel lag menu handler
+void MainWindow::on_actionChannelLag_triggered(bool checked)
+{
+    ChannelCorrelation::Settings lag = channelCorrelation.settings();
+    lag.enabled = checked;
+    channelCorrelation.setSettings(lag);
+    channelCorrelation.reset();         // Start from a fresh window
+    QSettings().setValue("channelLag", checked);
+}
+
+// Channel lag settings menu handler (used live and for recordings)
+void MainWindow::on_actionChannelLagSettings_triggered()
+{
+    ChannelCorrelation::Settings lag = channelCorrelation.settings();
+    bool ok;
+    int window = QInputDialog::getInt(this, "Channel Lag", "Samples per analysis window:",
+                                      lag.windowSamples, 16, 1 << 20, 64, &ok);
+    if (!ok) return;
+    int maxLag = QInputDialog::getInt(this, "Channel Lag", "Largest lag searched (samples):",
+                                      qMin(lag.maxLagSamples, window / 4), 1, window / 4, 1, &ok);
+    if (!ok) return;
+    double band = QInputDialog::getDouble(this, "Channel Lag", "Coherence band up to (Hz):",
+                                          lag.bandHz, 0.1, 100000, 1, &ok);
+    if (!ok) return;
+
+    lag.windowSamples = window;
+    lag.maxLagSamples = maxLag;
+    lag.bandHz = band;
+    channelCorrelation.setSettings(lag);
+
+    QSettings settings;
+    settings.setValue("channelLagWindow", lag.windowSamples);
+    settings.setValue("channelLagMax", lag.maxLagSamples);
+    settings.setValue("channelLagBandHz", lag.bandHz);
+}
@@ -7,6 +7,24 @@
 #include <QTextStream>
 #include <QTimer>
 #include <QKeyEvent>
+#include <QElapsedTimer>
+#include "allocationstats.h"
+#include "recordingwriter.h"
+#include "acquisitionpipeline.h"
+#include "framesource.h"
+#include "latencymonitor.h"
+#include "capturescheduler.h"
+#include "clock.h"
+#include "eventmarkers.h"
+#include "triggersequence.h"
+#include "capturesession.h"
+#include "triggergroup.h"
+#include "phaselock.h"
+#include "ratecontroller.h"
+#include "channelcorrelation.h"
+#include "dashboardserver.h"
+#include <QMap>
+#include <functional>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -21,6 +39,7 @@ public:
     ~MainWindow();
 
 protected:
+    bool event(QEvent *event) override;
     bool eventFilter(QObject *watched, QEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
     void keyReleaseEvent(QKeyEvent *event) override;
@@ -28,39 +47,139 @@ protected:
 private slots:
     void on_btnStart_clicked();
     void on_btnStop_clicked();
-    void on_btnOpenPort_clicked();
+    void on_btnPause_clicked();
+    void on_captureMode_currentIndexChanged(int index);
+    void on_sourceType_currentIndexChanged(int index);
+    void on_HC06Button_clicked();
     void on_btnClosPort_clicked();
     void on_btnRefreshPorts_clicked();
     void on_btnZero_clicked();
     void on_PicoButton_clicked();
-    void readData();
+    void handleFrame(const SensorFrame &received);
+    void handleBlock(const FrameBlock &received);
+    void handleSourceStopped(const QString &reason);
+    void updateStatistics();
+    void captureTick();
+    void on_actionVerifyRecording_triggered();
+    void on_actionDerivedChannels_triggered();
+    void on_actionAlarmRules_triggered();
+    void on_actionJoinTimestamps_triggered();
+    void on_actionAnalyzeChannelLag_triggered();
+    void on_actionTriggerSequence_triggered();
+    void on_actionRunSequence_triggered(bool checked);
+    void sequenceTick();
+    void on_actionCaptureSession_triggered();
+    void on_actionRunSession_triggered(bool checked);
+    void sessionTick();
+    void on_actionTriggerGroup_triggered();
+    void on_actionWebDashboard_triggered(bool checked);
+    void on_actionDashboardSettings_triggered();
+    void on_actionOpenTriggerGroup_triggered(bool checked);
+    void triggerGroupFailed(const QString &reason);
+    void on_actionPhaseLock_triggered(bool checked);
+    void on_actionPhaseLockSettings_triggered();
+    void on_actionOverloadPolicy_triggered();
+    void on_actionSensorSettings_triggered();
+    void on_actionMatchSensorRate_triggered(bool checked);
+    void on_actionReliableLink_triggered(bool checked);
+    void on_actionFrameBatching_triggered();
+    void sensorCommandFinished(int id, const QByteArray &command, bool ok, const QString &text, qint64 latencyNs);
+    void on_actionTrackBaseline_triggered(bool checked);
+    void on_actionBaselineSettings_triggered();
+    void on_actionChannelLag_triggered(bool checked);
+    void on_actionChannelLagSettings_triggered();
+    void on_actionAddMarker_triggered();
+    void on_actionMarkerHotkeys_triggered();
+    void on_actionBrowseMarkers_triggered();
 
 private:
     Ui::MainWindow *ui;
 
-    // Serial port members
-    QSerialPort *_serialPort;
+    // Data source and Pico port members
+    FrameSource *frameSource;
     QSerialPort *Pico_Port;
 
     // CSV recording members
-    QFile csvFile;
-    QTextStream csvStream;
+    RecordingWriter csvWriter;
     bool csvRunning;
     double csvFramesPerSecond;
     int csvCaptureDuration;
     QTimer *csvTimer;
 
-    // Sensor calibration values
-    int zeroTopLeft;
-    int zeroTopRight;
-    int zeroBotLeft;
+    // Statistics panel members
+    QTimer *statsTimer;
+    AllocationStats::Snapshot lastAllocationSnapshot;
+    LatencyMonitor latencyMonitor;
+
+    // Frame processing (zero offsets and force estimation)
+    AcquisitionPipeline pipeline;
+
+    // Time base for frame timestamps, capture ticks and recordings
+    const Clock *clock;
+    CaptureScheduler captureScheduler;
+
+    // Trigger protocol run on the Pico port
+    TriggerSequence triggerSequence;
+    QTimer *sequenceTimer;
+    QVector<QByteArray> sequenceCommands;   // Reused for the commands of one step
+
+    // Session protocol (wait for force, zero, capture, ...) run on the frames and events
+    CaptureSession captureSession;
+    QTimer *sessionTimer;               // Wakes the session when a wait or timeout runs out
+    QVector<CaptureSession::Action> sessionActions;
+    bool sessionCapture;                // The running capture was started by the session
+
+    // Trigger outputs on separate devices, fired with the capture ticks
+    TriggerGroup *triggerGroup;
+
+    // Triggers on every Nth sensor sample instead of the capture ticks
+    PhaseLock phaseLock;
+
+    // Reacts to ticks the capture cannot keep up with
+    RateController rateController;
+    qint64 keptTicks;                   // Ticks of the capture recorded so far
+
+    // Sampling lag between the load cells, measured live
+    ChannelCorrelation channelCorrelation;
+
+    // Live view for browsers on this or other computers
+    DashboardServer *dashboard;
+
+    // Event marker labels by key (Qt::Key)
+    QMap<int, QString> markerHotkeys;
+
+    // Frames are delivered in blocks unless a latency-critical feature needs each at once
+    int blockFrames;
+    int blockDelayMs;
+    FrameBlock processedBlock;          // Reused output of the pipeline
 
     // Helper functions
     void resetValues();
+    FrameSource *createFrameSource();
+    void closeFrameSource();
+    void applyFrameBatching();
+    void runOffline(const char *name, std::function<void()> work, std::function<void()> done);
+    void startCapture(int mode, double fps, double duration, qint64 sampleCount);
     void startCsvRecording();
     void stopCsvRecording();
-    void writeCsvData();
+    void writeCsvData(const SensorFrame &frame, qint64 timestampNs);
+    bool updateCaptureProgress();
     void handleCsvCapture();
+    void updateEstimateDisplay(const SensorFrame &frame);
+    void updateDerivedDisplay(const SensorFrame &frame);
+    void displayFrame(const SensorFrame &frame);
+    void handleAlarmEvents();
+    void updateAlarmDisplay();
+    void handleBaselineAdjustments();
+    void logZeroOffsets(const char *reason, qint64 timestampNs);
+    void logEvent(const QString &label, qint64 timestampNs);
+    void stopSequence(const QString &reason);
+    bool runSessionAction(const CaptureSession::Action &action, QString *errorString);
+    void stopSession(const QString &reason);
+    void sendSampleTrigger(const SensorFrame &frame);
+    bool handleOverload(qint64 nowNs);
+    EventMarker stampMarker() const;
+    void addMarker(const EventMarker &marker);
 
 };
 
@@ -0,0 +1,261 @@
+// Include necessary headers
+#include "networkframesource.h"
+#include "allocationstats.h"            // For tagging the parse stage
+#include <QtEndian>                     // For the binary frame layout
+#include <algorithm>                    // For std::count
+#include <cstdlib>                      // For strtoul
+#include <cstring>                      // For memchr
+
+// How long open() waits for the bridge to accept a TCP connection
+static const int ConnectTimeoutMs = 3000;
+
+// UDP frames may overtake each other by up to this many sequence numbers...
+static const int UdpReorderWindow = 64;
+
+// ...and a missing frame is waited for at most this long
+static const int ReorderTimeoutMs = 20;
+
+// Magic bytes at the start of every binary frame
+static const uchar BinaryMagic0 = 0xA5;
+static const uchar BinaryMagic1 = 0x5A;
+
+// NetworkFrameSource constructor
+NetworkFrameSource::NetworkFrameSource(Transport transport, const QString &host, quint16 port, QObject *parent)
+    : FrameSource(parent)
+    , transport(transport)
+    , host(host)
+    , port(port)
+    , tcpSocket(nullptr)
+    , udpSocket(nullptr)
+    , closing(false)
+    , streamFormat(StreamUnknown)
+    , reorder(transport == TransportUdp ? UdpReorderWindow : 1, ReorderTimeoutMs)
+    , gapTimer(new QTimer(this))
+{
+    if (transport == TransportUdp) {
+        udpSocket = new QUdpSocket(this);
+        connect(udpSocket, &QUdpSocket::readyRead, this, &NetworkFrameSource::readUdp);
+    } else {
+        tcpSocket = new QTcpSocket(this);
+        connect(tcpSocket, &QTcpSocket::readyRead, this, &NetworkFrameSource::readTcp);
+        connect(tcpSocket, &QTcpSocket::disconnected, this, &NetworkFrameSource::handleDisconnect);
+    }
+
+    gapTimer->setSingleShot(true);
+    connect(gapTimer, &QTimer::timeout, this, &NetworkFrameSource::serviceReorder);
+}
+
+QString NetworkFrameSource::description() const
+{
+    if (transport == TransportUdp) return QString("UDP port %1").arg(port);
+    return QString("TCP %1:%2").arg(host).arg(port);
+}
+
+// Loss and ordering counters for the statistics panel
+QString NetworkFrameSource::statistics() const
+{
+    if (!reorder.isActive()) return "no sequence numbers (loss not measured)";
+    return reorder.statistics();
+}
+
+bool NetworkFrameSource::isOpen() const
+{
+    if (udpSocket) return udpSocket->state() == QAbstractSocket::BoundState;
+    return tcpSocket->state() == QAbstractSocket::ConnectedState;
+}
+
+// Connect to the bridge or start listening for its datagrams
+bool NetworkFrameSource::open(QString *errorString)
+{
+    resetLineBuffer();
+    reorder.reset();
+    gapTimer->stop();
+    streamFormat = StreamUnknown;
+    binaryPending.clear();
+
+    if (udpSocket) {
+        if (!udpSocket->bind(QHostAddress::AnyIPv4, port)) {
+            if (errorString) *errorString = udpSocket->errorString();
+            return false;
+        }
+        // Room for bursts while the GUI thread is busy repainting
+        udpSocket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, 1024 * 1024);
+        return true;
+    }
+
+    tcpSocket->connectToHost(host, port, QIODevice::ReadOnly);
+    if (!tcpSocket->waitForConnected(ConnectTimeoutMs)) {
+        if (errorString) *errorString = tcpSocket->errorString();
+        tcpSocket->abort();
+        return false;
+    }
+
+    // Readings are tiny; send them on without waiting to fill a segment
+    tcpSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    return true;
+}
+
+void NetworkFrameSource::close()
+{
+    // A deliberate close is not reported as a lost connection
+    closing = true;
+    if (udpSocket) udpSocket->close();
+    else tcpSocket->abort();
+    closing = false;
+    gapTimer->stop();
+}
+
+// TCP data ready read handler
+void NetworkFrameSource::readTcp()
+{
+    // Stamp at the socket, before anything else is done with the data
+    qint64 arrival = now();
+    QByteArray data = tcpSocket->readAll();
+    if (data.isEmpty()) return;
+
+    if (streamFormat == StreamUnknown) {
+        streamFormat = uchar(data[0]) == BinaryMagic0 ? StreamBinary : StreamText;
+    }
+
+    if (streamFormat == StreamText) {
+        receiveData(data.constData(), data.size(), arrival);
+        return;
+    }
+
+    // Binary frames may be split across reads
+    binaryPending.append(data);
+    int whole = binaryPending.size() / BinaryFrameSize * BinaryFrameSize;
+    receiveBinary(binaryPending.constData(), whole, arrival);
+    binaryPending.remove(0, whole);
+}
+
+// UDP data ready read handler
+void NetworkFrameSource::readUdp()
+{
+    while (udpSocket->hasPendingDatagrams()) {
+        qint64 arrival = now();
+        qint64 size = udpSocket->pendingDatagramSize();
+        if (size <= 0) {
+            udpSocket->readDatagram(nullptr, 0);    // Discard empty datagrams
+            continue;
+        }
+        if (datagram.size() < size) datagram.resize(int(size));
+        size = udpSocket->readDatagram(datagram.data(), size);
+        if (size <= 0) continue;
+
+        // Each datagram is self-contained: binary frames or complete lines
+        const char *data = datagram.constData();
+        if (uchar(data[0]) == BinaryMagic0) {
+            receiveBinary(data, size, arrival);
+            continue;
+        }
+
+        const char *end = data + size;
+        while (data < end) {
+            const char *newline = static_cast<const char *>(std::memchr(data, '\n', size_t(end - data)));
+            const char *lineEnd = newline ? newline : end;
+            receiveLine(data, lineEnd - data, arrival);
+            data = lineEnd + 1;
+        }
+    }
+}
+
+void NetworkFrameSource::handleDisconnect()
+{
+    if (closing) return;
+    emit stopped("Connection closed by " + host);
+}
+
+// Decode consecutive binary frames
+void NetworkFrameSource::receiveBinary(const char *data, qint64 length, qint64 timestampNs)
+{
+    for (qint64 offset = 0; offset + BinaryFrameSize <= length; offset += BinaryFrameSize) {
+        quint32 sequence;
+        SensorFrame frame;
+        bool decoded;
+        {
+            AllocationScope scope(AllocationStats::StageParse);
+            decoded = decodeBinaryFrame(data + offset, sequence, frame);
+        }
+        if (!decoded) {
+            countMalformed();
+            continue;
+        }
+        AllocationStats::recordFrame(AllocationStats::StageParse);
+        acceptSequenced(sequence, frame, timestampNs);
+    }
+    if (length % BinaryFrameSize != 0) countMalformed();
+}
+
+// Text readings, with or without a leading sequence number
+void NetworkFrameSource::receiveLine(const char *line, qint64 length, qint64 timestampNs)
+{
+    if (length > 0 && line[length - 1] == '\r') --length;
+    if (length == 0) return;
+
+    // Four fields mean the bridge numbered the reading
+    if (std::count(line, line + length, ',') == 3) {
+        char *end;
+        unsigned long sequence = std::strtoul(line, &end, 10);
+        if (end == line || *end != ',') {
+            countMalformed();
+            return;
+        }
+        SensorFrame frame;
+        const char *reading = end + 1;
+        if (parseLine(reading, line + length - reading, frame)) {
+            acceptSequenced(quint32(sequence), frame, timestampNs);
+        }
+        return;
+    }
+
+    SensorFrame frame;
+    if (parseLine(line, length, frame)) deliverFrame(frame, timestampNs);
+}
+
+// Hold a numbered frame until every frame before it was delivered or given up on
+void NetworkFrameSource::acceptSequenced(quint32 sequence, const SensorFrame &frame, qint64 timestampNs)
+{
+    reorder.accept(sequence, frame, timestampNs, now());
+    serviceReorder();
+}
+
+// Deliver the frames that are in order and wait for the next gap to time out
+void NetworkFrameSource::serviceReorder()
+{
+    qint64 nowNs = now();
+    reorder.service(nowNs);
+
+    ReorderBuffer::Delivery delivery;
+    while (reorder.takeDelivery(delivery)) deliverFrame(delivery.frame, delivery.timestampNs);
+
+    // Frames are waiting behind a gap: do not wait for it forever
+    qint64 deadline = reorder.nextDeadlineNs();
+    if (deadline < 0) gapTimer->stop();
+    else if (!gapTimer->isActive()) gapTimer->start(int(qMax<qint64>(0, (deadline - nowNs + 999999) / 1000000)));
+}
+
+// Write one binary frame
+void NetworkFrameSource::encodeBinaryFrame(quint32 sequence, const int raw[ChannelCount], char *out)
+{
+    uchar *bytes = reinterpret_cast<uchar *>(out);
+    bytes[0] = BinaryMagic0;
+    bytes[1] = BinaryMagic1;
+    qToLittleEndian<quint32>(sequence, bytes + 2);
+    qToLittleEndian<qint32>(raw[ChannelBotLeft], bytes + 6);    // Same order as the ASCII line
+    qToLittleEndian<qint32>(raw[ChannelTopLeft], bytes + 10);
+    qToLittleEndian<qint32>(raw[ChannelTopRight], bytes + 14);
+}
+
+// Read one binary frame
+bool NetworkFrameSource::decodeBinaryFrame(const char *data, quint32 &sequence, SensorFrame &frame)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+    if (bytes[0] != BinaryMagic0 || bytes[1] != BinaryMagic1) return false;
+
+    sequence = qFromLittleEndian<quint32>(bytes + 2);
+    frame.raw[ChannelBotLeft] = qFromLittleEndian<qint32>(bytes + 6);
+    frame.raw[ChannelTopLeft] = qFromLittleEndian<qint32>(bytes + 10);
+    frame.raw[ChannelTopRight] = qFromLittleEndian<qint32>(bytes + 14);
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef NETWORKFRAMESOURCE_H
+#define NETWORKFRAMESOURCE_H
+
+#include "framesource.h"
+#include "reorderbuffer.h"
+#include <QTcpSocket>
+#include <QUdpSocket>
+#include <QTimer>
+
+// Readings forwarded over the network by a bridge (a small computer wired to
+// the sensor). The bridge sends either
+//  - the sensor's ASCII lines, optionally prefixed with a sequence number
+//    ("seq,botLeft,topLeft,topRight"), or
+//  - binary frames of BinaryFrameSize bytes, little-endian: the two magic
+//    bytes A5 5A, a quint32 sequence number and qint32 bottom left, top left
+//    and top right.
+// Over TCP the bridge is the server; over UDP it sends datagrams (one or more
+// readings each) to the port we listen on. Sequence numbers let the source put
+// UDP datagrams back in order and count lost readings (see ReorderBuffer).
+class NetworkFrameSource : public FrameSource
+{
+    Q_OBJECT
+
+public:
+    enum Transport {
+        TransportTcp,
+        TransportUdp
+    };
+
+    static const int BinaryFrameSize = 18;
+
+    // Over UDP host is ignored and port is the local port to listen on
+    NetworkFrameSource(Transport transport, const QString &host, quint16 port, QObject *parent = nullptr);
+
+    bool open(QString *errorString = nullptr) override;
+    void close() override;
+    bool isOpen() const override;
+    QString description() const override;
+    QString statistics() const override;
+
+    // Binary frame encoding shared with the loopback bridge (raw values in SensorChannel order)
+    static void encodeBinaryFrame(quint32 sequence, const int raw[ChannelCount], char *out);
+    static bool decodeBinaryFrame(const char *data, quint32 &sequence, SensorFrame &frame);
+
+protected:
+    void receiveLine(const char *line, qint64 length, qint64 timestampNs) override;
+
+private:
+    void readTcp();
+    void readUdp();
+    void handleDisconnect();
+    void receiveBinary(const char *data, qint64 length, qint64 timestampNs);
+
+    // Reordering and loss accounting
+    void acceptSequenced(quint32 sequence, const SensorFrame &frame, qint64 timestampNs);
+    void serviceReorder();
+
+    Transport transport;
+    QString host;
+    quint16 port;
+    QTcpSocket *tcpSocket;
+    QUdpSocket *udpSocket;
+    QByteArray datagram;                // Reused receive buffer
+    bool closing;
+
+    // TCP streams are either all binary or all text, decided by the first byte
+    enum StreamFormat { StreamUnknown, StreamText, StreamBinary } streamFormat;
+    QByteArray binaryPending;           // Partial binary frame from the last read
+
+    ReorderBuffer reorder;
+    QTimer *gapTimer;                   // Gives up on a missing frame after a while
+};
+
+#endif // NETWORKFRAMESOURCE_H
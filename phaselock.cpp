@@ -0,0 +1,73 @@
+// Include necessary headers
+#include "phaselock.h"
+#include <cmath>                        // For std::abs
+
+// Share of each arrival's deviation taken into the estimated sampling instant; small,
+// so that bursts of serial reads average out
+static const double PhaseGain = 0.05;
+
+// An arrival this many periods off the estimate means the stream stalled, not jitter
+static const double ResyncPeriods = 20;
+
+// PhaseLock constructor
+PhaseLock::PhaseLock()
+{
+    reset();
+}
+
+void PhaseLock::setSettings(const Settings &settings)
+{
+    current = settings;
+    current.every = qMax(1, current.every);
+    current.phase = qBound(0, current.phase, current.every - 1);
+}
+
+// Count the samples of a new capture from zero
+void PhaseLock::restart()
+{
+    samples = 0;
+    triggered = 0;
+    maxJitter = 0;
+}
+
+// Forget the clock estimate as well
+void PhaseLock::reset()
+{
+    restart();
+    sampleNs = 0;
+    period = 0;
+    firstArrivalNs = 0;
+    clockSamples = 0;
+    started = false;
+}
+
+// Follow the sample clock and decide whether this sample triggers
+bool PhaseLock::update(qint64 timestampNs)
+{
+    // Track the sample clock: the period is the average since the clock was
+    // (re)started, the instant follows each arrival a little
+    if (started && period > 0 && std::abs(timestampNs - (sampleNs + period)) > ResyncPeriods * period) {
+        started = false;                // The stream stalled or jumped; start from here again
+    }
+    if (!started) {
+        firstArrivalNs = timestampNs;
+        clockSamples = 0;
+        sampleNs = timestampNs;
+        started = true;
+    } else {
+        clockSamples++;
+        if (timestampNs > firstArrivalNs) period = double(timestampNs - firstArrivalNs) / clockSamples;
+        if (period > 0) {
+            double predicted = sampleNs + period;
+            double error = timestampNs - predicted;
+            sampleNs = predicted + PhaseGain * error;
+            maxJitter = qMax(maxJitter, qint64(std::abs(error)));
+        }
+    }
+
+    // Triggers are counted in samples, so they stay locked whatever the estimate does
+    quint64 index = samples++;
+    if (!current.enabled || index % quint64(current.every) != quint64(current.phase)) return false;
+    triggered++;
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef PHASELOCK_H
+#define PHASELOCK_H
+
+#include <QtGlobal>
+
+// Derives ultrasound triggers from the sensor's own sampling instead of a
+// timer: every settings().every-th sensor sample of a capture, starting at
+// sample settings().phase, is a trigger sample. Each ultrasound frame then has
+// a force sample at a known, constant offset, however the two clocks drift.
+//
+// Alongside, the sample clock is estimated from the arrival times (the average
+// period and a slowly following phase), which smooths out the jitter of serial
+// reads. The estimate gives the sensor rate and a sampling instant for each
+// frame that triggers on other devices can be aligned to.
+class PhaseLock
+{
+public:
+    struct Settings {
+        bool enabled = false;
+        int every = 10;                 // Trigger on every Nth sample...
+        int phase = 0;                  // ...starting at this sample of the capture (0 to every - 1)
+    };
+
+    PhaseLock();
+
+    void setSettings(const Settings &settings);
+    const Settings &settings() const { return current; }
+
+    // Start counting samples for a new capture (the clock estimate is kept)
+    void restart();
+
+    // Forget everything, including the clock estimate (e.g. after reopening the port)
+    void reset();
+
+    // Watch one frame as soon as it was parsed; returns true if it is a trigger sample
+    bool update(qint64 timestampNs);
+
+    // Estimated sample clock (0 until two frames were seen)
+    double periodNs() const { return period; }
+    qint64 sampleTimeNs() const { return qint64(sampleNs); }
+
+    // Largest distance of an arrival from the estimated clock, since the last restart
+    qint64 maxJitterNs() const { return maxJitter; }
+    quint64 triggers() const { return triggered; }
+
+private:
+    Settings current;
+    quint64 samples;                    // Samples seen since restart()
+    quint64 triggered;
+    double sampleNs;                    // Estimated sampling instant of the latest frame
+    double period;                      // Average since firstArrivalNs
+    qint64 firstArrivalNs;
+    quint64 clockSamples;               // Samples since firstArrivalNs
+    bool started;
+    qint64 maxJitter;
+};
+
+#endif // PHASELOCK_H
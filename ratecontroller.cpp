@@ -0,0 +1,114 @@
+// Include necessary headers
+#include "ratecontroller.h"
+
+// Rate kept after an overloaded window (reduce policy)
+static const double DecreaseFactor = 0.8;
+
+// Share of the requested rate given back after each calm window
+static const double IncreaseStep = 0.05;
+
+// Calm windows before the skip factor is lowered again
+static const int CalmWindowsPerStep = 4;
+
+// Largest skip factor (keep one tick in this many)
+static const int MaxSkipFactor = 64;
+
+// RateController constructor
+RateController::RateController()
+    : requestedRate(0)
+    , currentRate(0)
+    , lowest(0)
+    , skip(1)
+    , calmWindows(0)
+    , changeCount(0)
+    , windowStartNs(0)
+{
+}
+
+const char *RateController::policyName(Policy policy)
+{
+    switch (policy) {
+    case PolicyReduce: return "reduce";
+    case PolicySkip:   return "skip";
+    case PolicyAbort:  return "abort";
+    default:           return "off";
+    }
+}
+
+// Begin a capture
+void RateController::start(qint64 nowNs, double framesPerSecond)
+{
+    requestedRate = framesPerSecond;
+    currentRate = framesPerSecond;
+    lowest = framesPerSecond;
+    skip = 1;
+    calmWindows = 0;
+    changeCount = 0;
+    windowStartNs = nowNs;
+    worst = Load();
+    lastReason.clear();
+}
+
+// Fold one tick into the window and act on a finished window
+RateController::Action RateController::update(qint64 nowNs, const Load &load)
+{
+    worst.latenessNs = qMax(worst.latenessNs, load.latenessNs);
+    worst.queueBytes = qMax(worst.queueBytes, load.queueBytes);
+    worst.deviceLatenessNs = qMax(worst.deviceLatenessNs, load.deviceLatenessNs);
+    if (nowNs - windowStartNs < qint64(current.windowMs * 1e6)) return ActionNone;
+
+    // Judge the window against the limits
+    const qint64 maxLatenessNs = qint64(current.maxLatenessMs * 1e6);
+    QString overload;
+    if (worst.latenessNs > maxLatenessNs) {
+        overload = QString("tick lateness %1 ms").arg(worst.latenessNs / 1e6, 0, 'f', 2);
+    } else if (worst.deviceLatenessNs > maxLatenessNs) {
+        overload = QString("device lateness %1 ms").arg(worst.deviceLatenessNs / 1e6, 0, 'f', 2);
+    } else if (worst.queueBytes > current.maxQueueBytes) {
+        overload = QString("%1 bytes queued").arg(worst.queueBytes);
+    }
+    bool calm = worst.latenessNs <= maxLatenessNs / 2 && worst.deviceLatenessNs <= maxLatenessNs / 2 &&
+                worst.queueBytes <= current.maxQueueBytes / 2;
+    windowStartNs = nowNs;
+    worst = Load();
+
+    if (!overload.isEmpty()) {
+        calmWindows = 0;
+        lastReason = overload;
+    } else if (calm) {
+        calmWindows++;
+        lastReason = "calm";
+    } else {
+        return ActionNone;              // Between the limits: hold
+    }
+
+    double previousRate = currentRate;
+    int previousSkip = skip;
+    switch (current.policy) {
+    case PolicyReduce:
+        if (!overload.isEmpty()) {
+            currentRate = qMax(requestedRate * current.minRateFraction, currentRate * DecreaseFactor);
+        } else {
+            currentRate = qMin(requestedRate, currentRate + requestedRate * IncreaseStep);
+        }
+        break;
+    case PolicySkip:
+        if (!overload.isEmpty()) {
+            skip = qMin(MaxSkipFactor, skip + 1);
+        } else if (calmWindows >= CalmWindowsPerStep && skip > 1) {
+            skip--;
+            calmWindows = 0;
+        }
+        break;
+    case PolicyAbort:
+        if (!overload.isEmpty()) return ActionAbort;
+        break;
+    default:
+        break;
+    }
+
+    if (currentRate == previousRate && skip == previousSkip) return ActionNone;
+    changeCount++;
+    lowest = qMin(lowest, currentRate / skip);
+    return ActionChange;
+}
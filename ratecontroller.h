@@ -0,0 +1,91 @@
+#ifndef RATECONTROLLER_H
+#define RATECONTROLLER_H
+
+#include <QString>
+
+// Keeps a tick-driven capture orderly when its rate cannot be sustained by the
+// host, the link or the trigger devices. Load is judged per window of
+// settings().windowMs from how late the ticks were taken, the trigger bytes
+// still queued for the Pico and how late the trigger group wrote its devices
+// (the nearest thing to an acknowledgement, as the devices send none). An
+// overloaded window makes the controller act according to its policy:
+//
+//  - reduce: lower the rate by a fixed factor (never below minRateFraction of
+//    the requested rate), and raise it back in small steps once calm;
+//  - skip:   keep only every Nth tick, N growing under overload and shrinking
+//    once calm, so the ticks that are kept stay on their exact times;
+//  - abort:  end the capture.
+//
+// A window only counts as calm when the load stayed below half of every limit.
+class RateController
+{
+public:
+    enum Policy {
+        PolicyOff = 0,                  // Only measure
+        PolicyReduce,
+        PolicySkip,
+        PolicyAbort
+    };
+
+    struct Settings {
+        Policy policy = PolicyOff;
+        double maxLatenessMs = 5;       // Latest a tick or device write may be
+        int maxQueueBytes = 64;         // Most trigger bytes waiting for the Pico port
+        double windowMs = 500;
+        double minRateFraction = 0.1;
+    };
+
+    // Load seen at one tick
+    struct Load {
+        qint64 latenessNs = 0;          // Of the oldest tick taken
+        qint64 queueBytes = 0;          // Waiting to be written to the Pico
+        qint64 deviceLatenessNs = 0;    // Of the trigger group's writes since the last tick
+    };
+
+    enum Action {
+        ActionNone,
+        ActionChange,                   // rate() or skipFactor() changed
+        ActionAbort
+    };
+
+    RateController();
+
+    void setSettings(const Settings &settings) { current = settings; }
+    const Settings &settings() const { return current; }
+
+    static const char *policyName(Policy policy);
+
+    // Begin a capture at the requested rate
+    void start(qint64 nowNs, double framesPerSecond);
+
+    // Account one tick's load; at the end of a window, decide
+    Action update(qint64 nowNs, const Load &load);
+
+    // Rate the capture should run at, and the share of its ticks to keep (1 in skipFactor())
+    double rate() const { return currentRate; }
+    int skipFactor() const { return skip; }
+    bool keepTick(qint64 tick) const { return tick % skip == 0; }
+
+    // Ticks in [first, last) kept at the current skip factor
+    qint64 keptBetween(qint64 first, qint64 last) const { return (last + skip - 1) / skip - (first + skip - 1) / skip; }
+
+    // What the last decision was based on, e.g. "tick lateness 12.30 ms" or "calm"
+    QString reason() const { return lastReason; }
+
+    int changes() const { return changeCount; }
+    double lowestRate() const { return lowest; }
+
+private:
+    Settings current;
+    double requestedRate;
+    double currentRate;
+    double lowest;                      // Lowest effective rate (rate / skip) so far
+    int skip;
+    int calmWindows;
+    int changeCount;
+    qint64 windowStartNs;
+    Load worst;                         // Of the current window
+    QString lastReason;
+};
+
+#endif // RATECONTROLLER_H
@@ -0,0 +1,120 @@
+// Include necessary headers
+#include "recordingmanifest.h"
+#include <QFile>                        // For reading and writing the sidecar
+#include <QSaveFile>                    // For atomic manifest writes
+#include <QTextStream>                  // For line based text I/O
+#include <QStringList>
+
+// Name of the manifest that belongs to a recording
+QString RecordingManifest::fileNameFor(const QString &recordingFileName)
+{
+    return recordingFileName + ".manifest";
+}
+
+// Write the manifest as simple key=value lines
+bool RecordingManifest::save(const QString &fileName, QString *errorString) const
+{
+    // QSaveFile never leaves a half written manifest behind
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+
+    QTextStream stream(&file);
+    stream << "format=" << format << "\n"
+           << "termination=" << termination << "\n"
+           << "fps=" << QString::number(framesPerSecond, 'g', 17) << "\n"
+           << "duration=" << QString::number(durationSeconds, 'g', 17) << "\n"
+           << "expectedFrames=" << expectedFrames << "\n"
+           << "rateChanges=" << rateChanges << "\n"
+           << "lowestFps=" << QString::number(lowestFramesPerSecond, 'g', 17) << "\n"
+           << "rows=" << rows << "\n"
+           << "events=" << events << "\n"
+           << "complete=" << (complete ? 1 : 0) << "\n";
+
+    // One line per block: offset,length,rows,crc
+    for (const Block &block : blocks) {
+        stream << "block=" << block.offset << "," << block.length << ","
+               << block.rows << "," << QString::number(block.crc, 16) << "\n";
+    }
+
+    stream.flush();
+    if (!file.commit()) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+// Read a manifest written by save()
+bool RecordingManifest::load(const QString &fileName, QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+
+    *this = RecordingManifest();
+    QTextStream stream(&file);
+    int lineNumber = 0;
+
+    while (!stream.atEnd()) {
+        QString line = stream.readLine().trimmed();
+        ++lineNumber;
+        if (line.isEmpty()) continue;  // Tolerate blank lines
+
+        // Split into key and value
+        int separator = line.indexOf('=');
+        if (separator < 0) {
+            if (errorString) *errorString = QString("Malformed manifest line %1").arg(lineNumber);
+            return false;
+        }
+        QString key = line.left(separator);
+        QString value = line.mid(separator + 1);
+
+        bool ok = true;
+        if (key == "format") {
+            format = value;
+        } else if (key == "termination") {
+            termination = value;
+        } else if (key == "fps") {
+            framesPerSecond = value.toDouble(&ok);
+        } else if (key == "duration") {
+            durationSeconds = value.toDouble(&ok);
+        } else if (key == "expectedFrames") {
+            expectedFrames = value.toLongLong(&ok);
+        } else if (key == "rateChanges") {
+            rateChanges = value.toInt(&ok);
+        } else if (key == "lowestFps") {
+            lowestFramesPerSecond = value.toDouble(&ok);
+        } else if (key == "rows") {
+            rows = value.toLongLong(&ok);
+        } else if (key == "events") {
+            events = value.toLongLong(&ok);
+        } else if (key == "complete") {
+            complete = value.toInt(&ok) != 0;
+        } else if (key == "block") {
+            QStringList fields = value.split(",");
+            ok = fields.size() == 4;
+            if (ok) {
+                bool ok1, ok2, ok3, ok4;
+                Block block;
+                block.offset = fields[0].toLongLong(&ok1);
+                block.length = fields[1].toLongLong(&ok2);
+                block.rows = fields[2].toLongLong(&ok3);
+                block.crc = fields[3].toUInt(&ok4, 16);
+                ok = ok1 && ok2 && ok3 && ok4;
+                blocks.append(block);
+            }
+        }
+        // Unknown keys are ignored so newer manifests stay readable
+
+        if (!ok) {
+            if (errorString) *errorString = QString("Invalid value on manifest line %1").arg(lineNumber);
+            return false;
+        }
+    }
+    return true;
+}
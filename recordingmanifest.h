@@ -0,0 +1,38 @@
+#ifndef RECORDINGMANIFEST_H
+#define RECORDINGMANIFEST_H
+
+#include <QString>
+#include <QVector>
+
+// Sidecar file written next to every recording ("<recording>.manifest").
+// It records the capture settings and a CRC-32 for each block of rows so a
+// recording can be checked for completeness and corruption after transfer.
+struct RecordingManifest
+{
+    // One checksummed run of consecutive data rows
+    struct Block {
+        qint64 offset = 0;      // Byte offset of the first row in the recording
+        qint64 length = 0;      // Number of bytes covered
+        qint64 rows = 0;        // Number of rows covered
+        quint32 crc = 0;        // CRC-32 of the covered bytes
+    };
+
+    QString format = "sensor-csv";  // Recording format identifier
+    QString termination = "ticks";  // What ended the capture: ticks, frames, time or overload
+    double framesPerSecond = 0;     // Requested capture rate (0 when every sensor frame is recorded)
+    double durationSeconds = 0;     // Requested capture length
+    qint64 expectedFrames = 0;      // Frames the capture was asked for
+    int rateChanges = 0;            // Times the rate controller changed the plan
+    double lowestFramesPerSecond = 0;   // Lowest rate the capture ran at (0 if never changed)
+    qint64 rows = 0;                // Data rows actually written
+    qint64 events = 0;              // Event markers in the "<recording>.events" file
+    bool complete = false;          // True if the recording was closed normally
+    QVector<Block> blocks;
+
+    static QString fileNameFor(const QString &recordingFileName);
+
+    bool save(const QString &fileName, QString *errorString = nullptr) const;
+    bool load(const QString &fileName, QString *errorString = nullptr);
+};
+
+#endif // RECORDINGMANIFEST_H
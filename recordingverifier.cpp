@@ -0,0 +1,419 @@
+// Include necessary headers
+#include "recordingverifier.h"
+#include "recordingmanifest.h"          // For expected frames and block checksums
+#include "crc32.h"                      // For block checksums
+#include "sensorframe.h"                // For parsing timestamps and values
+#include "eventmarkers.h"               // For checking the event markers
+#include "taskexecutor.h"               // For checking chunks in parallel
+#include <QFile>                        // For mapping the recording
+#include <QFileInfo>                    // For checking the manifest exists
+#include <QVector>
+#include <algorithm>                    // For std::count
+#include <cmath>                        // For sqrt
+#include <cstring>                      // For memchr
+#include <limits>
+#include <vector>
+
+namespace {
+
+// Splitting smaller files costs more than it saves
+const qint64 MinChunkBytes = 4 * 1024 * 1024;
+
+// A byte range of the recording handled by one worker; always starts at a row
+struct Chunk {
+    qint64 begin = 0;
+    qint64 end = 0;
+    int firstBlock = 0;                 // Manifest blocks covered, [firstBlock, lastBlock)
+    int lastBlock = 0;
+};
+
+// Everything one worker found in its chunk
+struct ChunkResult {
+    qint64 rows = 0;
+    qint64 malformedRows = 0;
+    qint64 firstMalformedRow = -1;      // Row index within the chunk
+    qint64 firstTimestamp = -1;         // Milliseconds, -1 if no valid timestamp
+    qint64 lastTimestamp = -1;
+    qint64 backwards = 0;
+    qint64 firstBackwardsRow = -1;      // Row index within the chunk
+    qint64 intervals = 0;
+    double intervalSum = 0;
+    double intervalSumSquares = 0;
+    qint64 minInterval = std::numeric_limits<qint64>::max();
+    qint64 maxInterval = std::numeric_limits<qint64>::min();
+    qint64 gaps = 0;
+    int blocksChecked = 0;
+    int blocksFailed = 0;
+    int firstFailedBlock = -1;
+};
+
+// Check every complete row in [begin, end) and accumulate into result
+void scanRows(const char *data, qint64 begin, qint64 end, int columns, double gapThresholdMs,
+              ChunkResult &result)
+{
+    qint64 position = begin;
+    while (position < end) {
+        const char *line = data + position;
+        const char *newline = static_cast<const char *>(std::memchr(line, '\n', size_t(end - position)));
+        if (!newline) break;            // A trailing partial row is reported by the caller
+
+        qint64 length = newline - line;
+        if (length > 0 && line[length - 1] == '\r') --length;
+        position = (newline - data) + 1;
+
+        // Walk the comma separated fields
+        qint64 row = result.rows++;
+        int fields = 0;
+        bool valid = true;
+        qint64 timestamp = -1;
+        qint64 fieldStart = 0;
+        for (qint64 i = 0; i <= length && valid; ++i) {
+            if (i < length && line[i] != ',') continue;
+
+            const char *field = line + fieldStart;
+            qint64 fieldLength = i - fieldStart;
+            double value;
+            if (fields == 0) {
+                valid = parseRecordingTimestamp(field, fieldLength, value);
+                timestamp = qint64(value);
+            } else {
+                valid = parseRecordingNumber(field, fieldLength, value);
+            }
+            ++fields;
+            fieldStart = i + 1;
+        }
+
+        if (!valid || fields != columns) {
+            if (result.malformedRows++ == 0) result.firstMalformedRow = row;
+            continue;
+        }
+
+        // Interval statistics against the previous valid row
+        if (result.lastTimestamp >= 0) {
+            qint64 interval = timestamp - result.lastTimestamp;
+            if (interval < 0 && result.backwards++ == 0) result.firstBackwardsRow = row;
+            result.intervals++;
+            result.intervalSum += interval;
+            result.intervalSumSquares += double(interval) * interval;
+            result.minInterval = qMin(result.minInterval, interval);
+            result.maxInterval = qMax(result.maxInterval, interval);
+            if (gapThresholdMs > 0 && interval > gapThresholdMs) result.gaps++;
+        } else {
+            result.firstTimestamp = timestamp;
+        }
+        result.lastTimestamp = timestamp;
+    }
+}
+
+// Verify one chunk, including checksums for the manifest blocks it covers
+void verifyChunk(const char *data, const Chunk &chunk, const QVector<RecordingManifest::Block> &blocks,
+                 int columns, double gapThresholdMs, ChunkResult &result)
+{
+    if (chunk.firstBlock == chunk.lastBlock) {
+        scanRows(data, chunk.begin, chunk.end, columns, gapThresholdMs, result);
+        return;
+    }
+
+    for (int index = chunk.firstBlock; index < chunk.lastBlock; ++index) {
+        const RecordingManifest::Block &block = blocks[index];
+        qint64 rowsBefore = result.rows;
+        scanRows(data, block.offset, block.offset + block.length, columns, gapThresholdMs, result);
+
+        // A block is good if both its checksum and its row count match
+        quint32 crc = crc32Update(0, data + block.offset, block.length);
+        bool good = crc == block.crc && result.rows - rowsBefore == block.rows;
+        result.blocksChecked++;
+        if (!good && result.blocksFailed++ == 0) result.firstFailedBlock = index;
+    }
+}
+
+// Split [begin, end) into roughly equal chunks that each start at a row
+QVector<Chunk> splitByBytes(const char *data, qint64 begin, qint64 end, int count)
+{
+    QVector<Chunk> chunks;
+    qint64 step = (end - begin) / count;
+    qint64 start = begin;
+
+    for (int i = 1; i < count && start < end; ++i) {
+        qint64 split = qMax(start, begin + step * i);
+        const char *newline = static_cast<const char *>(std::memchr(data + split, '\n', size_t(end - split)));
+        if (!newline) break;
+        qint64 next = (newline - data) + 1;
+
+        Chunk chunk;
+        chunk.begin = start;
+        chunk.end = next;
+        chunks.append(chunk);
+        start = next;
+    }
+
+    if (start < end) {
+        Chunk chunk;
+        chunk.begin = start;
+        chunk.end = end;
+        chunks.append(chunk);
+    }
+    return chunks;
+}
+
+// Split the manifest blocks into contiguous groups of similar size
+QVector<Chunk> splitByBlocks(const QVector<RecordingManifest::Block> &blocks, int count)
+{
+    QVector<Chunk> chunks;
+    int perChunk = (blocks.size() + count - 1) / count;
+
+    for (int first = 0; first < blocks.size(); first += perChunk) {
+        Chunk chunk;
+        chunk.firstBlock = first;
+        chunk.lastBlock = qMin(first + perChunk, int(blocks.size()));
+        chunk.begin = blocks[first].offset;
+        chunk.end = blocks[chunk.lastBlock - 1].offset + blocks[chunk.lastBlock - 1].length;
+        chunks.append(chunk);
+    }
+    return chunks;
+}
+
+} // namespace
+
+// Human readable multi-line description of the result
+QString RecordingReport::summary() const
+{
+    QStringList lines;
+    lines << QString("%1: %2").arg(fileName, ok() ? "OK" : "FAILED");
+
+    if (expectedRows >= 0) {
+        lines << QString("  Rows: %1 (expected %2)").arg(rows).arg(expectedRows);
+    } else {
+        lines << QString("  Rows: %1").arg(rows);
+    }
+    if (blocksChecked > 0) {
+        lines << QString("  Blocks: %1 checked, %2 failed").arg(blocksChecked).arg(blocksFailed);
+    }
+    if (rows > 1) {
+        lines << QString("  Interval: mean %1 ms, sd %2 ms, min %3 ms, max %4 ms, gaps %5")
+                     .arg(meanIntervalMs, 0, 'f', 2)
+                     .arg(stdDevIntervalMs, 0, 'f', 2)
+                     .arg(minIntervalMs)
+                     .arg(maxIntervalMs)
+                     .arg(gaps);
+    }
+    lines << QString("  Backwards timestamps: %1").arg(backwardsTimestamps);
+    if (events > 0) {
+        lines << QString("  Event markers: %1 (%2 pauses)").arg(events).arg(pauses);
+    }
+
+    for (const QString &error : errors) lines << "  Error: " + error;
+    for (const QString &warning : warnings) lines << "  Warning: " + warning;
+    return lines.join("\n");
+}
+
+// Check one recording
+RecordingReport RecordingVerifier::verify(const QString &fileName, const Options &options)
+{
+    RecordingReport report;
+    report.fileName = fileName;
+
+    // Map the recording instead of reading it so large files stream from disk
+    // (the mapping is released when the file is closed)
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        report.errors << "Cannot open file: " + file.errorString();
+        return report;
+    }
+    const qint64 size = file.size();
+    if (size == 0) {
+        report.errors << "File is empty";
+        return report;
+    }
+    const uchar *mapped = file.map(0, size);
+    if (!mapped) {
+        report.errors << "Cannot map file: " + file.errorString();
+        return report;
+    }
+    const char *data = reinterpret_cast<const char *>(mapped);
+
+    // Identify the format from the header line
+    const char *headerEnd = static_cast<const char *>(std::memchr(data, '\n', size_t(size)));
+    if (!headerEnd || !QByteArray(data, int(headerEnd - data)).startsWith("Timestamp,")) {
+        report.errors << "Unsupported recording format (no CSV header)";
+        return report;
+    }
+    const qint64 dataBegin = (headerEnd - data) + 1;
+    const int columns = int(std::count(data, headerEnd, ',')) + 1;
+
+    // Complete rows end at the last newline; anything after it is a truncated row
+    qint64 dataEnd = size;
+    while (dataEnd > dataBegin && data[dataEnd - 1] != '\n') --dataEnd;
+    if (dataEnd < size) {
+        report.errors << QString("Last row is truncated (%1 bytes without a newline)").arg(size - dataEnd);
+    }
+
+    // Load the manifest if there is one
+    RecordingManifest manifest;
+    bool haveManifest = false;
+    QString manifestName = RecordingManifest::fileNameFor(fileName);
+    if (QFileInfo::exists(manifestName)) {
+        QString error;
+        haveManifest = manifest.load(manifestName, &error);
+        if (!haveManifest) report.errors << "Unreadable manifest: " + error;
+    } else {
+        report.warnings << "No manifest found; block checksums not checked";
+    }
+
+    // Settings given on the command line win over the manifest
+    double fps = options.framesPerSecond > 0 ? options.framesPerSecond : manifest.framesPerSecond;
+    double duration = options.durationSeconds > 0 ? options.durationSeconds : manifest.durationSeconds;
+    bool planned = options.framesPerSecond <= 0 && options.durationSeconds <= 0 &&
+                   (manifest.rateChanges > 0 || manifest.termination == "overload");
+    if (planned) {
+        // The rate controller changed the plan; rows may be as far apart as its lowest rate
+        report.expectedRows = manifest.expectedFrames;
+        if (manifest.lowestFramesPerSecond > 0) fps = manifest.lowestFramesPerSecond;
+    } else if (fps > 0 && duration > 0) {
+        report.expectedRows = qRound64(fps * duration);
+    } else if (manifest.termination == "frames" && manifest.expectedFrames > 0) {
+        report.expectedRows = manifest.expectedFrames;     // An exact number of sensor frames
+    }
+    double gapThresholdMs = fps > 0 ? 1.5 * 1000.0 / fps : 0;
+
+    // Manifest blocks must tile the data exactly
+    QVector<RecordingManifest::Block> blocks = manifest.blocks;
+    qint64 blocksEnd = dataBegin;
+    for (int i = 0; i < blocks.size(); ++i) {
+        if (blocks[i].offset != blocksEnd || blocks[i].offset + blocks[i].length > dataEnd) {
+            report.errors << QString("Manifest block %1 does not match the file layout").arg(i);
+            blocks.resize(i);
+            break;
+        }
+        blocksEnd += blocks[i].length;
+    }
+    if (haveManifest && manifest.complete && blocksEnd < dataEnd) {
+        report.errors << QString("%1 bytes after the last checksummed block").arg(dataEnd - blocksEnd);
+    }
+
+    // Decide how many chunks the file is worth; by default the shared workers plus this thread
+    int threads = options.threads > 0 ? options.threads : TaskExecutor::shared().workerCount() + 1;
+    threads = int(qBound<qint64>(1, (dataEnd - dataBegin) / MinChunkBytes, qMax(1, threads)));
+
+    QVector<Chunk> chunks = splitByBlocks(blocks, threads);
+    if (blocksEnd < dataEnd) {
+        chunks += splitByBytes(data, blocksEnd, dataEnd, threads);
+    }
+
+    // Check all chunks in parallel
+    std::vector<ChunkResult> results(size_t(chunks.size()));
+    TaskExecutor::shared().parallelFor("verify", TaskExecutor::PriorityBestEffort, chunks.size(), [&](int i) {
+        verifyChunk(data, chunks[i], blocks, columns, gapThresholdMs, results[size_t(i)]);
+    }, options.threads);
+
+    // Merge chunk results in file order, including the intervals across chunk boundaries
+    ChunkResult total;
+    for (const ChunkResult &result : results) {
+        if (result.malformedRows > 0 && total.malformedRows == 0) {
+            total.firstMalformedRow = total.rows + result.firstMalformedRow;
+        }
+        if (result.backwards > 0 && total.backwards == 0) {
+            total.firstBackwardsRow = total.rows + result.firstBackwardsRow;
+        }
+        if (result.firstFailedBlock >= 0 && total.firstFailedBlock < 0) {
+            total.firstFailedBlock = result.firstFailedBlock;
+        }
+
+        if (total.lastTimestamp >= 0 && result.firstTimestamp >= 0) {
+            qint64 interval = result.firstTimestamp - total.lastTimestamp;
+            if (interval < 0 && total.backwards++ == 0) total.firstBackwardsRow = total.rows;
+            total.intervals++;
+            total.intervalSum += interval;
+            total.intervalSumSquares += double(interval) * interval;
+            total.minInterval = qMin(total.minInterval, interval);
+            total.maxInterval = qMax(total.maxInterval, interval);
+            if (gapThresholdMs > 0 && interval > gapThresholdMs) total.gaps++;
+        }
+        if (total.firstTimestamp < 0) total.firstTimestamp = result.firstTimestamp;
+        if (result.lastTimestamp >= 0) total.lastTimestamp = result.lastTimestamp;
+
+        total.rows += result.rows;
+        total.malformedRows += result.malformedRows;
+        total.backwards += result.backwards;
+        total.intervals += result.intervals;
+        total.intervalSum += result.intervalSum;
+        total.intervalSumSquares += result.intervalSumSquares;
+        total.minInterval = qMin(total.minInterval, result.minInterval);
+        total.maxInterval = qMax(total.maxInterval, result.maxInterval);
+        total.gaps += result.gaps;
+        total.blocksChecked += result.blocksChecked;
+        total.blocksFailed += result.blocksFailed;
+    }
+
+    // Fill in the report
+    report.rows = total.rows;
+    report.blocksChecked = total.blocksChecked;
+    report.blocksFailed = total.blocksFailed;
+    report.backwardsTimestamps = total.backwards;
+    report.gaps = total.gaps;
+    if (total.intervals > 0) {
+        report.meanIntervalMs = total.intervalSum / total.intervals;
+        double variance = total.intervalSumSquares / total.intervals - report.meanIntervalMs * report.meanIntervalMs;
+        report.stdDevIntervalMs = std::sqrt(qMax(0.0, variance));
+        report.minIntervalMs = total.minInterval;
+        report.maxIntervalMs = total.maxInterval;
+    }
+
+    // Row numbers below are 1-based file lines (the header is line 1)
+    if (total.malformedRows > 0) {
+        report.errors << QString("%1 malformed rows (first at line %2)")
+                             .arg(total.malformedRows).arg(total.firstMalformedRow + 2);
+    }
+    if (total.backwards > 0) {
+        report.errors << QString("%1 timestamps go backwards (first at line %2)")
+                             .arg(total.backwards).arg(total.firstBackwardsRow + 2);
+    }
+    if (total.blocksFailed > 0) {
+        report.errors << QString("%1 blocks failed their checksum (first is block %2)")
+                             .arg(total.blocksFailed).arg(total.firstFailedBlock);
+    }
+    if (report.expectedRows >= 0 && report.rows != report.expectedRows) {
+        report.errors << QString("Expected %1 rows but found %2").arg(report.expectedRows).arg(report.rows);
+    }
+    if (haveManifest) {
+        if (manifest.rows != report.rows) {
+            report.errors << QString("Manifest lists %1 rows but found %2").arg(manifest.rows).arg(report.rows);
+        }
+        if (!manifest.complete) {
+            report.warnings << "Recording was not closed normally";
+        }
+    }
+    // Markers must point into the recording and follow each other in time
+    QString eventsName = EventMarkers::fileNameFor(fileName);
+    if ((haveManifest && manifest.events > 0) || QFileInfo::exists(eventsName)) {
+        QVector<EventMarker> markers;
+        QString markerError;
+        if (!EventMarkers::load(eventsName, markers, &markerError)) {
+            report.errors << "Unreadable event markers: " + markerError;
+        } else {
+            report.events = markers.size();
+            if (haveManifest && manifest.events != markers.size()) {
+                report.errors << QString("Manifest lists %1 event markers but found %2")
+                                     .arg(manifest.events).arg(markers.size());
+            }
+            for (int index = 0; index < markers.size(); ++index) {
+                if (markers[index].label == EventMarkers::PauseLabel) report.pauses++;
+                if (markers[index].row > report.rows) {
+                    report.errors << QString("Event marker %1 points past the last row").arg(index + 1);
+                    break;
+                }
+                if (index > 0 && markers[index].timestampNs < markers[index - 1].timestampNs) {
+                    report.errors << QString("Event marker %1 is earlier than the one before").arg(index + 1);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Each pause leaves one long interval behind that is expected
+    if (report.gaps > report.pauses) {
+        report.warnings << QString("%1 intervals longer than 1.5x the frame interval")
+                               .arg(report.gaps - report.pauses);
+    }
+    return report;
+}
@@ -0,0 +1,47 @@
+#ifndef RECORDINGVERIFIER_H
+#define RECORDINGVERIFIER_H
+
+#include <QString>
+#include <QStringList>
+
+// Result of checking one recording
+struct RecordingReport
+{
+    QString fileName;
+    QStringList errors;                 // Problems that make the recording unusable
+    QStringList warnings;               // Things worth a second look
+
+    qint64 rows = 0;                    // Complete data rows found
+    qint64 expectedRows = -1;           // Rows the capture asked for (-1 if unknown)
+    int blocksChecked = 0;              // Manifest blocks whose checksum was verified
+    int blocksFailed = 0;               // Manifest blocks with a bad checksum or row count
+    qint64 backwardsTimestamps = 0;     // Rows whose timestamp is earlier than the previous row
+    int events = 0;                     // Event markers found next to the recording
+    int pauses = 0;                     // Times the capture was paused (from the markers)
+
+    // Interval statistics between consecutive rows in milliseconds
+    double meanIntervalMs = 0;
+    double stdDevIntervalMs = 0;
+    qint64 minIntervalMs = 0;
+    qint64 maxIntervalMs = 0;
+    qint64 gaps = 0;                    // Intervals longer than 1.5x the expected interval (pauses included)
+
+    bool ok() const { return errors.isEmpty(); }
+    QString summary() const;
+};
+
+// Streams through recordings and checks that they are complete and consistent
+class RecordingVerifier
+{
+public:
+    struct Options {
+        int threads = 0;                // Threads checking chunks at once, this one included (0 = one per core)
+        double framesPerSecond = 0;     // Overrides the manifest when > 0
+        double durationSeconds = 0;     // Overrides the manifest when > 0
+    };
+
+    static RecordingReport verify(const QString &fileName, const Options &options);
+    static RecordingReport verify(const QString &fileName) { return verify(fileName, Options()); }
+};
+
+#endif // RECORDINGVERIFIER_H
@@ -0,0 +1,144 @@
+// Include necessary headers
+#include "recordingwriter.h"
+#include "crc32.h"                      // For block checksums
+#include <QDebug>                       // For debug output
+
+// RecordingWriter constructor
+RecordingWriter::RecordingWriter()
+    : bytesWritten(0)
+    , derivedCount(0)
+{
+}
+
+// RecordingWriter destructor
+RecordingWriter::~RecordingWriter()
+{
+    close();                            // Make sure the manifest gets written
+}
+
+// Create the recording and write the CSV header
+bool RecordingWriter::open(const QString &fileName, double framesPerSecond, double durationSeconds,
+                           const QStringList &derivedColumns, QString *errorString)
+{
+    close();
+
+    // Binary mode so the checksummed bytes are exactly the bytes on disk
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+
+    // Markers of an earlier recording under the same name do not belong to this one
+    QFile::remove(EventMarkers::fileNameFor(fileName));
+
+    // Start a fresh manifest for this capture
+    manifest = RecordingManifest();
+    manifest.framesPerSecond = framesPerSecond;
+    manifest.durationSeconds = durationSeconds;
+    manifest.expectedFrames = qRound64(framesPerSecond * durationSeconds);
+
+    row.reserve(256);                   // Keep capacity across rows
+    row = CsvHeader;
+    for (const QString &column : derivedColumns) {
+        row += ',';
+        row += column.toUtf8();
+    }
+    row += '\n';
+    derivedCount = qMin(int(derivedColumns.size()), MaxDerivedChannels);
+    bytesWritten = file.write(row);
+    file.flush();
+
+    currentBlock = RecordingManifest::Block();
+    currentBlock.offset = bytesWritten;
+    return true;
+}
+
+// Append one frame to the recording
+void RecordingWriter::writeFrame(const QDateTime &timestamp, const SensorFrame &frame)
+{
+    if (!file.isOpen()) return;
+
+    row.resize(0);
+    appendCsvRow(row, timestamp, frame, derivedCount);
+    writeRow();
+}
+
+// Record in the manifest how the capture ends
+void RecordingWriter::setTermination(const QString &termination, qint64 expectedFrames)
+{
+    manifest.termination = termination;
+    manifest.expectedFrames = expectedFrames;
+}
+
+// Record in the manifest how the rate controller changed the capture
+void RecordingWriter::setRateChanges(int changes, double lowestFramesPerSecond, qint64 expectedFrames)
+{
+    manifest.rateChanges = changes;
+    manifest.lowestFramesPerSecond = lowestFramesPerSecond;
+    manifest.expectedFrames = expectedFrames;
+}
+
+// Write the formatted row and fold it into the current block checksum
+void RecordingWriter::writeRow()
+{
+    file.write(row);
+    file.flush();                       // Ensure data is written to file
+
+    currentBlock.crc = crc32Update(currentBlock.crc, row.constData(), row.size());
+    currentBlock.length += row.size();
+    currentBlock.rows++;
+    bytesWritten += row.size();
+    manifest.rows++;
+
+    if (currentBlock.rows >= RowsPerBlock) {
+        finishBlock();
+    }
+}
+
+// Append a marker to the event file next to the recording
+void RecordingWriter::writeEvent(const EventMarker &marker)
+{
+    if (!file.isOpen()) return;
+
+    // Most recordings have no markers, so the file is only created when needed
+    if (!eventsFile.isOpen()) {
+        eventsFile.setFileName(EventMarkers::fileNameFor(file.fileName()));
+        if (!eventsFile.open(QIODevice::WriteOnly)) {
+            qWarning() << "Failed to create event marker file:" << eventsFile.errorString();
+            return;
+        }
+        eventsFile.write(EventMarkers::Header);
+    }
+
+    QByteArray line;
+    EventMarkers::appendLine(line, marker);
+    eventsFile.write(line);
+    manifest.events++;
+}
+
+// Move the current block into the manifest and start the next one
+void RecordingWriter::finishBlock()
+{
+    if (currentBlock.rows > 0) {
+        manifest.blocks.append(currentBlock);
+    }
+    currentBlock = RecordingManifest::Block();
+    currentBlock.offset = bytesWritten;
+}
+
+// Close the recording and write its manifest
+void RecordingWriter::close()
+{
+    if (!file.isOpen()) return;
+
+    finishBlock();
+    file.close();
+    eventsFile.close();
+
+    manifest.complete = true;
+    QString error;
+    if (!manifest.save(RecordingManifest::fileNameFor(file.fileName()), &error)) {
+        qWarning() << "Failed to write recording manifest:" << error;
+    }
+}
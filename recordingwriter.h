@@ -0,0 +1,58 @@
+#ifndef RECORDINGWRITER_H
+#define RECORDINGWRITER_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QDateTime>
+#include <QStringList>
+#include "sensorframe.h"
+#include "recordingmanifest.h"
+#include "eventmarkers.h"
+
+// Writes a CSV recording together with its checksum manifest and event markers
+class RecordingWriter
+{
+public:
+    static const int RowsPerBlock = 1024;   // Rows covered by one manifest checksum
+
+    RecordingWriter();
+    ~RecordingWriter();
+
+    // derivedColumns names the derived channels recorded after the fixed columns
+    bool open(const QString &fileName, double framesPerSecond, double durationSeconds,
+              const QStringList &derivedColumns = QStringList(), QString *errorString = nullptr);
+    void writeFrame(const QDateTime &timestamp, const SensorFrame &frame);
+
+    // For captures that record sensor frames rather than ticks: what ends the
+    // capture ("frames" or "time") and how many rows it must have (0 if unknown)
+    void setTermination(const QString &termination, qint64 expectedFrames);
+
+    // For captures whose rate the overload controller changed: how often, the
+    // lowest rate and the rows the final plan called for
+    void setRateChanges(int changes, double lowestFramesPerSecond, qint64 expectedFrames);
+    void close();
+
+    // Add a marker before the next row; it is buffered, not flushed, so that
+    // marking never waits for the disk (it reaches the file on close)
+    void writeEvent(const EventMarker &marker);
+
+    bool isOpen() const { return file.isOpen(); }
+    qint64 rowsWritten() const { return manifest.rows; }
+    QString fileName() const { return file.fileName(); }
+
+private:
+    void writeRow();
+    void finishBlock();
+
+    QFile file;
+    QFile eventsFile;                   // Opened with the first marker
+    QByteArray row;                     // Reused buffer for the row being written
+    qint64 bytesWritten;                // Current end of file
+    int derivedCount;                   // Derived channels recorded per row
+    RecordingManifest manifest;
+    RecordingManifest::Block currentBlock;
+
+    Q_DISABLE_COPY(RecordingWriter)
+};
+
+#endif // RECORDINGWRITER_H
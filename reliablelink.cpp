@@ -0,0 +1,256 @@
+// Include necessary headers
+#include "reliablelink.h"
+#include "crc32.h"                      // For the reading checksums
+#include <cstdlib>                      // For strtoul
+#include <cstring>                      // For memchr
+
+// Checksum field: '*' and 8 hex digits
+static const int ChecksumLength = 9;
+
+// ReliableLink constructor
+ReliableLink::ReliableLink()
+    : window(WindowSize)
+{
+    reset();
+}
+
+// A reliable line ends in "*xxxxxxxx"
+bool ReliableLink::isReliableLine(const char *line, qint64 length)
+{
+    return length > ChecksumLength && line[length - ChecksumLength] == '*';
+}
+
+// Verify the checksum and split the line
+bool ReliableLink::checkLine(const char *line, qint64 length, quint32 &sequence,
+                             const char *&reading, qint64 &readingLength)
+{
+    if (!isReliableLine(line, length)) return false;
+
+    // The checksum covers everything before the '*'
+    qint64 payload = length - ChecksumLength;
+    char digits[ChecksumLength];
+    std::memcpy(digits, line + payload + 1, ChecksumLength - 1);
+    digits[ChecksumLength - 1] = '\0';
+    char *end;
+    unsigned long crc = std::strtoul(digits, &end, 16);
+    if (end != digits + ChecksumLength - 1 || quint32(crc) != crc32Update(0, line, payload)) return false;
+
+    // Sequence number first, then the reading as the board sends it without reliable mode
+    const char *comma = static_cast<const char *>(std::memchr(line, ',', size_t(payload)));
+    if (!comma || comma == line) return false;
+    sequence = quint32(std::strtoul(line, &end, 10));
+    if (end != comma) return false;
+
+    reading = comma + 1;
+    readingLength = line + payload - reading;
+    return true;
+}
+
+// Number and checksum a reading
+QByteArray ReliableLink::formatLine(quint32 sequence, const QByteArray &reading)
+{
+    QByteArray line = QByteArray::number(sequence) + "," + reading;
+    quint32 crc = crc32Update(0, line.constData(), line.size());
+    return line + "*" + QByteArray::number(crc, 16).rightJustified(8, '0');
+}
+
+// Take a verified frame
+void ReliableLink::accept(quint32 sequence, const SensorFrame &frame, qint64 timestampNs, qint64 nowNs)
+{
+    // Signed distances so that the 32 bit sequence number may wrap around.
+    // Further back than the window, the board started numbering again (after a
+    // reboot, say) and this reading is where the new sequence begins.
+    if (haveSequence && qint32(sequence - nextSequence) < -WindowSize) {
+        restart();
+        restarts++;
+    }
+
+    if (!haveSequence) {
+        haveSequence = true;
+        nextSequence = sequence;
+        highestSequence = sequence - 1;     // So that it is new, not recovered
+    }
+
+    if (qint32(sequence - nextSequence) < 0) {
+        duplicates++;                   // Delivered (or given up on) already
+        return;
+    }
+
+    // Too far ahead to hold the frames before it: give up on the oldest
+    if (qint32(sequence - nextSequence) >= WindowSize) skipTo(sequence - quint32(WindowSize - 1));
+
+    Slot &slot = window[int(sequence % WindowSize)];
+    if (slot.valid) {
+        duplicates++;
+        return;
+    }
+
+    slot.valid = true;
+    slot.frame = frame;
+    slot.timestampNs = timestampNs;
+
+    if (qint32(sequence - highestSequence) > 0) {
+        // Readings skipped since the highest one are a new gap; ask for them at once
+        quint32 first = highestSequence + 1;
+        if (qint32(first - nextSequence) < 0) first = nextSequence;
+        if (sequence != first) {
+            Gap gap;
+            gap.first = first;
+            gap.count = sequence - first;
+            gap.detectedNs = nowNs;
+            gap.stampNs = timestampNs;
+            request(gap, nowNs);
+            gaps.append(gap);
+        }
+        highestSequence = sequence;
+    } else {
+        // A reading asked for again: stamp it like the frame that revealed its gap
+        for (const Gap &gap : gaps) {
+            if (sequence - gap.first < gap.count) {
+                slot.timestampNs = gap.stampNs;
+                break;
+            }
+        }
+        recovered++;
+    }
+
+    deliverInOrder();
+}
+
+// Retry and give up on gaps
+void ReliableLink::service(qint64 nowNs)
+{
+    // The oldest gaps expire first; giving up on one delivers everything before it
+    while (!gaps.isEmpty() && nowNs - gaps.first().detectedNs >= qint64(MaxDelayMs) * 1000000) {
+        quint32 end = gaps.first().first + gaps.first().count;
+        while (qint32(end - nextSequence) > 0) giveUpHead();
+        deliverInOrder();
+    }
+
+    for (Gap &gap : gaps) {
+        if (nowNs - gap.requestedNs >= qint64(RetryMs) * 1000000) request(gap, nowNs);
+    }
+}
+
+qint64 ReliableLink::nextDeadlineNs() const
+{
+    qint64 earliest = -1;
+    for (const Gap &gap : gaps) {
+        qint64 deadline = qMin(gap.requestedNs + qint64(RetryMs) * 1000000,
+                               gap.detectedNs + qint64(MaxDelayMs) * 1000000);
+        if (earliest < 0 || deadline < earliest) earliest = deadline;
+    }
+    return earliest;
+}
+
+bool ReliableLink::takeDelivery(Delivery &delivery)
+{
+    if (deliveries.isEmpty()) return false;
+    delivery = deliveries.takeFirst();
+    return true;
+}
+
+bool ReliableLink::takeResendRequest(quint32 &first, quint32 &count)
+{
+    if (requests.isEmpty()) return false;
+    first = requests[0];
+    count = requests[1];
+    requests.remove(0, 2);
+    return true;
+}
+
+QString ReliableLink::statistics() const
+{
+    return QString("reliable link: %1 recovered, %2 lost, %3 corrupt, %4 duplicate, %5 resend requests, %6 restarts")
+        .arg(recovered).arg(lost).arg(corrupt).arg(duplicates).arg(resendRequests).arg(restarts);
+}
+
+// Deliver everything held and forget the sequence
+void ReliableLink::restart()
+{
+    if (!haveSequence) return;
+    while (qint32(highestSequence - nextSequence) >= 0) giveUpHead();
+    gaps.clear();
+    haveSequence = false;
+}
+
+void ReliableLink::reset()
+{
+    for (Slot &slot : window) slot.valid = false;
+    gaps.clear();
+    deliveries.clear();
+    requests.clear();
+    haveSequence = false;
+    nextSequence = 0;
+    highestSequence = 0;
+    lastDeliveredNs = 0;
+    recovered = lost = corrupt = duplicates = resendRequests = restarts = 0;
+}
+
+// Queue the frames at the head of the window that are complete
+void ReliableLink::deliverInOrder()
+{
+    for (;;) {
+        Slot &head = window[int(nextSequence % WindowSize)];
+        if (!head.valid) break;
+        deliver(head);
+        nextSequence++;
+    }
+
+    // Gaps that were filled or passed need no more requests
+    while (!gaps.isEmpty() && qint32(gaps.first().first + gaps.first().count - nextSequence) <= 0) {
+        gaps.removeFirst();
+    }
+}
+
+// Ask for the readings of a gap that are still missing, one request per run
+void ReliableLink::request(Gap &gap, qint64 nowNs)
+{
+    gap.requestedNs = nowNs;
+    quint32 end = gap.first + gap.count;
+    quint32 sequence = qint32(gap.first - nextSequence) < 0 ? nextSequence : gap.first;
+    while (qint32(end - sequence) > 0) {
+        if (window[int(sequence % WindowSize)].valid) {
+            sequence++;
+            continue;
+        }
+        quint32 first = sequence;
+        while (qint32(end - sequence) > 0 && !window[int(sequence % WindowSize)].valid) sequence++;
+        requests << first << sequence - first;
+        resendRequests++;
+    }
+}
+
+// Move past the oldest reading, delivering it if it is there
+void ReliableLink::giveUpHead()
+{
+    Slot &head = window[int(nextSequence % WindowSize)];
+    if (head.valid) deliver(head);
+    else lost++;
+    nextSequence++;
+    if (qint32(nextSequence - 1 - highestSequence) > 0) highestSequence = nextSequence - 1;
+}
+
+// Give up on everything before sequence. Once a whole window was passed nothing
+// is held any more, so the rest of a long dropout is counted as lost in one step.
+void ReliableLink::skipTo(quint32 sequence)
+{
+    quint32 steps = sequence - nextSequence;
+    quint32 scanned = qMin(steps, quint32(WindowSize));
+    for (quint32 step = 0; step < scanned; ++step) giveUpHead();
+    lost += steps - scanned;
+    nextSequence = sequence;
+    if (qint32(nextSequence - 1 - highestSequence) > 0) highestSequence = nextSequence - 1;
+}
+
+// Queue a held frame, keeping timestamps monotonic
+void ReliableLink::deliver(Slot &slot)
+{
+    slot.valid = false;
+
+    Delivery delivery;
+    delivery.frame = slot.frame;
+    delivery.timestampNs = qMax(slot.timestampNs, lastDeliveredNs);
+    lastDeliveredNs = delivery.timestampNs;
+    deliveries.append(delivery);
+}
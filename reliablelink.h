@@ -0,0 +1,118 @@
+#ifndef RELIABLELINK_H
+#define RELIABLELINK_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include "sensorframe.h"
+
+// Reliable mode of the sensor link, for Bluetooth links that drop or corrupt
+// bytes. The board numbers every reading and appends a checksum:
+//
+//   "<sequence>,<botLeft>,<topLeft>,<topRight>*<crc>"
+//
+// where crc is the CRC-32 of everything before the '*' as 8 hex digits. The
+// board keeps its recent readings, and the host asks for missing ones with the
+// one-way line "!RESEND <first> <count>"; the readings themselves are the
+// answer. A reading that fails its checksum is dropped like a lost one and
+// asked for again.
+//
+// Frames are delivered in sequence order. Frames behind a gap are held while
+// the gap is asked for again every RetryMs, for at most MaxDelayMs, after which
+// the missing readings are counted as lost. A recovered frame is stamped with
+// the arrival time of the frame that revealed the gap, so timestamps stay
+// monotonic. A reading more than WindowSize ahead gives up on the gaps before
+// it at once, and every reading skipped is counted as lost however long the
+// dropout. A sequence number more than WindowSize behind the expected one is
+// taken as the board restarting its counter: what is held is delivered and the
+// sequence starts over. Time comes from the caller;
+// deliveries and resend requests are queued and collected with takeDelivery()
+// and takeResendRequest().
+class ReliableLink
+{
+public:
+    static const int WindowSize = 512;  // Frames that can be held behind a gap
+    static const int RetryMs = 25;
+    static const int MaxDelayMs = 150;
+
+    struct Delivery {
+        SensorFrame frame;
+        qint64 timestampNs = 0;
+    };
+
+    ReliableLink();
+
+    // Whether a line is in the reliable format (has a checksum)
+    static bool isReliableLine(const char *line, qint64 length);
+
+    // Check a reliable line's checksum and split off the sequence number;
+    // reading/readingLength then cover the "botLeft,topLeft,topRight" part
+    static bool checkLine(const char *line, qint64 length, quint32 &sequence,
+                          const char *&reading, qint64 &readingLength);
+
+    // Format a reading the way the board sends it in reliable mode (without the line end)
+    static QByteArray formatLine(quint32 sequence, const QByteArray &reading);
+
+    // Take a frame whose checksum was correct
+    void accept(quint32 sequence, const SensorFrame &frame, qint64 timestampNs, qint64 nowNs);
+
+    // Count a line that failed its checksum (the gap it leaves is asked for again)
+    void countCorrupt() { corrupt++; }
+
+    // Ask again for gaps that are due and give up on the ones waited for too long
+    void service(qint64 nowNs);
+
+    // When service() should run next, -1 if nothing is waited for
+    qint64 nextDeadlineNs() const;
+
+    bool takeDelivery(Delivery &delivery);
+    bool takeResendRequest(quint32 &first, quint32 &count);
+
+    // The board left reliable mode: give up on the gaps, deliver what is held and
+    // start over with the next sequence number (the counters are kept)
+    void restart();
+
+    bool isActive() const { return haveSequence; }
+    QString statistics() const;
+    void reset();
+
+private:
+    struct Slot {
+        bool valid = false;
+        qint64 timestampNs = 0;
+        SensorFrame frame;
+    };
+
+    // Missing readings [first, first + count) and how they were asked for
+    struct Gap {
+        quint32 first = 0;
+        quint32 count = 0;
+        qint64 detectedNs = 0;
+        qint64 requestedNs = 0;
+        qint64 stampNs = 0;             // Arrival of the frame after the gap
+    };
+
+    void deliverInOrder();
+    void request(Gap &gap, qint64 nowNs);
+    void giveUpHead();
+    void skipTo(quint32 sequence);
+    void deliver(Slot &slot);
+
+    QVector<Slot> window;               // Ring indexed by sequence number
+    QVector<Gap> gaps;                  // Oldest first
+    QVector<Delivery> deliveries;
+    QVector<quint32> requests;          // Pairs of first, count
+    bool haveSequence;
+    quint32 nextSequence;               // Next sequence number to deliver
+    quint32 highestSequence;
+    qint64 lastDeliveredNs;
+
+    quint64 recovered;                  // Delivered after being asked for again
+    quint64 lost;
+    quint64 corrupt;
+    quint64 duplicates;
+    quint64 resendRequests;
+    quint64 restarts;                   // Sequence numbers went back further than the window
+};
+
+#endif // RELIABLELINK_H
@@ -0,0 +1,155 @@
+// Include necessary headers
+#include "reorderbuffer.h"
+
+// ReorderBuffer constructor
+ReorderBuffer::ReorderBuffer(int windowSize, int timeoutMs)
+    : window(qMax(1, windowSize))
+    , timeoutNs(qint64(timeoutMs) * 1000000)
+{
+    reset();
+}
+
+// Hold a numbered frame until every frame before it was delivered or given up on
+void ReorderBuffer::accept(quint32 sequence, const SensorFrame &frame, qint64 timestampNs, qint64 nowNs)
+{
+    const int size = window.size();
+    if (!haveSequence) {
+        haveSequence = true;
+        nextSequence = sequence;
+        highestSequence = sequence;
+    }
+
+    // Signed distance so that the 32 bit sequence number may wrap around
+    qint32 ahead = qint32(sequence - nextSequence);
+    if (ahead < 0) {
+        if (ahead >= -size) {
+            late++;
+            return;
+        }
+
+        // Further back than anything that could still be on its way: the bridge
+        // started numbering again, so deliver what is held and continue from here
+        while (buffered > 0) releaseHead();
+        restarts++;
+        nextSequence = sequence;
+        highestSequence = sequence;
+    }
+    bool overtaken = qint32(sequence - highestSequence) < 0;
+    if (qint32(sequence - highestSequence) > 0) highestSequence = sequence;
+
+    // Too far ahead to wait for the gap any longer: give up on the oldest missing frames
+    if (qint32(sequence - nextSequence) >= size) skipTo(sequence - quint32(size - 1));
+
+    Slot &slot = window[int(sequence % quint32(size))];
+    if (slot.valid) {
+        duplicates++;
+        return;
+    }
+    if (overtaken) reordered++;
+    slot.valid = true;
+    slot.timestampNs = timestampNs;
+    slot.frame = frame;
+    buffered++;
+
+    deliverInOrder(nowNs);
+}
+
+// The timeout expired: count the missing frames at the head as lost
+void ReorderBuffer::service(qint64 nowNs)
+{
+    if (waitingSinceNs < 0 || nowNs - waitingSinceNs < timeoutNs) return;
+
+    const int size = window.size();
+    while (buffered > 0 && !window[int(nextSequence % quint32(size))].valid) {
+        lost++;
+        nextSequence++;
+    }
+    waitingSinceNs = -1;
+    deliverInOrder(nowNs);
+}
+
+qint64 ReorderBuffer::nextDeadlineNs() const
+{
+    return waitingSinceNs < 0 ? -1 : waitingSinceNs + timeoutNs;
+}
+
+bool ReorderBuffer::takeDelivery(Delivery &delivery)
+{
+    if (taken >= deliveries.size()) {
+        deliveries.resize(0);           // Keeps the capacity for the next frames
+        taken = 0;
+        return false;
+    }
+    delivery = deliveries[taken++];
+    return true;
+}
+
+QString ReorderBuffer::statistics() const
+{
+    return QString("%1 lost, %2 reordered, %3 late, %4 duplicate, %5 restarts")
+        .arg(lost).arg(reordered).arg(late).arg(duplicates).arg(restarts);
+}
+
+void ReorderBuffer::reset()
+{
+    for (Slot &slot : window) slot.valid = false;
+    buffered = 0;
+    deliveries.resize(0);
+    taken = 0;
+    haveSequence = false;
+    nextSequence = 0;
+    highestSequence = 0;
+    lastDeliveredNs = 0;
+    waitingSinceNs = -1;
+    lost = reordered = late = duplicates = restarts = 0;
+}
+
+// Queue the frames at the head of the window that are complete
+void ReorderBuffer::deliverInOrder(qint64 nowNs)
+{
+    const int size = window.size();
+    for (;;) {
+        Slot &head = window[int(nextSequence % quint32(size))];
+        if (!head.valid) break;
+        deliver(head);
+        nextSequence++;
+    }
+
+    // Frames are waiting behind a gap: do not wait for it forever
+    if (buffered == 0) waitingSinceNs = -1;
+    else if (waitingSinceNs < 0) waitingSinceNs = nowNs;
+}
+
+// Deliver the frame at the head of the window, or count it as lost if it is missing
+void ReorderBuffer::releaseHead()
+{
+    Slot &head = window[int(nextSequence % quint32(window.size()))];
+    if (head.valid) deliver(head);
+    else lost++;
+    nextSequence++;
+}
+
+// Move the head up to sequence. Once a whole window was passed nothing is held
+// any more, so the rest of a long outage is counted as lost in one step.
+void ReorderBuffer::skipTo(quint32 sequence)
+{
+    quint32 steps = sequence - nextSequence;
+    quint32 scanned = qMin(steps, quint32(window.size()));
+    for (quint32 step = 0; step < scanned; ++step) releaseHead();
+    lost += steps - scanned;
+    nextSequence = sequence;
+    if (buffered == 0) waitingSinceNs = -1;
+}
+
+// Queue a held frame, keeping timestamps monotonic
+void ReorderBuffer::deliver(Slot &slot)
+{
+    slot.valid = false;
+    buffered--;
+
+    Delivery delivery;
+    delivery.frame = slot.frame;
+    delivery.timestampNs = qMax(slot.timestampNs, lastDeliveredNs);
+    lastDeliveredNs = delivery.timestampNs;
+    deliveries.append(delivery);
+}
@@ -0,0 +1,82 @@
+#ifndef REORDERBUFFER_H
+#define REORDERBUFFER_H
+
+#include <QString>
+#include <QVector>
+#include "sensorframe.h"
+
+// Puts sequence-numbered frames back in order and accounts for the ones that
+// went missing, for bridges that send over UDP.
+//
+// Frames are delivered in sequence order. A frame behind a gap is held until
+// the gap is filled, until a frame arrives too far ahead to hold it any longer,
+// or until a gap has been waited for timeoutMs; the missing frames are then
+// counted as lost. A jump further ahead than the window delivers what is held
+// and counts every skipped number as lost at once. A frame behind the ones
+// already delivered is late and dropped, unless it is further behind than the
+// window: then the bridge restarted its counter (after a reboot, say), what is
+// held is delivered and the sequence starts over from it. Timestamps stay
+// monotonic. Time comes from the caller; deliveries are queued and collected
+// with takeDelivery().
+class ReorderBuffer
+{
+public:
+    struct Delivery {
+        SensorFrame frame;
+        qint64 timestampNs = 0;
+    };
+
+    // A window of 1 delivers every frame at once (for ordered transports)
+    ReorderBuffer(int windowSize, int timeoutMs);
+
+    void accept(quint32 sequence, const SensorFrame &frame, qint64 timestampNs, qint64 nowNs);
+
+    // Give up on a gap that was waited for too long
+    void service(qint64 nowNs);
+
+    // When service() should run next, -1 if nothing is waited for
+    qint64 nextDeadlineNs() const;
+
+    bool takeDelivery(Delivery &delivery);
+
+    bool isActive() const { return haveSequence; }
+    QString statistics() const;
+    void reset();
+
+    quint64 lostFrames() const { return lost; }
+    quint64 reorderedFrames() const { return reordered; }
+    quint64 lateFrames() const { return late; }
+    quint64 duplicateFrames() const { return duplicates; }
+    quint64 restartCount() const { return restarts; }
+
+private:
+    struct Slot {
+        bool valid = false;
+        qint64 timestampNs = 0;
+        SensorFrame frame;
+    };
+
+    void deliverInOrder(qint64 nowNs);
+    void releaseHead();
+    void skipTo(quint32 sequence);
+    void deliver(Slot &slot);
+
+    QVector<Slot> window;               // Ring indexed by sequence number
+    qint64 timeoutNs;
+    int buffered;                       // Valid entries in the window
+    QVector<Delivery> deliveries;       // Queued, taken from index taken on
+    int taken;
+    bool haveSequence;
+    quint32 nextSequence;               // Next sequence number to deliver
+    quint32 highestSequence;            // Highest sequence number seen
+    qint64 lastDeliveredNs;
+    qint64 waitingSinceNs;              // Since frames are held behind a gap, -1 if none are
+
+    quint64 lost;                       // Skipped, or given up on after waiting
+    quint64 reordered;                  // Arrived after a later frame but still delivered in order
+    quint64 late;                       // Older than the frames already delivered, dropped
+    quint64 duplicates;                 // Same sequence number received twice while waiting
+    quint64 restarts;                   // Sequence numbers went back further than the window
+};
+
+#endif // REORDERBUFFER_H
@@ -0,0 +1,108 @@
+// Include necessary headers
+#include "replayframesource.h"
+#include <QFileInfo>                    // For the description
+#include <cstdio>                       // For snprintf
+
+// Rows delivered per timer tick at most, so the event loop stays responsive
+static const int MaxRowsPerTick = 2000;
+
+// Columns of the recording holding the raw readings (see CsvHeader)
+static const int RawTopLeftColumn = 4;
+static const int RawTopRightColumn = 5;
+static const int RawBotLeftColumn = 6;
+
+// ReplayFrameSource constructor
+ReplayFrameSource::ReplayFrameSource(const QString &fileName, double speed, QObject *parent)
+    : FrameSource(parent)
+    , file(fileName)
+    , timer(new QTimer(this))
+    , speed(speed)
+    , haveRow(false)
+    , rowMs(0)
+    , lineLength(0)
+    , firstRowMs(0)
+    , startNs(0)
+{
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, &QTimer::timeout, this, &ReplayFrameSource::poll);
+}
+
+QString ReplayFrameSource::description() const
+{
+    return QString("Replay %1").arg(QFileInfo(file.fileName()).fileName());
+}
+
+// Open the recording and check its header
+bool ReplayFrameSource::open(QString *errorString)
+{
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    if (!file.readLine().startsWith("Timestamp,")) {
+        if (errorString) *errorString = "Not a sensor recording (no CSV header)";
+        file.close();
+        return false;
+    }
+
+    haveRow = readRow();
+    if (!haveRow) {
+        if (errorString) *errorString = "Recording contains no readable rows";
+        file.close();
+        return false;
+    }
+
+    firstRowMs = rowMs;
+    startNs = now();
+    resetLineBuffer();
+    timer->start(speed > 0 ? 1 : 0);
+    return true;
+}
+
+void ReplayFrameSource::close()
+{
+    timer->stop();
+    file.close();
+    haveRow = false;
+}
+
+// Read the next row and rebuild the line the sensor originally sent
+bool ReplayFrameSource::readRow()
+{
+    while (!file.atEnd()) {
+        QByteArray row = file.readLine().trimmed();
+        QList<QByteArray> fields = row.split(',');
+        if (fields.size() <= RawBotLeftColumn) continue;
+        if (!parseRecordingTimestamp(fields[0].constData(), fields[0].size(), rowMs)) continue;
+
+        // The sensor sends bottom left first
+        lineLength = std::snprintf(line, sizeof(line), "%s,%s,%s",
+                                   fields[RawBotLeftColumn].constData(),
+                                   fields[RawTopLeftColumn].constData(),
+                                   fields[RawTopRightColumn].constData());
+        if (lineLength <= 0 || lineLength >= int(sizeof(line))) continue;
+        return true;
+    }
+    return false;
+}
+
+// Deliver every row whose time has come
+void ReplayFrameSource::poll()
+{
+    qint64 current = now();
+    for (int delivered = 0; haveRow && delivered < MaxRowsPerTick; ++delivered) {
+        // Rows keep the spacing they were recorded with, scaled by the replay speed
+        double offsetNs = (rowMs - firstRowMs) * 1e6;
+        qint64 dueNs = startNs + qint64(speed > 0 ? offsetNs / speed : offsetNs);
+        if (speed > 0 && dueNs > current) return;
+
+        // Flat out, frames still carry their recorded spacing so the filters see real time steps
+        receiveLine(line, lineLength, speed > 0 ? dueNs : startNs + qint64(offsetNs));
+        haveRow = readRow();
+    }
+
+    if (!haveRow) {
+        close();
+        emit stopped("Replay finished");
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef REPLAYFRAMESOURCE_H
+#define REPLAYFRAMESOURCE_H
+
+#include "framesource.h"
+#include <QFile>
+#include <QTimer>
+
+// Plays back the raw readings of a sensor_data_*.csv recording
+class ReplayFrameSource : public FrameSource
+{
+    Q_OBJECT
+
+public:
+    // speed 1 replays in real time, 2 twice as fast, 0 as fast as the pipeline can go
+    ReplayFrameSource(const QString &fileName, double speed, QObject *parent = nullptr);
+
+    bool open(QString *errorString = nullptr) override;
+    void close() override;
+    bool isOpen() const override { return file.isOpen(); }
+    QString description() const override;
+    void poll() override;
+
+private:
+    bool readRow();
+
+    QFile file;
+    QTimer *timer;
+    double speed;
+
+    // Row read ahead of its delivery time
+    bool haveRow;
+    double rowMs;                       // Recording timestamp of the row
+    char line[64];                      // The row's raw values in the sensor's wire format
+    int lineLength;
+
+    double firstRowMs;                  // Recording timestamp of the first row
+    qint64 startNs;                     // Time base when the first row was delivered
+};
+
+#endif // REPLAYFRAMESOURCE_H
@@ -0,0 +1,114 @@
+// Include necessary headers
+#include "sensorcommands.h"
+
+// Ids wrap around well before they could be confused with a request still outstanding
+static const int MaxId = 9999;
+
+// SensorCommands constructor
+SensorCommands::SensorCommands()
+    : nextId(1)
+{
+}
+
+// Register a request and format its line
+int SensorCommands::request(const QByteArray &command, qint64 nowNs, int timeoutMs, QByteArray &line)
+{
+    if (pending.size() >= MaxPending) return -1;
+
+    Pending request;
+    request.id = nextId;
+    request.command = command.trimmed();
+    request.sentNs = nowNs;
+    request.deadlineNs = nowNs + qint64(timeoutMs) * 1000000;
+    pending.append(request);
+    nextId = nextId >= MaxId ? 1 : nextId + 1;
+
+    line = "$" + QByteArray::number(request.id) + " " + request.command + "\n";
+    return request.id;
+}
+
+void SensorCommands::cancel(int id)
+{
+    for (int index = 0; index < pending.size(); ++index) {
+        if (pending[index].id == id) {
+            pending.remove(index);
+            return;
+        }
+    }
+}
+
+// Match "$<id> OK [value]" or "$<id> ERR <message>" to its request
+bool SensorCommands::handleResponse(const char *line, qint64 length, qint64 nowNs)
+{
+    QByteArray text = QByteArray(line, int(length)).trimmed();
+    if (!text.startsWith('$')) return false;
+
+    int space = text.indexOf(' ');
+    bool ok;
+    int id = text.mid(1, space < 0 ? -1 : space - 1).toInt(&ok);
+    if (!ok || space < 0) return false;
+
+    QByteArray status = text.mid(space + 1);
+    int valueAt = status.indexOf(' ');
+    QByteArray value = valueAt < 0 ? QByteArray() : status.mid(valueAt + 1).trimmed();
+    if (valueAt >= 0) status.truncate(valueAt);
+    if (status != "OK" && status != "ERR") return false;
+
+    for (int index = 0; index < pending.size(); ++index) {
+        if (pending[index].id != id) continue;
+
+        Reply reply;
+        reply.id = id;
+        reply.command = pending[index].command;
+        reply.ok = status == "OK";
+        reply.text = QString::fromUtf8(value);
+        reply.latencyNs = nowNs - pending[index].sentNs;
+        replies.append(reply);
+        pending.remove(index);
+        return true;
+    }
+    return false;                       // Answer to a request that already timed out
+}
+
+// Time out overdue requests
+void SensorCommands::expire(qint64 nowNs)
+{
+    for (int index = 0; index < pending.size();) {
+        if (pending[index].deadlineNs > nowNs) {
+            ++index;
+            continue;
+        }
+
+        Reply reply;
+        reply.id = pending[index].id;
+        reply.command = pending[index].command;
+        reply.timedOut = true;
+        reply.text = "no answer";
+        reply.latencyNs = nowNs - pending[index].sentNs;
+        replies.append(reply);
+        pending.remove(index);
+    }
+}
+
+qint64 SensorCommands::nextDeadlineNs() const
+{
+    qint64 earliest = -1;
+    for (const Pending &request : pending) {
+        if (earliest < 0 || request.deadlineNs < earliest) earliest = request.deadlineNs;
+    }
+    return earliest;
+}
+
+// Pop the oldest completed request
+bool SensorCommands::takeReply(Reply &reply)
+{
+    if (replies.isEmpty()) return false;
+    reply = replies.takeFirst();
+    return true;
+}
+
+void SensorCommands::reset()
+{
+    pending.clear();
+    replies.clear();
+}
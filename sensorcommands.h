@@ -0,0 +1,81 @@
+#ifndef SENSORCOMMANDS_H
+#define SENSORCOMMANDS_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Request/response protocol for configuring the sensor board over its data
+// port. A request is one line "$<id> <COMMAND> [arguments]", e.g. "$7 RATE 100";
+// the board answers each with "$<id> OK [value]" or "$<id> ERR <message>",
+// interleaved with its readings (which never start with '$'). Ids match
+// responses to requests, so several may be outstanding and a late answer to a
+// request that already timed out is recognised and dropped.
+//
+// Commands the board understands:
+//   RATE <hz>          sample rate
+//   GAIN <n>           ADC gain
+//   OVERSAMPLE <n>     ADC samples averaged per reading
+//   FORMAT <TEXT|BINARY>
+//   INFO               firmware version and current settings
+//   RELIABLE <0|1>     numbered, checksummed readings (see ReliableLink)
+//
+// Completed requests (answered or timed out) are queued and collected with
+// takeReply(); time comes from the caller.
+class SensorCommands
+{
+public:
+    static const int DefaultTimeoutMs = 500;
+    static const int MaxPending = 16;
+
+    // Outcome of one request
+    struct Reply {
+        int id = 0;
+        QByteArray command;             // As sent, without the id
+        bool ok = false;
+        bool timedOut = false;
+        QString text;                   // Value after OK, or the error message
+        qint64 latencyNs = 0;           // From sending to the answer (or the timeout)
+    };
+
+    SensorCommands();
+
+    // Register a request and build its line (with the trailing newline);
+    // returns its id, or -1 if too many requests are outstanding
+    int request(const QByteArray &command, qint64 nowNs, int timeoutMs, QByteArray &line);
+
+    // Whether a received line is a response rather than a reading
+    static bool isResponse(const char *line, qint64 length) { return length > 0 && line[0] == '$'; }
+
+    // Forget a request that could not be sent; no reply is queued for it
+    void cancel(int id);
+
+    // Match a response line; returns false if it answers no outstanding request
+    bool handleResponse(const char *line, qint64 length, qint64 nowNs);
+
+    // Time out the requests whose deadline has passed
+    void expire(qint64 nowNs);
+
+    // Earliest deadline of an outstanding request, -1 if there is none
+    qint64 nextDeadlineNs() const;
+
+    bool takeReply(Reply &reply);
+    int pendingCount() const { return pending.size(); }
+
+    // Drop everything outstanding (e.g. when the port closes)
+    void reset();
+
+private:
+    struct Pending {
+        int id = 0;
+        QByteArray command;
+        qint64 sentNs = 0;
+        qint64 deadlineNs = 0;
+    };
+
+    QVector<Pending> pending;
+    QVector<Reply> replies;
+    int nextId;
+};
+
+#endif // SENSORCOMMANDS_H
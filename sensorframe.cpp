@@ -0,0 +1,168 @@
+// Include necessary headers
+#include "sensorframe.h"
+#include <QString>
+#include <QStringList>
+#include <cmath>                        // For pow and nan/inf
+#include <limits>
+
+// Parse one sensor reading into a frame
+bool parseSensorLine(const QByteArray &data, SensorFrame &frame)
+{
+    // Convert data to string and split by commas
+    QString text = QString::fromUtf8(data).trimmed();
+    QStringList items = text.split(",");
+
+    // Check if we have exactly 3 values (expected sensor data)
+    if (items.size() != 3) return false;
+
+    bool ok1, ok2, ok3;
+    // Convert strings to integers (the sensor sends bottom left first)
+    int botLeft = items[0].toInt(&ok1);
+    int topLeft = items[1].toInt(&ok2);
+    int topRight = items[2].toInt(&ok3);
+
+    // Only accept the frame if all conversions succeeded
+    if (!(ok1 && ok2 && ok3)) return false;
+
+    frame.raw[ChannelTopLeft] = topLeft;
+    frame.raw[ChannelTopRight] = topRight;
+    frame.raw[ChannelBotLeft] = botLeft;
+    return true;
+}
+
+// Column names of the CSV recording
+const char CsvHeader[] = "Timestamp,Top Left,Top Right,Bottom Left,"
+                         "Top Left w/o Zero,Top Right w/o Zero,Bottom Left w/o Zero";
+
+// Append one row of the CSV recording
+void appendCsvRow(QByteArray &row, const QDateTime &timestamp, const SensorFrame &frame,
+                  int derivedCount)
+{
+    // Write timestamp and sensor values (both zero-adjusted and raw)
+    row += timestamp.toString("yyyy-MM-dd HH:mm:ss.zzz").toLatin1();
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        row += ',';
+        row += QByteArray::number(frame.zeroed[channel]);
+    }
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        row += ',';
+        row += QByteArray::number(frame.raw[channel]);
+    }
+
+    // Derived channels follow the fixed columns
+    for (int index = 0; index < derivedCount; ++index) {
+        row += ',';
+        row += QByteArray::number(frame.derived[index], 'g', 10);
+    }
+    row += '\n';
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+static qint64 daysFromCivil(int year, int month, int day)
+{
+    year -= month <= 2;
+    const qint64 era = (year >= 0 ? year : year - 399) / 400;
+    const qint64 yearOfEra = year - era * 400;
+    const qint64 dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const qint64 dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// Parse a timestamp in the exact recording format
+bool parseRecordingTimestamp(const char *text, qint64 length, double &milliseconds)
+{
+    static const qint64 recordingLength = qint64(sizeof("yyyy-MM-dd HH:mm:ss.zzz") - 1);
+    if (length != recordingLength || text[10] != ' ') return false;
+    return parseTimestampText(text, length, milliseconds);
+}
+
+// Parse a timestamp leniently
+bool parseTimestampText(const char *text, qint64 length, double &milliseconds)
+{
+    // Fixed part: "yyyy-MM-dd HH:mm:ss"
+    static const char pattern[] = "dddd-dd-dd dd:dd:dd";
+    const qint64 fixedLength = qint64(sizeof(pattern) - 1);
+    if (length < fixedLength) return false;
+
+    for (qint64 i = 0; i < fixedLength; ++i) {
+        bool digit = text[i] >= '0' && text[i] <= '9';
+        if ((pattern[i] == 'd') != digit) return false;
+        if (!digit && text[i] != pattern[i] && !(i == 10 && text[i] == 'T')) return false;
+    }
+
+    // Read a run of digits as a number
+    auto number = [text](int position, int digits) {
+        int value = 0;
+        for (int i = 0; i < digits; ++i) value = value * 10 + (text[position + i] - '0');
+        return value;
+    };
+
+    // Optional fraction of a second with any number of digits
+    double fraction = 0;
+    if (length > fixedLength) {
+        if (text[fixedLength] != '.' || length == fixedLength + 1) return false;
+        double scale = 100.0;
+        for (qint64 i = fixedLength + 1; i < length; ++i) {
+            if (text[i] < '0' || text[i] > '9') return false;
+            fraction += (text[i] - '0') * scale;
+            scale /= 10;
+        }
+    }
+
+    qint64 days = daysFromCivil(number(0, 4), number(5, 2), number(8, 2));
+    qint64 seconds = ((days * 24 + number(11, 2)) * 60 + number(14, 2)) * 60 + number(17, 2);
+    milliseconds = seconds * 1000.0 + fraction;
+    return true;
+}
+
+// Parse a number written by appendCsvRow (or any plain decimal number)
+bool parseRecordingNumber(const char *text, qint64 length, double &value)
+{
+    qint64 i = 0;
+    bool negative = false;
+    if (i < length && (text[i] == '-' || text[i] == '+')) negative = text[i++] == '-';
+
+    // QByteArray::number writes nan and inf in lower case
+    if (length - i == 3 && text[i] == 'n' && text[i + 1] == 'a' && text[i + 2] == 'n') {
+        value = std::numeric_limits<double>::quiet_NaN();
+        return true;
+    }
+    if (length - i == 3 && text[i] == 'i' && text[i + 1] == 'n' && text[i + 2] == 'f') {
+        value = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+        return true;
+    }
+
+    // Mantissa digits, remembering where the decimal point was
+    double mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    for (; i < length && text[i] >= '0' && text[i] <= '9'; ++i, ++digits) {
+        mantissa = mantissa * 10 + (text[i] - '0');
+    }
+    if (i < length && text[i] == '.') {
+        for (++i; i < length && text[i] >= '0' && text[i] <= '9'; ++i, ++digits) {
+            mantissa = mantissa * 10 + (text[i] - '0');
+            --exponent;
+        }
+    }
+    if (digits == 0) return false;
+
+    // Optional exponent
+    if (i < length && (text[i] == 'e' || text[i] == 'E')) {
+        ++i;
+        bool negativeExponent = false;
+        if (i < length && (text[i] == '-' || text[i] == '+')) negativeExponent = text[i++] == '-';
+        int power = 0;
+        int powerDigits = 0;
+        for (; i < length && text[i] >= '0' && text[i] <= '9'; ++i, ++powerDigits) {
+            power = qMin(power * 10 + (text[i] - '0'), 9999);
+        }
+        if (powerDigits == 0) return false;
+        exponent += negativeExponent ? -power : power;
+    }
+    if (i != length) return false;
+
+    value = exponent == 0 ? mantissa : mantissa * std::pow(10.0, exponent);
+    if (negative) value = -value;
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef SENSORFRAME_H
+#define SENSORFRAME_H
+
+#include <QByteArray>
+#include <QDateTime>
+
+// Load cell channels, in the order they are written to the CSV recording
+enum SensorChannel {
+    ChannelTopLeft = 0,
+    ChannelTopRight,
+    ChannelBotLeft,
+    ChannelCount
+};
+
+// Upper limit of user-defined derived channels carried by each frame
+const int MaxDerivedChannels = 8;
+
+// One sample from the sensor board and everything derived from it
+struct SensorFrame
+{
+    quint64 sequence = 0;                       // Running frame number since the port was opened
+    qint64 timestampNs = 0;                     // Monotonic arrival time
+    int raw[ChannelCount] = {0, 0, 0};          // Counts exactly as sent by the sensor
+    int zeroed[ChannelCount] = {0, 0, 0};       // Raw counts minus the zero offsets
+
+    // Force estimator output (zero-adjusted counts and counts per second)
+    double filtered[ChannelCount] = {0, 0, 0};
+    double rate[ChannelCount] = {0, 0, 0};
+    double forceStdDev[ChannelCount] = {0, 0, 0};
+    double rateStdDev[ChannelCount] = {0, 0, 0};
+
+    // Values of the user-defined derived channels, in definition order
+    double derived[MaxDerivedChannels] = {};
+};
+
+// Parse a "botLeft,topLeft,topRight" reading; returns false if it is malformed
+bool parseSensorLine(const QByteArray &data, SensorFrame &frame);
+
+// Header line of the CSV recording (without the trailing newline)
+extern const char CsvHeader[];
+
+// Append one CSV row: timestamp, zero-adjusted values, raw values, then the
+// first derivedCount derived channels
+void appendCsvRow(QByteArray &row, const QDateTime &timestamp, const SensorFrame &frame,
+                  int derivedCount = 0);
+
+// Parse a recording timestamp, exactly "yyyy-MM-dd HH:mm:ss.zzz" as appendCsvRow
+// writes it, into milliseconds since 1970-01-01 of the same (local) clock,
+// without allocating
+bool parseRecordingTimestamp(const char *text, qint64 length, double &milliseconds);
+
+// The same for timestamps written by other programs: 'T' is accepted as the
+// separator, and the fraction of a second may have any number of digits or none
+bool parseTimestampText(const char *text, qint64 length, double &milliseconds);
+
+// Parse a decimal number (or nan/inf) independently of the C locale
+bool parseRecordingNumber(const char *text, qint64 length, double &value);
+
+#endif // SENSORFRAME_H
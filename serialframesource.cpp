@@ -0,0 +1,62 @@
+// Include necessary headers
+#include "serialframesource.h"
+
+// SerialFrameSource constructor
+SerialFrameSource::SerialFrameSource(const QString &portName, QObject *parent)
+    : FrameSource(parent)
+    , port(new QSerialPort(this))
+{
+    // Configure the port the way the HC-06 module expects
+    port->setPortName(portName);
+    port->setBaudRate(QSerialPort::Baud9600);           // Set baud rate
+    port->setDataBits(QSerialPort::Data8);              // 8 data bits
+    port->setParity(QSerialPort::NoParity);             // No parity
+    port->setStopBits(QSerialPort::OneStop);            // 1 stop bit
+    port->setFlowControl(QSerialPort::NoFlowControl);   // No flow control
+
+    connect(port, &QSerialPort::readyRead, this, &SerialFrameSource::readData);
+    connect(port, &QSerialPort::errorOccurred, this, &SerialFrameSource::handleError);
+}
+
+// Open the port for readings and commands
+bool SerialFrameSource::open(QString *errorString)
+{
+    resetLineBuffer();
+    resetCommands();
+    if (!port->open(QIODevice::ReadWrite)) {
+        if (errorString) *errorString = port->errorString();
+        return false;
+    }
+    return true;
+}
+
+void SerialFrameSource::close()
+{
+    port->close();
+    resetCommands();
+}
+
+// Commands share the port with the readings
+bool SerialFrameSource::writeCommand(const QByteArray &line)
+{
+    return port->write(line) == line.size();
+}
+
+// Serial port data ready read handler
+void SerialFrameSource::readData()
+{
+    // All bytes of one read arrived together, so they share a timestamp
+    qint64 arrival = now();
+    QByteArray data = port->readAll();
+    receiveData(data.constData(), data.size(), arrival);
+}
+
+// A vanished port (e.g. Bluetooth link dropped) ends the source
+void SerialFrameSource::handleError(QSerialPort::SerialPortError error)
+{
+    if (error == QSerialPort::ResourceError) {
+        QString reason = port->errorString();
+        port->close();
+        emit stopped(reason);
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef SERIALFRAMESOURCE_H
+#define SERIALFRAMESOURCE_H
+
+#include "framesource.h"
+#include <QSerialPort>
+
+// Readings from the sensor board over a (Bluetooth) serial port
+class SerialFrameSource : public FrameSource
+{
+    Q_OBJECT
+
+public:
+    explicit SerialFrameSource(const QString &portName, QObject *parent = nullptr);
+
+    bool open(QString *errorString = nullptr) override;
+    void close() override;
+    bool isOpen() const override { return port->isOpen(); }
+    QString description() const override { return port->portName(); }
+    bool supportsCommands() const override { return true; }
+
+protected:
+    bool writeCommand(const QByteArray &line) override;
+
+private:
+    void readData();
+    void handleError(QSerialPort::SerialPortError error);
+
+    QSerialPort *port;
+};
+
+#endif // SERIALFRAMESOURCE_H
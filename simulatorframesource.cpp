@@ -0,0 +1,181 @@
+// Include necessary headers
+#include "simulatorframesource.h"
+#include <cmath>                        // For cos
+#include <cstdio>                       // For snprintf
+
+// Frames generated per timer tick at most; a slow pipeline then falls behind instead of freezing the UI
+static const int MaxFramesPerTick = 20000;
+
+// Reliable lines the simulated board can send again
+static const int HistorySize = 1024;
+
+// Shape of the simulated load: a press every few seconds on top of a resting offset
+static const double RestingCounts = 500;
+static const double PressCounts = 300;
+static const double PressHz = 0.25;
+static const double NoiseCounts = 2;
+static const double Pi = 3.14159265358979323846;
+
+// SimulatorFrameSource constructor
+SimulatorFrameSource::SimulatorFrameSource(double framesPerSecond, QObject *parent)
+    : FrameSource(parent)
+    , timer(new QTimer(this))
+    , framesPerSecond(framesPerSecond)
+    , startNs(0)
+    , generated(0)
+    , random(12345)                     // Fixed seed so runs are repeatable
+    , reliable(false)
+    , sequence(0)
+    , history(HistorySize)
+    , dropPermille(0)
+    , dropRandom(54321)
+{
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, &QTimer::timeout, this, &SimulatorFrameSource::poll);
+}
+
+QString SimulatorFrameSource::description() const
+{
+    return QString("Simulator %1 Hz").arg(framesPerSecond);
+}
+
+bool SimulatorFrameSource::open(QString *errorString)
+{
+    if (framesPerSecond <= 0) {
+        if (errorString) *errorString = "Frame rate must be greater than zero";
+        return false;
+    }
+    resetCommands();
+    startNs = now();
+    generated = 0;
+    reliable = false;                   // The board starts in its plain format
+    timer->start(1);
+    return true;
+}
+
+void SimulatorFrameSource::close()
+{
+    timer->stop();
+    resetCommands();
+}
+
+// Answer a command the way the sensor board does, after the current event
+bool SimulatorFrameSource::writeCommand(const QByteArray &line)
+{
+    QList<QByteArray> words = line.trimmed().split(' ');
+    if (words.size() == 3 && words[0] == "!RESEND") {
+        // One-way request: the readings are the answer
+        quint32 first = words[1].toUInt();
+        quint32 count = words[2].toUInt();
+        QTimer::singleShot(0, this, [this, first, count]() { resend(first, count); });
+        return true;
+    }
+
+    if (words.size() < 2) return false;
+    QByteArray id = words[0];
+    QByteArray command = words[1];
+    QByteArray argument = words.size() > 2 ? words[2] : QByteArray();
+
+    QByteArray response = id + " OK";
+    bool ok = true;
+    if (command == "RATE") {
+        double rate = argument.toDouble(&ok);
+        if (ok && rate > 0) {
+            // Restart the schedule at the new rate from now
+            poll();
+            framesPerSecond = rate;
+            startNs = now();
+            generated = 0;
+            response += " " + argument;
+        } else {
+            response = id + " ERR invalid rate";
+        }
+    } else if (command == "INFO") {
+        response += " simulator rate=" + QByteArray::number(framesPerSecond);
+    } else if (command == "RELIABLE" && (argument == "0" || argument == "1")) {
+        reliable = argument == "1";
+        response += " " + argument;
+    } else if (command == "DROP") {
+        int permille = argument.toInt(&ok);
+        if (ok && permille >= 0 && permille <= 1000) {
+            dropPermille = permille;
+            response += " " + argument;
+        } else {
+            response = id + " ERR invalid share";
+        }
+    } else if (command == "GAIN" || command == "OVERSAMPLE" || command == "FORMAT") {
+        if (argument.isEmpty()) response = id + " ERR missing value";
+        else response += " " + argument;
+    } else {
+        response = id + " ERR unknown command";
+    }
+
+    QTimer::singleShot(0, this, [this, response]() { receiveResponse(response.constData(), response.size()); });
+    return true;
+}
+
+// Simulated load at a point in time
+void SimulatorFrameSource::syntheticReading(double seconds, std::mt19937 &random, int values[ChannelCount])
+{
+    // Each load cell is pressed a little out of phase with the others
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        double press = 0.5 - 0.5 * std::cos(2 * Pi * PressHz * seconds + channel * 2.0);
+
+        // Twelve uniform draws less six are close to normal noise, and unlike
+        // std::normal_distribution the same with every standard library, so a
+        // simulated recording has the same checksum on every platform
+        double noise = -6;
+        for (int draw = 0; draw < 12; ++draw) noise += random() / 4294967296.0;
+
+        values[channel] = int(std::lround(RestingCounts + PressCounts * press + NoiseCounts * noise));
+    }
+}
+
+// Generate every frame that is due by now, each stamped with its nominal time
+void SimulatorFrameSource::poll()
+{
+    const double intervalNs = 1e9 / framesPerSecond;
+    quint64 due = quint64((now() - startNs) / intervalNs) + 1;
+
+    char line[64];
+    for (int count = 0; generated < due && count < MaxFramesPerTick; ++count, ++generated) {
+        double seconds = generated / framesPerSecond;
+
+        int values[ChannelCount];
+        syntheticReading(seconds, random, values);
+
+        // Same format as the sensor board: bottom left first
+        int length = std::snprintf(line, sizeof(line), "%d,%d,%d", values[ChannelBotLeft],
+                                   values[ChannelTopLeft], values[ChannelTopRight]);
+        qint64 timestampNs = startNs + qint64(generated * intervalNs);
+        if (reliable) {
+            QByteArray numbered = ReliableLink::formatLine(sequence, QByteArray(line, length));
+            history[int(sequence % HistorySize)] = numbered;
+            sequence++;
+            sendLine(numbered, timestampNs);
+        } else if (dropPermille == 0) {
+            receiveLine(line, length, timestampNs);
+        } else {
+            sendLine(QByteArray(line, length), timestampNs);
+        }
+    }
+}
+
+// Hand a line to the parser unless the simulated link loses it
+void SimulatorFrameSource::sendLine(const QByteArray &line, qint64 timestampNs)
+{
+    if (dropPermille > 0 && int(dropRandom() % 1000) < dropPermille) return;
+    receiveLine(line.constData(), line.size(), timestampNs);
+}
+
+// Send stored readings again, skipping the ones no longer kept
+void SimulatorFrameSource::resend(quint32 first, quint32 count)
+{
+    qint64 arrival = now();
+    for (quint32 offset = 0; offset < count; ++offset) {
+        quint32 number = first + offset;
+        quint32 age = sequence - number;
+        if (age == 0 || age > quint32(HistorySize)) continue;
+        sendLine(history[int(number % HistorySize)], arrival);
+    }
+}
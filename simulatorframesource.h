@@ -0,0 +1,51 @@
+#ifndef SIMULATORFRAMESOURCE_H
+#define SIMULATORFRAMESOURCE_H
+
+#include "framesource.h"
+#include <QTimer>
+#include <QVector>
+#include <random>
+
+// Synthetic sensor readings at any rate: slow presses on each load cell plus
+// noise, formatted exactly like the sensor board's lines
+class SimulatorFrameSource : public FrameSource
+{
+    Q_OBJECT
+
+public:
+    SimulatorFrameSource(double framesPerSecond, QObject *parent = nullptr);
+
+    bool open(QString *errorString = nullptr) override;
+    void close() override;
+    bool isOpen() const override { return timer->isActive(); }
+    QString description() const override;
+    void poll() override;
+    bool supportsCommands() const override { return true; }
+
+    // Raw values (in SensorChannel order) of the simulated sensor at a point in time
+    static void syntheticReading(double seconds, std::mt19937 &random, int values[ChannelCount]);
+
+protected:
+    // Answers RATE (which it follows) and INFO; other settings are acknowledged but have no effect.
+    // Like the board it also switches to the reliable format with RELIABLE 1 and answers
+    // "!RESEND" lines; DROP <permille> loses that share of its lines to test the link.
+    bool writeCommand(const QByteArray &line) override;
+
+private:
+    QTimer *timer;
+    double framesPerSecond;
+    qint64 startNs;
+    quint64 generated;
+    std::mt19937 random;
+
+    // Reliable mode
+    void sendLine(const QByteArray &line, qint64 timestampNs);
+    void resend(quint32 first, quint32 count);
+    bool reliable;
+    quint32 sequence;                   // Of the next reading
+    QVector<QByteArray> history;        // Recent reliable lines, indexed by sequence number
+    int dropPermille;
+    std::mt19937 dropRandom;            // Separate so dropping does not change the readings
+};
+
+#endif // SIMULATORFRAMESOURCE_H
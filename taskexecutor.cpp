@@ -0,0 +1,218 @@
+// Include necessary headers
+#include "taskexecutor.h"
+#include "clock.h"                      // For the queue and run times
+#include <QThread>                      // For the worker threads
+#include <algorithm>                    // For std::max
+
+namespace {
+
+// The executor and queue of the worker running on this thread, so that tasks
+// queued by a task go to the worker's own queue
+thread_local TaskExecutor *currentExecutor = nullptr;
+thread_local int currentWorker = -1;
+
+qint64 nowNs()
+{
+    return Clock::system()->nowNs();
+}
+
+}
+
+// TaskExecutor constructor
+TaskExecutor::TaskExecutor(int workers)
+    : queued(0)
+    , stopping(false)
+    , tasks(0)
+    , steals(0)
+{
+    if (workers <= 0) workers = std::max(1, QThread::idealThreadCount() - 1);
+
+    for (int index = 0; index <= workers; ++index) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue));
+    }
+    for (int index = 0; index < workers; ++index) {
+        QThread *thread = QThread::create([this, index]() { work(index); });
+        thread->setObjectName(QString("Task worker %1").arg(index + 1));
+        thread->start(QThread::LowPriority);
+        threads.push_back(thread);
+    }
+}
+
+// TaskExecutor destructor
+TaskExecutor::~TaskExecutor()
+{
+    {
+        QMutexLocker locker(&sleepMutex);
+        stopping = true;
+        wake.wakeAll();
+    }
+    for (QThread *thread : threads) {
+        thread->wait();
+        delete thread;
+    }
+}
+
+TaskExecutor &TaskExecutor::shared()
+{
+    static TaskExecutor executor;
+    return executor;
+}
+
+void TaskExecutor::submit(const char *name, Priority priority, Task task)
+{
+    Job job;
+    job.name = name;
+    job.task = std::move(task);
+    job.queuedNs = nowNs();
+
+    int index = currentExecutor == this ? currentWorker : int(queues.size()) - 1;
+    {
+        QMutexLocker locker(&queues[index]->mutex);
+        queues[index]->jobs[priority].push_back(std::move(job));
+    }
+    queued.fetch_add(1);
+
+    QMutexLocker locker(&sleepMutex);
+    wake.wakeOne();
+}
+
+// Parallel loop handler: helpers and the caller claim indices until none are left
+void TaskExecutor::parallelFor(const char *name, Priority priority, int count, const std::function<void(int)> &task,
+                               int maxThreads)
+{
+    if (count <= 0) return;
+
+    struct Loop {
+        std::atomic<int> next{0};
+        std::atomic<int> remaining{0};
+        QMutex mutex;
+        QWaitCondition done;
+    };
+    auto loop = std::make_shared<Loop>();
+    loop->remaining = count;
+    qint64 startNs = nowNs();
+
+    // Helpers only call task for indices they claimed, and all indices are
+    // finished before this returns, so a helper that starts late never touches it
+    const std::function<void(int)> *body = &task;
+    auto claim = [this, loop, name, count, body, startNs]() {
+        for (;;) {
+            int index = loop->next.fetch_add(1);
+            if (index >= count) return;
+
+            qint64 beginNs = nowNs();
+            (*body)(index);
+            record(name, beginNs - startNs, nowNs() - beginNs);
+
+            if (loop->remaining.fetch_sub(1) == 1) {
+                QMutexLocker locker(&loop->mutex);
+                loop->done.wakeAll();
+            }
+        }
+    };
+
+    // Helper jobs have no name: their indices are timed one by one instead
+    int helpers = std::min(count - 1, workerCount());
+    if (maxThreads > 0) helpers = std::min(helpers, maxThreads - 1);
+    for (int helper = 0; helper < helpers; ++helper) submit(nullptr, priority, claim);
+
+    claim();
+
+    QMutexLocker locker(&loop->mutex);
+    while (loop->remaining.load() > 0) loop->done.wait(&loop->mutex);
+}
+
+// Worker loop handler
+void TaskExecutor::work(int index)
+{
+    currentExecutor = this;
+    currentWorker = index;
+
+    Job job;
+    for (;;) {
+        if (take(index, job)) {
+            run(job);
+            continue;
+        }
+
+        QMutexLocker locker(&sleepMutex);
+        if (queued.load() > 0) continue;
+        if (stopping) return;
+        wake.wait(&sleepMutex);
+    }
+}
+
+// Take the next job for a worker: critical before best effort, and for each
+// the worker's own newest job, then the oldest job of the other queues
+bool TaskExecutor::take(int index, Job &job)
+{
+    const int count = int(queues.size());
+    const int injection = count - 1;
+
+    for (int priority = 0; priority < PriorityCount; ++priority) {
+        {
+            Queue &own = *queues[index];
+            QMutexLocker locker(&own.mutex);
+            std::deque<Job> &jobs = own.jobs[priority];
+            if (!jobs.empty()) {
+                job = std::move(jobs.back());
+                jobs.pop_back();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+
+        for (int offset = 1; offset < count; ++offset) {
+            int victim = (index + offset) % count;
+            Queue &other = *queues[victim];
+            QMutexLocker locker(&other.mutex);
+            std::deque<Job> &jobs = other.jobs[priority];
+            if (jobs.empty()) continue;
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            queued.fetch_sub(1);
+            if (victim != injection) steals.fetch_add(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskExecutor::run(Job &job)
+{
+    qint64 startNs = nowNs();
+    job.task();
+    if (job.name) record(job.name, startNs - job.queuedNs, nowNs() - startNs);
+    job.task = Task();                  // Let go of the captures now, not at the next job
+}
+
+void TaskExecutor::record(const char *name, qint64 waitNs, qint64 runNs)
+{
+    QMutexLocker locker(&statsMutex);
+    Timing &timing = timings[name];
+    timing.run.add(runNs);
+    timing.maxWaitNs = std::max(timing.maxWaitNs, waitNs);
+    tasks++;
+}
+
+// Statistics handler
+QString TaskExecutor::report(bool reset)
+{
+    QMutexLocker locker(&statsMutex);
+    QString text = QString("Task executor: %1 workers, %2 tasks, %3 stolen")
+                       .arg(workerCount())
+                       .arg(tasks)
+                       .arg(quint64(steals.load()));
+    for (const auto &entry : timings) {
+        text += "\n" + entry.second.run.format(entry.first)
+                + QString(" waited max %1 ms").arg(entry.second.maxWaitNs / 1e6, 0, 'f', 2);
+    }
+
+    if (reset) {
+        timings.clear();
+        tasks = 0;
+        steals = 0;
+    }
+    return text;
+}
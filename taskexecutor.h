@@ -0,0 +1,104 @@
+#ifndef TASKEXECUTOR_H
+#define TASKEXECUTOR_H
+
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+#include "latencymonitor.h"
+
+class QThread;
+
+// Shared pool of worker threads for everything that is not acquisition:
+// verification, joins, channel lag analysis. Sharing one pool keeps the
+// analysis stages from each starting threads of their own and fighting over the
+// few cores of a lab laptop. By default it has one worker per core but one, so a
+// core stays free for the GUI thread that parses, processes and records the
+// frames, and the workers run at low thread priority so that the operating
+// system prefers acquisition whenever both want to run.
+//
+// Every worker has its own queue. Tasks queued from a worker go to its own
+// queue and are taken newest first; an idle worker steals the oldest task of
+// another queue, so a task that splits its work spreads over all cores.
+// Critical tasks (analysis that must keep up with a running capture) are taken
+// from every queue before any best-effort task (analysis the operator started).
+// Run and queue times are kept per task name for the statistics panel.
+class TaskExecutor
+{
+public:
+    enum Priority {
+        PriorityCritical = 0,
+        PriorityBestEffort,
+        PriorityCount
+    };
+
+    typedef std::function<void()> Task;
+
+    // workers = 0: one per core but one (at least one)
+    explicit TaskExecutor(int workers = 0);
+    ~TaskExecutor();                    // Runs the queued tasks to the end first
+
+    // The pool shared by the whole application
+    static TaskExecutor &shared();
+
+    int workerCount() const { return int(threads.size()); }
+
+    // Queue a task; name must outlive the executor (use a string literal)
+    void submit(const char *name, Priority priority, Task task);
+
+    // Run task(0) .. task(count - 1) and return when all have finished. The
+    // calling thread runs its share too, so tasks may use this themselves. At
+    // most maxThreads threads work on the loop, the caller included (0: all workers).
+    void parallelFor(const char *name, Priority priority, int count, const std::function<void(int)> &task,
+                     int maxThreads = 0);
+
+    // Tasks run, tasks stolen and the times per task name; clears them when reset is true
+    QString report(bool reset);
+
+private:
+    struct Job {
+        const char *name = nullptr;
+        Task task;
+        qint64 queuedNs = 0;
+    };
+
+    // One worker's tasks; the last queue takes the tasks submitted from other threads
+    struct Queue {
+        QMutex mutex;
+        std::deque<Job> jobs[PriorityCount];
+    };
+
+    struct Timing {
+        LatencyHistogram run;
+        qint64 maxWaitNs = 0;
+    };
+
+    struct NameLess {
+        bool operator()(const char *a, const char *b) const { return std::strcmp(a, b) < 0; }
+    };
+
+    void work(int index);
+    bool take(int index, Job &job);
+    void run(Job &job);
+    void record(const char *name, qint64 waitNs, qint64 runNs);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<QThread *> threads;
+    std::atomic<int> queued;            // Jobs in all queues
+    QMutex sleepMutex;
+    QWaitCondition wake;
+    bool stopping;
+
+    QMutex statsMutex;
+    std::map<const char *, Timing, NameLess> timings;
+    quint64 tasks;
+    std::atomic<quint64> steals;
+};
+
+#endif // TASKEXECUTOR_H
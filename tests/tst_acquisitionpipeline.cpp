@@ -0,0 +1,124 @@
+// Include necessary headers
+#include <QtTest>                       // For the test framework
+#include "acquisitionpipeline.h"
+
+// Frames processed in blocks must come out exactly as processed one by one,
+// with drift tracking on and off, across filter restarts and in a reused block
+class AcquisitionPipelineTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void blocksMatchSingleFrames_data();
+    void blocksMatchSingleFrames();
+};
+
+static const qint64 Millisecond = 1000000;
+
+// Quiet channels around a slowly drifting zero, one loaded channel, a gap long
+// enough to restart the filters and a timestamp going backwards
+static QVector<SensorFrame> makeFrames(int count)
+{
+    QVector<SensorFrame> frames(count);
+    quint32 state = 12345;
+    qint64 timeNs = 0;
+    for (int index = 0; index < count; ++index) {
+        SensorFrame &frame = frames[index];
+        timeNs += index == count / 2 ? 2000 * Millisecond : index == count / 3 ? -5 * Millisecond : Millisecond;
+        frame.timestampNs = timeNs;
+        for (int channel = 0; channel < ChannelCount; ++channel) {
+            state = state * 1664525 + 1013904223;
+            frame.raw[channel] = 5 + index / 200 + int(state >> 30);
+        }
+        frame.raw[2] += (index / 300) % 2 ? 4000 : 0;
+    }
+    return frames;
+}
+
+// Same definitions and settings for both pipelines
+static void configure(AcquisitionPipeline &pipeline, bool tracking)
+{
+    QVector<DerivedChannels::Definition> definitions;
+    DerivedChannels::parseDefinitions("total = topLeft + topRight + botLeft\n"
+                                      "trend = filteredTopLeft + rateTopLeft * t + total\n",
+                                      definitions);
+    pipeline.derivedChannels().setDefinitions(definitions);
+
+    BaselineTracker::Settings settings;
+    settings.enabled = tracking;
+    settings.windowMs = 100;
+    pipeline.baselineTracker().setSettings(settings);
+}
+
+// Equal values, where NaN equals NaN
+static bool sameValue(double a, double b)
+{
+    return (qIsNaN(a) && qIsNaN(b)) || a == b;
+}
+
+static bool sameFrame(const SensorFrame &a, const SensorFrame &b, int derivedCount)
+{
+    bool same = a.sequence == b.sequence && a.timestampNs == b.timestampNs;
+    for (int channel = 0; channel < ChannelCount; ++channel) {
+        same = same && a.raw[channel] == b.raw[channel] && a.zeroed[channel] == b.zeroed[channel]
+               && sameValue(a.filtered[channel], b.filtered[channel]) && sameValue(a.rate[channel], b.rate[channel])
+               && sameValue(a.forceStdDev[channel], b.forceStdDev[channel])
+               && sameValue(a.rateStdDev[channel], b.rateStdDev[channel]);
+    }
+    for (int index = 0; index < derivedCount; ++index) same = same && sameValue(a.derived[index], b.derived[index]);
+    return same;
+}
+
+void AcquisitionPipelineTest::blocksMatchSingleFrames_data()
+{
+    QTest::addColumn<bool>("tracking");
+    QTest::addColumn<int>("blockSize");
+
+    QTest::newRow("fixed zero, full blocks") << false << int(FrameBlock::Capacity);
+    QTest::newRow("fixed zero, odd blocks") << false << 37;
+    QTest::newRow("drift tracking, full blocks") << true << int(FrameBlock::Capacity);
+    QTest::newRow("drift tracking, single frames") << true << 1;
+}
+
+void AcquisitionPipelineTest::blocksMatchSingleFrames()
+{
+    QFETCH(bool, tracking);
+    QFETCH(int, blockSize);
+
+    AcquisitionPipeline single;
+    AcquisitionPipeline blocks;
+    configure(single, tracking);
+    configure(blocks, tracking);
+    QCOMPARE(blocks.derivedChannels().count(), 2);
+
+    const QVector<SensorFrame> frames = makeFrames(2000);
+    FrameBlock input;
+    FrameBlock output;                  // Reused for every block, as by the main window
+    SensorFrame expected;
+    SensorFrame actual;
+    int processed = 0;
+    for (int start = 0; start < frames.size(); start += blockSize) {
+        input.clear();
+        for (int index = start; index < qMin(start + blockSize, frames.size()); ++index) input.append(frames[index]);
+        blocks.processBlock(input, output);
+        QCOMPARE(output.size(), input.size());
+
+        for (int index = 0; index < output.size(); ++index) {
+            expected = frames[processed++];
+            single.process(expected);
+            output.readFrame(index, actual);
+            QVERIFY2(sameFrame(expected, actual, 2), qPrintable(QString("frame %1").arg(processed - 1)));
+        }
+        QVERIFY(sameFrame(single.latestFrame(), blocks.latestFrame(), 2));
+        for (int channel = 0; channel < ChannelCount; ++channel) {
+            QCOMPARE(blocks.zeroOffsets()[channel], single.zeroOffsets()[channel]);
+        }
+    }
+    QCOMPARE(processed, frames.size());
+
+    // The drift was followed, so the offsets no longer start from zero
+    if (tracking) QVERIFY(single.zeroOffsets()[0] != 0);
+}
+
+QTEST_GUILESS_MAIN(AcquisitionPipelineTest)
+#include "tst_acquisitionpipeline.moc"
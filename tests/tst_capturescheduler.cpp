@@ -0,0 +1,206 @@
+// Include necessary headers
+#include <QtTest>                       // For the test framework
+#include <QTemporaryDir>                // For the simulated recording
+#include "acquisitionpipeline.h"
+#include "capturescheduler.h"
+#include "clock.h"
+#include "crc32.h"
+#include "recordingwriter.h"
+#include "simulatorframesource.h"
+
+// Capture timing on a virtual clock: a simulated hour runs in moments, and
+// every tick time and every byte of the recording is the same on every run
+class CaptureSchedulerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void tickTimesAreExact();
+    void ticksDoNotDrift();
+    void lateTicksAreCaughtUp();
+    void pauseShiftsTheSchedule();
+    void setRateKeepsTheEnd_data();
+    void setRateKeepsTheEnd();
+    void simulatedHourRecording();
+};
+
+static const qint64 Second = 1000000000;
+static const qint64 Hour = 3600 * Second;
+
+// Jump from one tick to the next until the capture ends; returns the time of the last tick
+static qint64 runToEnd(CaptureScheduler &scheduler, VirtualClock &clock)
+{
+    while (!scheduler.finished()) {
+        clock.advanceTo(scheduler.nextDueNs());
+        if (scheduler.takeDue(clock.nowNs()) != 1) return -1;
+    }
+    return clock.nowNs();
+}
+
+// An hour at 50 fps: every tick exactly 20 ms after the one before
+void CaptureSchedulerTest::tickTimesAreExact()
+{
+    VirtualClock clock;
+    CaptureScheduler scheduler;
+    const qint64 ticks = 3600 * 50;
+    scheduler.start(clock.nowNs(), 50, ticks);
+
+    for (qint64 tick = 0; tick < ticks; ++tick) {
+        QCOMPARE(scheduler.nextDueNs(), tick * 20000000);
+        clock.advanceTo(scheduler.nextDueNs());
+        QCOMPARE(scheduler.takeDue(clock.nowNs()), 1);
+        QCOMPARE(scheduler.lastLatenessNs(), qint64(0));
+    }
+    QVERIFY(scheduler.finished());
+    QVERIFY(!scheduler.isRunning());
+    QCOMPARE(scheduler.issued(), ticks);
+    QCOMPARE(clock.nowNs(), Hour - 20000000);
+}
+
+// At 30 fps the interval is not a whole number of nanoseconds, yet the last
+// tick of the hour is still within a nanosecond of its exact time
+void CaptureSchedulerTest::ticksDoNotDrift()
+{
+    VirtualClock clock;
+    CaptureScheduler scheduler;
+    const qint64 ticks = 3600 * 30;
+    scheduler.start(clock.nowNs(), 30, ticks);
+
+    for (qint64 tick = 0; tick < ticks; ++tick) {
+        qint64 exactNs = tick * Second / 30;
+        QVERIFY(qAbs(scheduler.nextDueNs() - exactNs) <= 1);
+        clock.advanceTo(scheduler.nextDueNs());
+        QCOMPARE(scheduler.takeDue(clock.nowNs()), 1);
+    }
+    QVERIFY(qAbs(clock.nowNs() - (ticks - 1) * Second / 30) <= 1);
+    QVERIFY(qAbs(scheduler.nextDueNs() - Hour) <= 1);
+}
+
+// A timer that fires a second late gets every tick it missed at once
+void CaptureSchedulerTest::lateTicksAreCaughtUp()
+{
+    VirtualClock clock;
+    CaptureScheduler scheduler;
+    scheduler.start(clock.nowNs(), 50, 1000);
+
+    clock.advanceTo(Second);
+    QCOMPARE(scheduler.takeDue(clock.nowNs()), 51);    // 0 ms to 1000 ms
+    QCOMPARE(scheduler.backlogNs(), Second);
+    QCOMPARE(scheduler.lastLatenessNs(), qint64(0));
+    QCOMPARE(scheduler.nextDueNs(), Second + 20000000);
+
+    // Each caught-up tick still knows its own time
+    for (qint64 tick = 0; tick <= 50; ++tick) QCOMPARE(scheduler.tickDueNs(tick), tick * 20000000);
+}
+
+// A pause moves the rest of the schedule by its length
+void CaptureSchedulerTest::pauseShiftsTheSchedule()
+{
+    VirtualClock clock;
+    CaptureScheduler scheduler;
+    scheduler.start(clock.nowNs(), 10, 100);
+
+    clock.advanceTo(Second);
+    QCOMPARE(scheduler.takeDue(clock.nowNs()), 11);
+
+    clock.advanceTo(Second + 50000000);
+    scheduler.pause(clock.nowNs());
+    clock.advanceTo(3 * Second + 550000000);
+    QCOMPARE(scheduler.takeDue(clock.nowNs()), 0);
+    QVERIFY(scheduler.isPaused());
+
+    scheduler.resume(clock.nowNs());
+    QCOMPARE(scheduler.pausedNs(), 2 * Second + 500000000);
+    QCOMPARE(scheduler.nextDueNs(), 3 * Second + 600000000);
+
+    // Ticks stay 100 ms apart and the last one is as late as the pause was long
+    QCOMPARE(runToEnd(scheduler, clock), 12 * Second + 400000000);
+    QCOMPARE(scheduler.issued(), qint64(100));
+}
+
+void CaptureSchedulerTest::setRateKeepsTheEnd_data()
+{
+    QTest::addColumn<double>("rate");
+    QTest::addColumn<qint64>("ticks");
+    QTest::addColumn<qint64>("lastTickNs");
+
+    // 10 fps for 10 s, changed at 2 s after 21 ticks: the rest fills 2 s to 10 s
+    QTest::newRow("doubled") << 20.0 << qint64(21 + 159) << 9950000000LL;
+    QTest::newRow("halved") << 5.0 << qint64(21 + 39) << 9800000000LL;
+    QTest::newRow("30 fps") << 30.0 << qint64(21 + 239) << 9966666666LL;
+}
+
+// A new rate applies from now on, and the capture still ends at 10 s
+void CaptureSchedulerTest::setRateKeepsTheEnd()
+{
+    QFETCH(double, rate);
+    QFETCH(qint64, ticks);
+    QFETCH(qint64, lastTickNs);
+
+    VirtualClock clock;
+    CaptureScheduler scheduler;
+    scheduler.start(clock.nowNs(), 10, 100);
+
+    clock.advanceTo(2 * Second);
+    QCOMPARE(scheduler.takeDue(clock.nowNs()), 21);
+
+    scheduler.setRate(clock.nowNs(), rate);
+    QCOMPARE(scheduler.total(), ticks);
+    QVERIFY(qAbs(scheduler.nextDueNs() - (2 * Second + qint64(1e9 / rate))) <= 1);
+
+    QVERIFY(qAbs(runToEnd(scheduler, clock) - lastTickNs) <= 1);
+    QCOMPARE(scheduler.issued(), ticks);
+    QVERIFY(qAbs(scheduler.nextDueNs() - 10 * Second) <= 1);
+}
+
+// An hour at 25 fps from the 200 Hz simulator, recorded the way
+// --simulate-capture does; the recording must not change by a single byte
+void CaptureSchedulerTest::simulatedHourRecording()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    const QString fileName = directory.filePath("simulated.csv");
+
+    VirtualClock clock(QDateTime(QDate(2024, 1, 1), QTime(12, 0)));
+    AcquisitionPipeline pipeline;
+    SimulatorFrameSource source(200);
+    RecordingWriter writer;
+    CaptureScheduler scheduler;
+    source.setClock(&clock);
+    connect(&source, &FrameSource::frameReceived, [&](const SensorFrame &received) {
+        SensorFrame frame = received;
+        pipeline.process(frame);
+    });
+
+    QString error;
+    QVERIFY2(source.open(&error), qPrintable(error));
+    QVERIFY2(writer.open(fileName, 25, 3600, QStringList(), &error), qPrintable(error));
+
+    qint64 maxLatenessNs = 0;
+    scheduler.start(clock.nowNs(), 25, 25 * 3600);
+    while (!scheduler.finished()) {
+        clock.advanceTo(scheduler.nextDueNs());
+        source.poll();
+        int due = scheduler.takeDue(clock.nowNs());
+        maxLatenessNs = qMax(maxLatenessNs, scheduler.lastLatenessNs());
+        for (int i = 0; i < due; ++i) writer.writeFrame(clock.wallTime(), pipeline.latestFrame());
+    }
+    writer.close();
+    source.close();
+
+    QCOMPARE(writer.rowsWritten(), qint64(25 * 3600));
+    QCOMPARE(source.framesReceived(), quint64(8 * (25 * 3600 - 1) + 1));
+    QCOMPARE(maxLatenessNs, qint64(0));
+    QCOMPARE(clock.nowNs(), Hour - 40000000);
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QByteArray contents = file.readAll();
+    QCOMPARE(int(contents.size()), 4320099);
+    QVERIFY(contents.startsWith("Timestamp,Top Left,Top Right,Bottom Left,"));
+    QVERIFY(contents.endsWith("\n2024-01-01 12:59:59.960,500,705,756,500,705,756\n"));
+    QCOMPARE(crc32Update(0, contents.constData(), contents.size()), quint32(0x38b8a5fd));
+}
+
+QTEST_GUILESS_MAIN(CaptureSchedulerTest)
+#include "tst_capturescheduler.moc"
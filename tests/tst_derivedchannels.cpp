@@ -0,0 +1,136 @@
+// Include necessary headers
+#include <QtTest>                       // For the test framework
+#include "channelexpression.h"
+#include "derivedchannels.h"
+#include "frameblock.h"
+
+// Derived channels evaluated frame by frame and over a block must agree, and
+// no expression text may take the parser down
+class DerivedChannelsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void batchMatchesSingleFrames_data();
+    void batchMatchesSingleFrames();
+    void deepNestingFails_data();
+    void deepNestingFails();
+    void moderateNestingCompiles();
+};
+
+// Equal values, where NaN equals NaN
+static bool sameValue(double a, double b)
+{
+    return (qIsNaN(a) && qIsNaN(b)) || a == b;
+}
+
+// Frames with varied values, some channels negative so that sqrt gives NaN
+static QVector<SensorFrame> makeFrames(int count)
+{
+    QVector<SensorFrame> frames(count);
+    quint32 state = 12345;
+    for (int index = 0; index < count; ++index) {
+        SensorFrame &frame = frames[index];
+        frame.timestampNs = qint64(index) * 1000000;
+        for (int channel = 0; channel < ChannelCount; ++channel) {
+            state = state * 1664525 + 1013904223;
+            frame.raw[channel] = int(state >> 20) - 2048;
+            frame.zeroed[channel] = frame.raw[channel] - 100;
+            frame.filtered[channel] = frame.zeroed[channel] * 0.75;
+            frame.rate[channel] = (int(state & 0xFFFF) - 32768) / 16.0;
+        }
+    }
+    return frames;
+}
+
+void DerivedChannelsTest::batchMatchesSingleFrames_data()
+{
+    QTest::addColumn<int>("count");
+
+    QTest::newRow("one frame") << 1;
+    QTest::newRow("odd size") << 37;
+    QTest::newRow("full block") << 256;
+}
+
+// Every operation, constants and channels that use the ones defined before them
+void DerivedChannelsTest::batchMatchesSingleFrames()
+{
+    QFETCH(int, count);
+
+    QVector<DerivedChannels::Definition> definitions;
+    QString error;
+    QVERIFY2(DerivedChannels::parseDefinitions(
+                 "total = topLeft + topRight + botLeft\n"
+                 "shear = (topLeft - topRight) / (abs(total) + 1)\n"
+                 "root = sqrt(botLeft) * 2 + -rateTopLeft\n"
+                 "limited = clamp(filteredTopLeft, -500, 2 * 250)\n"
+                 "extreme = max(rawTopLeft, min(rawTopRight, rawBotLeft))\n"
+                 "state = topLeft > 0 && !(topRight <= 0) || botLeft == 7 ? shear : t * 1000\n"
+                 "tested = (total != 0) + (total < 100) + (total >= -100)\n"
+                 "constant = 3 * (4 - 1) + root * 0\n",
+                 definitions, &error),
+             qPrintable(error));
+
+    DerivedChannels derived;
+    QVERIFY2(derived.setDefinitions(definitions, &error), qPrintable(error));
+    QCOMPARE(derived.count(), 8);
+
+    QVector<SensorFrame> single = makeFrames(count);
+    FrameBlock block;
+    for (const SensorFrame &frame : single) block.append(frame);
+    for (SensorFrame &frame : single) derived.evaluate(frame);
+    derived.evaluate(block);
+
+    for (int index = 0; index < count; ++index) {
+        for (int channel = 0; channel < derived.count(); ++channel) {
+            double expected = single[index].derived[channel];
+            double actual = block.derived(channel)[index];
+            QVERIFY2(sameValue(expected, actual),
+                     qPrintable(QString("frame %1, %2: %3 one by one, %4 in the batch")
+                                    .arg(index).arg(derived.names()[channel]).arg(expected).arg(actual)));
+        }
+    }
+}
+
+void DerivedChannelsTest::deepNestingFails_data()
+{
+    QTest::addColumn<QString>("expression");
+
+    const int levels = 100000;
+    QTest::newRow("parentheses") << QString(levels, '(') + "topLeft" + QString(levels, ')');
+    QTest::newRow("minus") << QString(levels, '-') + "topLeft";
+    QTest::newRow("not") << QString(levels, '!') + "topLeft";
+    QTest::newRow("conditional") << QString("topLeft ? 1 : ").repeated(levels) + "0";
+    QTest::newRow("function") << QString("abs(").repeated(levels) + "topLeft" + QString(levels, ')');
+    QTest::newRow("unclosed") << QString(levels, '(');
+}
+
+// Expressions come from settings that may be corrupted; they must fail, not crash
+void DerivedChannelsTest::deepNestingFails()
+{
+    QFETCH(QString, expression);
+
+    ChannelExpression compiled;
+    QString error;
+    QVERIFY(!compiled.compile(expression, DerivedChannels::variableNames(), &error));
+    QVERIFY2(error.contains("nested too deeply"), qPrintable(error));
+    QVERIFY(!compiled.isValid());
+}
+
+// Real expressions nest far less than the limit
+void DerivedChannelsTest::moderateNestingCompiles()
+{
+    const int levels = 100;
+    ChannelExpression compiled;
+    QString error;
+    QVERIFY2(compiled.compile(QString(levels, '(') + "-topLeft" + QString(levels, ')'),
+                              DerivedChannels::variableNames(), &error),
+             qPrintable(error));
+
+    double variables[DerivedChannels::MaxVariables] = {};
+    variables[0] = 5;
+    QCOMPARE(compiled.evaluate(variables), -5.0);
+}
+
+QTEST_GUILESS_MAIN(DerivedChannelsTest)
+#include "tst_derivedchannels.moc"
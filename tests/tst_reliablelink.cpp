@@ -0,0 +1,180 @@
+// Include necessary headers
+#include <QtTest>                       // For the test framework
+#include "reliablelink.h"
+
+// The reliable sensor link on made-up arrival times: checksums, resend
+// requests, recovery, giving up, long dropouts and counter restarts
+class ReliableLinkTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void checksumsAreChecked();
+    void inOrderNeedsNoRequests();
+    void gapIsRecovered();
+    void gapIsRetriedThenLost();
+    void longDropoutIsCountedInFull();
+    void sequenceWrapsAround();
+    void restartDeliversWhatIsHeld();
+};
+
+static const qint64 Millisecond = 1000000;
+
+// Sequence numbers are carried in the first raw value so the output order can be checked
+static void send(ReliableLink &link, quint32 sequence, qint64 timeNs)
+{
+    SensorFrame frame;
+    frame.raw[0] = int(sequence);
+    link.accept(sequence, frame, timeNs, timeNs);
+}
+
+// The sequence numbers delivered so far
+static QVector<quint32> delivered(ReliableLink &link, QVector<qint64> *times = nullptr)
+{
+    QVector<quint32> sequences;
+    ReliableLink::Delivery delivery;
+    while (link.takeDelivery(delivery)) {
+        sequences.append(quint32(delivery.frame.raw[0]));
+        if (times) times->append(delivery.timestampNs);
+    }
+    return sequences;
+}
+
+// The resend requests so far, as first and count pairs
+static QVector<quint32> requested(ReliableLink &link)
+{
+    QVector<quint32> requests;
+    quint32 first, count;
+    while (link.takeResendRequest(first, count)) requests << first << count;
+    return requests;
+}
+
+void ReliableLinkTest::checksumsAreChecked()
+{
+    QByteArray line = ReliableLink::formatLine(42, "512,498,503");
+    QVERIFY(ReliableLink::isReliableLine(line.constData(), line.size()));
+
+    quint32 sequence = 0;
+    const char *reading = nullptr;
+    qint64 readingLength = 0;
+    QVERIFY(ReliableLink::checkLine(line.constData(), line.size(), sequence, reading, readingLength));
+    QCOMPARE(sequence, quint32(42));
+    QCOMPARE(QByteArray(reading, int(readingLength)), QByteArray("512,498,503"));
+
+    QByteArray corrupted = line;
+    corrupted[4] = '9';
+    QVERIFY(!ReliableLink::checkLine(corrupted.constData(), corrupted.size(), sequence, reading, readingLength));
+    QVERIFY(!ReliableLink::isReliableLine("512,498,503", 11));
+}
+
+void ReliableLinkTest::inOrderNeedsNoRequests()
+{
+    ReliableLink link;
+    for (quint32 sequence = 0; sequence < 10; ++sequence) send(link, sequence, sequence * Millisecond);
+
+    QCOMPARE(delivered(link), QVector<quint32>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    QCOMPARE(requested(link), QVector<quint32>());
+    QCOMPARE(link.nextDeadlineNs(), qint64(-1));
+}
+
+// A gap is asked for at once; the resent readings fill it in order and take
+// the arrival time of the frame that revealed it
+void ReliableLinkTest::gapIsRecovered()
+{
+    ReliableLink link;
+    send(link, 0, 0);
+    send(link, 3, 1 * Millisecond);
+    QCOMPARE(requested(link), QVector<quint32>({1, 2}));
+    QCOMPARE(delivered(link), QVector<quint32>({0}));
+    QCOMPARE(link.nextDeadlineNs(), 1 * Millisecond + ReliableLink::RetryMs * Millisecond);
+
+    send(link, 1, 5 * Millisecond);
+    send(link, 2, 6 * Millisecond);
+    QVector<qint64> times;
+    QCOMPARE(delivered(link, &times), QVector<quint32>({1, 2, 3}));
+    QCOMPARE(times, QVector<qint64>({1 * Millisecond, 1 * Millisecond, 1 * Millisecond}));
+    QCOMPARE(link.nextDeadlineNs(), qint64(-1));
+
+    // A resent reading that arrives twice is a duplicate
+    send(link, 2, 7 * Millisecond);
+    QCOMPARE(delivered(link), QVector<quint32>());
+    QCOMPARE(link.statistics(),
+             QString("reliable link: 2 recovered, 0 lost, 0 corrupt, 1 duplicate, 1 resend requests, 0 restarts"));
+}
+
+// Unanswered requests are repeated, and the gap is given up on after MaxDelayMs
+void ReliableLinkTest::gapIsRetriedThenLost()
+{
+    ReliableLink link;
+    send(link, 0, 0);
+    send(link, 2, 0);
+    link.countCorrupt();                // Reading 1 failed its checksum
+    QCOMPARE(requested(link), QVector<quint32>({1, 1}));
+
+    link.service((ReliableLink::RetryMs - 1) * Millisecond);
+    QCOMPARE(requested(link), QVector<quint32>());
+    link.service(ReliableLink::RetryMs * Millisecond);
+    QCOMPARE(requested(link), QVector<quint32>({1, 1}));
+    QCOMPARE(delivered(link), QVector<quint32>({0}));
+
+    link.service(ReliableLink::MaxDelayMs * Millisecond);
+    QCOMPARE(delivered(link), QVector<quint32>({2}));
+    QCOMPARE(requested(link), QVector<quint32>());
+    QCOMPARE(link.nextDeadlineNs(), qint64(-1));
+    QCOMPARE(link.statistics(),
+             QString("reliable link: 0 recovered, 1 lost, 1 corrupt, 0 duplicate, 2 resend requests, 0 restarts"));
+}
+
+// A dropout far longer than the window still counts every reading it lost
+void ReliableLinkTest::longDropoutIsCountedInFull()
+{
+    ReliableLink link;
+    for (quint32 sequence = 0; sequence < 10; ++sequence) send(link, sequence, 0);
+    send(link, 100000, Millisecond);
+    QCOMPARE(delivered(link), QVector<quint32>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+
+    // Only what the window can still hold is asked for
+    QCOMPARE(requested(link), QVector<quint32>({100000 - (ReliableLink::WindowSize - 1),
+                                                quint32(ReliableLink::WindowSize - 1)}));
+
+    link.service(Millisecond + ReliableLink::MaxDelayMs * Millisecond);
+    QCOMPARE(delivered(link), QVector<quint32>({100000}));
+    QCOMPARE(link.statistics(),
+             QString("reliable link: 0 recovered, 99990 lost, 0 corrupt, 0 duplicate, 1 resend requests, 0 restarts"));
+}
+
+// Sequence numbers run on across the 32 bit boundary
+void ReliableLinkTest::sequenceWrapsAround()
+{
+    ReliableLink link;
+    send(link, 0xFFFFFFFE, 0);
+    send(link, 1, 0);
+    QCOMPARE(requested(link), QVector<quint32>({0xFFFFFFFF, 2}));
+
+    send(link, 0, 0);
+    send(link, 0xFFFFFFFF, 0);
+    QCOMPARE(delivered(link), QVector<quint32>({0xFFFFFFFE, 0xFFFFFFFF, 0, 1}));
+    QCOMPARE(link.nextDeadlineNs(), qint64(-1));
+}
+
+// Numbers going back further than the window mean the board restarted
+void ReliableLinkTest::restartDeliversWhatIsHeld()
+{
+    ReliableLink link;
+    for (quint32 sequence = 1000; sequence < 1010; ++sequence) send(link, sequence, 0);
+    send(link, 1011, 0);                // Held behind 1010
+    send(link, 0, 0);
+    send(link, 1, 0);
+
+    QCOMPARE(delivered(link), QVector<quint32>({1000, 1001, 1002, 1003, 1004, 1005, 1006, 1007, 1008, 1009,
+                                                1011, 0, 1}));
+    QCOMPARE(link.nextDeadlineNs(), qint64(-1));
+    QCOMPARE(link.statistics(),
+             QString("reliable link: 0 recovered, 1 lost, 0 corrupt, 0 duplicate, 1 resend requests, 1 restarts"));
+
+    link.reset();
+    QVERIFY(!link.isActive());
+}
+
+QTEST_GUILESS_MAIN(ReliableLinkTest)
+#include "tst_reliablelink.moc"
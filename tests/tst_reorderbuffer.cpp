@@ -0,0 +1,210 @@
+// Include necessary headers
+#include <QtTest>                       // For the test framework
+#include "reorderbuffer.h"
+
+// Sequenced frames from a UDP bridge: what comes out, in which order, and
+// what is counted as lost, late, reordered or a restart
+class ReorderBufferTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void inOrderPassesStraightThrough();
+    void reorderedFramesAreSorted();
+    void gapTimesOut();
+    void gapPushedOutOfTheWindow();
+    void longOutageIsCountedInFull();
+    void sequenceWrapsAround();
+    void lateAndDuplicateFramesAreDropped();
+    void restartDeliversWhatIsHeld();
+    void orderedTransportCountsGaps();
+};
+
+static const int Window = 64;
+static const int TimeoutMs = 20;
+static const qint64 Millisecond = 1000000;
+
+// Sequence numbers are carried in the first raw value so the output order can be checked
+static void send(ReorderBuffer &buffer, quint32 sequence, qint64 timeNs)
+{
+    SensorFrame frame;
+    frame.raw[0] = int(sequence);
+    buffer.accept(sequence, frame, timeNs, timeNs);
+}
+
+// The sequence numbers delivered so far
+static QVector<quint32> delivered(ReorderBuffer &buffer, QVector<qint64> *times = nullptr)
+{
+    QVector<quint32> sequences;
+    ReorderBuffer::Delivery delivery;
+    while (buffer.takeDelivery(delivery)) {
+        sequences.append(quint32(delivery.frame.raw[0]));
+        if (times) times->append(delivery.timestampNs);
+    }
+    return sequences;
+}
+
+void ReorderBufferTest::inOrderPassesStraightThrough()
+{
+    ReorderBuffer buffer(Window, TimeoutMs);
+    for (quint32 sequence = 100; sequence < 110; ++sequence) send(buffer, sequence, sequence * Millisecond);
+
+    QCOMPARE(delivered(buffer), QVector<quint32>({100, 101, 102, 103, 104, 105, 106, 107, 108, 109}));
+    QCOMPARE(buffer.nextDeadlineNs(), qint64(-1));
+    QCOMPARE(buffer.statistics(), QString("0 lost, 0 reordered, 0 late, 0 duplicate, 0 restarts"));
+}
+
+// A frame that overtook another waits for it; timestamps stay monotonic
+void ReorderBufferTest::reorderedFramesAreSorted()
+{
+    ReorderBuffer buffer(Window, TimeoutMs);
+    send(buffer, 0, 10 * Millisecond);
+    send(buffer, 2, 11 * Millisecond);
+    QCOMPARE(buffer.nextDeadlineNs(), 11 * Millisecond + TimeoutMs * Millisecond);
+    send(buffer, 1, 12 * Millisecond);
+    send(buffer, 3, 13 * Millisecond);
+
+    QVector<qint64> times;
+    QCOMPARE(delivered(buffer, &times), QVector<quint32>({0, 1, 2, 3}));
+    QCOMPARE(times, QVector<qint64>({10 * Millisecond, 12 * Millisecond, 12 * Millisecond, 13 * Millisecond}));
+    QCOMPARE(buffer.reorderedFrames(), quint64(1));
+    QCOMPARE(buffer.lostFrames(), quint64(0));
+    QCOMPARE(buffer.nextDeadlineNs(), qint64(-1));
+}
+
+// A missing frame is waited for the timeout, then counted as lost
+void ReorderBufferTest::gapTimesOut()
+{
+    ReorderBuffer buffer(Window, TimeoutMs);
+    send(buffer, 0, 0);
+    send(buffer, 3, 1 * Millisecond);
+    send(buffer, 4, 2 * Millisecond);
+    QCOMPARE(delivered(buffer), QVector<quint32>({0}));
+
+    buffer.service(20 * Millisecond);
+    QCOMPARE(delivered(buffer), QVector<quint32>());
+    buffer.service(21 * Millisecond);
+    QCOMPARE(delivered(buffer), QVector<quint32>({3, 4}));
+    QCOMPARE(buffer.lostFrames(), quint64(2));
+    QCOMPARE(buffer.nextDeadlineNs(), qint64(-1));
+
+    // The lost frames turning up afterwards are late
+    send(buffer, 1, 30 * Millisecond);
+    QCOMPARE(buffer.lateFrames(), quint64(1));
+    QCOMPARE(delivered(buffer), QVector<quint32>());
+}
+
+// A frame a window ahead of a gap gives up on the gap without waiting
+void ReorderBufferTest::gapPushedOutOfTheWindow()
+{
+    ReorderBuffer buffer(Window, TimeoutMs);
+    send(buffer, 0, 0);
+    send(buffer, 2, 0);
+    send(buffer, 2 + Window, 0);
+    QCOMPARE(delivered(buffer), QVector<quint32>({0, 2}));
+    QCOMPARE(buffer.lostFrames(), quint64(1));
+
+    // Frames 3 to 65 are still waited for
+    buffer.service(TimeoutMs * Millisecond);
+    QCOMPARE(delivered(buffer), QVector<quint32>({2 + Window}));
+    QCOMPARE(buffer.lostFrames(), quint64(Window));
+}
+
+// An outage far longer than the window still counts every frame it lost
+void ReorderBufferTest::longOutageIsCountedInFull()
+{
+    ReorderBuffer buffer(Window, TimeoutMs);
+    for (quint32 sequence = 0; sequence < 10; ++sequence) send(buffer, sequence, 0);
+    send(buffer, 5, 0);                                 // Late, not a restart
+    send(buffer, 11, 0);                                // Held behind 10
+    send(buffer, 1000000, Millisecond);
+    send(buffer, 1000001, Millisecond);
+
+    QVector<quint32> expected = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 11};
+    QCOMPARE(delivered(buffer), expected);
+    buffer.service(Millisecond + TimeoutMs * Millisecond);
+    QCOMPARE(delivered(buffer), QVector<quint32>({1000000, 1000001}));
+
+    QCOMPARE(buffer.lostFrames(), quint64(1000000 - 11));
+    QCOMPARE(buffer.lateFrames(), quint64(1));
+    QCOMPARE(buffer.restartCount(), quint64(0));
+}
+
+// Sequence numbers run on across the 32 bit boundary
+void ReorderBufferTest::sequenceWrapsAround()
+{
+    ReorderBuffer buffer(Window, TimeoutMs);
+    send(buffer, 0xFFFFFFFE, 0);
+    send(buffer, 0, 0);
+    send(buffer, 0xFFFFFFFF, 0);
+    send(buffer, 2, 0);
+    send(buffer, 1, 0);
+
+    QCOMPARE(delivered(buffer), QVector<quint32>({0xFFFFFFFE, 0xFFFFFFFF, 0, 1, 2}));
+    QCOMPARE(buffer.reorderedFrames(), quint64(2));
+    QCOMPARE(buffer.lostFrames(), quint64(0));
+    QCOMPARE(buffer.restartCount(), quint64(0));
+
+    // A gap across the boundary is counted like any other
+    ReorderBuffer gapped(Window, TimeoutMs);
+    send(gapped, 0xFFFFFFF0, 0);
+    send(gapped, 0x10, 0);
+    gapped.service(TimeoutMs * Millisecond);
+    QCOMPARE(delivered(gapped), QVector<quint32>({0xFFFFFFF0, 0x10}));
+    QCOMPARE(gapped.lostFrames(), quint64(0x1F));
+}
+
+void ReorderBufferTest::lateAndDuplicateFramesAreDropped()
+{
+    ReorderBuffer buffer(Window, TimeoutMs);
+    send(buffer, 0, 0);
+    send(buffer, 1, 0);
+    send(buffer, 3, 0);
+    send(buffer, 3, 0);                                 // Duplicate while held
+    send(buffer, 1, 0);                                 // Delivered already
+    send(buffer, 2, 0);
+
+    QCOMPARE(delivered(buffer), QVector<quint32>({0, 1, 2, 3}));
+    QCOMPARE(buffer.duplicateFrames(), quint64(1));
+    QCOMPARE(buffer.lateFrames(), quint64(1));
+    QCOMPARE(buffer.lostFrames(), quint64(0));
+}
+
+// Numbers going back further than the window mean the bridge restarted
+void ReorderBufferTest::restartDeliversWhatIsHeld()
+{
+    ReorderBuffer buffer(Window, TimeoutMs);
+    for (quint32 sequence = 1000; sequence < 1010; ++sequence) send(buffer, sequence, 0);
+    send(buffer, 1011, 0);                              // Held behind 1010
+    send(buffer, 0, 0);
+    send(buffer, 1, 0);
+
+    QCOMPARE(delivered(buffer), QVector<quint32>({1000, 1001, 1002, 1003, 1004, 1005, 1006, 1007, 1008, 1009,
+                                                  1011, 0, 1}));
+    QCOMPARE(buffer.restartCount(), quint64(1));
+    QCOMPARE(buffer.lostFrames(), quint64(1));          // 1010, never seen
+    QCOMPARE(buffer.lateFrames(), quint64(0));
+    QCOMPARE(buffer.nextDeadlineNs(), qint64(-1));
+
+    buffer.reset();
+    QVERIFY(!buffer.isActive());
+    QCOMPARE(buffer.statistics(), QString("0 lost, 0 reordered, 0 late, 0 duplicate, 0 restarts"));
+}
+
+// Over TCP nothing is held: a jump is loss at once
+void ReorderBufferTest::orderedTransportCountsGaps()
+{
+    ReorderBuffer buffer(1, TimeoutMs);
+    send(buffer, 0, 0);
+    send(buffer, 1, 0);
+    send(buffer, 5, 0);
+    send(buffer, 100000, 0);
+    send(buffer, 100001, 0);
+
+    QCOMPARE(delivered(buffer), QVector<quint32>({0, 1, 5, 100000, 100001}));
+    QCOMPARE(buffer.lostFrames(), quint64(3 + 99994));
+    QCOMPARE(buffer.nextDeadlineNs(), qint64(-1));
+}
+
+QTEST_GUILESS_MAIN(ReorderBufferTest)
+#include "tst_reorderbuffer.moc"
@@ -0,0 +1,439 @@
+// Include necessary headers
+#include "timestampjoin.h"
+#include "sensorframe.h"                // For parsing timestamps and values
+#include <QDateTime>                    // For the local UTC offset
+#include <QElapsedTimer>                // For timing the join
+#include <QFile>                        // For mapping the recording
+#include <QSaveFile>                    // For atomic output writes
+#include <algorithm>                    // For std::stable_sort
+#include <cmath>                        // For floor
+#include <cstring>                      // For memchr
+#include <limits>
+#include <vector>
+
+namespace {
+
+// Output is written in pieces of about this size
+const int FlushBytes = 1024 * 1024;
+
+// One log timestamp with its position in the log
+struct Frame {
+    double ms;
+    qint64 index;
+    bool sinceStart;                    // ms counts from the recording start
+};
+
+// One recording row held while matching
+struct Row {
+    double ms = 0;
+    const char *timestamp = nullptr;    // Timestamp text as written in the recording
+    int timestampLength = 0;
+    const char *values = nullptr;       // Remaining columns, without the leading comma
+    int valuesLength = 0;
+    std::vector<double> parsed;         // Only filled when interpolating
+};
+
+// Walks the data rows of a mapped recording in file order
+class RowReader
+{
+public:
+    RowReader(const char *data, qint64 begin, qint64 end, int valueColumns, bool parseValues)
+        : data(data), position(begin), end(end), valueColumns(valueColumns), parseValues(parseValues) {}
+
+    // Read the next usable row; rows earlier than the previous one are skipped
+    bool next(Row &row, double notBefore)
+    {
+        while (position < end) {
+            const char *line = data + position;
+            const char *newline = static_cast<const char *>(std::memchr(line, '\n', size_t(end - position)));
+            qint64 length = newline ? newline - line : end - position;
+            position += length + 1;
+            if (length > 0 && line[length - 1] == '\r') --length;
+            if (length == 0) continue;
+
+            if (parse(line, length, row) && row.ms >= notBefore) {
+                ++rows;
+                return true;
+            }
+            ++skipped;
+        }
+        return false;
+    }
+
+    qint64 rows = 0;
+    qint64 skipped = 0;
+
+private:
+    bool parse(const char *line, qint64 length, Row &row)
+    {
+        const char *comma = static_cast<const char *>(std::memchr(line, ',', size_t(length)));
+        if (!comma) return false;
+        if (!parseTimestampText(line, comma - line, row.ms)) return false;
+
+        row.timestamp = line;
+        row.timestampLength = int(comma - line);
+        row.values = comma + 1;
+        row.valuesLength = int(line + length - row.values);
+        if (std::count(row.values, row.values + row.valuesLength, ',') != valueColumns - 1) return false;
+        if (!parseValues) return true;
+
+        // Interpolation needs every value as a number
+        row.parsed.resize(size_t(valueColumns));
+        const char *field = row.values;
+        const char *valuesEnd = row.values + row.valuesLength;
+        for (int column = 0; column < valueColumns; ++column) {
+            const char *fieldEnd = static_cast<const char *>(std::memchr(field, ',', size_t(valuesEnd - field)));
+            if (!fieldEnd) fieldEnd = valuesEnd;
+            if (!parseRecordingNumber(field, fieldEnd - field, row.parsed[size_t(column)])) return false;
+            field = fieldEnd + 1;
+        }
+        return true;
+    }
+
+    const char *data;
+    qint64 position;
+    qint64 end;
+    int valueColumns;
+    bool parseValues;
+};
+
+// Date for a count of days since 1970-01-01 (inverse of the parser's conversion)
+void civilFromDays(qint64 days, int &year, int &month, int &day)
+{
+    days += 719468;
+    const qint64 era = (days >= 0 ? days : days - 146096) / 146097;
+    const qint64 dayOfEra = days - era * 146097;
+    const qint64 yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const qint64 dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const qint64 monthIndex = (5 * dayOfYear + 2) / 153;
+    day = int(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    month = int(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+    year = int(yearOfEra + era * 400 + (month <= 2));
+}
+
+// Append digits with leading zeros
+void appendDigits(QByteArray &out, qint64 value, int digits)
+{
+    char buffer[8];
+    for (int i = digits - 1; i >= 0; --i) {
+        buffer[i] = char('0' + value % 10);
+        value /= 10;
+    }
+    out.append(buffer, digits);
+}
+
+// Append a timestamp in the recording's "yyyy-MM-dd HH:mm:ss.zzz" format
+void appendTimestamp(QByteArray &out, double ms)
+{
+    qint64 total = qint64(std::floor(ms + 0.5));
+    qint64 days = total >= 0 ? total / 86400000 : (total - 86399999) / 86400000;
+    qint64 ofDay = total - days * 86400000;
+
+    int year, month, day;
+    civilFromDays(days, year, month, day);
+    appendDigits(out, year, 4);
+    out.append('-');
+    appendDigits(out, month, 2);
+    out.append('-');
+    appendDigits(out, day, 2);
+    out.append(' ');
+    appendDigits(out, ofDay / 3600000, 2);
+    out.append(':');
+    appendDigits(out, ofDay / 60000 % 60, 2);
+    out.append(':');
+    appendDigits(out, ofDay / 1000 % 60, 2);
+    out.append('.');
+    appendDigits(out, ofDay % 1000, 3);
+}
+
+// UTC offsets only change on a quarter hour, so one lookup serves every
+// timestamp of the same quarter hour
+const qint64 OffsetSlotMs = 15 * 60 * 1000;
+
+// Converts plain-number log timestamps to the recording's local wall-clock time
+struct LogClock {
+    TimestampJoin::TimeBase timeBase;
+    qint64 offsetSlot = std::numeric_limits<qint64>::min();
+    double utcOffsetMs = 0;
+
+    // Local time of a Unix time, with the UTC offset in force at that moment
+    // (a log that crosses a daylight saving change keeps the right hour)
+    double localMs(double unixMs)
+    {
+        qint64 slot = qint64(std::floor(unixMs / OffsetSlotMs));
+        if (slot != offsetSlot) {
+            utcOffsetMs = QDateTime::fromMSecsSinceEpoch(qint64(unixMs)).offsetFromUtc() * 1000.0;
+            offsetSlot = slot;
+        }
+        return unixMs + utcOffsetMs;
+    }
+};
+
+// Read a log field as a timestamp; date text is taken as local time, plain
+// numbers as the log clock's time base says. Times since the recording start
+// are returned as they are, with sinceStart set; the caller adds the start.
+bool parseLogTimestamp(const char *text, qint64 length, double &ms, bool &sinceStart, LogClock &clock)
+{
+    sinceStart = false;
+    if (parseTimestampText(text, length, ms)) return true;
+
+    double value;
+    if (!parseRecordingNumber(text, length, value) || !std::isfinite(value)) return false;
+    sinceStart = clock.timeBase != TimestampJoin::TimeUnix;
+    switch (clock.timeBase) {
+    case TimestampJoin::TimeStartSeconds:      ms = value * 1000.0; return true;
+    case TimestampJoin::TimeStartMilliseconds: ms = value; return true;
+    case TimestampJoin::TimeStartMicroseconds: ms = value / 1000.0; return true;
+    default: break;
+    }
+
+    if (value > 1e14) ms = value / 1000.0;          // Microseconds
+    else if (value > 1e11) ms = value;              // Milliseconds
+    else ms = value * 1000.0;                       // Seconds
+    ms = clock.localMs(ms);                         // Recordings hold local wall-clock time
+    return true;
+}
+
+// Read every timestamp of the log
+bool readLog(const QString &fileName, int column, TimestampJoin::TimeBase timeBase, std::vector<Frame> &frames,
+             QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) *errorString = "Cannot open timestamp log: " + file.errorString();
+        return false;
+    }
+    const QByteArray contents = file.readAll();
+    const char *data = contents.constData();
+    const qint64 size = contents.size();
+
+    LogClock clock;
+    clock.timeBase = timeBase;
+    qint64 lineNumber = 0;
+    qint64 position = 0;
+    while (position < size) {
+        const char *line = data + position;
+        const char *newline = static_cast<const char *>(std::memchr(line, '\n', size_t(size - position)));
+        qint64 length = newline ? newline - line : size - position;
+        position += length + 1;
+        ++lineNumber;
+
+        // Pick out the timestamp column; commas, semicolons and tabs all separate fields
+        const char *field = line;
+        const char *lineEnd = line + length;
+        for (int i = 0; i < column && field < lineEnd; ++i) {
+            while (field < lineEnd && *field != ',' && *field != ';' && *field != '\t') ++field;
+            if (field < lineEnd) ++field;
+        }
+        const char *fieldEnd = field;
+        while (fieldEnd < lineEnd && *fieldEnd != ',' && *fieldEnd != ';' && *fieldEnd != '\t') ++fieldEnd;
+
+        // Ignore surrounding blanks and quotes
+        while (field < fieldEnd && (*field == ' ' || *field == '"')) ++field;
+        while (fieldEnd > field && (fieldEnd[-1] == ' ' || fieldEnd[-1] == '"' || fieldEnd[-1] == '\r')) --fieldEnd;
+        if (field == fieldEnd && fieldEnd == lineEnd) continue;     // Blank line
+
+        double ms;
+        bool sinceStart;
+        if (!parseLogTimestamp(field, fieldEnd - field, ms, sinceStart, clock)) {
+            if (frames.empty() && lineNumber == 1) continue;        // Header line
+            if (errorString) *errorString = QString("Unreadable timestamp on log line %1").arg(lineNumber);
+            return false;
+        }
+        frames.push_back(Frame{ms, qint64(frames.size()), sinceStart});
+    }
+
+    if (frames.empty()) {
+        if (errorString) *errorString = "Timestamp log contains no timestamps";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// Parse a mode name as used on the command line
+TimestampJoin::Mode TimestampJoin::modeFromName(const QString &name, bool *ok)
+{
+    if (ok) *ok = true;
+    if (name == "asof") return ModeAsOf;
+    if (name == "nearest") return ModeNearest;
+    if (name == "interpolate") return ModeInterpolate;
+    if (ok) *ok = false;
+    return ModeAsOf;
+}
+
+const char *TimestampJoin::modeName(Mode mode)
+{
+    switch (mode) {
+    case ModeNearest:     return "nearest";
+    case ModeInterpolate: return "interpolate";
+    default:              return "asof";
+    }
+}
+
+// Parse a time base name as used on the command line
+TimestampJoin::TimeBase TimestampJoin::timeBaseFromName(const QString &name, bool *ok)
+{
+    if (ok) *ok = true;
+    if (name == "unix") return TimeUnix;
+    if (name == "s") return TimeStartSeconds;
+    if (name == "ms") return TimeStartMilliseconds;
+    if (name == "us") return TimeStartMicroseconds;
+    if (ok) *ok = false;
+    return TimeUnix;
+}
+
+const char *TimestampJoin::timeBaseName(TimeBase timeBase)
+{
+    switch (timeBase) {
+    case TimeStartSeconds:      return "s";
+    case TimeStartMilliseconds: return "ms";
+    case TimeStartMicroseconds: return "us";
+    default:                    return "unix";
+    }
+}
+
+// One line description of a finished join
+QString TimestampJoin::Summary::text() const
+{
+    return QString("%1 of %2 frames matched against %3 sensor rows (%4 skipped) in %5 ms")
+        .arg(matched).arg(frames).arg(sensorRows).arg(skippedRows).arg(elapsedMs);
+}
+
+// Join the log against the recording
+bool TimestampJoin::run(const QString &recordingName, const QString &timestampsName, const QString &outputName,
+                        const Options &options, Summary *summary, QString *errorString)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // Log timestamps are sorted once; the recording is already in time order
+    std::vector<Frame> frames;
+    if (!readLog(timestampsName, options.timestampColumn, options.timeBase, frames, errorString)) return false;
+    for (Frame &frame : frames) frame.ms += options.offsetMs;
+
+    // Map the recording so that rows are read straight from the page cache
+    QFile recording(recordingName);
+    if (!recording.open(QIODevice::ReadOnly)) {
+        if (errorString) *errorString = "Cannot open recording: " + recording.errorString();
+        return false;
+    }
+    const qint64 size = recording.size();
+    const uchar *mapped = size > 0 ? recording.map(0, size) : nullptr;
+    if (!mapped) {
+        if (errorString) *errorString = "Cannot map recording: " + recording.errorString();
+        return false;
+    }
+    const char *data = reinterpret_cast<const char *>(mapped);
+
+    const char *headerEnd = static_cast<const char *>(std::memchr(data, '\n', size_t(size)));
+    QByteArray header = headerEnd ? QByteArray(data, int(headerEnd - data)).trimmed() : QByteArray();
+    if (!header.startsWith("Timestamp,")) {
+        if (errorString) *errorString = "Unsupported recording format (no CSV header)";
+        return false;
+    }
+    const QByteArray valueHeader = header.mid(int(sizeof("Timestamp,") - 1));
+    const int valueColumns = valueHeader.count(',') + 1;
+
+    QSaveFile output(outputName);
+    if (!output.open(QIODevice::WriteOnly)) {
+        if (errorString) *errorString = "Cannot create output: " + output.errorString();
+        return false;
+    }
+
+    QByteArray buffer;
+    buffer.reserve(FlushBytes + 4096);
+    buffer.append("Frame,Ultrasound Timestamp,Sensor Timestamp,Delta ms,");
+    buffer.append(valueHeader);
+    buffer.append('\n');
+
+    // Two-pointer pass: prev is the last row at or before the frame, next the first row after it
+    const bool interpolate = options.mode == ModeInterpolate;
+    RowReader reader(data, (headerEnd - data) + 1, size, valueColumns, interpolate);
+    Row prev, next;
+    bool havePrev = false;
+    bool haveNext = reader.next(next, -std::numeric_limits<double>::infinity());
+
+    // Times since the recording start count from its first usable row; only
+    // then can the log be put in time order
+    if (haveNext) {
+        for (Frame &frame : frames) {
+            if (frame.sinceStart) frame.ms += next.ms;
+        }
+    }
+    std::stable_sort(frames.begin(), frames.end(), [](const Frame &a, const Frame &b) { return a.ms < b.ms; });
+    qint64 matched = 0;
+
+    for (const Frame &frame : frames) {
+        while (haveNext && next.ms <= frame.ms) {
+            std::swap(prev, next);
+            havePrev = true;
+            haveNext = reader.next(next, prev.ms);
+        }
+
+        // Pick the sensor row(s) for this frame
+        const Row *match = nullptr;
+        double distance = 0;
+        if (options.mode == ModeAsOf) {
+            if (havePrev) match = &prev;
+        } else if (options.mode == ModeNearest) {
+            if (havePrev && (!haveNext || frame.ms - prev.ms <= next.ms - frame.ms)) match = &prev;
+            else if (haveNext) match = &next;
+        } else if (havePrev && (haveNext || prev.ms == frame.ms)) {
+            match = &prev;
+            distance = prev.ms == frame.ms ? 0 : qMax(frame.ms - prev.ms, next.ms - frame.ms);
+        }
+        if (match && !interpolate) distance = qAbs(match->ms - frame.ms);
+        if (match && options.toleranceMs >= 0 && distance > options.toleranceMs) match = nullptr;
+
+        buffer.append(QByteArray::number(frame.index));
+        buffer.append(',');
+        appendTimestamp(buffer, frame.ms);
+        buffer.append(',');
+
+        if (!match) {
+            // Unmatched frames keep their row with empty values
+            buffer.append(QByteArray(valueColumns + 1, ','));
+        } else {
+            buffer.append(match->timestamp, match->timestampLength);
+            buffer.append(',');
+            buffer.append(QByteArray::number(match->ms - frame.ms, 'f', 3));
+            buffer.append(',');
+
+            if (interpolate && match->ms != frame.ms) {
+                double weight = (frame.ms - prev.ms) / (next.ms - prev.ms);
+                for (int column = 0; column < valueColumns; ++column) {
+                    double a = prev.parsed[size_t(column)];
+                    double b = next.parsed[size_t(column)];
+                    if (column > 0) buffer.append(',');
+                    buffer.append(QByteArray::number(a + (b - a) * weight, 'g', 10));
+                }
+            } else {
+                buffer.append(match->values, match->valuesLength);
+            }
+            ++matched;
+        }
+        buffer.append('\n');
+
+        if (buffer.size() >= FlushBytes) {
+            output.write(buffer);
+            buffer.clear();
+        }
+    }
+
+    output.write(buffer);
+    if (!output.commit()) {
+        if (errorString) *errorString = "Cannot write output: " + output.errorString();
+        return false;
+    }
+
+    if (summary) {
+        summary->frames = qint64(frames.size());
+        summary->matched = matched;
+        summary->sensorRows = reader.rows;
+        summary->skippedRows = reader.skipped;
+        summary->elapsedMs = timer.elapsed();
+    }
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef TIMESTAMPJOIN_H
+#define TIMESTAMPJOIN_H
+
+#include <QString>
+
+// Matches the frames of an external timestamp log (e.g. the ultrasound
+// system's per-frame log) to rows of a sensor recording in one linear pass
+class TimestampJoin
+{
+public:
+    enum Mode {
+        ModeAsOf,                       // Last sensor row at or before the frame
+        ModeNearest,                    // Closest sensor row either side
+        ModeInterpolate                 // Linear between the rows either side
+    };
+
+    // What a log timestamp written as a plain number counts from
+    enum TimeBase {
+        TimeUnix,                       // Unix time in s, ms or us, told apart by magnitude
+        TimeStartSeconds,               // Seconds since the first recording row
+        TimeStartMilliseconds,          // Milliseconds since the first recording row
+        TimeStartMicroseconds           // Microseconds since the first recording row
+    };
+
+    struct Options {
+        Mode mode = ModeAsOf;
+        double offsetMs = 0;            // Added to every log timestamp before matching
+        double toleranceMs = -1;        // Farthest allowed sensor row (-1 = no limit)
+        int timestampColumn = 0;        // Column of the log holding the timestamp
+        TimeBase timeBase = TimeUnix;   // How plain-number timestamps are read
+    };
+
+    struct Summary {
+        qint64 frames = 0;              // Timestamps read from the log
+        qint64 matched = 0;             // Frames that received sensor values
+        qint64 sensorRows = 0;          // Recording rows used for matching
+        qint64 skippedRows = 0;         // Malformed or out-of-order recording rows
+        qint64 elapsedMs = 0;
+
+        QString text() const;
+    };
+
+    static Mode modeFromName(const QString &name, bool *ok = nullptr);
+    static const char *modeName(Mode mode);
+    static TimeBase timeBaseFromName(const QString &name, bool *ok = nullptr);
+    static const char *timeBaseName(TimeBase timeBase);
+
+    // Write one output row per log timestamp, in time order
+    static bool run(const QString &recordingName, const QString &timestampsName, const QString &outputName,
+                    const Options &options, Summary *summary = nullptr, QString *errorString = nullptr);
+};
+
+#endif // TIMESTAMPJOIN_H
@@ -0,0 +1,259 @@
+// Include necessary headers
+#include "triggergroup.h"
+#include <QMutexLocker>                 // For the statistics shared with the GUI
+#include <QSerialPort>                  // For the trigger outputs
+#include <QStringList>                  // For parsing device lines
+#include <algorithm>                    // For ordering the devices by offset
+
+// Left to busy waiting before a write; sleeping is not precise enough below this
+static const qint64 SpinNs = 1000000;
+
+// Longest an offset may be, so a typo cannot hold the group thread for seconds
+static const double MaxOffsetMs = 100;
+
+// TriggerGroup constructor
+TriggerGroup::TriggerGroup(QObject *parent)
+    : QObject(parent)
+    , clock(Clock::system())
+    , worker(new QObject)
+    , maxOffsetMs(0)
+    , opened(false)
+    , fires(0)
+    , lateFires(0)
+    , worstLateness(0)
+{
+    worker->moveToThread(&thread);
+    thread.setObjectName("TriggerGroup");
+    thread.start(QThread::TimeCriticalPriority);
+}
+
+// TriggerGroup destructor
+TriggerGroup::~TriggerGroup()
+{
+    close();
+    thread.quit();
+    thread.wait();
+    delete worker;
+}
+
+// Parse device lines
+bool TriggerGroup::parseDevices(const QString &text, QVector<TriggerDevice> &devices, QString *errorString)
+{
+    devices.clear();
+    QStringList lines = text.split("\n");
+
+    for (int i = 0; i < lines.size(); ++i) {
+        QString line = lines[i];
+        int comment = line.indexOf('#');
+        if (comment >= 0) line = line.left(comment);
+        line = line.trimmed();
+        if (line.isEmpty()) continue;
+
+        int separator = line.indexOf('=');
+        QStringList parts = line.mid(separator + 1).split(";");
+        TriggerDevice device;
+        device.name = separator < 0 ? QString() : line.left(separator).trimmed();
+        device.portName = parts[0].trimmed();
+        if (device.name.isEmpty() || device.portName.isEmpty()) {
+            if (errorString) *errorString = QString("Line %1: expected 'name = port'").arg(i + 1);
+            return false;
+        }
+
+        // Options after the port
+        for (int part = 1; part < parts.size(); ++part) {
+            QString option = parts[part].trimmed();
+            bool ok = true;
+            if (option.isEmpty()) {
+                continue;
+            } else if (option.startsWith("offset=")) {
+                device.offsetMs = option.mid(7).toDouble(&ok);
+                ok = ok && device.offsetMs >= 0 && device.offsetMs <= MaxOffsetMs;
+            } else if (option.startsWith("send=")) {
+                device.command = option.mid(5).toUtf8();
+                ok = !device.command.isEmpty();
+            } else {
+                ok = false;
+            }
+
+            if (!ok) {
+                if (errorString) *errorString = QString("Line %1: invalid option '%2'").arg(i + 1).arg(option);
+                return false;
+            }
+        }
+
+        for (const TriggerDevice &other : devices) {
+            if (other.name == device.name || other.portName == device.portName) {
+                if (errorString) *errorString = QString("Line %1: %2 is used twice").arg(i + 1)
+                                                    .arg(other.name == device.name ? device.name : device.portName);
+                return false;
+            }
+        }
+        devices.append(device);
+    }
+
+    if (devices.size() > MaxDevices) {
+        if (errorString) *errorString = QString("At most %1 trigger devices are supported").arg(MaxDevices);
+        return false;
+    }
+    return true;
+}
+
+// Format devices so that parseDevices() reads them back unchanged
+QString TriggerGroup::formatDevices(const QVector<TriggerDevice> &devices)
+{
+    QStringList lines;
+    for (const TriggerDevice &device : devices) {
+        QString line = device.name + " = " + device.portName;
+        if (device.offsetMs != 0) line += QString("; offset=%1").arg(device.offsetMs);
+        if (device.command != "1") line += "; send=" + QString::fromUtf8(device.command);
+        lines << line;
+    }
+    return lines.join("\n");
+}
+
+// Open all ports
+bool TriggerGroup::open(const QVector<TriggerDevice> &devices, QString *errorString)
+{
+    close();
+    if (devices.isEmpty()) {
+        if (errorString) *errorString = "No trigger devices are defined";
+        return false;
+    }
+
+    // Write the device that needs the most time first
+    configured = devices;
+    std::stable_sort(configured.begin(), configured.end(),
+                     [](const TriggerDevice &a, const TriggerDevice &b) { return a.offsetMs > b.offsetMs; });
+    maxOffsetMs = configured.first().offsetMs;
+
+    // The ports must be created on the thread that writes to them
+    bool success = false;
+    QString error;
+    QMetaObject::invokeMethod(worker, [&]() { success = openPorts(&error); }, Qt::BlockingQueuedConnection);
+    if (!success) {
+        if (errorString) *errorString = error;
+        return false;
+    }
+
+    report(true);
+    opened = true;
+    return true;
+}
+
+// Close all ports
+void TriggerGroup::close()
+{
+    if (!opened) return;
+    opened = false;
+    QMetaObject::invokeMethod(worker, [this]() { closePorts(); }, Qt::BlockingQueuedConnection);
+}
+
+// Queue a fire on the group's thread
+void TriggerGroup::fire(qint64 triggerNs)
+{
+    if (!opened) return;
+    QMetaObject::invokeMethod(worker, [this, triggerNs]() { firePorts(triggerNs); }, Qt::QueuedConnection);
+}
+
+// Latest write since the last call
+qint64 TriggerGroup::takeWorstLatenessNs()
+{
+    QMutexLocker locker(&statsMutex);
+    qint64 worst = worstLateness;
+    worstLateness = 0;
+    return worst;
+}
+
+// Report the statistics since the last reset
+QString TriggerGroup::report(bool reset)
+{
+    QMutexLocker locker(&statsMutex);
+    QString text = QString("Trigger group: %1 devices, %2 fires, %3 late")
+                       .arg(deviceCount()).arg(fires).arg(lateFires);
+    text += "\n" + skew.format("skew");
+    text += "\n" + lateness.format("late");
+    if (reset) {
+        fires = 0;
+        lateFires = 0;
+        skew.clear();
+        lateness.clear();
+    }
+    return text;
+}
+
+// Create and open the ports (group thread)
+bool TriggerGroup::openPorts(QString *errorString)
+{
+    for (const TriggerDevice &device : configured) {
+        QSerialPort *port = new QSerialPort(worker);
+        port->setPortName(device.portName);
+        port->setBaudRate(QSerialPort::Baud115200);         // Same settings as the Pico port
+        port->setDataBits(QSerialPort::Data8);
+        port->setParity(QSerialPort::NoParity);
+        port->setStopBits(QSerialPort::OneStop);
+        port->setFlowControl(QSerialPort::NoFlowControl);
+        ports.append(port);
+
+        if (!port->open(QIODevice::WriteOnly)) {
+            if (errorString) *errorString = QString("%1 (%2): %3").arg(device.name, device.portName, port->errorString());
+            closePorts();
+            return false;
+        }
+
+        // A vanished port stops the group rather than leaving the other outputs firing alone
+        connect(port, &QSerialPort::errorOccurred, worker, [this, port, device](QSerialPort::SerialPortError error) {
+            if (error != QSerialPort::ResourceError) return;
+            QString reason = QString("%1 (%2): %3").arg(device.name, device.portName, port->errorString());
+            closePorts();
+            emit failed(reason);
+        });
+    }
+    return true;
+}
+
+// Close and delete the ports (group thread)
+void TriggerGroup::closePorts()
+{
+    for (QSerialPort *port : ports) {
+        port->close();
+        port->deleteLater();
+    }
+    ports.clear();
+}
+
+// Write every device's command at its time (group thread)
+void TriggerGroup::firePorts(qint64 triggerNs)
+{
+    if (ports.isEmpty()) return;
+
+    qint64 earliest = 0, latest = 0;
+    bool late = false;
+    for (int index = 0; index < ports.size(); ++index) {
+        qint64 target = triggerNs - qint64(configured[index].offsetMs * 1e6);
+        if (clock->nowNs() > target) late = true;
+        waitUntil(target);
+
+        ports[index]->write(configured[index].command);
+        ports[index]->flush();          // Hand the bytes to the driver now, not on the next event
+        qint64 error = clock->nowNs() - target;
+
+        if (index == 0 || error < earliest) earliest = error;
+        if (index == 0 || error > latest) latest = error;
+    }
+
+    QMutexLocker locker(&statsMutex);
+    fires++;
+    if (late) lateFires++;
+    skew.add(latest - earliest);
+    lateness.add(latest);
+    worstLateness = qMax(worstLateness, latest);
+}
+
+// Sleep until shortly before ns, then spin (group thread)
+void TriggerGroup::waitUntil(qint64 ns) const
+{
+    qint64 remaining = ns - clock->nowNs();
+    if (remaining > SpinNs) QThread::usleep((remaining - SpinNs) / 1000);
+    while (clock->nowNs() < ns) {
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef TRIGGERGROUP_H
+#define TRIGGERGROUP_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include "clock.h"
+#include "latencymonitor.h"
+
+class QSerialPort;
+
+// One trigger output of a group (a microcontroller on its own serial port)
+struct TriggerDevice
+{
+    QString name;
+    QString portName;
+    double offsetMs = 0;                // Calibrated output latency: the command is written this much earlier
+    QByteArray command = "1";
+};
+
+// Several trigger outputs (e.g. ultrasound, lighting and camera) fired as one.
+// The ports are owned by a thread of their own, so firing never waits for the
+// GUI. A fire is requested for a time a little in the future; each device's
+// command is written at that time minus its offset, the last stretch busy
+// waited, so that the outputs line up once the offsets are calibrated.
+//
+// Skew is measured on the host: for each fire, the spread between the devices
+// of how late their writes completed against their targets. It includes the
+// write time of every port, but not what happens after the bytes leave.
+class TriggerGroup : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int MaxDevices = 8;
+
+    // How far ahead of the trigger time fire() should be called, beyond the largest offset
+    static const qint64 LeadNs = 2000000;
+
+    explicit TriggerGroup(QObject *parent = nullptr);
+    ~TriggerGroup();
+
+    // Convert between devices and "name = port; offset=0.35; send=1" lines
+    static bool parseDevices(const QString &text, QVector<TriggerDevice> &devices, QString *errorString = nullptr);
+    static QString formatDevices(const QVector<TriggerDevice> &devices);
+
+    // Time base shared with the capture; must be safe to read from another thread (the system clock is)
+    void setClock(const Clock *clock) { this->clock = clock; }
+
+    // Open every port (all or none) on the group's thread
+    bool open(const QVector<TriggerDevice> &devices, QString *errorString = nullptr);
+    void close();
+    bool isOpen() const { return opened; }
+    int deviceCount() const { return opened ? configured.size() : 0; }
+
+    // Fire every output at triggerNs on the clock; returns immediately
+    void fire(qint64 triggerNs);
+
+    // How long after fire() is called the trigger time should be, so all devices can be aligned
+    qint64 alignmentNs() const { return LeadNs + qint64(maxOffsetMs * 1e6); }
+
+    // Time to pass to fire() for triggers as soon as all devices can be aligned
+    qint64 earliestTriggerNs() const { return clock->nowNs() + alignmentNs(); }
+
+    // Latest a device write completed since the last call, against its target
+    qint64 takeWorstLatenessNs();
+
+    // Fires, skew and lateness for the statistics panel; clears the histograms when reset is true
+    QString report(bool reset);
+
+signals:
+    // A port failed; the group has closed itself
+    void failed(const QString &reason);
+
+private:
+    // Runs on the group's thread
+    bool openPorts(QString *errorString);
+    void closePorts();
+    void firePorts(qint64 triggerNs);
+    void waitUntil(qint64 ns) const;
+
+    const Clock *clock;
+    QThread thread;
+    QObject *worker;                    // Lives on the thread; owns the ports
+    QVector<TriggerDevice> configured;  // In the order the commands are written (largest offset first)
+    QVector<QSerialPort *> ports;
+    double maxOffsetMs;
+    bool opened;
+
+    // Shared with the GUI thread
+    mutable QMutex statsMutex;
+    quint64 fires;
+    quint64 lateFires;                  // Requested too late to write every device on time
+    LatencyHistogram skew;
+    LatencyHistogram lateness;
+    qint64 worstLateness;               // Since takeWorstLatenessNs()
+};
+
+#endif // TRIGGERGROUP_H
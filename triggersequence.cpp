@@ -0,0 +1,238 @@
+// Include necessary headers
+#include "triggersequence.h"
+#include "derivedchannels.h"            // For the variable layout shared with alarm rules
+#include <QHash>                        // For resolving labels
+
+// TriggerSequence constructor
+TriggerSequence::TriggerSequence()
+    : running(false)
+    , current(0)
+    , dueNs(0)
+    , maxLateness(0)
+    , sent(0)
+{
+}
+
+// Decode the escapes allowed in a send command
+bool TriggerSequence::unescape(const QString &text, QByteArray &command)
+{
+    QByteArray source = text.toUtf8();
+    command.clear();
+    for (int i = 0; i < source.size(); ++i) {
+        char c = source[i];
+        if (c != '\\') {
+            command += c;
+            continue;
+        }
+        if (++i >= source.size()) return false;
+        switch (source[i]) {
+        case 'n':  command += '\n'; break;
+        case 'r':  command += '\r'; break;
+        case '\\': command += '\\'; break;
+        case 'x': {
+            bool ok;
+            int value = source.mid(i + 1, 2).toInt(&ok, 16);
+            if (!ok || i + 2 >= source.size()) return false;
+            command += char(value);
+            i += 2;
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return !command.isEmpty();
+}
+
+// Undo unescape() for display
+QString TriggerSequence::escape(const QByteArray &command)
+{
+    QString text;
+    for (char c : command) {
+        if (c == '\n') text += "\\n";
+        else if (c == '\r') text += "\\r";
+        else if (c == '\\') text += "\\\\";
+        else if (uchar(c) < 0x20 || uchar(c) >= 0x7f) text += QString("\\x%1").arg(uchar(c), 2, 16, QChar('0'));
+        else text += QLatin1Char(c);
+    }
+    return text;
+}
+
+// Parse and compile a sequence
+bool TriggerSequence::compile(const QString &source, const QStringList &derivedNames, QString *errorString)
+{
+    QVector<Step> compiled;
+    QVector<ChannelExpression> compiledConditions;
+    QHash<QString, int> labels;         // Label -> index of the step after it
+    QVector<QString> targets;           // Label each jumping step refers to
+    QStringList variables = DerivedChannels::variableNames() + derivedNames;
+
+    const QStringList lines = source.split("\n");
+    for (int i = 0; i < lines.size(); ++i) {
+        QString line = lines[i];
+        int comment = line.indexOf('#');
+        if (comment >= 0) line = line.left(comment);
+        line = line.trimmed();
+        if (line.isEmpty()) continue;
+
+        auto fail = [&](const QString &message) {
+            if (errorString) *errorString = QString("Line %1: %2").arg(i + 1).arg(message);
+            return false;
+        };
+
+        // A label names the next step
+        if (line.endsWith(':')) {
+            QString label = line.left(line.size() - 1).trimmed();
+            if (label.isEmpty() || label.contains(' ')) return fail("invalid label");
+            if (labels.contains(label)) return fail("label '" + label + "' is defined twice");
+            labels.insert(label, compiled.size());
+            continue;
+        }
+
+        int space = line.indexOf(' ');
+        QString keyword = space < 0 ? line : line.left(space);
+        QString argument = space < 0 ? QString() : line.mid(space + 1).trimmed();
+        QStringList words = argument.simplified().split(" ");
+
+        Step step;
+        step.line = i + 1;
+        QString target;
+        bool ok = true;
+
+        if (keyword == "send") {
+            step.op = OpSend;
+            if (!unescape(argument, step.command)) return fail("invalid command '" + argument + "'");
+        } else if (keyword == "wait") {
+            step.op = OpWait;
+            double ms = argument.toDouble(&ok);
+            if (!ok || ms < 0) return fail("invalid wait '" + argument + "'");
+            step.waitNs = qint64(ms * 1e6);
+        } else if (keyword == "repeat") {
+            step.op = OpRepeat;
+            if (words.size() == 2) step.times = words[1].toInt(&ok);
+            if (words.size() != 2 || !ok || step.times < 0) return fail("expected 'repeat <label> <times>'");
+            target = words[0];
+        } else if (keyword == "if") {
+            step.op = OpBranch;
+            int gotoAt = argument.lastIndexOf(" goto ");
+            if (gotoAt < 0) return fail("expected 'if <condition> goto <label>'");
+            target = argument.mid(gotoAt + 6).trimmed();
+            ChannelExpression condition;
+            QString error;
+            if (!condition.compile(argument.left(gotoAt).trimmed(), variables, &error)) return fail(error);
+            step.condition = compiledConditions.size();
+            compiledConditions.append(condition);
+        } else if (keyword == "goto") {
+            step.op = OpJump;
+            if (words.size() != 1 || words[0].isEmpty()) return fail("expected 'goto <label>'");
+            target = words[0];
+        } else if (keyword == "stop" && argument.isEmpty()) {
+            step.op = OpStop;
+        } else {
+            return fail("unknown step '" + keyword + "'");
+        }
+
+        compiled.append(step);
+        targets.append(target);
+    }
+
+    // Resolve the labels now that all of them are known
+    for (int index = 0; index < compiled.size(); ++index) {
+        if (targets[index].isEmpty()) continue;
+        if (!labels.contains(targets[index])) {
+            if (errorString) *errorString = QString("Line %1: unknown label '%2'")
+                                                .arg(compiled[index].line).arg(targets[index]);
+            return false;
+        }
+        compiled[index].target = labels.value(targets[index]);
+    }
+
+    // Falling off the end stops the sequence
+    Step end;
+    end.op = OpStop;
+    compiled.append(end);
+
+    text = source;
+    steps = compiled;
+    conditions = compiledConditions;
+    running = false;
+    return true;
+}
+
+// Start from the first step, due now
+void TriggerSequence::start(qint64 nowNs)
+{
+    running = isValid();
+    current = 0;
+    dueNs = nowNs;
+    remaining.fill(-1, steps.size());
+    error.clear();
+    maxLateness = 0;
+    sent = 0;
+}
+
+// Run the steps that are due
+bool TriggerSequence::advance(qint64 nowNs, const SensorFrame &latest, QVector<QByteArray> &commands)
+{
+    commands.clear();
+    if (!running) return false;
+
+    double variables[DerivedChannels::MaxVariables];
+    bool variablesLoaded = false;
+    int stepsRun = 0;
+
+    while (dueNs <= nowNs) {
+        if (++stepsRun > MaxStepsWithoutWait) {
+            error = QString("Line %1: the sequence loops without waiting").arg(steps[current].line);
+            running = false;
+            return false;
+        }
+
+        const Step &step = steps[current];
+        switch (step.op) {
+        case OpSend:
+            maxLateness = qMax(maxLateness, nowNs - dueNs);
+            commands.append(step.command);
+            sent++;
+            current++;
+            break;
+
+        case OpWait:
+            dueNs += step.waitNs;       // From when this step was due, not from now
+            if (step.waitNs > 0) stepsRun = 0;
+            current++;
+            break;
+
+        case OpRepeat: {
+            // The counter starts when the repeat is first reached and is rearmed once it runs out
+            int &left = remaining[current];
+            if (left < 0) left = step.times;
+            if (left > 0) {
+                left--;
+                current = step.target;
+            } else {
+                left = -1;
+                current++;
+            }
+            break;
+        }
+
+        case OpBranch:
+            if (!variablesLoaded) {
+                DerivedChannels::loadVariables(latest, variables);
+                variablesLoaded = true;
+            }
+            current = conditions[step.condition].evaluate(variables) != 0 ? step.target : current + 1;
+            break;
+
+        case OpJump:
+            current = step.target;
+            break;
+
+        case OpStop:
+            running = false;
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,81 @@
+#ifndef TRIGGERSEQUENCE_H
+#define TRIGGERSEQUENCE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "sensorframe.h"
+#include "channelexpression.h"
+
+// A trigger protocol for the Pico, written one step per line ('#' starts a comment):
+//
+//   name:                       label that steps can jump to
+//   send <command>              send the command to the Pico (\n, \r, \\ and \xHH escapes)
+//   wait <ms>                   dwell before the next step
+//   repeat <label> <times>      jump back to the label, <times> more times
+//   if <condition> goto <label> branch on the latest frame (same values as alarm rules)
+//   goto <label>
+//   stop                        end the sequence (also at the end of the text)
+//
+// Waits are added to the time the previous step was due rather than to the time
+// it actually ran, so a late step never shifts the rest of the protocol.
+class TriggerSequence
+{
+public:
+    // Steps run in a row without a wait before a loop is taken to be missing one
+    static const int MaxStepsWithoutWait = 10000;
+
+    TriggerSequence();
+
+    // Parse and compile; conditions may use the built-ins and the given derived channels
+    bool compile(const QString &text, const QStringList &derivedNames, QString *errorString = nullptr);
+    bool isValid() const { return !steps.isEmpty(); }
+    QString source() const { return text; }
+
+    void start(qint64 nowNs);
+    void stop() { running = false; }
+    bool isRunning() const { return running; }
+
+    // When the next step is due (only meaningful while running)
+    qint64 nextDueNs() const { return dueNs; }
+
+    // Run every step due by nowNs; the commands to send are put in commands.
+    // Returns false if the sequence ended (normally or with an error).
+    bool advance(qint64 nowNs, const SensorFrame &latest, QVector<QByteArray> &commands);
+
+    QString errorString() const { return error; }
+    qint64 maxLatenessNs() const { return maxLateness; }
+    quint64 commandsSent() const { return sent; }
+
+    // A command written the way send takes it, for logs, and back
+    static QString escape(const QByteArray &command);
+    static bool unescape(const QString &text, QByteArray &command);
+
+private:
+    enum Op { OpSend, OpWait, OpRepeat, OpBranch, OpJump, OpStop };
+
+    struct Step {
+        Op op = OpStop;
+        QByteArray command;             // OpSend
+        qint64 waitNs = 0;              // OpWait
+        int target = 0;                 // OpRepeat, OpBranch and OpJump
+        int times = 0;                  // OpRepeat
+        int condition = -1;             // OpBranch: index into conditions
+        int line = 0;                   // Source line, for error messages
+    };
+
+    QString text;
+    QVector<Step> steps;
+    QVector<ChannelExpression> conditions;
+
+    bool running;
+    int current;                        // Next step to run
+    qint64 dueNs;                       // When it is due
+    QVector<int> remaining;             // Repeats left per step, -1 when not counting
+    QString error;
+    qint64 maxLateness;
+    quint64 sent;
+};
+
+#endif // TRIGGERSEQUENCE_H